@@ -0,0 +1,76 @@
+/**
+ * @file /check/magma/core/bench_check.c
+ *
+ * @brief The timing harness shared by the multi-threaded allocator benchmarks.
+ */
+
+#include "magma_check.h"
+
+/// The number of threads used by each benchmark pass.
+static uint64_t check_bench_threads[CHECK_BENCH_PASSES] = { 1, 8, 32 };
+
+/**
+ * @brief	Time a benchmark thread function using 1, 8 and 32 concurrent threads.
+ * @note	The thread function is passed the data pointer, and should increment the failure counter atomically when it finds a problem.
+ * 			The counter is reset before every pass, and the remaining passes are skipped once a pass fails.
+ * @param	name		a description of the benchmark, which is used in the error message.
+ * @param	function	the function run by every benchmark thread.
+ * @param	data		an arbitrary pointer passed to every benchmark thread.
+ * @param	failed		a pointer to the failure counter used by the thread function.
+ * @param	elapsed		an array which receives the number of nanoseconds each pass took.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_bench_mthread(chr_t *name, void *function, void *data, uint64_t *failed, uint64_t elapsed[CHECK_BENCH_PASSES]) {
+
+	uint64_t threads;
+	struct timespec start, end;
+	pthread_t workers[CHECK_BENCH_THREADS_MAX];
+
+	for (uint64_t pass = 0; pass < CHECK_BENCH_PASSES; pass++) {
+
+		__atomic_store_n(failed, 0, __ATOMIC_RELAXED);
+		threads = check_bench_threads[pass];
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (uint64_t i = 0; i < check_bench_threads[pass]; i++) {
+			if (thread_launch(workers + i, function, data)) {
+				__atomic_add_fetch(failed, 1, __ATOMIC_RELAXED);
+				threads = i;
+				break;
+			}
+		}
+
+		for (uint64_t i = 0; i < threads; i++) {
+			thread_join(workers[i]);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed[pass] = ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+		if (__atomic_load_n(failed, __ATOMIC_RELAXED)) {
+			return st_aprint("The %s benchmark failed. { threads = %lu / failures = %lu }", name, check_bench_threads[pass],
+				__atomic_load_n(failed, __ATOMIC_RELAXED));
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Print the throughput of each benchmark pass.
+ * @param	label		the label printed in front of each pass.
+ * @param	operations	the number of operations performed by each thread.
+ * @param	elapsed		the number of nanoseconds each pass took.
+ * @return	This function returns no value.
+ */
+void check_bench_report(chr_t *label, uint64_t operations, uint64_t elapsed[CHECK_BENCH_PASSES]) {
+
+	for (uint64_t pass = 0; pass < CHECK_BENCH_PASSES; pass++) {
+		log_unit("%-32.32s %-12.12s %2lu threads %14.0f pairs/s %10.1f ns/pair\n", "", label, check_bench_threads[pass],
+			(double)(operations * check_bench_threads[pass]) / ((double)(elapsed[pass] ? elapsed[pass] : 1) / 1000000000.0),
+			(double)elapsed[pass] / (double)(operations * check_bench_threads[pass]));
+	}
+
+	return;
+}
@@ -816,6 +816,65 @@ START_TEST (check_secmem) {
 }
 END_TEST
 
+START_TEST (check_secmem_double_free_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_secure_double_free_sthread();
+	}
+
+	log_test("CORE / MEMORY / SECURE DOUBLE FREE / SINGLE THREADED:", !errmsg && !magma_core.secure.memory.enable ? NULLER("SKIPPED") : errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_secmem_bench_m) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+	uint64_t elapsed[2][CHECK_BENCH_PASSES] = { { 0, 0, 0 }, { 0, 0, 0 } };
+
+	if (status()) {
+		errmsg = check_secure_bench_mthread(elapsed);
+	}
+
+	log_test("CORE / MEMORY / SECURE BENCHMARK / MULTI THREADED:", !errmsg && !magma_core.secure.memory.enable ? NULLER("SKIPPED") : errmsg);
+
+	// Print the throughput of the first fit, and size class, allocators for each thread count.
+	if (!errmsg && status() && magma_core.secure.memory.enable) {
+		check_secure_bench_report(elapsed);
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_slab_bench_m) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+	uint64_t elapsed[CHECK_BENCH_PASSES] = { 0, 0, 0 };
+
+	if (status()) {
+		errmsg = check_slab_bench_mthread(elapsed);
+	}
+
+	log_test("CORE / MEMORY / SLAB BENCHMARK / MULTI THREADED:", errmsg);
+
+	// Print the throughput for each thread count.
+	if (!errmsg && status()) {
+		check_slab_bench_report(elapsed);
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
 START_TEST (check_signames_s) {
 
 	log_disable();
@@ -950,6 +1009,9 @@ Suite * suite_check_core(void) {
 
 	suite_check_testcase(s, "CORE", "Memory / Checksum", check_checksum);
 	suite_check_testcase(s, "CORE", "Memory / Secure Address Range", check_secmem);
+	suite_check_testcase(s, "CORE", "Memory / Secure Double Free/S", check_secmem_double_free_s);
+	suite_check_testcase(s, "CORE", "Memory / Secure Benchmark/M", check_secmem_bench_m);
+	suite_check_testcase(s, "CORE", "Memory / Slab Benchmark/M", check_slab_bench_m);
 
 	suite_check_testcase(s, "CORE", "Host / System / Signal Names", check_signames_s);
 	suite_check_testcase(s, "CORE", "Host / System / Error Names", check_errnames_s);
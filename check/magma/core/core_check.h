@@ -212,6 +212,10 @@ struct check_mi_t {
 
 extern stringer_t *string_check_constant;
 
+// The number of passes made by the multi-threaded benchmarks, and the thread count used by the largest pass.
+#define CHECK_BENCH_PASSES 3
+#define CHECK_BENCH_THREADS_MAX 32
+
 /// clamp_check.c
 chr_t * check_clamp_max(void);
 chr_t * check_clamp_min(void);
@@ -296,11 +300,24 @@ bool_t   check_bitwise_parameters(void);
 bool_t   check_bitwise_determinism(void);
 bool_t   check_bitwise_simple(void);
 
+/// bench_check.c
+stringer_t *  check_bench_mthread(chr_t *name, void *function, void *data, uint64_t *failed, uint64_t elapsed[CHECK_BENCH_PASSES]);
+void          check_bench_report(chr_t *label, uint64_t operations, uint64_t elapsed[CHECK_BENCH_PASSES]);
+
 /// checksum_check.c
 bool_t check_checksum_fuzz_sthread(void);
 bool_t check_checksum_fixed_sthread(void);
 bool_t check_checksum_loop_sthread(void);
 
+/// secure_check.c
+void          check_secure_bench_report(uint64_t elapsed[2][CHECK_BENCH_PASSES]);
+stringer_t *  check_secure_bench_mthread(uint64_t elapsed[2][CHECK_BENCH_PASSES]);
+stringer_t *  check_secure_double_free_sthread(void);
+
+/// slab_check.c
+void          check_slab_bench_report(uint64_t elapsed[CHECK_BENCH_PASSES]);
+stringer_t *  check_slab_bench_mthread(uint64_t elapsed[CHECK_BENCH_PASSES]);
+
 /// address_check.c
 void check_address_octet_s (int _i CK_ATTRIBUTE_UNUSED);
 void check_address_presentation_s (int _i CK_ATTRIBUTE_UNUSED);
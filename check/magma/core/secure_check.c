@@ -0,0 +1,270 @@
+/**
+ * @file /check/magma/core/secure_check.c
+ *
+ * @brief Checks and benchmarks for the secure memory allocator.
+ */
+
+#include "magma_check.h"
+
+/// The allocator exercised by a benchmark pass.
+typedef struct {
+	chr_t *name;
+	void * (*alloc)(size_t len);
+	void (*free)(void *block);
+} check_secure_allocator_t;
+
+/// The boundary tag used by the first fit allocator the size class allocator replaced.
+typedef struct __attribute__ ((packed)) {
+	uint32_t flags;
+	size_t length;
+} check_secured_t;
+
+/// The pool used by the first fit allocator, which is the same length as the secure memory slab, but isn't locked into memory.
+struct {
+	uchr_t *data;
+	size_t length;
+	pthread_mutex_t lock;
+} check_secure_legacy = {
+		.data = NULL,
+		.length = 0,
+		.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/// The number of problems found by the benchmark threads.
+static uint64_t check_secure_bench_failed = 0;
+
+/**
+ * @brief	Determine whether a pointer falls inside the first fit allocator pool.
+ * @param	block	the pointer.
+ * @return	true if the pointer is inside the pool, otherwise false.
+ */
+static bool_t check_secure_legacy_secured(void *block) {
+	return (uchr_t *)block >= check_secure_legacy.data && (uchr_t *)block < check_secure_legacy.data + check_secure_legacy.length;
+}
+
+/**
+ * @brief	Get the chunk which follows a chunk in the first fit allocator pool.
+ * @param	chunk	the chunk.
+ * @return	NULL if the end of the pool is reached, or a pointer to the next chunk.
+ */
+static check_secured_t * check_secure_legacy_next(check_secured_t *chunk) {
+
+	check_secured_t *next = (check_secured_t *)((chr_t *)chunk + sizeof(check_secured_t) + chunk->length);
+
+	return check_secure_legacy_secured(next) ? next : NULL;
+}
+
+/**
+ * @brief	Get the chunk in front of a chunk, by walking the first fit allocator pool from the start, the way every free used to.
+ * @param	chunk	the chunk.
+ * @return	NULL if the chunk is the first, or a pointer to the previous chunk.
+ */
+static check_secured_t * check_secure_legacy_prev(check_secured_t *chunk) {
+
+	check_secured_t *prev, *next;
+
+	if (chunk == (check_secured_t *)check_secure_legacy.data) {
+		return NULL;
+	}
+
+	prev = (check_secured_t *)check_secure_legacy.data;
+	while ((next = check_secure_legacy_next(prev)) && next != chunk) prev = next;
+
+	return prev;
+}
+
+/**
+ * @brief	Merge a chunk with its available neighbors.
+ * @param	chunk	the chunk.
+ * @return	This function returns no value.
+ */
+static void check_secure_legacy_merge(check_secured_t *chunk) {
+
+	check_secured_t *prev = check_secure_legacy_prev(chunk), *next = check_secure_legacy_next(chunk);
+
+	if (prev && !(prev->flags & 1)) {
+		prev->length += sizeof(check_secured_t) + chunk->length;
+		chunk = prev;
+	}
+
+	if (next && !(next->flags & 1)) {
+		chunk->length += sizeof(check_secured_t) + next->length;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate a block from the first fit allocator, using the walk, split and wipe the secure allocator used before size classes.
+ * @param	len		the length of the block.
+ * @return	NULL on failure, or a pointer to the wiped block.
+ */
+static void * check_secure_legacy_alloc(size_t len) {
+
+	check_secured_t *chunk, *split;
+
+	len = align(16, len);
+
+	mutex_lock(&check_secure_legacy.lock);
+
+	for (chunk = (check_secured_t *)check_secure_legacy.data; chunk && ((chunk->flags & 1) || chunk->length < len);
+		chunk = check_secure_legacy_next(chunk));
+
+	if (chunk) {
+
+		chunk->flags |= 1;
+
+		if ((chunk->length - len) > sizeof(check_secured_t)) {
+			split = (check_secured_t *)((chr_t *)chunk + sizeof(check_secured_t) + len);
+			split->length = chunk->length - len - sizeof(check_secured_t);
+			split->flags = 0;
+			chunk->length = len;
+			check_secure_legacy_merge(split);
+		}
+	}
+
+	mutex_unlock(&check_secure_legacy.lock);
+
+	return chunk ? mm_wipe((chr_t *)chunk + sizeof(check_secured_t), len) : NULL;
+}
+
+/**
+ * @brief	Wipe a block three times, and return it to the first fit allocator.
+ * @param	block	the block.
+ * @return	This function returns no value.
+ */
+static void check_secure_legacy_free(void *block) {
+
+	check_secured_t *chunk = (check_secured_t *)((chr_t *)block - sizeof(check_secured_t));
+
+	mm_set(block, 255, chunk->length);
+	mm_set(block, 128, chunk->length);
+	mm_set(block, 0, chunk->length);
+
+	mutex_lock(&check_secure_legacy.lock);
+	chunk->flags &= ~1;
+	check_secure_legacy_merge(chunk);
+	mutex_unlock(&check_secure_legacy.lock);
+
+	return;
+}
+
+/**
+ * @brief	Allocate and free a series of small blocks, making sure every block arrives wiped, and survives until it's freed.
+ * @param	allocator	the allocator being exercised.
+ * @return	This function returns no value.
+ */
+static void check_secure_bench_thread(check_secure_allocator_t *allocator) {
+
+	size_t len;
+	uchr_t *block;
+	unsigned int seed = (unsigned int)(uintptr_t)pthread_self();
+
+	for (uint64_t i = 0; i < SECURE_CHECK_PAIRS && !__atomic_load_n(&check_secure_bench_failed, __ATOMIC_RELAXED); i++) {
+
+		len = 1 + (rand_r(&seed) % 255);
+
+		if (!(block = allocator->alloc(len))) {
+			__atomic_add_fetch(&check_secure_bench_failed, 1, __ATOMIC_RELAXED);
+			break;
+		}
+
+		for (size_t j = 0; j < len; j++) {
+			if (block[j]) {
+				__atomic_add_fetch(&check_secure_bench_failed, 1, __ATOMIC_RELAXED);
+				break;
+			}
+		}
+
+		mm_set(block, (uint8_t)i, len);
+
+		if (block[0] != (uchr_t)i || block[len - 1] != (uchr_t)i) {
+			__atomic_add_fetch(&check_secure_bench_failed, 1, __ATOMIC_RELAXED);
+		}
+
+		allocator->free(block);
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Time a fixed number of allocation and free pairs using 1, 8 and 32 threads, first with the first fit allocator the size class
+ * 			allocator replaced, and then with the secure memory allocator.
+ * @param	elapsed		an array which receives the number of nanoseconds each pass took, for the first fit, and then the current, allocator.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_secure_bench_mthread(uint64_t elapsed[2][CHECK_BENCH_PASSES]) {
+
+	stringer_t *errmsg = NULL;
+	check_secure_allocator_t allocators[] = {
+		{ .name = "first fit", .alloc = &check_secure_legacy_alloc, .free = &check_secure_legacy_free },
+		{ .name = "size classes", .alloc = &mm_sec_alloc, .free = &mm_sec_free }
+	};
+
+	if (!magma_core.secure.memory.enable) {
+		return NULL;
+	}
+
+	// The first fit pool starts out as a single available chunk covering the whole pool.
+	else if (!(check_secure_legacy.data = mm_alloc(check_secure_legacy.length = magma_core.secure.memory.length))) {
+		return st_aprint("Unable to allocate the first fit allocator pool.");
+	}
+
+	((check_secured_t *)check_secure_legacy.data)->length = check_secure_legacy.length - sizeof(check_secured_t);
+
+	for (uint64_t allocator = 0; !errmsg && allocator < 2; allocator++) {
+		errmsg = check_bench_mthread(allocators[allocator].name, &check_secure_bench_thread, allocators + allocator,
+			&check_secure_bench_failed, elapsed[allocator]);
+	}
+
+	mm_free(check_secure_legacy.data);
+	check_secure_legacy.data = NULL;
+
+	return errmsg;
+}
+
+/**
+ * @brief	Print the throughput of each benchmark pass.
+ * @param	elapsed		the number of nanoseconds each pass took, for the first fit, and then the current, allocator.
+ * @return	This function returns no value.
+ */
+void check_secure_bench_report(uint64_t elapsed[2][CHECK_BENCH_PASSES]) {
+	check_bench_report("first fit", SECURE_CHECK_PAIRS, elapsed[0]);
+	check_bench_report("size classes", SECURE_CHECK_PAIRS, elapsed[1]);
+	return;
+}
+
+/**
+ * @brief	Free a small secure block twice, and make sure the second free is rejected, instead of letting the block be handed out twice.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_secure_double_free_sthread(void) {
+
+	void *block, *first, *second;
+
+	if (!magma_core.secure.memory.enable) {
+		return NULL;
+	}
+	else if (!(block = mm_sec_alloc(64))) {
+		return st_aprint("Unable to allocate a secure memory block.");
+	}
+
+	// The first free places the block in the thread cache, so the second free has to be caught before it's cached again.
+	mm_sec_free(block);
+	mm_sec_free(block);
+
+	first = mm_sec_alloc(64);
+	second = mm_sec_alloc(64);
+
+	mm_sec_cleanup(first);
+
+	if (first && first == second) {
+		return st_aprint("A secure memory block freed twice was handed out twice. { block = %p }", block);
+	}
+
+	mm_sec_cleanup(second);
+
+	return NULL;
+}
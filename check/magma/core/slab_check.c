@@ -0,0 +1,95 @@
+/**
+ * @file /check/magma/core/slab_check.c
+ *
+ * @brief Checks and benchmarks for the slab caches.
+ */
+
+#include "magma_check.h"
+
+typedef struct {
+	uint64_t owner; /* The thread which holds the object, which is checked before the object is returned. */
+	uint64_t pattern[7];
+} check_slab_object_t;
+
+/// The cache exercised by the checks, and the number of problems found by the benchmark threads.
+static slab_t check_slab_cache = SLAB_CACHE("check.objects", sizeof(check_slab_object_t));
+static uint64_t check_slab_bench_failed = 0;
+
+/**
+ * @brief	Get and put a series of objects, while holding a random window of them, making sure every object arrives zeroed, and nothing
+ * 			overwrites an object while it's held.
+ * @param	data	this parameter is unused.
+ * @return	This function returns no value.
+ */
+static void check_slab_bench_thread(void *data) {
+
+	uint64_t self, slot;
+	check_slab_object_t *held[SLAB_CHECK_WINDOW];
+	unsigned int seed = (unsigned int)(uintptr_t)pthread_self();
+
+	mm_wipe(held, sizeof(held));
+	self = (uint64_t)(uintptr_t)pthread_self();
+
+	for (uint64_t i = 0; i < SLAB_CHECK_PAIRS && !__atomic_load_n(&check_slab_bench_failed, __ATOMIC_RELAXED); i++) {
+
+		slot = rand_r(&seed) % SLAB_CHECK_WINDOW;
+
+		if (held[slot]) {
+
+			if (held[slot]->owner != self || held[slot]->pattern[6] != slot) {
+				__atomic_add_fetch(&check_slab_bench_failed, 1, __ATOMIC_RELAXED);
+			}
+
+			slab_put(&check_slab_cache, held[slot]);
+			held[slot] = NULL;
+		}
+
+		if (!(held[slot] = slab_get(&check_slab_cache)) || held[slot]->owner || held[slot]->pattern[6]) {
+			__atomic_add_fetch(&check_slab_bench_failed, 1, __ATOMIC_RELAXED);
+			break;
+		}
+
+		held[slot]->owner = self;
+		held[slot]->pattern[6] = slot;
+	}
+
+	for (uint64_t i = 0; i < SLAB_CHECK_WINDOW; i++) {
+		slab_put(&check_slab_cache, held[i]);
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Time a fixed number of slab cache get and put pairs using 1, 8 and 32 threads, and make sure the cache reports every object as
+ * 			returned once the threads have exited.
+ * @param	elapsed		an array which receives the number of nanoseconds each pass took.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_slab_bench_mthread(uint64_t elapsed[CHECK_BENCH_PASSES]) {
+
+	stringer_t *errmsg;
+	uint64_t objects, bytes;
+
+	if ((errmsg = check_bench_mthread("slab cache", &check_slab_bench_thread, NULL, &check_slab_bench_failed, elapsed))) {
+		return errmsg;
+	}
+
+	// The magazines of the exited threads have been returned, so the cache should be holding only its reserve of empty slabs.
+	else if (!slab_stats(&check_slab_cache, &objects, &bytes) || objects || bytes > MM_SLAB_IDLE * MM_SLAB_LENGTH) {
+		return st_aprint("The slab cache statistics didn't reflect the returned objects. { objects = %lu / bytes = %lu }", objects, bytes);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Print the throughput of each benchmark pass.
+ * @param	elapsed		the number of nanoseconds each pass took.
+ * @return	This function returns no value.
+ */
+void check_slab_bench_report(uint64_t elapsed[CHECK_BENCH_PASSES]) {
+	check_bench_report("slab cache", SLAB_CHECK_PAIRS, elapsed);
+	return;
+}
@@ -29,11 +29,280 @@ START_TEST (check_engine_context_system_s) {
 }
 END_TEST
 
+START_TEST (check_engine_queue_deque_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_queue_deque_sthread();
+	}
+
+	log_test("ENGINE / QUEUE / DEQUE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_wait_s) {
+
+	log_disable();
+	uint64_t p99 = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_queue_wait_sthread(&p99);
+	}
+
+	log_test("ENGINE / QUEUE / WAIT / SINGLE THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %10lu microseconds p99 wait / %lu queued\n", "", p99, queue_depth());
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_handshake_s) {
+
+	log_disable();
+	uint64_t p50 = 0, p99 = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_queue_handshake_sthread(&p50, &p99);
+	}
+
+	log_test("ENGINE / QUEUE / HANDSHAKES / SINGLE THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %10lu microseconds p50 / %lu microseconds p99\n", "", p50, p99);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_priority_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+	uint64_t interactive = 0, background = 0, overlap = 0;
+
+	if (status()) {
+		errmsg = check_queue_priority_sthread(&interactive, &background, &overlap);
+	}
+
+	log_test("ENGINE / QUEUE / PRIORITY / SINGLE THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %10lu interactive / %lu background average position / %lu background overlapped\n", "", interactive,
+		background, overlap);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_starve_s) {
+
+	log_disable();
+	uint64_t steps = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_queue_starve_sthread(&steps);
+	}
+
+	log_test("ENGINE / QUEUE / STARVATION / SINGLE THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %10lu requeues before the older job ran\n", "", steps);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_bench_m) {
+
+	log_disable();
+	uint64_t elapsed = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_queue_bench_mthread(&elapsed);
+	}
+
+	log_test("ENGINE / QUEUE / BENCHMARK / MULTI THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %2u workers %14.0f jobs/s\n", "", magma.system.worker_threads,
+		(double)QUEUE_CHECK_JOBS / ((double)(elapsed ? elapsed : 1) / 1000000000.0));
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_queue_sweep_m) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+	uint64_t legacy[64], stealing[64];
+
+	mm_wipe(legacy, sizeof(legacy));
+	mm_wipe(stealing, sizeof(stealing));
+
+	if (status()) {
+		errmsg = check_queue_sweep_mthread(legacy, stealing);
+	}
+
+	log_test("ENGINE / QUEUE / SWEEP / MULTI THREADED:", errmsg);
+
+	// Print the throughput of each queue design, for each thread count.
+	for (uint64_t threads = 1, pass = 0; !errmsg && status() && threads <= QUEUE_CHECK_MTHREADS; threads *= 2, pass++) {
+		log_unit("%-32.32s %2lu threads %14.0f legacy jobs/s %14.0f stealing jobs/s\n", "", threads,
+			(double)QUEUE_CHECK_JOBS / ((double)(legacy[pass] ? legacy[pass] : 1) / 1000000000.0),
+			(double)QUEUE_CHECK_JOBS / ((double)(stealing[pass] ? stealing[pass] : 1) / 1000000000.0));
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_timers_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_timers_sthread();
+	}
+
+	log_test("ENGINE / TIMERS / WHEEL / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_log_overflow_m) {
+
+	log_disable();
+	uint64_t dropped = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_log_overflow_mthread(&dropped);
+	}
+
+	log_test("ENGINE / LOG / OVERFLOW / MULTI THREADED:", errmsg);
+	if (!errmsg) log_unit("%-32.32s %2i threads %14lu messages dropped\n", "", LOG_CHECK_MTHREADS, dropped);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_stats_names_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_stats_names_sthread();
+	}
+
+	log_test("ENGINE / STATISTICS / NAMES / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_stats_counters_m) {
+
+	log_disable();
+	uint64_t elapsed = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_stats_counters_mthread(&elapsed);
+	}
+
+	log_test("ENGINE / STATISTICS / COUNTERS / MULTI THREADED:", errmsg);
+
+	if (!errmsg && status()) {
+		log_unit("%-32.32s %2i threads %14.0f updates/s\n", "", STATS_CHECK_MTHREADS,
+			(double)(STATS_CHECK_MTHREADS * STATS_CHECK_ITERATIONS * 3) / ((double)(elapsed ? elapsed : 1) / 1000000000.0));
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_stats_latency_s) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+	uint64_t p50 = 0, p999 = 0;
+
+	if (status()) {
+		errmsg = check_stats_latency_sthread(&p50, &p999);
+	}
+
+	log_test("ENGINE / STATISTICS / LATENCY / SINGLE THREADED:", errmsg);
+
+	if (!errmsg && status()) {
+		log_unit("%-32.32s %14.3f ms p50 %14.3f ms p999\n", "", (double)p50 / 1000000.0, (double)p999 / 1000000.0);
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_stats_recorder_s) {
+
+	log_disable();
+	uint64_t cost = 0;
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_stats_recorder_sthread(&cost);
+	}
+
+	log_test("ENGINE / STATISTICS / RECORDER / SINGLE THREADED:", errmsg);
+
+	if (!errmsg && status()) {
+		log_unit("%-32.32s %14lu ns per event\n", "", cost);
+	}
+
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
+START_TEST (check_engine_stats_recorder_m) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (status()) {
+		errmsg = check_stats_recorder_mthread();
+	}
+
+	log_test("ENGINE / STATISTICS / RECORDER / MULTI THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+	st_cleanup(errmsg);
+}
+END_TEST
+
 Suite * suite_check_engine(void) {
 
 	Suite *s = suite_create("\tEngine");
 
 	suite_check_testcase(s, "ENGINE", "Engine System Interfaces/S", check_engine_context_system_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Deque/S", check_engine_queue_deque_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Wait/S", check_engine_queue_wait_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Handshakes/S", check_engine_queue_handshake_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Priority/S", check_engine_queue_priority_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Starvation/S", check_engine_queue_starve_s);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Benchmark/M", check_engine_queue_bench_m);
+	suite_check_testcase(s, "ENGINE", "Engine Queue Sweep/M", check_engine_queue_sweep_m);
+	suite_check_testcase(s, "ENGINE", "Engine Timer Wheel/S", check_engine_timers_s);
+	suite_check_testcase(s, "ENGINE", "Engine Log Overflow/M", check_engine_log_overflow_m);
+	suite_check_testcase(s, "ENGINE", "Engine Statistics Names/S", check_engine_stats_names_s);
+	suite_check_testcase(s, "ENGINE", "Engine Statistics Counters/M", check_engine_stats_counters_m);
+	suite_check_testcase(s, "ENGINE", "Engine Statistics Latency/S", check_engine_stats_latency_s);
+	suite_check_testcase(s, "ENGINE", "Engine Statistics Recorder/S", check_engine_stats_recorder_s);
+	suite_check_testcase(s, "ENGINE", "Engine Statistics Recorder/M", check_engine_stats_recorder_m);
 
 	return s;
 }
@@ -8,6 +8,41 @@
 #ifndef ENGINE_CHECK_H
 #define ENGINE_CHECK_H
 
+/// queue_check.c
+void           check_queue_bench_job(uint64_t *sequence);
+stringer_t *   check_queue_bench_mthread(uint64_t *elapsed);
+void           check_queue_bench_requeue(uint64_t *sequence);
+stringer_t *   check_queue_deque_sthread(void);
+void           check_queue_handshake_finish(uint64_t *finished);
+void           check_queue_handshake_job(uint64_t *finished);
+stringer_t *   check_queue_handshake_sthread(uint64_t *p50, uint64_t *p99);
+void           check_queue_priority_job(void *data);
+stringer_t *   check_queue_priority_sthread(uint64_t *interactive, uint64_t *background, uint64_t *overlap);
+void           check_queue_starve_block(void *data);
+void           check_queue_starve_chain(void *data);
+void           check_queue_starve_old(void *data);
+stringer_t *   check_queue_starve_sthread(uint64_t *steps);
+stringer_t *   check_queue_sweep_mthread(uint64_t *legacy, uint64_t *stealing);
+bool_t         check_queue_sweep_run(uint64_t threads, bool_t stealing, uint64_t *elapsed);
+void           check_queue_wait_job(uint64_t *finished);
+stringer_t *   check_queue_wait_sthread(uint64_t *p99);
+
+/// log_check.c
+stringer_t *   check_log_overflow_mthread(uint64_t *dropped);
+void           check_log_thread(void);
+
+/// timers_check.c
+void           check_timers_fire(void *data);
+stringer_t *   check_timers_sthread(void);
+
+/// stats_check.c
+stringer_t *   check_stats_counters_mthread(uint64_t *elapsed);
+stringer_t *   check_stats_latency_sthread(uint64_t *p50, uint64_t *p999);
+stringer_t *   check_stats_recorder_mthread(void);
+stringer_t *   check_stats_recorder_sthread(uint64_t *cost);
+stringer_t *   check_stats_names_sthread(void);
+void           check_stats_thread(void);
+
 Suite * suite_check_engine(void);
 
 #endif
@@ -0,0 +1,156 @@
+/**
+ * @file /check/magma/engine/log_check.c
+ *
+ * @brief Checks for the log writer, and the per thread ring buffers it drains.
+ */
+
+#include "magma_check.h"
+
+extern pthread_mutex_t log_mutex;
+
+/**
+ * @brief	Log LOG_CHECK_MESSAGES lines, each of which is tagged, so it can be found in the output.
+ * @return	This function returns no value.
+ */
+void check_log_thread(void) {
+
+	for (uint64_t i = 0; i < LOG_CHECK_MESSAGES; i++) {
+		log_options(M_LOG_TIME_DISABLE | M_LOG_FILE_DISABLE | M_LOG_LINE_DISABLE | M_LOG_FUNCTION_DISABLE | M_LOG_STACK_TRACE_DISABLE,
+			"check.log.overflow %016lu", i);
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Count the tagged lines written by check_log_thread(), and look for the notice reporting dropped messages.
+ * @param	fd		the file holding the captured log output.
+ * @param	lines	a pointer to receive the number of tagged lines.
+ * @param	notice	a pointer to receive whether the dropped message notice was found.
+ * @return	true if the file was read, or false on failure.
+ */
+static bool_t check_log_count(int fd, uint64_t *lines, bool_t *notice) {
+
+	ssize_t bytes;
+	size_t carry = 0;
+	chr_t buffer[8192 + 128], *line, *end;
+
+	*lines = 0;
+	*notice = false;
+
+	if (lseek(fd, 0, SEEK_SET)) {
+		return false;
+	}
+
+	// Lines are counted as they're found, and whatever follows the last line feed is carried into the next read.
+	while ((bytes = read(fd, buffer + carry, sizeof(buffer) - carry - 1)) > 0) {
+
+		buffer[carry + bytes] = '\0';
+		line = buffer;
+
+		while ((end = strchr(line, '\n'))) {
+			if (!strncmp(line, "check.log.overflow ", 19)) (*lines)++;
+			else if (strstr(line, "log messages were dropped")) *notice = true;
+			line = end + 1;
+		}
+
+		if ((carry = buffer + carry + bytes - line) >= 128) {
+			carry = 0;
+		}
+		else {
+			mm_move(buffer, line, carry);
+		}
+	}
+
+	return bytes == 0;
+}
+
+/**
+ * @brief	Log from several threads while the writer is held up, so the ring buffers overflow, and verify that every message was either
+ * 			written by log_stop(), or counted as dropped.
+ * @note	The log output is redirected to a temporary file while the check runs, and the writer thread is relaunched afterward.
+ * @param	dropped	a pointer to receive the number of messages which were dropped.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_log_overflow_mthread(uint64_t *dropped) {
+
+	bool_t notice, block;
+	int fd = -1, saved = -1;
+	chr_t path[] = "/tmp/check.log.XXXXXX";
+	pthread_t threads[LOG_CHECK_MTHREADS];
+	uint64_t launched = 0, lines = 0, original, expected;
+
+	if (!log_launch()) {
+		return st_aprint("Unable to launch the log writer thread.");
+	}
+	else if ((fd = mkstemp(path)) < 0 || (saved = dup(STDOUT_FILENO)) < 0) {
+		if (fd >= 0) close(fd);
+		unlink(path);
+		return st_aprint("Unable to create a file to capture the log output.");
+	}
+
+	unlink(path);
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+
+	// Messages are only dropped when the caller isn't configured to wait for room in its ring buffer.
+	block = magma.log.block;
+	magma.log.block = false;
+	original = log_dropped();
+
+	// Holding the log mutex keeps the writer from draining the ring buffers, so every thread fills its own ring, and then starts dropping.
+	mutex_lock(&log_mutex);
+	log_enable();
+
+	for (; launched < LOG_CHECK_MTHREADS; launched++) {
+		if (thread_launch(&(threads[launched]), &check_log_thread, NULL)) {
+			break;
+		}
+	}
+
+	for (uint64_t i = 0; i < launched; i++) {
+		thread_join(threads[i]);
+	}
+
+	log_disable();
+	mutex_unlock(&log_mutex);
+
+	// Stopping the writer should flush everything that made it into the ring buffers, along with the notice reporting the drops.
+	log_stop();
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	magma.log.block = block;
+	*dropped = log_dropped() - original;
+	expected = launched * LOG_CHECK_MESSAGES;
+
+	if (!check_log_count(fd, &lines, &notice)) {
+		close(fd);
+		log_launch();
+		return st_aprint("Unable to read the captured log output.");
+	}
+
+	close(fd);
+
+	if (!log_launch()) {
+		return st_aprint("Unable to relaunch the log writer thread.");
+	}
+	else if (launched != LOG_CHECK_MTHREADS) {
+		return st_aprint("Unable to launch the log check threads.");
+	}
+	else if (!*dropped || !notice) {
+		return st_aprint("The overflowing ring buffers didn't drop, and report, any messages. { dropped = %lu }", *dropped);
+	}
+	else if (lines + *dropped != expected) {
+		return st_aprint("The messages written, and the messages dropped, didn't account for every message logged. { written = %lu / "
+			"dropped = %lu / expected = %lu }", lines, *dropped, expected);
+	}
+	else if (stats_get_value_by_name("log.dropped") != log_dropped()) {
+		return st_aprint("The log.dropped statistic didn't match the number of dropped messages. { statistic = %lu / dropped = %lu }",
+			stats_get_value_by_name("log.dropped"), log_dropped());
+	}
+
+	return NULL;
+}
@@ -0,0 +1,700 @@
+
+/**
+ * @file /check/magma/engine/queue_check.c
+ *
+ * @brief Checks and benchmarks for the worker queue, and the work stealing deque it's built upon.
+ */
+
+#include "magma_check.h"
+
+/// The state shared by the benchmark jobs, which is kept in static storage since the jobs may outlive a failed check.
+struct {
+	uint64_t spawned, executed, total;
+	uint64_t sequences[QUEUE_CHECK_DEPTH];
+} check_queue_bench;
+
+/// The state shared by the starvation check jobs, which is kept in static storage for the same reason.
+struct {
+	uint64_t blocked, released, steps, overtaken, finished;
+} check_queue_starve;
+
+/**
+ * @brief	Execute a benchmark job.
+ * @param	sequence	a pointer to the number of times the job has been executed.
+ * @return	This function returns no value.
+ */
+void check_queue_bench_job(uint64_t *sequence) {
+
+	(*sequence)++;
+	__atomic_add_fetch(&check_queue_bench.executed, 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Requeue a benchmark job, until the total number of jobs has been spawned.
+ * @note	This mirrors a protocol handler requeuing a connection once it finishes processing a command.
+ * @param	sequence	a pointer to the number of times the job has been executed.
+ * @return	This function returns no value.
+ */
+void check_queue_bench_requeue(uint64_t *sequence) {
+
+	if (__atomic_fetch_add(&check_queue_bench.spawned, 1, __ATOMIC_RELAXED) < check_queue_bench.total) {
+		requeue(&check_queue_bench_job, &check_queue_bench_requeue, sequence);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Time how long the worker pool takes to execute a fixed number of jobs, which keep requeueing themselves.
+ * @note	The benchmark only uses requeue(), and the worker threads started by queue_init(), so it measures the real enqueue, requeue
+ * 			and dequeue code, and builds unchanged against the single list queue which preceded the work stealing deques.
+ * @param	elapsed		a pointer to receive the number of nanoseconds it took to execute all of the jobs.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_bench_mthread(uint64_t *elapsed) {
+
+	struct timespec start, end;
+	uint64_t deadline = time(NULL) + 300;
+
+	mm_wipe(&check_queue_bench, sizeof(check_queue_bench));
+	check_queue_bench.total = QUEUE_CHECK_JOBS;
+	check_queue_bench.spawned = QUEUE_CHECK_DEPTH;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// Seed the queue with the initial set of jobs, each of which is requeued by the worker which executes it.
+	for (uint64_t i = 0; i < QUEUE_CHECK_DEPTH; i++) {
+		requeue(&check_queue_bench_job, &check_queue_bench_requeue, check_queue_bench.sequences + i);
+	}
+
+	while (__atomic_load_n(&check_queue_bench.executed, __ATOMIC_ACQUIRE) < QUEUE_CHECK_JOBS && time(NULL) < deadline && status()) {
+		usleep(100);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*elapsed = ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+	if (__atomic_load_n(&check_queue_bench.executed, __ATOMIC_ACQUIRE) != QUEUE_CHECK_JOBS) {
+		return st_aprint("The benchmark jobs never finished. { executed = %lu / total = %u }", check_queue_bench.executed, QUEUE_CHECK_JOBS);
+	}
+
+	return NULL;
+}
+
+typedef struct check_queue_sweep_job_t {
+	uint64_t sequence;
+	struct check_queue_sweep_job_t *next;
+} check_queue_sweep_job_t;
+
+/// The single list, single mutex design which the worker queue used before the switch to work stealing. Kept here as the sweep baseline.
+struct {
+	sem_t sema;
+	pthread_mutex_t lock;
+	check_queue_sweep_job_t *items;
+} check_queue_legacy;
+
+/// The state shared by the sweep threads, for both queue designs.
+struct {
+	sem_t sema;
+	deque_t **deques;
+	uint64_t threads, started, spawned, executed, total, finished;
+} check_queue_sweep;
+
+/**
+ * @brief	Append a job to the tail of the legacy queue, and wake a worker.
+ */
+static void check_queue_legacy_push(check_queue_sweep_job_t *job) {
+
+	check_queue_sweep_job_t *local;
+
+	mutex_lock(&check_queue_legacy.lock);
+
+	if ((local = check_queue_legacy.items)) {
+		while (local->next) local = local->next;
+		local->next = job;
+	}
+	else {
+		check_queue_legacy.items = job;
+	}
+
+	mutex_unlock(&check_queue_legacy.lock);
+	sem_post(&check_queue_legacy.sema);
+
+	return;
+}
+
+/**
+ * @brief	Wait for a job, and remove it from the head of the legacy queue.
+ */
+static check_queue_sweep_job_t * check_queue_legacy_pop(void) {
+
+	check_queue_sweep_job_t *job;
+
+	sem_wait(&check_queue_legacy.sema);
+	mutex_lock(&check_queue_legacy.lock);
+
+	if ((job = check_queue_legacy.items)) {
+		check_queue_legacy.items = job->next;
+	}
+
+	mutex_unlock(&check_queue_legacy.lock);
+
+	return job;
+}
+
+/**
+ * @brief	Execute a sweep job, and requeue it until the total number of jobs has been reached.
+ * @note	This mirrors a protocol handler requeuing a connection once it finishes processing a command.
+ * @return	NULL if the pass is complete, otherwise the job to be requeued.
+ */
+static check_queue_sweep_job_t * check_queue_sweep_execute(check_queue_sweep_job_t *job) {
+
+	uint64_t executed = __atomic_add_fetch(&check_queue_sweep.executed, 1, __ATOMIC_RELAXED);
+
+	if (__atomic_fetch_add(&check_queue_sweep.spawned, 1, __ATOMIC_RELAXED) < check_queue_sweep.total) {
+		job->sequence++;
+		job->next = NULL;
+		return job;
+	}
+
+	mm_free(job);
+
+	// The thread which executes the final job wakes everybody else up so they can exit.
+	if (executed == check_queue_sweep.total) {
+		__atomic_store_n(&check_queue_sweep.finished, 1, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Take jobs from the legacy queue, and requeue them, until the pass is finished.
+ */
+static void check_queue_legacy_thread(void) {
+
+	check_queue_sweep_job_t *job;
+
+	while ((job = check_queue_legacy_pop())) {
+		if ((job = check_queue_sweep_execute(job))) {
+			check_queue_legacy_push(job);
+		}
+		else if (__atomic_load_n(&check_queue_sweep.finished, __ATOMIC_ACQUIRE)) {
+			for (uint64_t i = 0; i < check_queue_sweep.threads; i++) {
+				sem_post(&check_queue_legacy.sema);
+			}
+		}
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Take jobs the same way a worker does, popping the newest job off its own deque, unless it has already done so
+ * 			MAGMA_QUEUE_LIFO_RUN times in a row, and then stealing the oldest job from its neighbors.
+ * @return	This function returns no value.
+ */
+static void check_queue_stealing_thread(void) {
+
+	deque_t *own;
+	uint64_t runs = 0;
+	check_queue_sweep_job_t *job;
+	uint64_t self = __atomic_fetch_add(&check_queue_sweep.started, 1, __ATOMIC_RELAXED);
+
+	own = check_queue_sweep.deques[self];
+
+	while (!__atomic_load_n(&check_queue_sweep.finished, __ATOMIC_ACQUIRE)) {
+
+		sem_wait(&check_queue_sweep.sema);
+
+		if (runs < MAGMA_QUEUE_LIFO_RUN && (job = deque_pop(own))) {
+			runs++;
+		}
+		else {
+			job = deque_steal(own);
+			runs = 0;
+		}
+
+		for (uint64_t i = 1; !job && i < check_queue_sweep.threads; i++) {
+			job = deque_steal(check_queue_sweep.deques[(self + i) % check_queue_sweep.threads]);
+		}
+
+		// A job may be in flight between a thief and its owner, so return the token and try again.
+		if (!job) {
+			if (!__atomic_load_n(&check_queue_sweep.finished, __ATOMIC_ACQUIRE)) {
+				sem_post(&check_queue_sweep.sema);
+				sched_yield();
+			}
+		}
+		else if ((job = check_queue_sweep_execute(job))) {
+			if (!deque_push(own, job)) {
+				mm_free(job);
+			}
+			sem_post(&check_queue_sweep.sema);
+		}
+		else if (__atomic_load_n(&check_queue_sweep.finished, __ATOMIC_ACQUIRE)) {
+			for (uint64_t i = 0; i < check_queue_sweep.threads; i++) {
+				sem_post(&check_queue_sweep.sema);
+			}
+		}
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Run a single sweep pass using the specified queue design and number of worker threads.
+ * @param	threads		the number of worker threads.
+ * @param	stealing	true to use the work stealing deques, or false to use the legacy single list queue.
+ * @param	elapsed		a pointer to receive the number of nanoseconds it took to execute all of the jobs.
+ * @return	true if every job was executed exactly once, otherwise false.
+ */
+bool_t check_queue_sweep_run(uint64_t threads, bool_t stealing, uint64_t *elapsed) {
+
+	bool_t result = true;
+	pthread_t *workers = NULL;
+	check_queue_sweep_job_t *job;
+	struct timespec start, end;
+
+	mm_wipe(&check_queue_sweep, sizeof(check_queue_sweep));
+	mm_wipe(&check_queue_legacy, sizeof(check_queue_legacy));
+
+	check_queue_sweep.threads = threads;
+	check_queue_sweep.total = QUEUE_CHECK_JOBS;
+	check_queue_sweep.spawned = QUEUE_CHECK_DEPTH;
+
+	if (!(workers = mm_alloc(sizeof(pthread_t) * threads)) || !(check_queue_sweep.deques = mm_alloc(sizeof(deque_t *) * threads))) {
+		mm_cleanup(workers);
+		return false;
+	}
+
+	sem_init(&check_queue_sweep.sema, 0, 0);
+	sem_init(&check_queue_legacy.sema, 0, 0);
+	mutex_init(&check_queue_legacy.lock, NULL);
+
+	for (uint64_t i = 0; i < threads; i++) {
+		if (!(check_queue_sweep.deques[i] = deque_alloc())) {
+			result = false;
+		}
+	}
+
+	// Seed the queue with the initial set of jobs, which are spread evenly across the deques.
+	for (uint64_t i = 0; result && i < QUEUE_CHECK_DEPTH; i++) {
+
+		if (!(job = mm_alloc(sizeof(check_queue_sweep_job_t)))) {
+			result = false;
+		}
+		else if (stealing && !deque_push(check_queue_sweep.deques[i % threads], job)) {
+			mm_free(job);
+			result = false;
+		}
+		else if (stealing) {
+			sem_post(&check_queue_sweep.sema);
+		}
+		else {
+			check_queue_legacy_push(job);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (uint64_t i = 0; result && i < threads; i++) {
+		if (thread_launch(workers + i, stealing ? &check_queue_stealing_thread : &check_queue_legacy_thread, NULL)) {
+			result = false;
+			threads = i;
+		}
+	}
+
+	for (uint64_t i = 0; i < threads; i++) {
+		thread_join(*(workers + i));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*elapsed = ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+	if (check_queue_sweep.executed != check_queue_sweep.total) {
+		result = false;
+	}
+
+	// Release any jobs left behind if the pass failed.
+	for (uint64_t i = 0; i < check_queue_sweep.threads; i++) {
+		while (check_queue_sweep.deques[i] && (job = deque_steal(check_queue_sweep.deques[i]))) {
+			mm_free(job);
+		}
+		deque_free(check_queue_sweep.deques[i]);
+	}
+
+	while ((job = check_queue_legacy.items)) {
+		check_queue_legacy.items = job->next;
+		mm_free(job);
+	}
+
+	mutex_destroy(&check_queue_legacy.lock);
+	sem_destroy(&check_queue_legacy.sema);
+	sem_destroy(&check_queue_sweep.sema);
+	mm_free(check_queue_sweep.deques);
+	mm_free(workers);
+
+	return result;
+}
+
+/**
+ * @brief	Compare the throughput of the legacy single list queue, against the work stealing deques, using between 1 and
+ * 			QUEUE_CHECK_MTHREADS threads, with the requeue heavy workload used by the worker pool benchmark.
+ * @note	The thread count is doubled after each pass, so the elapsed time for pass N, which used 2^N threads, is stored at offset N.
+ * @param	legacy		an array which will receive the elapsed time, in nanoseconds, for each pass using the legacy queue.
+ * @param	stealing	an array which will receive the elapsed time, in nanoseconds, for each pass using the work stealing deques.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_sweep_mthread(uint64_t *legacy, uint64_t *stealing) {
+
+	for (uint64_t threads = 1, pass = 0; status() && threads <= QUEUE_CHECK_MTHREADS; threads *= 2, pass++) {
+
+		if (!check_queue_sweep_run(threads, false, legacy + pass)) {
+			return st_aprint("The legacy queue sweep failed. { threads = %lu }", threads);
+		}
+		else if (!check_queue_sweep_run(threads, true, stealing + pass)) {
+			return st_aprint("The work stealing queue sweep failed. { threads = %lu }", threads);
+		}
+
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Verify the ordering and capacity rules of the work stealing deque.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_deque_sthread(void) {
+
+	deque_t *deque;
+	stringer_t *result = NULL;
+
+	if (!(deque = deque_alloc())) {
+		return st_dupe(NULLER("The deque allocation failed."));
+	}
+
+	// The owner should pop items in last in, first out order, while thieves steal in first in, first out order.
+	for (uint64_t i = 1; !result && i <= MAGMA_QUEUE_DEQUE_SIZE; i++) {
+		if (!deque_push(deque, (void *)i)) {
+			result = st_aprint("The deque rejected an item before reaching its capacity. { item = %lu }", i);
+		}
+	}
+
+	if (!result && deque_push(deque, (void *)UINT64_MAX)) {
+		result = st_dupe(NULLER("The deque accepted an item beyond its capacity."));
+	}
+	else if (!result && deque_count(deque) != MAGMA_QUEUE_DEQUE_SIZE) {
+		result = st_dupe(NULLER("The deque returned the wrong item count."));
+	}
+	else if (!result && deque_pop(deque) != (void *)MAGMA_QUEUE_DEQUE_SIZE) {
+		result = st_dupe(NULLER("The deque pop didn't return the newest item."));
+	}
+	else if (!result && deque_steal(deque) != (void *)1) {
+		result = st_dupe(NULLER("The deque steal didn't return the oldest item."));
+	}
+
+	// Drain the deque and make sure it reports empty.
+	while (!result && deque_pop(deque));
+
+	if (!result && (deque_count(deque) || deque_pop(deque) || deque_steal(deque))) {
+		result = st_dupe(NULLER("The deque returned an item after being drained."));
+	}
+
+	deque_free(deque);
+	return result;
+}
+
+/**
+ * @brief	The job enqueued by the queue wait check, which holds the worker long enough for the jobs behind it to wait.
+ * @param	data	a pointer to the counter of finished jobs.
+ * @return	This function returns no value.
+ */
+void check_queue_wait_job(uint64_t *finished) {
+
+	usleep(1000);
+	__atomic_add_fetch(finished, 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Verify the worker queue records how long work waits, and reports the depth and wait percentiles consistently.
+ * @param	p99		a pointer which will receive the 99th percentile wait, in microseconds, once the jobs have finished.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_wait_sthread(uint64_t *p99) {
+
+	static uint64_t finished;
+	uint64_t deadline = time(NULL) + 30;
+
+	__atomic_store_n(&finished, 0, __ATOMIC_RELEASE);
+
+	// Queue more jobs than there are workers, so some of them have to wait for a worker to finish.
+	for (uint64_t i = 0; i < QUEUE_CHECK_DEPTH; i++) {
+		enqueue(&check_queue_wait_job, &finished);
+	}
+
+	while (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_DEPTH && time(NULL) < deadline && status()) {
+		usleep(10000);
+	}
+
+	if (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_DEPTH) {
+		return st_aprint("The queued jobs never finished. { finished = %lu / queued = %u }", finished, QUEUE_CHECK_DEPTH);
+	}
+	else if (!(*p99 = queue_wait(99)) || !queue_wait(1)) {
+		return st_dupe(NULLER("The queue didn't record how long the jobs waited."));
+	}
+	else if (queue_wait(1) > *p99 || *p99 > queue_wait(100)) {
+		return st_aprint("The queue wait percentiles are out of order. { p1 = %lu / p99 = %lu / p100 = %lu }", queue_wait(1), *p99, queue_wait(100));
+	}
+	else if (queue_wait(100) < 1000 && magma.system.worker_threads < QUEUE_CHECK_DEPTH) {
+		return st_aprint("The queue wait percentiles don't reflect the jobs waiting behind each other. { p100 = %lu }", queue_wait(100));
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	A job executed by the worker queue once the simulated handshake has finished.
+ * @param	finished	a pointer to the counter of finished jobs.
+ * @return	This function returns no value.
+ */
+void check_queue_handshake_finish(uint64_t *finished) {
+
+	__atomic_add_fetch(finished, 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	A job executed by the handshake pool, which stands in for the key agreement of a full handshake, and then hands off to the worker queue.
+ * @param	finished	a pointer to the counter of finished jobs.
+ * @return	This function returns no value.
+ */
+void check_queue_handshake_job(uint64_t *finished) {
+
+	usleep(1000);
+	enqueue(&check_queue_handshake_finish, finished);
+
+	return;
+}
+
+/**
+ * @brief	Verify the handshake pool runs its jobs, hands them back to the worker queue, and reports the handshake percentiles consistently.
+ * @param	p50		a pointer which will receive the median handshake time, in microseconds, once the jobs have finished.
+ * @param	p99		a pointer which will receive the 99th percentile handshake time, in microseconds, once the jobs have finished.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_handshake_sthread(uint64_t *p50, uint64_t *p99) {
+
+	static uint64_t finished;
+	uint64_t deadline = time(NULL) + 30;
+
+	__atomic_store_n(&finished, 0, __ATOMIC_RELEASE);
+
+	for (uint64_t i = 0; i < QUEUE_CHECK_HANDSHAKES; i++) {
+		handshake_enqueue(&check_queue_handshake_job, &finished);
+	}
+
+	while (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_HANDSHAKES && time(NULL) < deadline && status()) {
+		usleep(10000);
+	}
+
+	if (__atomic_load_n(&finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_HANDSHAKES) {
+		return st_aprint("The handshake jobs never finished. { finished = %lu / queued = %u }", finished, QUEUE_CHECK_HANDSHAKES);
+	}
+	// Every job sleeps for a millisecond, so the bucket holding the median can't be any shorter.
+	else if ((*p50 = handshake_latency(50)) < 1000 || (*p99 = handshake_latency(99)) < *p50) {
+		return st_aprint("The handshake percentiles don't reflect the time the jobs took. { p50 = %lu / p99 = %lu }", *p50, *p99);
+	}
+	else if (handshake_wait(100) < 1000 && magma.system.handshake_threads < QUEUE_CHECK_HANDSHAKES) {
+		return st_aprint("The handshake wait percentiles don't reflect the jobs waiting behind each other. { p100 = %lu }", handshake_wait(100));
+	}
+
+	return NULL;
+}
+
+/// The order the prioritized jobs finished in, which is kept in static storage since the jobs may outlive a failed check.
+struct {
+	uint64_t finished;
+	uint64_t ranks[QUEUE_CHECK_PRIORITY_JOBS * 2];
+} check_queue_priority;
+
+/**
+ * @brief	A job used by the priority check, which records the order it finished in.
+ * @param	data	the offset of the job, cast to a pointer.
+ * @return	This function returns no value.
+ */
+void check_queue_priority_job(void *data) {
+
+	usleep(1000);
+	check_queue_priority.ranks[(uintptr_t)data] = __atomic_add_fetch(&check_queue_priority.finished, 1, __ATOMIC_ACQ_REL);
+
+	return;
+}
+
+/**
+ * @brief	Queue a batch of background jobs, followed by an equal batch of interactive jobs, and make sure the interactive jobs are
+ * 			favored, without the background jobs being starved.
+ * @param	interactive		a pointer which will receive the average finishing position of the interactive jobs.
+ * @param	background		a pointer which will receive the average finishing position of the background jobs.
+ * @param	overlap			a pointer which will receive the number of background jobs which finished before the last interactive job.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_priority_sthread(uint64_t *interactive, uint64_t *background, uint64_t *overlap) {
+
+	uint64_t deadline = time(NULL) + 60, last = 0;
+
+	mm_wipe(&check_queue_priority, sizeof(check_queue_priority));
+	*interactive = *background = *overlap = 0;
+
+	// The background jobs go first, so a plain first in, first out queue would finish them first.
+	for (uint64_t i = 0; i < QUEUE_CHECK_PRIORITY_JOBS; i++) {
+		enqueue_priority(QUEUE_BACKGROUND, &check_queue_priority_job, (void *)(uintptr_t)(QUEUE_CHECK_PRIORITY_JOBS + i));
+	}
+
+	for (uint64_t i = 0; i < QUEUE_CHECK_PRIORITY_JOBS; i++) {
+		enqueue_priority(QUEUE_INTERACTIVE, &check_queue_priority_job, (void *)(uintptr_t)i);
+	}
+
+	while (__atomic_load_n(&check_queue_priority.finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_PRIORITY_JOBS * 2 && time(NULL) < deadline && status()) {
+		usleep(10000);
+	}
+
+	if (__atomic_load_n(&check_queue_priority.finished, __ATOMIC_ACQUIRE) != QUEUE_CHECK_PRIORITY_JOBS * 2) {
+		return st_aprint("The prioritized jobs never finished. { finished = %lu / queued = %u }", check_queue_priority.finished,
+			QUEUE_CHECK_PRIORITY_JOBS * 2);
+	}
+
+	for (uint64_t i = 0; i < QUEUE_CHECK_PRIORITY_JOBS; i++) {
+		*interactive += check_queue_priority.ranks[i];
+		*background += check_queue_priority.ranks[QUEUE_CHECK_PRIORITY_JOBS + i];
+		if (check_queue_priority.ranks[i] > last) last = check_queue_priority.ranks[i];
+	}
+
+	for (uint64_t i = 0; i < QUEUE_CHECK_PRIORITY_JOBS; i++) {
+		if (check_queue_priority.ranks[QUEUE_CHECK_PRIORITY_JOBS + i] < last) (*overlap)++;
+	}
+
+	*interactive /= QUEUE_CHECK_PRIORITY_JOBS;
+	*background /= QUEUE_CHECK_PRIORITY_JOBS;
+
+	if (*interactive >= *background) {
+		return st_aprint("The interactive jobs weren't favored over the background jobs. { interactive = %lu / background = %lu }",
+			*interactive, *background);
+	}
+	// While both classes are waiting, the background jobs should get their weighted share of the worker turns. Half of that share is
+	// required, which allows for the turns lost while the workers pick up the first jobs.
+	else if (*overlap < (QUEUE_CHECK_PRIORITY_JOBS * MAGMA_QUEUE_WEIGHT_BACKGROUND) / ((MAGMA_QUEUE_WEIGHT_INTERACTIVE + MAGMA_QUEUE_WEIGHT_DELIVERY +
+		MAGMA_QUEUE_WEIGHT_BACKGROUND) * 2)) {
+		return st_aprint("The background jobs were starved while the interactive jobs were still running. { overlap = %lu / background = %u }",
+			*overlap, QUEUE_CHECK_PRIORITY_JOBS);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	A job used by the starvation check, which holds a worker until the check releases it.
+ * @param	data	this parameter is unused.
+ * @return	This function returns no value.
+ */
+void check_queue_starve_block(void *data) {
+
+	__atomic_add_fetch(&check_queue_starve.blocked, 1, __ATOMIC_ACQ_REL);
+
+	while (!__atomic_load_n(&check_queue_starve.released, __ATOMIC_ACQUIRE) && status()) {
+		usleep(100);
+	}
+
+	return;
+}
+
+/**
+ * @brief	A job used by the starvation check, which is queued underneath a job that keeps requeueing itself, and records when it ran.
+ * @param	data	this parameter is unused.
+ * @return	This function returns no value.
+ */
+void check_queue_starve_old(void *data) {
+
+	__atomic_store_n(&check_queue_starve.overtaken, __atomic_load_n(&check_queue_starve.steps, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	A job used by the starvation check, which queues an older job on the deque of its worker, and then keeps requeueing itself,
+ * 			until the older job runs, or the step limit is reached.
+ * @param	data	this parameter is unused.
+ * @return	This function returns no value.
+ */
+void check_queue_starve_chain(void *data) {
+
+	uint64_t steps = __atomic_add_fetch(&check_queue_starve.steps, 1, __ATOMIC_ACQ_REL);
+
+	if (steps == 1) {
+		enqueue(&check_queue_starve_old, NULL);
+	}
+
+	if (steps < QUEUE_CHECK_STARVE_STEPS && !__atomic_load_n(&check_queue_starve.overtaken, __ATOMIC_ACQUIRE)) {
+		enqueue(&check_queue_starve_chain, NULL);
+	}
+	else {
+		__atomic_store_n(&check_queue_starve.finished, 1, __ATOMIC_RELEASE);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Occupy every worker but one, and then make sure a job which keeps requeueing itself on the remaining worker can't starve an
+ * 			older job sitting underneath it on the same deque, since there are no idle workers left to steal the older job.
+ * @param	steps	a pointer which will receive the number of times the requeueing job ran before the older job.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_queue_starve_sthread(uint64_t *steps) {
+
+	stringer_t *result = NULL;
+	uint64_t deadline = time(NULL) + 30;
+
+	mm_wipe(&check_queue_starve, sizeof(check_queue_starve));
+	*steps = 0;
+
+	for (uint64_t i = 1; i < magma.system.worker_threads; i++) {
+		enqueue(&check_queue_starve_block, NULL);
+	}
+
+	while (__atomic_load_n(&check_queue_starve.blocked, __ATOMIC_ACQUIRE) + 1 < magma.system.worker_threads && time(NULL) < deadline && status()) {
+		usleep(1000);
+	}
+
+	if (__atomic_load_n(&check_queue_starve.blocked, __ATOMIC_ACQUIRE) + 1 < magma.system.worker_threads) {
+		result = st_aprint("The blocking jobs never started. { blocked = %lu / workers = %u }", check_queue_starve.blocked,
+			magma.system.worker_threads);
+	}
+	else {
+
+		enqueue(&check_queue_starve_chain, NULL);
+
+		while (!__atomic_load_n(&check_queue_starve.finished, __ATOMIC_ACQUIRE) && time(NULL) < deadline && status()) {
+			usleep(1000);
+		}
+
+		if (!__atomic_load_n(&check_queue_starve.finished, __ATOMIC_ACQUIRE)) {
+			result = st_dupe(NULLER("The requeueing job never finished."));
+		}
+		else if (!(*steps = __atomic_load_n(&check_queue_starve.overtaken, __ATOMIC_ACQUIRE)) || *steps > MAGMA_QUEUE_LIFO_RUN + 1) {
+			result = st_aprint("The older job was starved by the requeueing job. { steps = %lu / limit = %u }",
+				__atomic_load_n(&check_queue_starve.steps, __ATOMIC_ACQUIRE), MAGMA_QUEUE_LIFO_RUN + 1);
+		}
+	}
+
+	__atomic_store_n(&check_queue_starve.released, 1, __ATOMIC_RELEASE);
+
+	return result;
+}
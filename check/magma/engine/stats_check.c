@@ -0,0 +1,312 @@
+
+/**
+ * @file /check/magma/engine/stats_check.c
+ *
+ * @brief Checks for the statistics interface, and its thread local counters.
+ */
+
+#include "magma_check.h"
+
+void check_stats_thread(void) {
+
+	for (uint64_t i = 0; i < STATS_CHECK_ITERATIONS; i++) {
+		stats_increment_by_name("web.register.blocked");
+		stats_adjust_by_name("web.register.blocked", 2);
+		stats_decrement_by_name("web.register.blocked");
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Verify every statistic name resolves to its own position, that unknown names are rejected, and that interned ids are cached.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_stats_names_sthread(void) {
+
+	uint64_t cache = 0, missing = 0;
+
+	if (stats_get_name_pos("default") || stats_get_name_pos("check.stats.missing") || stats_get_name(stats_get_count())) {
+		return st_aprint("The statistics interface resolved an invalid name or position.");
+	}
+	// An unknown name must leave the cache empty, while a known name should be kept, and returned without searching for the name again.
+	else if (stats_intern(&missing, "check.stats.missing") || missing || stats_intern(&cache, "web.register.blocked") !=
+		stats_get_name_pos("web.register.blocked") || cache != stats_get_name_pos("web.register.blocked") ||
+		stats_intern(&cache, "check.stats.missing") != stats_get_name_pos("web.register.blocked")) {
+		return st_aprint("The statistics interface didn't cache the interned id of a name correctly.");
+	}
+
+	for (uint64_t i = 1; i < stats_get_count(); i++) {
+		if (stats_get_name_pos(stats_get_name(i)) != i) {
+			return st_aprint("The statistic name didn't resolve to its own position. { name = %s / position = %lu }", stats_get_name(i), i);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Update a statistic from several threads at once, and verify the total survives the threads exiting.
+ * @param	elapsed		a pointer to receive the number of nanoseconds it took the threads to finish.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_stats_counters_mthread(uint64_t *elapsed) {
+
+	uint64_t original, expected;
+	pthread_t threads[STATS_CHECK_MTHREADS];
+	struct timespec start, end;
+	uint64_t launched = 0;
+
+	original = stats_get_value_by_name("web.register.blocked");
+	expected = original + (STATS_CHECK_MTHREADS * STATS_CHECK_ITERATIONS * 2);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (; launched < STATS_CHECK_MTHREADS; launched++) {
+		if (thread_launch(&(threads[launched]), &check_stats_thread, NULL)) {
+			break;
+		}
+	}
+
+	for (uint64_t i = 0; i < launched; i++) {
+		thread_join(threads[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*elapsed = ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+	if (launched != STATS_CHECK_MTHREADS) {
+		stats_set_by_name("web.register.blocked", original);
+		return st_aprint("Unable to launch the statistics check threads.");
+	}
+	else if (stats_get_value_by_name("web.register.blocked") != expected) {
+		stats_set_by_name("web.register.blocked", original);
+		return st_aprint("The statistic total didn't include the updates from every thread. { expected = %lu / found = %lu }", expected,
+			stats_get_value_by_name("web.register.blocked"));
+	}
+
+	// Setting a value has to account for the counters still held by this thread.
+	stats_increment_by_name("web.register.blocked");
+	stats_set_by_name("web.register.blocked", original);
+
+	if (stats_get_value_by_name("web.register.blocked") != original) {
+		return st_aprint("The statistic couldn't be reset to its original value.");
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Time a series of short sleeps using a latency histogram, and verify the percentiles fall where the sleeps say they should.
+ * @param	p50		a pointer to receive the estimated median, in nanoseconds.
+ * @param	p999	a pointer to receive the estimated 99.9th percentile, in nanoseconds.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_stats_latency_sthread(uint64_t *p50, uint64_t *p999) {
+
+	uint64_t start;
+	latency_t *histogram;
+
+	if (!perf_calibrate()) {
+		return st_aprint("The CPU cycle counter couldn't be calibrated.");
+	}
+	else if (!(histogram = latency_find("check.latency")) && !(histogram = latency_alloc("check", "LATENCY", 7))) {
+		return st_aprint("The latency histogram couldn't be allocated.");
+	}
+	else if (latency_find("CHECK.LATENCY") != histogram || st_cmp_cs_eq(NULLER(latency_name(histogram)), NULLER("check.latency"))) {
+		return st_aprint("The latency histogram couldn't be found using its name. { name = %s }", latency_name(histogram));
+	}
+
+	// A command which wasn't timed shouldn't be counted.
+	start = latency_count(histogram);
+	latency_record(histogram, 0);
+
+	if (latency_count(histogram) != start) {
+		return st_aprint("The latency histogram counted a sample which wasn't timed.");
+	}
+
+	for (uint64_t i = 0; i < STATS_CHECK_LATENCY_SAMPLES; i++) {
+		start = perf_rdtsc();
+		usleep(1000);
+		latency_record(histogram, start);
+	}
+
+	*p50 = latency_percentile(histogram, 500);
+	*p999 = latency_percentile(histogram, 999);
+
+	if (latency_count(histogram) < STATS_CHECK_LATENCY_SAMPLES) {
+		return st_aprint("The latency histogram lost samples. { expected = %i / found = %lu }", STATS_CHECK_LATENCY_SAMPLES, latency_count(histogram));
+	}
+	// A sleep can run long, but never short, and each percentile is reported using the upper bound of its bucket.
+	else if (*p50 < 1000000 || *p50 > *p999 || latency_percentile(histogram, 900) > latency_percentile(histogram, 990)) {
+		return st_aprint("The latency percentiles are out of order, or too short. { p50 = %lu / p999 = %lu }", *p50, *p999);
+	}
+
+	return NULL;
+}
+
+typedef struct {
+	uint32_t tank;
+	uint64_t found, next;
+	bool_t ordered;
+} stats_check_recorder_t;
+
+/**
+ * @brief	Count the flight recorder lines which hold the events recorded by the recorder check, and make sure they're in order.
+ * @param	context	the recorder check state.
+ * @param	line	the formatted line.
+ * @param	length	the length of the line.
+ * @return	This function always returns true, so the entire dump is examined.
+ */
+static bool_t check_stats_recorder_line(void *context, chr_t *line, size_t length) {
+
+	uint32_t tank;
+	uint64_t object;
+	stats_check_recorder_t *state = context;
+
+	if (sscanf(line, "%*i %*u tank.read tank = %u object = %lu", &tank, &object) == 2 && tank == state->tank) {
+		if (object != state->next) {
+			state->ordered = false;
+		}
+		state->next = object + 1;
+		state->found++;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Record a series of events using the flight recorder, and verify a dump returns every event, oldest first.
+ * @param	cost	a pointer to receive the average cost of recording an event, in nanoseconds.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_stats_recorder_sthread(uint64_t *cost) {
+
+	uint64_t start;
+	stats_check_recorder_t state = { .found = 0, .next = 0, .ordered = true };
+
+	if (!perf_calibrate()) {
+		return st_aprint("The CPU cycle counter couldn't be calibrated.");
+	}
+
+	// Use a tank number which is unlikely to collide with the events recorded by earlier runs.
+	state.tank = 0x10000 | (perf_rdtsc() & 0xFFFF);
+
+	start = perf_rdtsc();
+
+	for (uint64_t i = 0; i < STATS_CHECK_RECORDER_EVENTS; i++) {
+		recorder_event(RECORDER_TANK_READ, state.tank, i);
+	}
+
+	*cost = perf_elapsed(start) / STATS_CHECK_RECORDER_EVENTS;
+
+	recorder_dump(&check_stats_recorder_line, &state);
+
+	if (state.found != STATS_CHECK_RECORDER_EVENTS) {
+		return st_aprint("The flight recorder lost events. { expected = %i / found = %lu }", STATS_CHECK_RECORDER_EVENTS, state.found);
+	}
+	else if (!state.ordered) {
+		return st_aprint("The flight recorder returned events out of order.");
+	}
+
+	return NULL;
+}
+
+typedef struct {
+	pid_t tid;
+	bool_t stop;
+	uint64_t lines, torn;
+} stats_check_overwrite_t;
+
+/**
+ * @brief	Record a command event, followed by two tank events, as fast as possible, so the flight recorder is overwritten while it's being dumped.
+ * @note	The tank events carry the number one, which would crash the dump if a torn copy paired it with the type of a command event. The
+ * 			pattern repeats every three events, so each slot in the ring buffer alternates between the two types as it's overwritten.
+ * @param	state	the overwrite check state.
+ * @return	This function returns no value.
+ */
+static void check_stats_recorder_writer(stats_check_overwrite_t *state) {
+
+	// The ring buffer may have been released by an exited thread, so its old events are overwritten before the dumps begin.
+	for (uint64_t i = 0; i < MAGMA_RECORDER_EVENTS; i++) {
+		recorder_event(RECORDER_TANK_READ, 0, 1);
+	}
+
+	__atomic_store_n(&(state->tid), syscall(SYS_gettid), __ATOMIC_RELEASE);
+
+	while (!__atomic_load_n(&(state->stop), __ATOMIC_ACQUIRE)) {
+		recorder_event(RECORDER_COMMAND_START, 0, (uintptr_t)"CHECK");
+		recorder_event(RECORDER_TANK_READ, 0, 1);
+		recorder_event(RECORDER_TANK_READ, 0, 1);
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Make sure every line recorded by the writer thread holds a complete event.
+ * @param	context	the overwrite check state.
+ * @param	line	the formatted line.
+ * @param	length	the length of the line.
+ * @return	This function always returns true, so the entire dump is examined.
+ */
+static bool_t check_stats_recorder_overwrite_line(void *context, chr_t *line, size_t length) {
+
+	pid_t tid;
+	uint64_t object;
+	chr_t command[16];
+	stats_check_overwrite_t *state = context;
+
+	if (sscanf(line, "%i", &tid) != 1 || tid != __atomic_load_n(&(state->tid), __ATOMIC_ACQUIRE)) {
+		return true;
+	}
+	else if (sscanf(line, "%*i %*u command.start %15s", command) == 1) {
+		if (st_cmp_cs_eq(NULLER(command), PLACER("CHECK", 5))) state->torn++;
+	}
+	else if (sscanf(line, "%*i %*u tank.read tank = %*u object = %lu", &object) == 1) {
+		if (object != 1) state->torn++;
+	}
+	else {
+		state->torn++;
+	}
+
+	state->lines++;
+
+	return true;
+}
+
+/**
+ * @brief	Dump the flight recorders repeatedly while another thread overwrites its ring buffer, and make sure no dump formats a torn event.
+ * @return	NULL on success, or a managed string describing the failure.
+ */
+stringer_t * check_stats_recorder_mthread(void) {
+
+	pthread_t writer;
+	stats_check_overwrite_t state = { .tid = 0, .stop = false, .lines = 0, .torn = 0 };
+
+	if (thread_launch(&writer, &check_stats_recorder_writer, &state)) {
+		return st_aprint("Unable to launch the flight recorder writer thread.");
+	}
+
+	while (!__atomic_load_n(&(state.tid), __ATOMIC_ACQUIRE)) {
+		usleep(100);
+	}
+
+	for (uint64_t i = 0; i < STATS_CHECK_RECORDER_DUMPS && !state.torn; i++) {
+		recorder_dump(&check_stats_recorder_overwrite_line, &state);
+	}
+
+	__atomic_store_n(&(state.stop), true, __ATOMIC_RELEASE);
+	thread_join(writer);
+
+	if (state.torn) {
+		return st_aprint("The flight recorder dump returned torn events. { torn = %lu / lines = %lu }", state.torn, state.lines);
+	}
+	else if (!state.lines) {
+		return st_aprint("The flight recorder dump didn't return any of the events recorded by the writer thread.");
+	}
+
+	return NULL;
+}
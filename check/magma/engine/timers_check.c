@@ -0,0 +1,114 @@
+
+/**
+ * @file /check/magma/engine/timers_check.c
+ *
+ * @brief Checks for the hierarchical timer wheel.
+ */
+
+#include "magma_check.h"
+
+/// The timers are kept in static storage, since a timer which fires late may still be sitting in the worker queue when the check returns.
+struct {
+	timer_event_t timers[TIMERS_CHECK_COUNT];
+	uint64_t delays[TIMERS_CHECK_COUNT], scheduled[TIMERS_CHECK_COUNT], fired[TIMERS_CHECK_COUNT];
+} check_timers;
+
+/**
+ * @brief	Get the value of the monotonic clock in milliseconds.
+ * @return	the number of milliseconds since an arbitrary point in the past.
+ */
+static uint64_t check_timers_clock(void) {
+
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000) + ((uint64_t)now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief	Determine whether a timer should be cancelled. The shortest timers are never cancelled, since they may fire before the cancel.
+ * @param	offset	the offset of the timer.
+ * @return	true if the timer should be cancelled, otherwise false.
+ */
+static bool_t check_timers_cancelled(uint64_t offset) {
+	return offset >= 5 && (offset % 3) == 2;
+}
+
+/**
+ * @brief	The function enqueued by the timer wheel, which records when each timer fired.
+ * @param	data	the offset of the timer, cast to a pointer.
+ * @return	This function returns no value.
+ */
+void check_timers_fire(void *data) {
+	__atomic_store_n(&(check_timers.fired[(uintptr_t)data]), check_timers_clock(), __ATOMIC_RELEASE);
+	return;
+}
+
+/**
+ * @brief	Schedule timers which land on the lower levels of the wheel, cancel some of them, and make sure the rest fire, and never early.
+ * @return	NULL on success, or an error message describing the failure.
+ */
+stringer_t * check_timers_sthread(void) {
+
+	uint64_t pending, deadline;
+	stringer_t *result = NULL;
+
+	mm_wipe(&check_timers, sizeof(check_timers));
+
+	// The delays double with each timer, so the later timers start out on the upper levels of the wheel, and have to be cascaded down.
+	for (uint64_t i = 0; !result && i < TIMERS_CHECK_COUNT; i++) {
+
+		check_timers.delays[i] = i ? (1UL << i) : 0;
+		check_timers.scheduled[i] = check_timers_clock();
+
+		if (!timer_schedule(check_timers.timers + i, check_timers.delays[i], &check_timers_fire, (void *)(uintptr_t)i)) {
+			result = st_aprint("The timer couldn't be scheduled. { timer = %lu / delay = %lu }", i, check_timers.delays[i]);
+		}
+	}
+
+	// Only the timers which are still pending can be cancelled.
+	for (uint64_t i = 0; !result && i < TIMERS_CHECK_COUNT; i++) {
+		if (check_timers_cancelled(i) && !timer_cancel(check_timers.timers + i)) {
+			result = st_aprint("The timer couldn't be cancelled. { timer = %lu / delay = %lu }", i, check_timers.delays[i]);
+		}
+	}
+
+	deadline = check_timers_clock() + (1UL << (TIMERS_CHECK_COUNT - 1)) + 2000;
+
+	do {
+
+		pending = 0;
+
+		for (uint64_t i = 0; i < TIMERS_CHECK_COUNT; i++) {
+			if (!check_timers_cancelled(i) && !__atomic_load_n(&(check_timers.fired[i]), __ATOMIC_ACQUIRE)) {
+				pending++;
+			}
+		}
+
+		if (pending) {
+			usleep(10000);
+		}
+
+	} while (!result && pending && status() && check_timers_clock() < deadline);
+
+	for (uint64_t i = 0; !result && i < TIMERS_CHECK_COUNT; i++) {
+
+		if (check_timers_cancelled(i) && check_timers.fired[i]) {
+			result = st_aprint("A cancelled timer fired. { timer = %lu / delay = %lu }", i, check_timers.delays[i]);
+		}
+		else if (!check_timers_cancelled(i) && !check_timers.fired[i]) {
+			result = st_aprint("The timer never fired. { timer = %lu / delay = %lu }", i, check_timers.delays[i]);
+		}
+		else if (!check_timers_cancelled(i) && (check_timers.fired[i] - check_timers.scheduled[i]) < check_timers.delays[i]) {
+			result = st_aprint("The timer fired early. { timer = %lu / delay = %lu / elapsed = %lu }", i, check_timers.delays[i],
+				check_timers.fired[i] - check_timers.scheduled[i]);
+		}
+	}
+
+	// Make sure nothing is left on the wheel which points at the check structure.
+	for (uint64_t i = 0; i < TIMERS_CHECK_COUNT; i++) {
+		timer_cancel(check_timers.timers + i);
+	}
+
+	return result;
+}
@@ -124,11 +124,51 @@ void suite_check_testcase(Suite *s, const char *tags, const char *name, TFun fun
 #define PRIME_CHECK_SPANNING_CHUNK_SIZE (1024 * 1024 * 20) // 20 megabytes
 
 #define OBJECT_CHECK_ITERATIONS 16
+#define OBJECT_CHECK_FLAGS_MESSAGES 10000 // The number of messages updated by the message flag check.
+#define NETWORK_CHECK_OUTPUT_LINES 256 // The number of response lines written by the network output check.
+#define NETWORK_CHECK_OUTPUT_BUFFER (256 * 1024) // The socket buffer size used by the network output check.
+#define NETWORK_CHECK_HANDSHAKES 64 // The number of full, and resumed, TLS handshakes timed by the session resumption check.
 
 #define MAIL_CHECK_LOAD_MAX 64 // Maximum number of messages loaded per user.
+#define MAIL_CHECK_SYNC_MTHREADS 8 // The number of threads delivering concurrently during the group commit check.
+#define MAIL_CHECK_SYNC_ITERATIONS 16 // The number of files each group commit thread writes.
+#define MAIL_CHECK_SYNC_FULL_WINDOW 10000 // The group commit window, in milliseconds, used by the full batch check, which should never wait it out.
+#define MAIL_CHECK_CACHE_USERNUM UINT64_MAX // The user number the shared message cache check stores its messages under.
+#define MAIL_CHECK_CACHE_MESSAGES 32 // The number of distinct messages the shared message cache threads compete over.
+#define MAIL_CHECK_CACHE_MTHREADS 8 // The number of threads reading and writing the shared message cache concurrently.
+#define MAIL_CHECK_CACHE_ITERATIONS 1024 // The number of cache lookups made by each thread.
 
 #define REGRESSION_CHECK_FILE_DESCRIPTORS_LEAK_MTHREADS 8
 
+#define SECURE_CHECK_PAIRS 16384 // The number of secure memory allocation and free pairs made by each secure memory benchmark thread.
+
+#define SLAB_CHECK_PAIRS 16384 // The number of slab cache get and put pairs made by each slab cache benchmark thread.
+#define SLAB_CHECK_WINDOW 256 // The number of objects each slab cache benchmark thread holds at once.
+
+#define QUEUE_CHECK_JOBS 65536 // The number of jobs executed by the queue benchmark.
+#define QUEUE_CHECK_DEPTH 1024 // The number of jobs kept in flight by the queue benchmark.
+#define QUEUE_CHECK_MTHREADS 64 // The largest thread count used by the queue sweep.
+#define QUEUE_CHECK_STARVE_STEPS 1024 // The number of times the starvation check lets a job requeue itself before giving up on the older job.
+#define QUEUE_CHECK_HANDSHAKES 64 // The number of simulated handshakes queued for the handshake pool.
+#define QUEUE_CHECK_PRIORITY_JOBS 1024 // The number of jobs queued in each priority class by the priority check.
+#define LOG_CHECK_MTHREADS 8 // The number of threads logging at once while the log ring buffers are being overflowed.
+#define LOG_CHECK_MESSAGES 8192 // The number of messages logged by each log check thread, which should be enough to overflow its ring buffer.
+#define TIMERS_CHECK_COUNT 13 // The number of timers scheduled by the timer wheel check. Each timer waits twice as long as the one before it.
+#define STATS_CHECK_MTHREADS 16 // The number of threads updating the same statistic concurrently.
+#define STATS_CHECK_ITERATIONS 65536 // The number of updates each statistics check thread makes.
+#define STATS_CHECK_LATENCY_SAMPLES 32 // The number of one millisecond sleeps timed by the latency histogram check.
+#define STATS_CHECK_RECORDER_EVENTS 1024 // The number of events recorded by the flight recorder check. Must not exceed MAGMA_RECORDER_EVENTS.
+#define STATS_CHECK_RECORDER_DUMPS 64 // The number of dumps taken while the flight recorder is being overwritten by another thread.
+
+#define SMTP_CHECK_DATA_CORPUS "dev/corpus" // The directory holding the messages used by the DATA scanner benchmark.
+#define SMTP_CHECK_DATA_ITERATIONS 64 // The number of times each message is scanned by the DATA scanner benchmark.
+
+#define IMAP_CHECK_NARROW_FOLDERS 4 // The number of folders the synthetic mailbox messages are spread across.
+#define IMAP_CHECK_NARROW_MESSAGES 100000 // The number of messages in the synthetic mailbox used by the narrowing benchmark.
+#define IMAP_CHECK_NARROW_ITERATIONS 8 // The number of times the narrowing benchmark fetches the flags of the selected folder.
+#define IMAP_CHECK_ARENA_MESSAGES 4096 // The number of messages in the synthetic mailbox used by the connection arena benchmark.
+#define IMAP_CHECK_ARENA_ITERATIONS 8 // The number of FETCH commands run with, and without, the connection arena.
+
 //! Exhaustive Test
 #else
 
@@ -208,9 +248,49 @@ void suite_check_testcase(Suite *s, const char *tags, const char *name, TFun fun
 //#define SYMMETRIC_CHECK_SIZE_MAX (1 * 1024 * 1024) // 1 megabyte
 
 #define OBJECT_CHECK_ITERATIONS 256
+#define OBJECT_CHECK_FLAGS_MESSAGES 10000 // The number of messages updated by the message flag check.
+#define NETWORK_CHECK_OUTPUT_LINES 256 // The number of response lines written by the network output check.
+#define NETWORK_CHECK_OUTPUT_BUFFER (256 * 1024) // The socket buffer size used by the network output check.
+#define NETWORK_CHECK_HANDSHAKES 1024 // The number of full, and resumed, TLS handshakes timed by the session resumption check.
 
 #define MAIL_CHECK_LOAD_MAX UINT64_MAX // Maximum number of messages loaded per user.
+#define MAIL_CHECK_SYNC_MTHREADS 32 // The number of threads delivering concurrently during the group commit check.
+#define MAIL_CHECK_SYNC_ITERATIONS 256 // The number of files each group commit thread writes.
+#define MAIL_CHECK_SYNC_FULL_WINDOW 10000 // The group commit window, in milliseconds, used by the full batch check, which should never wait it out.
+#define MAIL_CHECK_CACHE_USERNUM UINT64_MAX // The user number the shared message cache check stores its messages under.
+#define MAIL_CHECK_CACHE_MESSAGES 256 // The number of distinct messages the shared message cache threads compete over.
+#define MAIL_CHECK_CACHE_MTHREADS 32 // The number of threads reading and writing the shared message cache concurrently.
+#define MAIL_CHECK_CACHE_ITERATIONS 65536 // The number of cache lookups made by each thread.
 
 #define REGRESSION_CHECK_FILE_DESCRIPTORS_LEAK_MTHREADS 32
 
+#define SECURE_CHECK_PAIRS 1048576 // The number of secure memory allocation and free pairs made by each secure memory benchmark thread.
+
+#define SLAB_CHECK_PAIRS 1048576 // The number of slab cache get and put pairs made by each slab cache benchmark thread.
+#define SLAB_CHECK_WINDOW 256 // The number of objects each slab cache benchmark thread holds at once.
+
+#define QUEUE_CHECK_JOBS 4194304 // The number of jobs executed by the queue benchmark.
+#define QUEUE_CHECK_DEPTH 1024 // The number of jobs kept in flight by the queue benchmark.
+#define QUEUE_CHECK_MTHREADS 64 // The largest thread count used by the queue sweep.
+#define QUEUE_CHECK_STARVE_STEPS 1024 // The number of times the starvation check lets a job requeue itself before giving up on the older job.
+#define QUEUE_CHECK_HANDSHAKES 64 // The number of simulated handshakes queued for the handshake pool.
+#define QUEUE_CHECK_PRIORITY_JOBS 1024 // The number of jobs queued in each priority class by the priority check.
+#define LOG_CHECK_MTHREADS 32 // The number of threads logging at once while the log ring buffers are being overflowed.
+#define LOG_CHECK_MESSAGES 65536 // The number of messages logged by each log check thread, which should be enough to overflow its ring buffer.
+#define TIMERS_CHECK_COUNT 15 // The number of timers scheduled by the timer wheel check. Each timer waits twice as long as the one before it.
+#define STATS_CHECK_MTHREADS 64 // The number of threads updating the same statistic concurrently.
+#define STATS_CHECK_ITERATIONS 1048576 // The number of updates each statistics check thread makes.
+#define STATS_CHECK_LATENCY_SAMPLES 256 // The number of one millisecond sleeps timed by the latency histogram check.
+#define STATS_CHECK_RECORDER_EVENTS 2048 // The number of events recorded by the flight recorder check. Must not exceed MAGMA_RECORDER_EVENTS.
+#define STATS_CHECK_RECORDER_DUMPS 1024 // The number of dumps taken while the flight recorder is being overwritten by another thread.
+
+#define SMTP_CHECK_DATA_CORPUS "dev/corpus" // The directory holding the messages used by the DATA scanner benchmark.
+#define SMTP_CHECK_DATA_ITERATIONS 4096 // The number of times each message is scanned by the DATA scanner benchmark.
+
+#define IMAP_CHECK_NARROW_FOLDERS 4 // The number of folders the synthetic mailbox messages are spread across.
+#define IMAP_CHECK_NARROW_MESSAGES 100000 // The number of messages in the synthetic mailbox used by the narrowing benchmark.
+#define IMAP_CHECK_NARROW_ITERATIONS 256 // The number of times the narrowing benchmark fetches the flags of the selected folder.
+#define IMAP_CHECK_ARENA_MESSAGES 65536 // The number of messages in the synthetic mailbox used by the connection arena benchmark.
+#define IMAP_CHECK_ARENA_ITERATIONS 64 // The number of FETCH commands run with, and without, the connection arena.
+
 #endif
@@ -0,0 +1,193 @@
+
+/**
+ * @file /magma/check/magma/mail/cache_check.c
+ */
+
+#include "magma_check.h"
+
+/**
+ * @brief	Generate predictable message text, so a message returned by the cache can be verified.
+ * @param	messagenum	the message number, which seeds the text.
+ * @param	length		the length of the text.
+ * @return	NULL on failure, or a managed string holding the text.
+ */
+stringer_t * check_mail_cache_text(uint64_t messagenum, size_t length) {
+
+	stringer_t *result;
+
+	if (!(result = st_alloc(length))) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		*(st_char_get(result) + i) = 'a' + ((messagenum + i) % 26);
+	}
+
+	st_length_set(result, length);
+	return result;
+}
+
+void check_mail_cache_mthread_wrap(void) {
+
+	bool_t *outcome;
+	uint64_t messagenum;
+	stringer_t *text, *cached;
+
+	if (!thread_start() || !(outcome = mm_alloc(sizeof(bool_t)))) {
+		log_unit("Unable to setup the thread context.");
+		pthread_exit(NULL);
+		return;
+	}
+
+	*outcome = true;
+
+	// Every thread works on the same small set of messages, so they constantly read entries the other threads inserted.
+	for (uint32_t i = 0; *outcome && status() && i < MAIL_CHECK_CACHE_ITERATIONS; i++) {
+
+		messagenum = (rand_get_uint64() % MAIL_CHECK_CACHE_MESSAGES) + 1;
+
+		if (!(text = check_mail_cache_text(messagenum, 1024 + (messagenum * 64)))) {
+			*outcome = false;
+		}
+		else if ((cached = mail_cache_get(MAIL_CHECK_CACHE_USERNUM, messagenum, true))) {
+			if (st_cmp_cs_eq(cached, text)) *outcome = false;
+			st_free(cached);
+		}
+		else {
+			mail_cache_set(MAIL_CHECK_CACHE_USERNUM, messagenum, text, true);
+		}
+
+		st_cleanup(text);
+	}
+
+	mail_cache_reset();
+
+	thread_stop();
+	pthread_exit(outcome);
+	return;
+}
+
+bool_t check_mail_cache_mthread(stringer_t *errmsg) {
+
+	void *outcome = NULL;
+	bool_t result = true;
+	pthread_t *threads = NULL;
+
+	if (!magma.storage.cache_size) {
+		st_sprint(errmsg, "SKIPPED");
+		return true;
+	}
+	else if (!(threads = mm_alloc(sizeof(pthread_t) * MAIL_CHECK_CACHE_MTHREADS))) {
+		st_sprint(errmsg, "Thread allocation error.");
+		return false;
+	}
+
+	for (uint64_t counter = 0; counter < MAIL_CHECK_CACHE_MTHREADS; counter++) {
+		if (thread_launch(threads + counter, &check_mail_cache_mthread_wrap, NULL)) {
+			st_sprint(errmsg, "Thread launch error.");
+			result = false;
+		}
+	}
+
+	for (uint64_t counter = 0; counter < MAIL_CHECK_CACHE_MTHREADS; counter++) {
+		if (thread_result(*(threads + counter), &outcome) || !outcome || !*(bool_t *)outcome) {
+			st_sprint(errmsg, "The shared message cache returned the wrong message text.");
+			result = false;
+		}
+		mm_cleanup(outcome);
+		outcome = NULL;
+	}
+
+	mm_free(threads);
+	return result;
+}
+
+bool_t check_mail_cache_sthread(stringer_t *errmsg) {
+
+	size_t length;
+	stringer_t *text, *cached;
+	uint64_t usernum = rand_get_uint64(), hits, misses, evictions;
+
+	if (!magma.storage.cache_size) {
+		st_sprint(errmsg, "SKIPPED");
+		return true;
+	}
+
+	hits = stats_get_value_by_name("objects.messages.cache.hits");
+	misses = stats_get_value_by_name("objects.messages.cache.misses");
+	evictions = stats_get_value_by_name("objects.messages.cache.evictions");
+
+	if (!(text = check_mail_cache_text(1, 4096))) {
+		st_sprint(errmsg, "Unable to generate the message text.");
+		return false;
+	}
+
+	// A message which was never cached should miss.
+	if ((cached = mail_cache_get(usernum, 1, true))) {
+		st_sprint(errmsg, "The message cache returned a message that was never cached.");
+		st_free(cached);
+		st_free(text);
+		return false;
+	}
+
+	// Once the thread cache is reset, the message should still be found in the shared cache.
+	mail_cache_set(usernum, 1, text, true);
+	mail_cache_reset();
+
+	if (!(cached = mail_cache_get(usernum, 1, true)) || st_cmp_cs_eq(cached, text)) {
+		st_sprint(errmsg, "The shared message cache didn't return the message.");
+		st_cleanup(cached);
+		st_free(text);
+		return false;
+	}
+
+	st_free(cached);
+	st_free(text);
+
+	// A lookup for an encrypted message should skip the shared cache.
+	if ((cached = mail_cache_get(usernum, 1, false))) {
+		st_sprint(errmsg, "The shared message cache was checked for an encrypted message.");
+		st_free(cached);
+		return false;
+	}
+
+	// Once the message is removed, neither cache should return it.
+	mail_cache_remove(usernum, 1);
+
+	if ((cached = mail_cache_get(usernum, 1, true))) {
+		st_sprint(errmsg, "The message cache returned a message that was removed.");
+		st_free(cached);
+		return false;
+	}
+
+	// The same message number, belonging to another user, shouldn't be found.
+	if ((cached = mail_cache_get(usernum + 1, 1, true))) {
+		st_sprint(errmsg, "The shared message cache returned a message belonging to a different user.");
+		st_free(cached);
+		return false;
+	}
+
+	// Fill the cache with twice its capacity, which should force entries out.
+	length = (magma.storage.cache_size / MAGMA_STORAGE_CACHE_SHARDS) / 8;
+
+	for (uint64_t i = 2; status() && i < (MAGMA_STORAGE_CACHE_SHARDS * 16) + 2; i++) {
+
+		if (!(text = check_mail_cache_text(i, length))) {
+			st_sprint(errmsg, "Unable to generate the message text.");
+			return false;
+		}
+
+		mail_cache_set(usernum, i, text, true);
+		st_free(text);
+	}
+
+	mail_cache_reset();
+
+	if (stats_get_value_by_name("objects.messages.cache.hits") <= hits || stats_get_value_by_name("objects.messages.cache.misses") <= misses ||
+		stats_get_value_by_name("objects.messages.cache.evictions") <= evictions) {
+		st_sprint(errmsg, "The message cache statistics weren't updated.");
+		return false;
+	}
+
+	return true;
+}
@@ -50,6 +50,58 @@ START_TEST (check_mail_headers_s) {
 }
 END_TEST
 
+START_TEST (check_mail_sync_m) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_mail_sync_mthread(errmsg);
+
+	log_test("MAIL / SYNC / MULTI THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_mail_sync_full_m) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_mail_sync_full_mthread(errmsg);
+
+	log_test("MAIL / SYNC / FULL BATCH / MULTI THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_mail_cache_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_mail_cache_sthread(errmsg);
+
+	log_test("MAIL / CACHE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_mail_cache_m) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_mail_cache_mthread(errmsg);
+
+	log_test("MAIL / CACHE / MULTI THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_mail(void) {
 
 	Suite *s = suite_create("\tMail");
@@ -57,6 +109,10 @@ Suite * suite_check_mail(void) {
 	suite_check_testcase(s, "MAIL", "Mail Store/S", check_mail_store_s);
 	suite_check_testcase(s, "MAIL", "Mail Load/S", check_mail_load_s);
 	suite_check_testcase(s, "MAIL", "Mail Headers/S", check_mail_headers_s);
+	suite_check_testcase(s, "MAIL", "Mail Sync/M", check_mail_sync_m);
+	suite_check_testcase(s, "MAIL", "Mail Sync Full Batch/M", check_mail_sync_full_m);
+	suite_check_testcase(s, "MAIL", "Mail Cache/S", check_mail_cache_s);
+	suite_check_testcase(s, "MAIL", "Mail Cache/M", check_mail_cache_m);
 
 	return s;
 }
@@ -16,6 +16,18 @@ bool_t   check_mail_load_sthread(stringer_t *errmsg);
 /// headers_check.c
 bool_t   check_mail_headers_sthread(stringer_t *errmsg);
 
+/// sync_check.c
+bool_t   check_mail_sync_full_mthread(stringer_t *errmsg);
+void     check_mail_sync_full_wrap(void);
+bool_t   check_mail_sync_mthread(stringer_t *errmsg);
+void     check_mail_sync_mthread_wrap(void);
+
+/// cache_check.c
+bool_t   check_mail_cache_sthread(stringer_t *errmsg);
+bool_t   check_mail_cache_mthread(stringer_t *errmsg);
+void     check_mail_cache_mthread_wrap(void);
+stringer_t *  check_mail_cache_text(uint64_t messagenum, size_t length);
+
 /// mail_check.c
 Suite *  suite_check_mail(void);
 
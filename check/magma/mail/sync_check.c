@@ -0,0 +1,152 @@
+
+/**
+ * @file /magma/check/magma/mail/sync_check.c
+ */
+
+#include "magma_check.h"
+
+void check_mail_sync_mthread_wrap(void) {
+
+	int fd;
+	chr_t path[1024];
+	bool_t *outcome;
+
+	if (!thread_start() || !(outcome = mm_alloc(sizeof(bool_t)))) {
+		log_unit("Unable to setup the thread context.");
+		pthread_exit(NULL);
+		return;
+	}
+
+	*outcome = true;
+
+	// Write a file into the storage tree, and then wait for the group commit to flush it.
+	for (uint32_t i = 0; *outcome && status() && i < MAIL_CHECK_SYNC_ITERATIONS; i++) {
+
+		snprintf(path, 1024, "%.*s/check.sync.XXXXXX", st_length_int(magma.storage.root), st_char_get(magma.storage.root));
+
+		if ((fd = mkstemp(path)) < 0) {
+			*outcome = false;
+		}
+		else {
+
+			if (write(fd, path, ns_length_get(path)) != ns_length_get(path) || !mail_sync_commit(fd)) {
+				*outcome = false;
+			}
+
+			close(fd);
+			unlink(path);
+		}
+	}
+
+	thread_stop();
+	pthread_exit(outcome);
+	return;
+}
+
+bool_t check_mail_sync_mthread(stringer_t *errmsg) {
+
+	void *outcome = NULL;
+	bool_t result = true;
+	pthread_t *threads = NULL;
+
+	if (!(threads = mm_alloc(sizeof(pthread_t) * MAIL_CHECK_SYNC_MTHREADS))) {
+		st_sprint(errmsg, "Thread allocation error.");
+		return false;
+	}
+
+	for (uint64_t counter = 0; counter < MAIL_CHECK_SYNC_MTHREADS; counter++) {
+		if (thread_launch(threads + counter, &check_mail_sync_mthread_wrap, NULL)) {
+			st_sprint(errmsg, "Thread launch error.");
+			result = false;
+		}
+	}
+
+	for (uint64_t counter = 0; counter < MAIL_CHECK_SYNC_MTHREADS; counter++) {
+		if (thread_result(*(threads + counter), &outcome) || !outcome || !*(bool_t *)outcome) {
+			st_sprint(errmsg, "The group commit failed to flush a message file.");
+			result = false;
+		}
+		mm_cleanup(outcome);
+		outcome = NULL;
+	}
+
+	mm_free(threads);
+	return result;
+}
+
+/**
+ * @brief	Write a single file into the storage tree, and wait for the group commit to flush it.
+ * @return	This function returns no value, but the thread result points to true on success, or false on failure.
+ */
+void check_mail_sync_full_wrap(void) {
+
+	int fd;
+	chr_t path[1024];
+	bool_t *outcome;
+
+	if (!thread_start() || !(outcome = mm_alloc(sizeof(bool_t)))) {
+		log_unit("Unable to setup the thread context.");
+		pthread_exit(NULL);
+		return;
+	}
+
+	snprintf(path, 1024, "%.*s/check.sync.XXXXXX", st_length_int(magma.storage.root), st_char_get(magma.storage.root));
+
+	if ((fd = mkstemp(path)) >= 0) {
+		*outcome = write(fd, path, ns_length_get(path)) == ns_length_get(path) && mail_sync_commit(fd);
+		close(fd);
+		unlink(path);
+	}
+
+	thread_stop();
+	pthread_exit(outcome);
+	return;
+}
+
+/**
+ * @brief	Fill an entire group commit batch, using a window far longer than the check should take, and verify the batch is flushed as
+ * 			soon as it fills, instead of when the window closes.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_mail_sync_full_mthread(stringer_t *errmsg) {
+
+	uint32_t window;
+	void *outcome = NULL;
+	bool_t result = true;
+	uint64_t launched = 0, elapsed;
+	struct timespec start, end;
+	pthread_t threads[MAGMA_STORAGE_SYNC_BATCH];
+
+	window = magma.storage.sync_window;
+	magma.storage.sync_window = MAIL_CHECK_SYNC_FULL_WINDOW;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (; launched < MAGMA_STORAGE_SYNC_BATCH; launched++) {
+		if (thread_launch(threads + launched, &check_mail_sync_full_wrap, NULL)) {
+			st_sprint(errmsg, "Thread launch error.");
+			result = false;
+			break;
+		}
+	}
+
+	for (uint64_t i = 0; i < launched; i++) {
+		if (thread_result(threads[i], &outcome) || !outcome || !*(bool_t *)outcome) {
+			st_sprint(errmsg, "The group commit failed to flush a message file.");
+			result = false;
+		}
+		mm_cleanup(outcome);
+		outcome = NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = ((end.tv_sec - start.tv_sec) * 1000) + ((end.tv_nsec - start.tv_nsec) / 1000000);
+	magma.storage.sync_window = window;
+
+	if (result && elapsed >= MAIL_CHECK_SYNC_FULL_WINDOW) {
+		st_sprint(errmsg, "The full group commit batch waited for the window to close. { elapsed = %lu ms }", elapsed);
+		result = false;
+	}
+
+	return result;
+}
@@ -7,10 +7,547 @@
 
 #include "magma_check.h"
 
+/**
+ * @brief	Connect a pair of sockets across the loopback interface.
+ * @param	local	a pointer to receive the socket used by the connection object.
+ * @param	remote	a pointer to receive the socket used to collect what the connection sends.
+ * @return	true on success, or false on failure.
+ */
+bool_t check_network_pair(int *local, int *remote) {
+
+	int listener;
+	struct sockaddr_in address;
+	socklen_t length = sizeof(struct sockaddr_in);
+
+	*local = *remote = -1;
+	mm_wipe(&address, sizeof(struct sockaddr_in));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((listener = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+		return false;
+	}
+	else if (bind(listener, (struct sockaddr *)&address, sizeof(struct sockaddr_in)) || listen(listener, 1) ||
+		getsockname(listener, (struct sockaddr *)&address, &length) || (*remote = socket(AF_INET, SOCK_STREAM, 0)) == -1 ||
+		connect(*remote, (struct sockaddr *)&address, sizeof(struct sockaddr_in)) || (*local = accept(listener, NULL, NULL)) == -1) {
+		if (*remote != -1) close(*remote);
+		close(listener);
+		return false;
+	}
+
+	close(listener);
+
+	// Make the socket buffers large enough to hold everything the check sends, since nothing reads the data until it's all been sent.
+	net_set_buffer_length(*local, NETWORK_CHECK_OUTPUT_BUFFER, NETWORK_CHECK_OUTPUT_BUFFER);
+	net_set_buffer_length(*remote, NETWORK_CHECK_OUTPUT_BUFFER, NETWORK_CHECK_OUTPUT_BUFFER);
+
+	return true;
+}
+
+/**
+ * @brief	Read exactly the specified number of bytes from a socket, and make sure nothing else is waiting.
+ */
+bool_t check_network_collect(int sockd, stringer_t *output, size_t length) {
+
+	ssize_t bytes;
+
+	st_length_set(output, 0);
+
+	while (st_length_get(output) < length) {
+		if ((bytes = recv(sockd, st_char_get(output) + st_length_get(output), length - st_length_get(output), 0)) <= 0) {
+			return false;
+		}
+		st_length_set(output, st_length_get(output) + bytes);
+	}
+
+	return recv(sockd, MEMORYBUF(1), 1, MSG_DONTWAIT) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * @brief	Perform a series of TLS handshakes with a server, and time how long they take.
+ * @param	port		the port of the TLS server.
+ * @param	resume		if true, the session negotiated by the first handshake is offered to the server by every handshake which follows.
+ * @param	resumed		a pointer to receive the number of handshakes which resumed a previous session.
+ * @param	elapsed		a pointer to receive the number of nanoseconds it took to complete the handshakes.
+ * @return	true if every handshake succeeded, otherwise false.
+ */
+bool_t check_network_handshakes(uint32_t port, bool_t resume, uint64_t *resumed, uint64_t *elapsed) {
+
+	bool_t result = true;
+	client_t *client = NULL;
+	SSL_SESSION *session = NULL;
+	struct timespec start, end;
+
+	*resumed = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (uint64_t i = 0; result && status() && i < NETWORK_CHECK_HANDSHAKES; i++) {
+
+		if (!(client = client_connect("localhost", port)) || !(client->tls = tls_client_resume(client->sockd, session))) {
+			result = false;
+		}
+		else {
+
+			if (tls_resumed(client->tls)) {
+				(*resumed)++;
+			}
+
+			if (resume && !session) {
+				session = SSL_get1_session_d(client->tls);
+			}
+		}
+
+		if (client) {
+			client_close(client);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	*elapsed = ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+	if (session) {
+		SSL_SESSION_free_d(session);
+	}
+
+	return result;
+}
+
+/// The state shared with the stub name server, which answers the reverse DNS queries sent by the resolver check.
+struct {
+	int sockd;
+	bool_t running;
+	uint64_t requests;
+	pthread_t *thread;
+	in_port_t ports[4]; /* The source ports of the first few queries. */
+	struct sockaddr_in address;
+} check_network_dns;
+
+/// The result of a reverse DNS lookup, as delivered by the resolver.
+typedef struct {
+	bool_t found, done;
+	chr_t domain[128];
+} check_network_lookup_t;
+
+/**
+ * @brief	A stub name server, which serves canned PTR records for the resolver check until it's stopped.
+ * @note	The name 1.2.0.192.in-addr.arpa resolves to one.check.magma, 3.2.0.192.in-addr.arpa resolves to three.check.magma, and
+ * 			every other name is answered with NXDOMAIN.
+ * @return	This function returns no value.
+ */
+void check_network_dns_server(void) {
+
+	ssize_t length;
+	socklen_t size;
+	uint64_t count;
+	size_t position, label;
+	struct sockaddr_in source;
+	chr_t name[256], *answer;
+	uchr_t packet[512];
+
+	while (__atomic_load_n(&check_network_dns.running, __ATOMIC_ACQUIRE)) {
+
+		size = sizeof(struct sockaddr_in);
+
+		if ((length = recvfrom(check_network_dns.sockd, packet, sizeof(packet), 0, (struct sockaddr *)&source, &size)) <= 12) {
+			continue;
+		}
+
+		// Decode the question name.
+		position = 12;
+		name[0] = '\0';
+
+		while (position < (size_t)length && (label = packet[position]) && position + label < (size_t)length &&
+			ns_length_get(name) + label + 2 < sizeof(name)) {
+			if (*name) strcat(name, ".");
+			strncat(name, (chr_t *)packet + position + 1, label);
+			position += label + 1;
+		}
+
+		// Skip the root label, and the question type and class.
+		if ((position += 5) > (size_t)length) {
+			continue;
+		}
+
+		// Remember where the first few queries came from, so the check can verify they weren't all sent from the same port.
+		if ((count = __atomic_add_fetch(&check_network_dns.requests, 1, __ATOMIC_RELEASE)) <= 4) {
+			check_network_dns.ports[count - 1] = ntohs(source.sin_port);
+		}
+
+		answer = !strcasecmp(name, "1.2.0.192.in-addr.arpa") ? "one.check.magma" :
+			!strcasecmp(name, "3.2.0.192.in-addr.arpa") ? "three.check.magma" : NULL;
+
+		// The reply echoes the question, with the response, and recursion available, flags set.
+		packet[2] = 0x81;
+		packet[3] = answer ? 0x80 : 0x83;
+		packet[6] = packet[8] = packet[9] = packet[10] = packet[11] = 0;
+		packet[7] = answer ? 1 : 0;
+
+		if (answer) {
+
+			// The answer refers back to the question name, and holds a sixty second PTR record.
+			mm_copy(packet + position, "\xc0\x0c\x00\x0c\x00\x01\x00\x00\x00\x3c", 10);
+			label = dn_comp(answer, packet + position + 12, sizeof(packet) - position - 12, NULL, NULL);
+			packet[position + 10] = label >> 8;
+			packet[position + 11] = label & 0xff;
+			position += label + 12;
+		}
+
+		sendto(check_network_dns.sockd, packet, position, MSG_NOSIGNAL, (struct sockaddr *)&source, size);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Launch the stub name server on an ephemeral port, bound to the loopback interface.
+ * @return	true on success, or false on failure.
+ */
+bool_t check_network_dns_start(void) {
+
+	struct timeval timeout = { .tv_sec = 0, .tv_usec = 100000 };
+	socklen_t length = sizeof(struct sockaddr_in);
+
+	mm_wipe(&check_network_dns, sizeof(check_network_dns));
+	check_network_dns.address.sin_family = AF_INET;
+	check_network_dns.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((check_network_dns.sockd = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+		return false;
+	}
+	else if (bind(check_network_dns.sockd, (struct sockaddr *)&check_network_dns.address, sizeof(struct sockaddr_in)) ||
+		getsockname(check_network_dns.sockd, (struct sockaddr *)&check_network_dns.address, &length) ||
+		setsockopt(check_network_dns.sockd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(struct timeval))) {
+		close(check_network_dns.sockd);
+		return false;
+	}
+
+	check_network_dns.running = true;
+
+	if (!(check_network_dns.thread = thread_alloc(check_network_dns_server, NULL))) {
+		close(check_network_dns.sockd);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the stub name server.
+ * @return	This function returns no value.
+ */
+void check_network_dns_stop(void) {
+
+	__atomic_store_n(&check_network_dns.running, false, __ATOMIC_RELEASE);
+
+	if (check_network_dns.thread) {
+		thread_join(*check_network_dns.thread);
+		mm_free(check_network_dns.thread);
+		check_network_dns.thread = NULL;
+	}
+
+	close(check_network_dns.sockd);
+
+	return;
+}
+
+/**
+ * @brief	Record the result of a reverse DNS lookup.
+ * @param	lookup	the lookup which finished.
+ * @param	domain	the domain name returned by the resolver, or NULL if the lookup failed.
+ * @return	This function returns no value.
+ */
+static void check_network_resolved(check_network_lookup_t *lookup, stringer_t *domain) {
+
+	if (domain) {
+		snprintf(lookup->domain, sizeof(lookup->domain), "%.*s", st_length_int(domain), st_char_get(domain));
+		lookup->found = true;
+	}
+
+	__atomic_store_n(&(lookup->done), true, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Look up an address using the reverse DNS resolver, and wait for the result.
+ * @param	address		the address to look up.
+ * @param	lookups		the number of concurrent lookups to submit for the address.
+ * @param	expected	the domain name which should be returned, or NULL if the lookup should fail.
+ * @return	true if every lookup returned the expected result, otherwise false.
+ */
+bool_t check_network_resolve(chr_t *address, uint_t lookups, chr_t *expected) {
+
+	ip_t ip;
+	bool_t result = true;
+	check_network_lookup_t results[lookups];
+
+	mm_wipe(results, sizeof(results));
+
+	if (!ip_addr_st(address, &ip)) {
+		return false;
+	}
+
+	for (uint_t i = 0; i < lookups; i++) {
+		net_resolver_lookup(&ip, &check_network_resolved, results + i);
+	}
+
+	for (uint_t i = 0; i < lookups; i++) {
+
+		// The lookups should finish well before the resolver gives up, so five seconds is more than enough.
+		for (uint_t wait = 0; wait < 5000 && !__atomic_load_n(&(results[i].done), __ATOMIC_ACQUIRE) && status(); wait++) {
+			usleep(1000);
+		}
+
+		if (!__atomic_load_n(&(results[i].done), __ATOMIC_ACQUIRE) || results[i].found != (expected != NULL) ||
+			(expected && strcmp(results[i].domain, expected))) {
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+START_TEST (check_network_output_s) {
+
+	log_disable();
+	server_t server;
+	int local = -1, remote = -1;
+	bool_t result = true;
+	connection_t *con = NULL;
+	uint64_t syscalls = 0, lines;
+	stringer_t *errmsg = NULL, *expected = NULL, *received = NULL, *block = NULL;
+
+	mm_wipe(&server, sizeof(server_t));
+
+	if (!check_network_pair(&local, &remote) || !(con = con_init(local, &server)) || !(expected = st_alloc(NETWORK_CHECK_OUTPUT_BUFFER)) ||
+		!(received = st_alloc(NETWORK_CHECK_OUTPUT_BUFFER)) || !(block = st_alloc(MAGMA_CONNECTION_OUTPUT_SIZE * 2))) {
+		errmsg = NULLER("Unable to setup the network output check.");
+		if (!con && local != -1) close(local);
+		result = false;
+	}
+
+	// A response made of many small lines should be held until the command finishes, and then be sent using a single system call.
+	if (result) {
+
+		syscalls = stats_get_value_by_name("network.output.syscalls");
+
+		for (lines = 0; lines < NETWORK_CHECK_OUTPUT_LINES; lines++) {
+			con_print(con, "* %lu FETCH (FLAGS (\\Seen) UID %lu)\r\n", lines + 1, lines + 1);
+			expected = st_append(expected, st_quick(MANAGEDBUF(128), "* %lu FETCH (FLAGS (\\Seen) UID %lu)\r\n", lines + 1, lines + 1));
+		}
+
+		if (stats_get_value_by_name("network.output.syscalls") != syscalls) {
+			errmsg = NULLER("The connection sent output before the command finished.");
+			result = false;
+		}
+		else if (con_flush(con) != st_length_get(expected) || stats_get_value_by_name("network.output.syscalls") != syscalls + 1) {
+			errmsg = NULLER("The connection output wasn't sent using a single system call.");
+			result = false;
+		}
+		else if (!check_network_collect(remote, received, st_length_get(expected)) || st_cmp_cs_eq(expected, received)) {
+			errmsg = NULLER("The connection output didn't match what was written.");
+			result = false;
+		}
+	}
+
+	// A write larger than the buffer should be sent along with any pending output, in order.
+	if (result) {
+
+		st_length_set(expected, 0);
+		rand_write(block);
+		st_length_set(block, st_avail_get(block));
+
+		con_write_bl(con, "* 1 FETCH (BODY[] {32768}\r\n", 27);
+		expected = st_append(expected, PLACER("* 1 FETCH (BODY[] {32768}\r\n", 27));
+		con_write_st(con, block);
+		expected = st_append(expected, block);
+		con_write_bl(con, ")\r\n", 3);
+		expected = st_append(expected, PLACER(")\r\n", 3));
+		con_flush(con);
+
+		if (!check_network_collect(remote, received, st_length_get(expected)) || st_cmp_cs_eq(expected, received)) {
+			errmsg = NULLER("The connection output was reordered, or lost, when a write overflowed the buffer.");
+			result = false;
+		}
+	}
+
+	// Once the connection is parked, the output buffer should be released, and allocated again by the next write.
+	if (result) {
+
+		con_release(con);
+
+		if (con->network.output) {
+			errmsg = NULLER("The output buffer wasn't released when the connection was parked.");
+			result = false;
+		}
+		else if (con_write_bl(con, "* OK\r\n", 6) != 6 || !con->network.output || con_flush(con) != 6 ||
+			!check_network_collect(remote, received, 6) || st_cmp_cs_eq(PLACER("* OK\r\n", 6), received)) {
+			errmsg = NULLER("The connection output was lost after the output buffer was released.");
+			result = false;
+		}
+	}
+
+	log_test("NETWORK / OUTPUT / SINGLE THREADED:", errmsg);
+
+	if (result) {
+		log_unit("%-32.32s %8i lines / %2lu system calls\n", "", NETWORK_CHECK_OUTPUT_LINES, stats_get_value_by_name("network.output.syscalls") - syscalls);
+	}
+
+	con_destroy(con);
+	if (remote != -1) close(remote);
+	st_cleanup(expected, received, block);
+
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_network_resumption_s) {
+
+	log_disable();
+	server_t *server = NULL;
+	bool_t result = true;
+	stringer_t *errmsg = NULL;
+	uint64_t full = 0, resumed = 0, full_elapsed = 1, resumed_elapsed = 1;
+
+	if (status() && !(server = servers_get_by_protocol(POP, true))) {
+		errmsg = NULLER("No POP servers were configured to support TLS connections.");
+		result = false;
+	}
+	else if (status() && !check_network_handshakes(server->network.port, false, &full, &full_elapsed)) {
+		errmsg = NULLER("Unable to complete the full TLS handshakes.");
+		result = false;
+	}
+	else if (status() && full) {
+		errmsg = NULLER("A TLS handshake was resumed, even though no session was offered.");
+		result = false;
+	}
+	else if (status() && !check_network_handshakes(server->network.port, true, &resumed, &resumed_elapsed)) {
+		errmsg = NULLER("Unable to complete the resumed TLS handshakes.");
+		result = false;
+	}
+	// Only the first connection should need a full handshake.
+	else if (status() && resumed != NETWORK_CHECK_HANDSHAKES - 1) {
+		errmsg = NULLER("The server didn't allow the previous TLS session to be resumed.");
+		result = false;
+	}
+
+	log_test("NETWORK / TLS / RESUMPTION / SINGLE THREADED:", errmsg);
+
+	if (result && status()) {
+		log_unit("%-32.32s %8.2f full handshakes per second\n", "", (NETWORK_CHECK_HANDSHAKES * 1000000000.0) / full_elapsed);
+		log_unit("%-32.32s %8.2f resumed handshakes per second\n", "", (NETWORK_CHECK_HANDSHAKES * 1000000000.0) / resumed_elapsed);
+	}
+
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_network_offload_s) {
+
+	log_disable();
+	bool_t result = true;
+	server_t *server = NULL;
+	client_t *client = NULL;
+	stringer_t *errmsg = NULL;
+	uint64_t offloaded = stats_get_value_by_name("network.tls.offloaded.total");
+
+	// Whether the kernel, or OpenSSL, encrypts the greeting, the client should be able to read it.
+	if (status() && !(server = servers_get_by_protocol(POP, true))) {
+		errmsg = NULLER("No POP servers were configured to support TLS connections.");
+		result = false;
+	}
+	else if (status() && (!(client = client_connect("localhost", server->network.port)) || client_secure(client) ||
+		!net_set_timeout(client->sockd, 20, 20))) {
+		errmsg = NULLER("Unable to establish a TLS connection with the POP server.");
+		result = false;
+	}
+	else if (status() && (client_read_line(client) <= 0 || st_cmp_cs_starts(&(client->line), PLACER("+OK", 3)))) {
+		errmsg = NULLER("The POP server greeting couldn't be read over the TLS connection.");
+		result = false;
+	}
+
+	if (client) {
+		client_close(client);
+	}
+
+	log_test("NETWORK / TLS / OFFLOAD / SINGLE THREADED:", errmsg);
+
+	if (result && status()) {
+		log_unit("%-32.32s %s\n", "", stats_get_value_by_name("network.tls.offloaded.total") != offloaded ? "kernel encryption" :
+			"user space encryption");
+	}
+
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_network_resolver_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = NULL;
+	uint64_t requests = 0, hits = stats_get_value_by_name("network.reverse.cache.hits");
+
+	if (status() && !check_network_dns_start()) {
+		errmsg = NULLER("Unable to start the stub name server.");
+		result = false;
+	}
+	else if (status()) {
+		net_resolver_nameserver(&check_network_dns.address);
+	}
+
+	if (result && status() && !check_network_resolve("192.0.2.1", 1, "one.check.magma")) {
+		errmsg = NULLER("The PTR record served by the stub name server wasn't returned.");
+		result = false;
+	}
+	// The second lookup should be answered from the cache, without asking the name server again.
+	else if (result && status() && (!check_network_resolve("192.0.2.1", 1, "one.check.magma") ||
+		(requests = __atomic_load_n(&check_network_dns.requests, __ATOMIC_ACQUIRE)) != 1)) {
+		errmsg = NULLER("The cached PTR record wasn't used.");
+		result = false;
+	}
+	else if (result && status() && (!check_network_resolve("192.0.2.2", 1, NULL) || !check_network_resolve("192.0.2.2", 1, NULL) ||
+		(requests = __atomic_load_n(&check_network_dns.requests, __ATOMIC_ACQUIRE)) != 2)) {
+		errmsg = NULLER("The missing PTR record wasn't cached as a negative result.");
+		result = false;
+	}
+	// Concurrent lookups for the same address should share a single query.
+	else if (result && status() && (!check_network_resolve("192.0.2.3", 8, "three.check.magma") ||
+		(requests = __atomic_load_n(&check_network_dns.requests, __ATOMIC_ACQUIRE)) != 3)) {
+		errmsg = NULLER("The concurrent lookups weren't coalesced into a single query.");
+		result = false;
+	}
+	// Every query is sent from its own socket, so the three queries shouldn't share a source port.
+	else if (result && status() && check_network_dns.ports[0] == check_network_dns.ports[1] &&
+		check_network_dns.ports[1] == check_network_dns.ports[2]) {
+		errmsg = NULLER("The queries were all sent from the same source port.");
+		result = false;
+	}
+
+	if (check_network_dns.thread) {
+		net_resolver_nameserver(NULL);
+		check_network_dns_stop();
+	}
+
+	log_test("NETWORK / RESOLVER / SINGLE THREADED:", errmsg);
+
+	if (result && status()) {
+		log_unit("%-32.32s %8lu queries / %2lu cache hits\n", "", requests, stats_get_value_by_name("network.reverse.cache.hits") - hits);
+	}
+
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_network(void) {
 
 	Suite *s = suite_create("\tNetwork");
 
+	suite_check_testcase(s, "NETWORK", "Network Output Buffering/S", check_network_output_s);
+	suite_check_testcase(s, "NETWORK", "Network TLS Resumption/S", check_network_resumption_s);
+	suite_check_testcase(s, "NETWORK", "Network TLS Offload/S", check_network_offload_s);
+	suite_check_testcase(s, "NETWORK", "Network Resolver/S", check_network_resolver_s);
+
 	// The IP address checks were the only thing handled by this suite. Those checks have since moved to
 	// to core. The empty suite remains to remind us what needs doing.
 
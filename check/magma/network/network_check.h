@@ -8,6 +8,15 @@
 #ifndef NETWORK_CHECK_H
 #define NETWORK_CHECK_H
 
+/// network_check.c
+bool_t   check_network_collect(int sockd, stringer_t *output, size_t length);
+void     check_network_dns_server(void);
+bool_t   check_network_dns_start(void);
+void     check_network_dns_stop(void);
+bool_t   check_network_handshakes(uint32_t port, bool_t resume, uint64_t *resumed, uint64_t *elapsed);
+bool_t   check_network_pair(int *local, int *remote);
+bool_t   check_network_resolve(chr_t *address, uint_t lookups, chr_t *expected);
+
 Suite * suite_check_network(void);
 
 #endif
@@ -117,12 +117,293 @@ START_TEST (check_warehouse_domains_s) {
 }
 END_TEST
 
+/**
+ * @brief	Count the number of times a subscriber is woken, or put to sleep, by the mailbox notification table.
+ */
+bool_t check_object_notify_wake(void *data) {
+	(*(uint64_t *)data)++;
+	return true;
+}
+
+void check_object_notify_wait(void *data) {
+	(*(uint64_t *)data) += 100;
+	return;
+}
+
+START_TEST (check_object_notify_s) {
+
+	log_disable();
+	bool_t result = true, overflow;
+	size_t count = 0;
+	inx_t *messages = NULL;
+	stringer_t *errmsg = NULL;
+	notify_subscriber_t *subscriber = NULL;
+	uint64_t woken = 0, usernum = rand_get_uint64() | 1, changed[MAGMA_NOTIFY_CHANGES];
+	meta_message_t first = { .messagenum = 1, .foldernum = 7 }, second = { .messagenum = 2, .foldernum = 7 };
+	multi_t one = { .type = M_TYPE_UINT64, .val.u64 = 1 }, two = { .type = M_TYPE_UINT64, .val.u64 = 2 };
+
+	if (!(subscriber = notify_subscribe(usernum, 7, &check_object_notify_wake, &woken)) || !(messages = inx_alloc(M_INX_LINKED, NULL)) ||
+		!inx_insert(messages, one, &first) || !inx_insert(messages, two, &second)) {
+		errmsg = NULLER("Unable to setup the mailbox notification check.");
+		result = false;
+	}
+
+	// Events published for another user, or another folder, shouldn't wake the subscriber.
+	if (result) {
+
+		notify_publish(OBJECT_MESSAGES, usernum + 1);
+		notify_publish_flags(usernum, 8, messages);
+
+		if (woken || notify_take(subscriber, changed, &count, &overflow) || count || overflow) {
+			errmsg = NULLER("The mailbox notification table woke the wrong subscriber.");
+			result = false;
+		}
+	}
+
+	// A serial number increment, and a flag change, should both be recorded.
+	if (result) {
+
+		serial_increment(OBJECT_MESSAGES, usernum);
+		notify_publish_flags(usernum, 7, messages);
+		notify_publish_flags(usernum, 7, messages);
+
+		if (woken != 3 || notify_wait(subscriber, &check_object_notify_wait, &woken) || woken != 3 ||
+			notify_take(subscriber, changed, &count, &overflow) != (1 << OBJECT_MESSAGES) || count != 2 || overflow ||
+			changed[0] != 1 || changed[1] != 2) {
+			errmsg = NULLER("The mailbox notification table didn't record the published events.");
+			result = false;
+		}
+	}
+
+	// Once the events have been collected, the subscriber should be put to sleep.
+	if (result && (!notify_wait(subscriber, &check_object_notify_wait, &woken) || woken != 103)) {
+		errmsg = NULLER("The mailbox notification table didn't put the subscriber to sleep.");
+		result = false;
+	}
+
+	notify_unsubscribe(subscriber);
+	inx_cleanup(messages);
+
+	// After unsubscribing, events shouldn't reach the subscriber.
+	if (result) {
+		notify_publish(OBJECT_MESSAGES, usernum);
+
+		if (woken != 103) {
+			errmsg = NULLER("The mailbox notification table woke a subscriber that was removed.");
+			result = false;
+		}
+	}
+
+	log_test("OBJECTS / NOTIFY / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
+/**
+ * @brief	Read the status of every message in a folder back from the database, and compare it with the expected value.
+ * @param	usernum		the numerical id of the user who owns the folder.
+ * @param	foldernum	the numerical id of the folder.
+ * @param	control		the numerical id of the message which was left out of the updates.
+ * @param	updated		the status expected for every message which was updated.
+ * @param	untouched	the status expected for the control message.
+ * @return	true if every message had the expected status, otherwise false.
+ */
+static bool_t check_object_flags_verify(uint64_t usernum, uint64_t foldernum, uint64_t control, uint32_t updated, uint32_t untouched) {
+
+	bool_t result = true;
+	message_t *record;
+	inx_cursor_t *cursor = NULL;
+	message_folder_t *folder = NULL;
+	uint64_t rows = 0;
+
+	if (!(folder = message_folder_alloc(foldernum, 0, 0, NULLER("check"))) || !meta_data_fetch_folder_messages(usernum, folder) ||
+		!(cursor = inx_cursor_alloc(folder->records))) {
+		result = false;
+	}
+
+	while (result && (record = inx_cursor_value_next(cursor))) {
+		if (record->status.flags != (record->message.num == control ? untouched : updated)) {
+			result = false;
+		}
+		rows++;
+	}
+
+	if (cursor) inx_cursor_free(cursor);
+	if (folder) message_folder_free(folder);
+
+	return result && rows == OBJECT_CHECK_FLAGS_MESSAGES;
+}
+
+START_TEST (check_object_flags_s) {
+
+	log_disable();
+	int64_t transaction;
+	inx_t *messages = NULL;
+	bool_t result = true;
+	stringer_t *errmsg = NULL, *name = NULL;
+	meta_message_t *message;
+	struct timespec start, end;
+	uint32_t initial = MAIL_STATUS_RECENT | MAIL_STATUS_ANSWERED;
+	uint64_t batches = 0, elapsed = 0, usernum = 1, foldernum = 0, control = 0, inserted = 0, messagenums[OBJECT_CHECK_FLAGS_MESSAGES];
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	// The check needs real rows to update, so it's skipped when the database isn't available.
+	if (!status()) {
+		log_test("OBJECTS / FLAGS / SINGLE THREADED:", NULLER("SKIPPED"));
+		return;
+	}
+
+	// The messages are placed inside a folder of their own, so the updates can't disturb any other messages.
+	if (!(name = st_aprint("check.flags.%lu", rand_get_uint64())) || !(foldernum = meta_data_insert_folder(usernum, name, 0, 0))) {
+		errmsg = NULLER("Unable to create the message flag folder.");
+		result = false;
+	}
+	else if ((transaction = tran_start()) < 0) {
+		errmsg = NULLER("Unable to start the message insert transaction.");
+		result = false;
+	}
+	else {
+
+		for (; inserted < OBJECT_CHECK_FLAGS_MESSAGES; inserted++) {
+			if (!(messagenums[inserted] = mail_db_insert_message(usernum, foldernum, initial, 1, 0, 0, transaction))) {
+				break;
+			}
+		}
+
+		if (inserted != OBJECT_CHECK_FLAGS_MESSAGES) {
+			tran_rollback(transaction);
+			inserted = 0;
+			errmsg = NULLER("Unable to insert the message flag rows.");
+			result = false;
+		}
+		else if (tran_commit(transaction)) {
+			inserted = 0;
+			errmsg = NULLER("Unable to commit the message flag rows.");
+			result = false;
+		}
+	}
+
+	// The last message is left out of the collection, so it can be used to confirm the updates don't spill over onto other rows.
+	if (result && !(messages = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+		errmsg = NULLER("Unable to allocate the message collection.");
+		result = false;
+	}
+
+	for (uint64_t i = 0; result && i < OBJECT_CHECK_FLAGS_MESSAGES - 1; i++) {
+
+		if (!(message = meta_message_alloc())) {
+			errmsg = NULLER("Unable to allocate a message.");
+			result = false;
+		}
+		else {
+
+			message->messagenum = key.val.u64 = messagenums[i];
+			message->foldernum = foldernum;
+			message->status = initial;
+
+			if (!inx_append(messages, key, message)) {
+				errmsg = NULLER("Unable to add a message to the collection.");
+				meta_message_free(message);
+				result = false;
+			}
+		}
+	}
+
+	if (result) {
+		control = messagenums[OBJECT_CHECK_FLAGS_MESSAGES - 1];
+		batches = stats_get_value_by_name("objects.messages.flags.batches");
+	}
+
+	// Each update spans a partial final batch, since the collection isn't a multiple of the batch size, and the rows are read back
+	// after every update, to confirm every message was changed, and the control message wasn't.
+	if (result) {
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		result = meta_data_flags_add(messages, usernum, foldernum, MAIL_STATUS_SEEN);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+		if (!result || !check_object_flags_verify(usernum, foldernum, control, initial | MAIL_STATUS_SEEN, initial)) {
+			errmsg = NULLER("The message flags weren't added to every message.");
+			result = false;
+		}
+	}
+
+	if (result) {
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		result = meta_data_flags_remove(messages, usernum, foldernum, MAIL_STATUS_ANSWERED);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+		if (!result || !check_object_flags_verify(usernum, foldernum, control, MAIL_STATUS_RECENT | MAIL_STATUS_SEEN, initial)) {
+			errmsg = NULLER("The message flags weren't removed from every message.");
+			result = false;
+		}
+	}
+
+	// Replacing the flags should strip the user flags, but leave the system flags alone.
+	if (result) {
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		result = meta_data_flags_replace(messages, usernum, foldernum, MAIL_STATUS_FLAGGED);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+
+		if (!result || !check_object_flags_verify(usernum, foldernum, control, MAIL_STATUS_RECENT | MAIL_STATUS_FLAGGED, initial)) {
+			errmsg = NULLER("The message flags weren't replaced on every message.");
+			result = false;
+		}
+	}
+
+	// Each call should issue a single statement per batch of messages, instead of one statement per message.
+	if (result) {
+
+		batches = stats_get_value_by_name("objects.messages.flags.batches") - batches;
+
+		if (batches != 3 * ((OBJECT_CHECK_FLAGS_MESSAGES - 1 + UPDATE_MESSAGE_FLAGS_BATCH - 1) / UPDATE_MESSAGE_FLAGS_BATCH)) {
+			errmsg = NULLER("The message flag updates weren't split into the expected number of batches.");
+			result = false;
+		}
+	}
+
+	inx_cleanup(messages);
+
+	// Remove the rows, and then the folder, so the check leaves the user the way it found them.
+	if (inserted && (transaction = tran_start()) >= 0) {
+
+		for (uint64_t i = 0; i < inserted; i++) {
+			mail_db_delete_message(usernum, messagenums[i], 1, transaction);
+		}
+
+		tran_commit(transaction);
+	}
+
+	if (foldernum) {
+		meta_data_delete_folder(usernum, foldernum);
+	}
+
+	st_cleanup(name);
+
+	log_test("OBJECTS / FLAGS / SINGLE THREADED:", errmsg);
+
+	if (result) {
+		log_unit("%-32.32s %8i messages / %6lu statements / %10.3f ms\n", "", OBJECT_CHECK_FLAGS_MESSAGES - 1, batches,
+			(double)elapsed / 1000000.0);
+	}
+
+	ck_assert_msg(result, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_objects(void) {
 
 	Suite *s = suite_create("\tObjects");
 
 	suite_check_testcase(s, "OBJECTS", "Object Serials/S", check_object_serials_s);
 	suite_check_testcase(s, "OBJECTS", "Object Warehouse Domains/S", check_warehouse_domains_s);
+	suite_check_testcase(s, "OBJECTS", "Object Notifications/S", check_object_notify_s);
+	suite_check_testcase(s, "OBJECTS", "Object Message Flags/S", check_object_flags_s);
 
 	return s;
 }
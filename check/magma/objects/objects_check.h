@@ -8,6 +8,10 @@
 #ifndef OBJECTS_CHECK_H
 #define OBJECTS_CHECK_H
 
+/// objects_check.c
+void check_object_notify_wait(void *data);
+bool_t check_object_notify_wake(void *data);
+
 Suite * suite_check_objects(void);
 
 #endif
@@ -0,0 +1,193 @@
+/**
+ * @file /check/magma/providers/fulltext_check.c
+ *
+ * @brief Checks the trigram splitting, text decoding, indexing, compaction and query logic of the full text search index.
+ */
+
+#include "magma_check.h"
+
+/**
+ * @brief	Verify that text is split into the sorted, unique set of lower case trigrams the index records.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_fulltext_grams_sthread(stringer_t *errmsg) {
+
+	size_t count = 0;
+	uint32_t *grams;
+	chr_t *expected[] = { "ell", "hel", "llo" };
+
+	// The repeated word should only be counted once, regardless of case, and the two letter word shouldn't produce any trigrams.
+	if (!(grams = fulltext_grams(NULLER("Hello, HELLO... hi"), &count))) {
+		st_sprint(errmsg, "The trigram splitter didn't return any trigrams.");
+		return false;
+	}
+	else if (count != sizeof(expected) / sizeof(chr_t *)) {
+		st_sprint(errmsg, "The trigram splitter returned the wrong number of trigrams. { count = %zu }", count);
+		mm_free(grams);
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (grams[i] != (((uint32_t)expected[i][0] << 16) | ((uint32_t)expected[i][1] << 8) | (uint32_t)expected[i][2])) {
+			st_sprint(errmsg, "The trigram splitter returned the wrong trigram. { expected = %s / gram = %06x }", expected[i], grams[i]);
+			mm_free(grams);
+			return false;
+		}
+	}
+
+	mm_free(grams);
+	return true;
+}
+
+/**
+ * @brief	Verify that encoded text parts are decoded before they're searched, while attachments are skipped, and that the raw lines
+ * 			indexed for BODY searches leave out the base64 encoded data.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_fulltext_decode_sthread(stringer_t *errmsg) {
+
+	size_t location;
+	bool_t result = true;
+	mail_mime_t *mime;
+	stringer_t *text = NULL, *raw = NULL;
+
+	// The first part is base64 encoded "Hello encoded world.", the second is quoted-printable, and the third is an attachment.
+	if (!(mime = mail_mime_part(NULLER("Content-Type: multipart/mixed; boundary=\"xyz\"\r\n\r\n"
+		"--xyz\r\nContent-Type: text/plain\r\nContent-Transfer-Encoding: base64\r\n\r\nSGVsbG8gZW5jb2RlZCB3b3JsZC4=\r\n"
+		"--xyz\r\nContent-Type: text/plain\r\nContent-Transfer-Encoding: quoted-printable\r\n\r\nsoft=\r\nbreak caf=C3=A9\r\n"
+		"--xyz\r\nContent-Type: application/octet-stream\r\nContent-Transfer-Encoding: base64\r\n\r\nQXR0YWNobWVudA==\r\n"
+		"--xyz--\r\n"), 1)) || !(text = mail_mime_text(mime))) {
+		st_sprint(errmsg, "The searchable text of the message couldn't be decoded.");
+		result = false;
+	}
+	else if (st_search_ci(text, NULLER("encoded world"), &location) != 1 || st_search_ci(text, NULLER("softbreak caf\xc3\xa9"), &location) != 1) {
+		st_sprint(errmsg, "The encoded text parts weren't decoded.");
+		result = false;
+	}
+	else if (st_search_ci(text, NULLER("SGVsbG8"), &location) == 1 || st_search_ci(text, NULLER("QXR0YWNobWVudA"), &location) == 1 ||
+		st_search_ci(text, NULLER("Attachment"), &location) == 1) {
+		st_sprint(errmsg, "The searchable text contained encoded data, or the contents of an attachment.");
+		result = false;
+	}
+
+	// The raw lines should keep the part headers, and the quoted-printable text as it appears on the wire, but skip the base64 lines.
+	else if (!(raw = fulltext_raw(&(mime->body))) || st_search_ci(raw, NULLER("break caf=C3=A9"), &location) != 1 ||
+		st_search_ci(raw, NULLER("Content-Type: application/octet-stream"), &location) != 1) {
+		st_sprint(errmsg, "The raw lines of the message body weren't kept.");
+		result = false;
+	}
+	else if (st_search_ci(raw, NULLER("SGVsbG8"), &location) == 1 || st_search_ci(raw, NULLER("QXR0YWNobWVudA"), &location) == 1) {
+		st_sprint(errmsg, "The raw lines of the message body contained base64 encoded data.");
+		result = false;
+	}
+
+	// Only a value which can't appear inside base64 data, and can't span lines, can be ruled out using the index.
+	else if (fulltext_term(NULLER("QXR0YWNobWVudA")) || fulltext_term(NULLER("caf=C3")) || fulltext_term(NULLER("encoded\r\nworld")) ||
+		!fulltext_term(NULLER("encoded world")) || !fulltext_term(NULLER("caf\xc3\xa9"))) {
+		st_sprint(errmsg, "The search values which can be ruled out using the index weren't identified.");
+		result = false;
+	}
+
+	st_cleanup(text);
+	st_cleanup(raw);
+	mail_mime_free(mime);
+
+	return result;
+}
+
+/**
+ * @brief	Index a pair of messages for a random user, and verify the queries only rule out messages which can't contain the value.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_fulltext_query_sthread(stringer_t *errmsg) {
+
+	bool_t result = true;
+	fulltext_query_t *query = NULL;
+	uint64_t usernum = rand_get_uint64(), report = rand_get_uint64(), lunch = report + 1, missing = report + 2;
+
+	if (!fulltext_index(usernum, report, NULLER("Subject: Quarterly Report\r\n\r\nThe budget is attached.\r\n")) ||
+		!fulltext_index(usernum, lunch, NULLER("Subject: Lunch\r\n\r\nPizza on Friday.\r\n")) || !fulltext_sync()) {
+		st_sprint(errmsg, "The messages couldn't be added to the index.");
+		return false;
+	}
+
+	// A value found inside a word must not rule the message out, since searches match substrings, regardless of case.
+	if (!(query = fulltext_query(usernum, NULLER("UDGE")))) {
+		st_sprint(errmsg, "The substring query failed.");
+		result = false;
+	}
+	else if (fulltext_query_check(query, report) != 0 || fulltext_query_check(query, lunch) != -1 || fulltext_query_check(query, missing) != 0) {
+		st_sprint(errmsg, "The substring query returned the wrong result.");
+		result = false;
+	}
+
+	fulltext_query_free(query);
+	query = NULL;
+
+	// A phrase should only rule out the messages which are missing a trigram.
+	if (result && !(query = fulltext_query(usernum, NULLER("quarterly report")))) {
+		st_sprint(errmsg, "The phrase query failed.");
+		result = false;
+	}
+	else if (result && (fulltext_query_check(query, report) != 0 || fulltext_query_check(query, lunch) != -1)) {
+		st_sprint(errmsg, "The phrase query returned the wrong result.");
+		result = false;
+	}
+
+	fulltext_query_free(query);
+	query = NULL;
+
+	// A value without any trigrams can't be answered, so every message has to be scanned.
+	if (result && (!(query = fulltext_query(usernum, NULLER("a @ b"))) || fulltext_query_check(query, report) != 0 || fulltext_query_check(query, lunch) != 0)) {
+		st_sprint(errmsg, "The query without any trigrams didn't fall back to a scan.");
+		result = false;
+	}
+
+	fulltext_query_free(query);
+	return result;
+}
+
+/**
+ * @brief	Index and then delete enough messages to trigger a compaction, and verify the deleted messages are removed from the index.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_fulltext_compact_sthread(stringer_t *errmsg) {
+
+	bool_t result = true;
+	fulltext_query_t *query = NULL;
+	uint64_t usernum = rand_get_uint64(), messagenum = rand_get_uint64(), kept = messagenum + MAGMA_STORAGE_SEARCH_COMPACT;
+
+	for (uint64_t i = 0; i <= MAGMA_STORAGE_SEARCH_COMPACT; i++) {
+		if (!fulltext_index(usernum, messagenum + i, NULLER("Subject: Compaction\r\n\r\nThis message will be deleted.\r\n"))) {
+			st_sprint(errmsg, "The messages couldn't be added to the index.");
+			return false;
+		}
+	}
+
+	if (!fulltext_sync()) {
+		st_sprint(errmsg, "The messages couldn't be written to the index.");
+		return false;
+	}
+
+	// Deleting every message but the last should trigger a compaction.
+	for (uint64_t i = 0; i < MAGMA_STORAGE_SEARCH_COMPACT; i++) {
+		fulltext_remove(usernum, messagenum + i);
+	}
+
+	if (!(query = fulltext_query(usernum, NULLER("compaction")))) {
+		st_sprint(errmsg, "The query failed after the compaction.");
+		result = false;
+	}
+	else if (query->indexed_count != 1 || query->matches_count != 1 || *(query->indexed) != kept || *(query->matches) != kept) {
+		st_sprint(errmsg, "The deleted messages weren't compacted out of the index. { indexed = %zu / matches = %zu }", query->indexed_count,
+			query->matches_count);
+		result = false;
+	}
+
+	fulltext_query_free(query);
+	return result;
+}
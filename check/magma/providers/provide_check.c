@@ -565,6 +565,23 @@ START_TEST (check_dkim_s) {
 }
 END_TEST
 
+START_TEST (check_tank_search_s) {
+
+	log_disable();
+	bool_t result = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) result = check_fulltext_grams_sthread(errmsg);
+	if (status() && result) result = check_fulltext_decode_sthread(errmsg);
+	if (status() && result) result = check_fulltext_query_sthread(errmsg);
+	if (status() && result) result = check_fulltext_compact_sthread(errmsg);
+
+	log_test("TANK / SEARCH / SINGLE THREADED:", errmsg);
+	ck_assert_msg(result, st_char_get(errmsg));
+
+}
+END_TEST
+
 //! Encoding/Parser Tests
 START_TEST (check_unicode_s) {
 
@@ -613,6 +630,7 @@ Suite * suite_check_provide(void) {
 		suite_check_testcase(s, "PROVIDERS", "Tank ZLIB/M", check_tank_zlib_m);
 		suite_check_testcase(s, "PROVIDERS", "Tank BZIP/S", check_tank_bzip_s);
 		suite_check_testcase(s, "PROVIDERS", "Tank BZIP/M", check_tank_bzip_m);
+		suite_check_testcase(s, "PROVIDERS", "Tank Search/S", check_tank_search_s);
 	}
 	else {
 		log_unit("Skipping tank checks...\n");
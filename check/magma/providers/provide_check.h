@@ -32,6 +32,12 @@ stringer_t *  check_rand_mthread(void);
 void          check_rand_mthread_wrap(void);
 stringer_t *  check_rand_sthread(void);
 
+/// fulltext_check.c
+bool_t   check_fulltext_compact_sthread(stringer_t *errmsg);
+bool_t   check_fulltext_decode_sthread(stringer_t *errmsg);
+bool_t   check_fulltext_grams_sthread(stringer_t *errmsg);
+bool_t   check_fulltext_query_sthread(stringer_t *errmsg);
+
 /// tank_check.c
 bool_t   check_tokyo_tank(check_tank_opt_t *opts);
 bool_t   check_tokyo_tank_cleanup(inx_t *check_collection);
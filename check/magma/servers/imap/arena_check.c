@@ -0,0 +1,198 @@
+/**
+ * @file /check/magma/servers/imap/arena_check.c
+ *
+ * @brief Checks and benchmarks for the connection arena used by IMAP commands.
+ */
+
+#include "magma_check.h"
+
+typedef struct {
+	int sockd; /* The client end of the connection. */
+	uint64_t digest; /* A running FNV-1a hash of every byte the server sent. */
+	pthread_t thread;
+} check_imap_arena_client_t;
+
+/**
+ * @brief	Read, and hash, everything the server sends until the connection is closed, so the server never blocks on a full socket buffer.
+ * @param	client	the client end of the connection.
+ * @return	This function returns no value.
+ */
+static void check_imap_arena_drain(check_imap_arena_client_t *client) {
+
+	ssize_t bytes;
+	uchr_t buffer[8192];
+
+	while ((bytes = recv(client->sockd, buffer, sizeof(buffer), 0)) > 0) {
+		for (ssize_t i = 0; i < bytes; i++) {
+			client->digest = (client->digest ^ buffer[i]) * 0x100000001B3UL;
+		}
+	}
+
+	pthread_exit(NULL);
+	return;
+}
+
+/**
+ * @brief	Setup an IMAP connection, with a folder selected in the synthetic mailbox, and a thread reading the client end of it.
+ * @param	server	the server the connection will belong to.
+ * @param	user	the meta user object holding the synthetic mailbox.
+ * @param	client	the client end of the connection, which is setup by the function.
+ * @return	NULL on failure, or the server end of the connection.
+ */
+static connection_t * check_imap_arena_connect(server_t *server, meta_user_t *user, check_imap_arena_client_t *client) {
+
+	int local = -1;
+	connection_t *con;
+
+	client->digest = 0xCBF29CE484222325UL;
+
+	if (!check_network_pair(&local, &(client->sockd))) {
+		return NULL;
+	}
+	else if (!(con = con_init(local, server))) {
+		close(client->sockd);
+		close(local);
+		return NULL;
+	}
+
+	stats_increment_by_name("imap.connections.total");
+
+	if (thread_launch(&(client->thread), &check_imap_arena_drain, client)) {
+		con_destroy(con);
+		close(client->sockd);
+		return NULL;
+	}
+
+	con->imap.user = user;
+	con->imap.session_state = 1;
+	con->imap.selected = 1;
+
+	return con;
+}
+
+/**
+ * @brief	Close an IMAP connection setup by check_imap_arena_connect(), and wait for the client thread to read the last of its output.
+ * @param	con		the server end of the connection.
+ * @param	client	the client end of the connection.
+ * @return	This function returns no value.
+ */
+static void check_imap_arena_close(connection_t *con, check_imap_arena_client_t *client) {
+
+	// The synthetic mailbox isn't registered as a user session, so it's detached before the session is destroyed.
+	con->imap.user = NULL;
+	con_destroy(con);
+
+	thread_join(client->thread);
+	close(client->sockd);
+
+	return;
+}
+
+/**
+ * @brief	Send UID FETCH 1:* (UID FLAGS INTERNALDATE RFC822.SIZE) across a connection, and run it using the same functions as the server.
+ * @note	The command is read and parsed the way imap_process() does it. It's then executed by imap_dispatch(), which makes the connection
+ * 			arena active, or by calling the command handler directly, which leaves every allocation on the heap. In both cases the command
+ * 			is finished by imap_complete(), the way imap_requeue() finishes it, before the response is flushed.
+ * @param	con		the connection, which should already have the synthetic mailbox selected.
+ * @param	client	the client end of the connection.
+ * @param	arena	if true, the command is run using imap_dispatch().
+ * @return	true if the command was executed, or false on failure.
+ */
+static bool_t check_imap_arena_fetch(connection_t *con, check_imap_arena_client_t *client, bool_t arena) {
+
+	chr_t *line = "A1 UID FETCH 1:* (UID FLAGS INTERNALDATE RFC822.SIZE)\r\n";
+
+	if (send(client->sockd, line, ns_length_get(line), 0) != (ssize_t)ns_length_get(line) || con_read_line(con, true) <= 0 ||
+		imap_command_parser(con) < 0 || !(con->command = imap_command(con->imap.command)) || con->command->function != &imap_fetch) {
+		return false;
+	}
+
+	if (arena) {
+		imap_dispatch(con);
+	}
+	else {
+		((void (*)(connection_t *))con->command->function)(con);
+	}
+
+	imap_complete(con);
+
+	return con_flush(con) > 0 && con_status(con) >= 0;
+}
+
+/**
+ * @brief	Count the heap allocations made by a FETCH command, and time it, with and without the connection arena.
+ * @note	Each connection is kept between iterations, the way it would be kept between commands, so the counts reflect a warmed up arena.
+ * @param	errmsg		a managed string to receive a description of any failure.
+ * @param	allocations	an array which receives the total number of heap allocations made without the arena, and then with the arena.
+ * @param	elapsed		an array which receives the total number of nanoseconds taken without the arena, and then with the arena.
+ * @return	true if the benchmark completed, and the arena produced the same responses using fewer allocations, or false otherwise.
+ */
+bool_t check_imap_arena_bench_sthread(stringer_t *errmsg, uint64_t allocations[2], uint64_t elapsed[2]) {
+
+	uint64_t count;
+	server_t server;
+	meta_user_t *user;
+	bool_t result = true;
+	struct timespec start, end;
+	connection_t *cons[2] = { NULL, NULL };
+	check_imap_arena_client_t clients[2];
+
+	mm_wipe(&server, sizeof(server_t));
+	server.protocol = IMAP;
+
+	if (!(user = check_imap_narrow_mailbox(IMAP_CHECK_ARENA_MESSAGES))) {
+		st_sprint(errmsg, "Unable to build the synthetic mailbox.");
+		return false;
+	}
+	else if (!(cons[0] = check_imap_arena_connect(&server, user, &clients[0])) || !(cons[1] = check_imap_arena_connect(&server, user, &clients[1]))) {
+		st_sprint(errmsg, "Unable to setup the IMAP connections.");
+		if (cons[0]) check_imap_arena_close(cons[0], &clients[0]);
+		meta_free(user);
+		return false;
+	}
+
+	// Build the index before counting anything, since it's only rebuilt when the mailbox changes.
+	meta_user_rlock(user);
+	meta_index_get(user);
+	meta_user_unlock(user);
+
+	allocations[0] = allocations[1] = elapsed[0] = elapsed[1] = 0;
+
+	for (uint64_t i = 0; result && status() && i < IMAP_CHECK_ARENA_ITERATIONS; i++) {
+
+		for (int_t j = 0; result && j < 2; j++) {
+
+			count = mm_alloc_count();
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			if (!check_imap_arena_fetch(cons[j], &clients[j], j ? true : false)) {
+				st_sprint(errmsg, "The FETCH command failed. { arena = %s }", j ? "true" : "false");
+				result = false;
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			elapsed[j] += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+			allocations[j] += mm_alloc_count() - count;
+		}
+	}
+
+	// Closing the connections lets the client threads finish hashing the responses.
+	check_imap_arena_close(cons[0], &clients[0]);
+	check_imap_arena_close(cons[1], &clients[1]);
+	meta_free(user);
+
+	if (!result) {
+		return false;
+	}
+	else if (clients[0].digest != clients[1].digest) {
+		st_sprint(errmsg, "The responses generated with the arena didn't match the responses generated without it.");
+		return false;
+	}
+	else if (status() && allocations[1] >= allocations[0]) {
+		st_sprint(errmsg, "The arena didn't reduce the number of heap allocations. { heap = %lu / arena = %lu }", allocations[0],
+			allocations[1]);
+		return false;
+	}
+
+	return true;
+}
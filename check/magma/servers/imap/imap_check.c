@@ -108,6 +108,68 @@ START_TEST (check_imap_network_starttls_s) {
 }
 END_TEST
 
+START_TEST (check_imap_narrow_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status() && !check_imap_narrow_sthread(errmsg)) {
+		outcome = false;
+	}
+
+	log_test("IMAP / NARROW / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_imap_narrow_bench_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	uint64_t legacy = 0, indexed = 0;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status() && !check_imap_narrow_bench_sthread(errmsg, &legacy, &indexed)) {
+		outcome = false;
+	}
+
+	log_test("IMAP / NARROW / BENCHMARK / SINGLE THREADED:", errmsg);
+
+	// Print the average time taken by UID FETCH 1:* FLAGS, using each approach.
+	if (outcome && status()) {
+		log_unit("%-32.32s %8i messages %14.0f legacy ns/fetch %14.0f indexed ns/fetch\n", "", IMAP_CHECK_NARROW_MESSAGES,
+			(double)legacy / IMAP_CHECK_NARROW_ITERATIONS, (double)indexed / IMAP_CHECK_NARROW_ITERATIONS);
+	}
+
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_imap_arena_bench_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+	uint64_t allocations[2] = { 0, 0 }, elapsed[2] = { 0, 0 };
+
+	if (status() && !check_imap_arena_bench_sthread(errmsg, allocations, elapsed)) {
+		outcome = false;
+	}
+
+	log_test("IMAP / ARENA / BENCHMARK / SINGLE THREADED:", errmsg);
+
+	// Print the average number of heap allocations, and the average time taken, by a FETCH command with and without the arena.
+	if (outcome && status()) {
+		log_unit("%-32.32s %8i messages %10.1f heap allocs/fetch %10.1f arena allocs/fetch %12.0f heap ns/fetch %12.0f arena ns/fetch\n", "",
+			IMAP_CHECK_ARENA_MESSAGES, (double)allocations[0] / IMAP_CHECK_ARENA_ITERATIONS, (double)allocations[1] / IMAP_CHECK_ARENA_ITERATIONS,
+			(double)elapsed[0] / IMAP_CHECK_ARENA_ITERATIONS, (double)elapsed[1] / IMAP_CHECK_ARENA_ITERATIONS);
+	}
+
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_imap(void) {
 
 	Suite *s = suite_create("\tIMAP");
@@ -117,6 +179,9 @@ Suite * suite_check_imap(void) {
 	suite_check_testcase(s, "IMAP", "IMAP Network Search/S", check_imap_network_search_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network Fetch/S", check_imap_network_fetch_s);
 	suite_check_testcase(s, "IMAP", "IMAP Network STARTTLS/S", check_imap_network_starttls_s);
+	suite_check_testcase(s, "IMAP", "IMAP Narrow/S", check_imap_narrow_s);
+	suite_check_testcase(s, "IMAP", "IMAP Narrow Benchmark/S", check_imap_narrow_bench_s);
+	suite_check_testcase(s, "IMAP", "IMAP Arena Benchmark/S", check_imap_arena_bench_s);
 
 	return s;
 }
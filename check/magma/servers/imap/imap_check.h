@@ -7,6 +7,9 @@
 #ifndef IMAP_CHECK_H
 #define IMAP_CHECK_H
 
+/// arena_check.c
+bool_t check_imap_arena_bench_sthread(stringer_t *errmsg, uint64_t allocations[2], uint64_t elapsed[2]);
+
 /// imap_check_network.c
 bool_t check_imap_client_read_end(client_t *client, chr_t *tag);
 bool_t check_imap_network_basic_sthread(stringer_t *errmsg, uint32_t port, bool_t secure);
@@ -17,6 +20,13 @@ bool_t check_imap_client_select(client_t *client, chr_t *folder, chr_t *tag, str
 bool_t check_imap_network_starttls_sthread(stringer_t *errmsg, uint32_t tcp_port, uint32_t tls_port);
 bool_t check_imap_client_login(client_t *client, chr_t *user, chr_t *pass, chr_t *tag, stringer_t *errmsg);
 
+/// narrow_check.c
+void check_imap_narrow_legacy(inx_t *messages, inx_t *output, uint64_t selected, uint64_t start, uint64_t end, int_t asterisk, int_t uid);
+meta_user_t * check_imap_narrow_mailbox(size_t count);
+bool_t check_imap_narrow_sthread(stringer_t *errmsg);
+bool_t check_imap_narrow_compare(inx_t *one, inx_t *two);
+bool_t check_imap_narrow_bench_sthread(stringer_t *errmsg, uint64_t *legacy, uint64_t *indexed);
+
 Suite * suite_check_imap(void);
 
 #endif
@@ -0,0 +1,338 @@
+
+/**
+ * @file /check/magma/servers/imap/narrow_check.c
+ *
+ * @brief Checks and benchmarks for the message index used to narrow IMAP sequence sets.
+ */
+
+#include "magma_check.h"
+
+typedef struct {
+	chr_t *range;
+	int_t uid;
+	struct {
+		uint64_t start, end;
+		int_t asterisk;
+	} parts[2];
+} check_imap_narrow_case_t;
+
+/**
+ * @brief	Build a synthetic mailbox, with the messages spread across several interleaved folders.
+ * @note	Message numbers are odd, so a UID range will always include numbers which don't exist.
+ * @param	count	the number of messages to generate.
+ * @return	NULL on failure, or a meta user object holding the generated messages.
+ */
+meta_user_t * check_imap_narrow_mailbox(size_t count) {
+
+	meta_user_t *user;
+	meta_message_t *message;
+	uint64_t sequences[IMAP_CHECK_NARROW_FOLDERS];
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	mm_wipe(sequences, sizeof(sequences));
+
+	if (!(user = meta_alloc()) || !(user->messages = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+		meta_free(user);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+
+		if (!(message = meta_message_alloc())) {
+			meta_free(user);
+			return NULL;
+		}
+
+		message->messagenum = (i * 2) + 1;
+		message->foldernum = (i % IMAP_CHECK_NARROW_FOLDERS) + 1;
+		message->sequencenum = ++sequences[i % IMAP_CHECK_NARROW_FOLDERS];
+		message->status = (i % 3) ? MAIL_STATUS_SEEN : MAIL_STATUS_RECENT;
+		message->size = 1024 + i;
+		message->created = 1000000000 + i;
+
+		key.val.u64 = message->messagenum;
+
+		if (!inx_insert(user->messages, key, message)) {
+			meta_message_free(message);
+			meta_free(user);
+			return NULL;
+		}
+	}
+
+	return user;
+}
+
+/**
+ * @brief	Collect the messages of a folder which fall inside a single range, using the linked list walk imap_narrow_messages() used
+ * 			before the message index. Kept here as the baseline for the checks and the benchmark.
+ * @param	messages	the messages collection.
+ * @param	output		the linked index which receives the matching messages.
+ * @param	selected	the numerical id of the selected folder.
+ * @param	start		the start of the range.
+ * @param	end			the end of the range.
+ * @param	asterisk	if set, the range is open ended.
+ * @param	uid			if set, the range holds UIDs, otherwise it holds sequence numbers.
+ * @return	This function returns no value.
+ */
+void check_imap_narrow_legacy(inx_t *messages, inx_t *output, uint64_t selected, uint64_t start, uint64_t end, int_t asterisk, int_t uid) {
+
+	uint64_t number = 0;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+
+	if ((cursor = inx_cursor_alloc(messages))) {
+
+		while ((active = inx_cursor_value_next(cursor))) {
+
+			if (active->foldernum == selected && ((uid == 0 && ++number >= start && (asterisk == 1 || number <= end)) ||
+				(uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)))) {
+				key.val.u64 = active->messagenum;
+				inx_append(output, key, active);
+			}
+
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether two narrowed message collections hold the same messages, in the same order.
+ */
+bool_t check_imap_narrow_compare(inx_t *one, inx_t *two) {
+
+	bool_t result = true;
+	meta_message_t *a, *b;
+	inx_cursor_t *first = NULL, *second = NULL;
+
+	if (!one || !two) {
+		return (!one || !inx_count(one)) && (!two || !inx_count(two));
+	}
+	else if (inx_count(one) != inx_count(two) || !(first = inx_cursor_alloc(one)) || !(second = inx_cursor_alloc(two))) {
+		result = false;
+	}
+
+	while (result && (a = inx_cursor_value_next(first))) {
+		if (a != (b = inx_cursor_value_next(second))) result = false;
+	}
+
+	if (first) inx_cursor_free(first);
+	if (second) inx_cursor_free(second);
+
+	return result;
+}
+
+/**
+ * @brief	Verify the index based narrowing returns the same messages as the legacy walk, and that the index follows messages as they're
+ * 			moved, flagged, appended and expunged.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_imap_narrow_sthread(stringer_t *errmsg) {
+
+	size_t first, last;
+	meta_user_t *user;
+	meta_index_t *index;
+	inx_t *narrowed, *expected;
+	meta_message_t *moved, *added;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+	check_imap_narrow_case_t cases[] = {
+		{ "1:*", 0, { { 1, 0, 1 }, { 0, 0, -1 } } },
+		{ "5", 0, { { 5, 5, 0 }, { 0, 0, -1 } } },
+		{ "3:7", 0, { { 3, 7, 0 }, { 0, 0, -1 } } },
+		{ "10:2", 0, { { 2, 10, 0 }, { 0, 0, -1 } } },
+		{ "2,4:6", 0, { { 2, 2, 0 }, { 4, 6, 0 } } },
+		{ "1:*", 1, { { 1, 0, 1 }, { 0, 0, -1 } } },
+		{ "9", 1, { { 9, 9, 0 }, { 0, 0, -1 } } },
+		{ "10", 1, { { 10, 10, 0 }, { 0, 0, -1 } } },
+		{ "4:40", 1, { { 4, 40, 0 }, { 0, 0, -1 } } },
+		{ "40:4", 1, { { 4, 40, 0 }, { 0, 0, -1 } } },
+		{ "1,17:33", 1, { { 1, 1, 0 }, { 17, 33, 0 } } },
+		{ "100:*", 1, { { 100, 0, 1 }, { 0, 0, -1 } } }
+	};
+
+	if (!(user = check_imap_narrow_mailbox(IMAP_CHECK_NARROW_FOLDERS * 64))) {
+		st_sprint(errmsg, "Unable to build the synthetic mailbox.");
+		return false;
+	}
+
+	for (uint64_t folder = 1; folder <= IMAP_CHECK_NARROW_FOLDERS; folder++) {
+		for (size_t i = 0; i < sizeof(cases) / sizeof(check_imap_narrow_case_t); i++) {
+
+			if (!(expected = inx_alloc(M_INX_LINKED, NULL))) {
+				st_sprint(errmsg, "Unable to allocate the expected message collection.");
+				meta_free(user);
+				return false;
+			}
+
+			for (size_t j = 0; j < 2 && cases[i].parts[j].asterisk != -1; j++) {
+				check_imap_narrow_legacy(user->messages, expected, folder, cases[i].parts[j].start, cases[i].parts[j].end,
+					cases[i].parts[j].asterisk, cases[i].uid);
+			}
+
+			narrowed = imap_narrow_messages(user, folder, NULLER(cases[i].range), cases[i].uid);
+
+			if (!check_imap_narrow_compare(narrowed, expected)) {
+				st_sprint(errmsg, "The narrowed messages didn't match the legacy walk. { folder = %lu / range = %s / uid = %i }",
+					folder, cases[i].range, cases[i].uid);
+				inx_cleanup(narrowed);
+				inx_free(expected);
+				meta_free(user);
+				return false;
+			}
+
+			inx_cleanup(narrowed);
+			inx_free(expected);
+		}
+	}
+
+	// Move a message into another folder, the way the message mover does, and make sure the index follows it.
+	index = meta_index_get(user);
+
+	if (!(moved = meta_index_find(index, 1, 1)) || meta_index_find(index, 2, 1)) {
+		st_sprint(errmsg, "The message index didn't find the first message in its folder.");
+		meta_free(user);
+		return false;
+	}
+
+	meta_index_move(user, moved, 2);
+	index = meta_index_get(user);
+
+	if (meta_index_find(index, 1, 1) || meta_index_find(index, 2, 1) != moved) {
+		st_sprint(errmsg, "The message index wasn't updated after a message changed folders.");
+		meta_free(user);
+		return false;
+	}
+
+	// A flag change is made in place, so it should be visible through the index that's already in hand.
+	meta_index_status(user, moved, moved->status | MAIL_STATUS_FLAGGED);
+
+	if (!meta_index_folder(index, 2, &first, &last) || !(index->flags[meta_index_uid(index, first, last, 1)] & MAIL_STATUS_FLAGGED) ||
+		meta_index_get(user) != index) {
+		st_sprint(errmsg, "The message index flags weren't updated in place.");
+		meta_free(user);
+		return false;
+	}
+
+	// Appending, and then expunging, a message should update the index directly, without forcing a rebuild from the collection.
+	if (!(added = meta_message_alloc())) {
+		st_sprint(errmsg, "Unable to allocate a message to append.");
+		meta_free(user);
+		return false;
+	}
+
+	key.val.u64 = added->messagenum = index->highest + 1;
+	added->foldernum = 1;
+	added->size = 1;
+
+	if (!inx_append(user->messages, key, added)) {
+		st_sprint(errmsg, "Unable to append a message to the collection.");
+		meta_message_free(added);
+		meta_free(user);
+		return false;
+	}
+
+	meta_index_insert(user, added);
+	index = user->index.current;
+
+	if (meta_index_get(user) != index || meta_index_find(index, 1, key.val.u64) != added || index->count != inx_count(user->messages)) {
+		st_sprint(errmsg, "The message index wasn't updated after a message was appended.");
+		meta_free(user);
+		return false;
+	}
+
+	inx_delete(user->messages, key);
+	meta_index_remove(user, 1, key.val.u64);
+	index = user->index.current;
+
+	if (meta_index_get(user) != index || meta_index_find(index, 1, key.val.u64) || index->count != inx_count(user->messages)) {
+		st_sprint(errmsg, "The message index wasn't updated after a message was expunged.");
+		meta_free(user);
+		return false;
+	}
+
+	meta_free(user);
+	return true;
+}
+
+/**
+ * @brief	Time UID FETCH 1:* FLAGS against a large synthetic mailbox, using the legacy walk and the message index.
+ * @note	Each pass narrows the folder and then visits the flags of every message in the result, which is the work done by the
+ * 			command before any output is generated.
+ * @param	errmsg		a managed string to receive a description of any failure.
+ * @param	legacy		a pointer to receive the total number of nanoseconds taken by the legacy walk.
+ * @param	indexed		a pointer to receive the total number of nanoseconds taken using the message index.
+ * @return	true if the benchmark completed, or false on failure.
+ */
+bool_t check_imap_narrow_bench_sthread(stringer_t *errmsg, uint64_t *legacy, uint64_t *indexed) {
+
+	inx_t *output;
+	meta_user_t *user;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+	uint64_t flags = 0, counted = 0;
+	struct timespec start, end;
+
+	if (!(user = check_imap_narrow_mailbox(IMAP_CHECK_NARROW_MESSAGES))) {
+		st_sprint(errmsg, "Unable to build the synthetic mailbox.");
+		return false;
+	}
+
+	// Build the index before timing anything, since it's only rebuilt when the mailbox changes.
+	meta_index_get(user);
+
+	*legacy = *indexed = 0;
+
+	for (uint64_t i = 0; status() && i < IMAP_CHECK_NARROW_ITERATIONS; i++) {
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if ((output = inx_alloc(M_INX_LINKED, NULL))) {
+
+			check_imap_narrow_legacy(user->messages, output, 1, 1, 0, 1, 1);
+
+			if ((cursor = inx_cursor_alloc(output))) {
+				while ((active = inx_cursor_value_next(cursor))) {
+					flags += active->status & (MAIL_STATUS_SEEN | MAIL_STATUS_FLAGGED);
+					counted++;
+				}
+				inx_cursor_free(cursor);
+			}
+
+			inx_free(output);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		*legacy += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if ((output = imap_narrow_messages(user, 1, NULLER("1:*"), 1))) {
+
+			if ((cursor = inx_cursor_alloc(output))) {
+				while ((active = inx_cursor_value_next(cursor))) {
+					flags -= active->status & (MAIL_STATUS_SEEN | MAIL_STATUS_FLAGGED);
+					counted--;
+				}
+				inx_cursor_free(cursor);
+			}
+
+			inx_free(output);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		*indexed += ((end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+	}
+
+	meta_free(user);
+
+	// Both approaches visited the same messages, so the running totals should cancel out.
+	if (flags || counted) {
+		st_sprint(errmsg, "The legacy walk and the message index returned different messages.");
+		return false;
+	}
+
+	return true;
+}
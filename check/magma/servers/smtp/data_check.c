@@ -0,0 +1,291 @@
+
+/**
+ * @file /check/magma/servers/smtp/data_check.c
+ *
+ * @brief Checks and benchmarks for the SMTP DATA scanner.
+ */
+
+#include "magma_check.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef struct {
+	chr_t *input;
+	chr_t *expected;
+	size_t consumed;
+} check_smtp_data_case_t;
+
+/**
+ * @brief	Read the processor cycle counter, or the monotonic clock in nanoseconds, on platforms without one.
+ */
+uint64_t check_smtp_data_cycles(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec * 1000000000) + now.tv_nsec;
+#endif
+
+}
+
+/**
+ * @brief	The byte at a time state machine which smtp_data_read() used before the scanner. Kept here as the benchmark baseline.
+ * @param	input	the message data, including the terminating line.
+ * @param	length	the length of the message data.
+ * @param	output	a buffer with room for twice the input length.
+ * @return	the number of bytes written to the output buffer.
+ */
+size_t check_smtp_data_legacy(chr_t *input, size_t length, chr_t *output) {
+
+	size_t used = 0;
+	int_t header = 1, checker = 1, carriage = 0;
+
+	for (size_t increment = 0; checker != 4 && increment < length; increment++, input++) {
+
+		if (header != 3) {
+			if (header == 0 && *input == '\n') header++;
+			else if (header == 1 && *input == '\n') header += 2;
+			else if (header == 1 && *input == '\r') header++;
+			else if (header == 2 && *input == '\n') header++;
+			else if (header != 0) header = 0;
+		}
+
+		if (checker == 0 && *input == '\n') checker++;
+		else if (checker == 1 && *input == '.') checker++;
+		else if (checker == 2 && *input == '\n') checker += 2;
+		else if (checker == 2 && *input == '\r') checker++;
+		else if (checker == 3 && *input == '\n') checker++;
+		else if (*input == '\n') checker = 1;
+		else if (checker != 0) checker = 0;
+
+		if (*input == '\n' && carriage == 0) {
+			output[used++] = '\r';
+		}
+		else if (*input == '\r') {
+			carriage = 1;
+		}
+		else if (carriage != 0) {
+			carriage = 0;
+		}
+
+		if (header == 3 || *input >= 0) {
+			output[used++] = *input;
+		}
+	}
+
+	return used;
+}
+
+/**
+ * @brief	Prepare a message for transmission by dot stuffing it, and appending the terminating line.
+ * @param	message		the message to be prepared.
+ * @return	NULL on failure, or a managed string holding the prepared message.
+ */
+stringer_t * check_smtp_data_stuff(stringer_t *message) {
+
+	chr_t *data;
+	size_t length, used = 0;
+	stringer_t *result;
+
+	if (st_empty_out(message, (uchr_t **)&data, &length) || !(result = st_alloc((length * 2) + 5))) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+
+		if (data[i] == '.' && (i == 0 || data[i - 1] == '\n')) {
+			*(st_char_get(result) + used++) = '.';
+		}
+
+		*(st_char_get(result) + used++) = data[i];
+	}
+
+	mm_copy(st_char_get(result) + used, "\r\n.\r\n", 5);
+	st_length_set(result, used + 5);
+
+	return result;
+}
+
+/**
+ * @brief	Feed a message to the DATA scanner in chunks of the specified size.
+ * @param	input		the message data, including the terminating line.
+ * @param	chunk		the number of bytes passed to each call.
+ * @param	output		a managed string with room for twice the input length, which will receive the scanned message.
+ * @param	consumed	a pointer to receive the number of input bytes consumed.
+ * @return	true if the terminating line was found, otherwise false.
+ */
+bool_t check_smtp_data_feed(stringer_t *input, size_t chunk, stringer_t *output, size_t *consumed) {
+
+	size_t pos = 0, used = 0, written, step;
+	smtp_data_t state = { .line = SMTP_DATA_LINE_START, .header = true, .carriage = false, .done = false };
+
+	while (pos < st_length_get(input) && !state.done) {
+		step = (st_length_get(input) - pos) < chunk ? (st_length_get(input) - pos) : chunk;
+		pos += smtp_data_scan(&state, st_data_get(input) + pos, step, st_data_get(output) + used, &written);
+		used += written;
+	}
+
+	st_length_set(output, used);
+	*consumed = pos;
+
+	return state.done;
+}
+
+/**
+ * @brief	Verify the DATA scanner unstuffs periods, repairs line endings, and stops at the terminating line, regardless of how the data is split.
+ * @param	errmsg	a managed string to receive a description of any failure.
+ * @return	true if the check passed, or false on failure.
+ */
+bool_t check_smtp_data_scan_sthread(stringer_t *errmsg) {
+
+	size_t consumed;
+	stringer_t *input, *output;
+	size_t chunks[] = { 1, 2, 3, 7, 16, 31, 33, 4096 };
+	check_smtp_data_case_t cases[] = {
+		{ "Subject: test\r\n\r\nbody\r\n.\r\n", "Subject: test\r\n\r\nbody\r\n", 26 },
+		{ "Subject: test\n\nbare\nfeeds\n.\n", "Subject: test\r\n\r\nbare\r\nfeeds\r\n", 28 },
+		{ "A: b\r\n\r\n..leading\r\n...\r\n.x\r\n.\r\nQUIT\r\n", "A: b\r\n\r\n.leading\r\n..\r\nx\r\n", 31 },
+		{ "Subject: caf\xc3\xa9\r\n\r\ncaf\xc3\xa9\r\n.\r\n", "Subject: caf\r\n\r\ncaf\xc3\xa9\r\n", 28 },
+		{ "\r\nno header\r\n.\r\n", "\r\nno header\r\n", 16 },
+		{ ".\r\n", "", 3 }
+	};
+
+	if (!(output = st_alloc(1024))) {
+		st_sprint(errmsg, "Unable to allocate the output buffer.");
+		return false;
+	}
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(check_smtp_data_case_t); i++) {
+
+		input = NULLER(cases[i].input);
+
+		for (size_t j = 0; j < sizeof(chunks) / sizeof(size_t); j++) {
+
+			if (!check_smtp_data_feed(input, chunks[j], output, &consumed)) {
+				st_sprint(errmsg, "The DATA scanner didn't find the terminating line. { case = %zu / chunk = %zu }", i, chunks[j]);
+				st_free(output);
+				return false;
+			}
+			else if (consumed != cases[i].consumed || st_cmp_cs_eq(output, NULLER(cases[i].expected))) {
+				st_sprint(errmsg, "The DATA scanner output didn't match what was expected. { case = %zu / chunk = %zu }", i, chunks[j]);
+				st_free(output);
+				return false;
+			}
+		}
+	}
+
+	st_free(output);
+	return true;
+}
+
+/**
+ * @brief	Load the benchmark corpus, which is dot stuffed and terminated, as it would be sent by a client.
+ * @note	If the corpus directory isn't available, the messages built into the check suite are used instead.
+ * @param	messages	an array which will receive the prepared messages.
+ * @param	limit		the size of the messages array.
+ * @return	the number of messages loaded.
+ */
+size_t check_smtp_data_corpus(stringer_t **messages, size_t limit) {
+
+	DIR *dir;
+	size_t count = 0;
+	struct dirent *entry;
+	stringer_t *path, *data;
+
+	if ((dir = opendir(SMTP_CHECK_DATA_CORPUS))) {
+
+		while (count < limit && (entry = readdir(dir))) {
+
+			if (*(entry->d_name) == '.' || !(path = st_aprint("%s/%s", SMTP_CHECK_DATA_CORPUS, entry->d_name))) {
+				continue;
+			}
+
+			if ((data = file_load(st_char_get(path)))) {
+				if ((messages[count] = check_smtp_data_stuff(data))) count++;
+				st_free(data);
+			}
+
+			st_free(path);
+		}
+
+		closedir(dir);
+	}
+
+	for (uint32_t i = 0; !count && i < check_message_max() && i < limit; i++) {
+		if ((data = check_message_get(i))) {
+			if ((messages[count] = check_smtp_data_stuff(data))) count++;
+			st_free(data);
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Compare the throughput of the legacy byte at a time DATA loop against the scanner, using the message corpus.
+ * @param	errmsg		a managed string to receive a description of any failure.
+ * @param	legacy		a pointer to receive the legacy throughput, in bytes per cycle.
+ * @param	scanner		a pointer to receive the scanner throughput, in bytes per cycle.
+ * @return	true if the benchmark completed, or false on failure.
+ */
+bool_t check_smtp_data_bench_sthread(stringer_t *errmsg, double *legacy, double *scanner) {
+
+	bool_t result = true;
+	stringer_t *messages[64], *output = NULL;
+	size_t count, total = 0, largest = 0, consumed, written;
+	uint64_t start, legacy_cycles = 0, scanner_cycles = 0;
+	smtp_data_t state;
+
+	if (!(count = check_smtp_data_corpus(messages, 64))) {
+		st_sprint(errmsg, "Unable to load the benchmark corpus.");
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		largest = st_length_get(messages[i]) > largest ? st_length_get(messages[i]) : largest;
+	}
+
+	if (!(output = st_alloc((largest * 2) + 1))) {
+		st_sprint(errmsg, "Unable to allocate the output buffer.");
+		result = false;
+	}
+
+	for (size_t i = 0; result && status() && i < count; i++) {
+
+		start = check_smtp_data_cycles();
+
+		for (size_t j = 0; j < SMTP_CHECK_DATA_ITERATIONS; j++) {
+			check_smtp_data_legacy(st_char_get(messages[i]), st_length_get(messages[i]), st_char_get(output));
+		}
+
+		legacy_cycles += check_smtp_data_cycles() - start;
+		start = check_smtp_data_cycles();
+
+		for (size_t j = 0; j < SMTP_CHECK_DATA_ITERATIONS; j++) {
+			state = (smtp_data_t){ .line = SMTP_DATA_LINE_START, .header = true, .carriage = false, .done = false };
+			consumed = smtp_data_scan(&state, st_data_get(messages[i]), st_length_get(messages[i]), st_data_get(output), &written);
+		}
+
+		scanner_cycles += check_smtp_data_cycles() - start;
+		total += st_length_get(messages[i]) * SMTP_CHECK_DATA_ITERATIONS;
+
+		if (!state.done || consumed != st_length_get(messages[i])) {
+			st_sprint(errmsg, "The DATA scanner didn't consume the entire message. { message = %zu }", i);
+			result = false;
+		}
+	}
+
+	*legacy = (double)total / (double)(legacy_cycles ? legacy_cycles : 1);
+	*scanner = (double)total / (double)(scanner_cycles ? scanner_cycles : 1);
+
+	for (size_t i = 0; i < count; i++) {
+		st_free(messages[i]);
+	}
+
+	st_cleanup(output);
+	return result;
+}
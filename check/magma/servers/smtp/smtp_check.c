@@ -191,6 +191,39 @@ START_TEST (check_smtp_network_starttls_s) {
 }
 END_TEST
 
+START_TEST (check_smtp_data_scan_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_data_scan_sthread(errmsg);
+
+	log_test("SMTP / DATA / SCANNER / SINGLE THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_smtp_data_bench_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	double legacy = 0, scanner = 0;
+	stringer_t *errmsg = MANAGEDBUF(1024);
+
+	if (status()) outcome = check_smtp_data_bench_sthread(errmsg, &legacy, &scanner);
+
+	log_test("SMTP / DATA / BENCHMARK / SINGLE THREADED:", errmsg);
+
+	// Report the throughput of the old byte at a time loop, and the scanner which replaced it.
+	if (status() && outcome) {
+		log_unit("%-64.64s%.3f -> %.3f bytes/cycle\n", "SMTP / DATA / BENCHMARK / THROUGHPUT:", legacy, scanner);
+	}
+
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
 Suite * suite_check_smtp(void) {
 
 	Suite *s = suite_create("\tSMTP");
@@ -199,6 +232,8 @@ Suite * suite_check_smtp(void) {
 	suite_check_testcase(s, "SMTP", "SMTP Checkers Greylist/S", check_smtp_checkers_greylist_s);
 	suite_check_testcase(s, "SMTP", "SMTP Checkers Filters/S", check_smtp_checkers_filters_s);
 	suite_check_testcase(s, "SMTP", "SMTP Checkers RBL", check_smtp_checkers_rbl_s);
+	suite_check_testcase(s, "SMTP", "SMTP Data Scanner/S", check_smtp_data_scan_s);
+	suite_check_testcase(s, "SMTP", "SMTP Data Benchmark/S", check_smtp_data_bench_s);
 	suite_check_testcase(s, "SMTP", "SMTP Network Basic/ TCP/S", check_smtp_network_basic_tcp_s);
 	suite_check_testcase(s, "SMTP", "SMTP Network Basic/ TLS/S", check_smtp_network_basic_tls_s);
 	suite_check_testcase(s, "SMTP", "SMTP Network Auth Plain/S", check_smtp_network_auth_plain_s);
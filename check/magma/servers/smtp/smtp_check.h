@@ -16,6 +16,15 @@ bool_t check_smtp_checkers_regex_sthread(stringer_t *errmsg);
 bool_t check_smtp_checkers_greylist_sthread(stringer_t *errmsg);
 bool_t check_smtp_checkers_filters_sthread(stringer_t *errmsg, int_t action, int_t expected);
 
+/// data_check.c
+uint64_t check_smtp_data_cycles(void);
+bool_t check_smtp_data_scan_sthread(stringer_t *errmsg);
+stringer_t * check_smtp_data_stuff(stringer_t *message);
+size_t check_smtp_data_corpus(stringer_t **messages, size_t limit);
+size_t check_smtp_data_legacy(chr_t *input, size_t length, chr_t *output);
+bool_t check_smtp_data_bench_sthread(stringer_t *errmsg, double *legacy, double *scanner);
+bool_t check_smtp_data_feed(stringer_t *input, size_t chunk, stringer_t *output, size_t *consumed);
+
 /// smtp_check_network.c
 bool_t check_smtp_client_read_end(client_t *client);
 bool_t check_smtp_client_quit(client_t *client, stringer_t *errmsg);
@@ -257,6 +257,23 @@ BIO * (*BIO_new_fp_d)(FILE *stream, int close_flag) = NULL;
 X509_EXTENSION * (*X509_get_ext_d) (X509 *x, int loc) = NULL;
 SSL_CTX * (*SSL_CTX_new_d)(const SSL_METHOD * method) = NULL;
 void (*SSL_set_bio_d)(SSL *ssl, BIO *rbio, BIO *wbio) = NULL;
+BIO * (*BIO_new_d)(BIO_METHOD *type) = NULL;
+BIO_METHOD * (*BIO_s_null_d)(void) = NULL;
+void (*SSL_set_info_callback_d)(SSL *ssl, void (*cb)(const SSL *ssl, int type, int val)) = NULL;
+void (*SSL_SESSION_free_d)(SSL_SESSION *ses) = NULL;
+SSL_SESSION * (*SSL_get1_session_d)(SSL *ssl) = NULL;
+int (*SSL_set_session_d)(SSL *to, SSL_SESSION *session) = NULL;
+long (*SSL_CTX_set_timeout_d)(SSL_CTX *ctx, long t) = NULL;
+int (*i2d_SSL_SESSION_d)(SSL_SESSION *in, unsigned char **pp) = NULL;
+SSL_SESSION * (*d2i_SSL_SESSION_d)(SSL_SESSION **a, const unsigned char **pp, long length) = NULL;
+long (*SSL_SESSION_get_time_d)(const SSL_SESSION *s) = NULL;
+long (*SSL_SESSION_get_timeout_d)(const SSL_SESSION *s) = NULL;
+const unsigned char * (*SSL_SESSION_get_id_d)(const SSL_SESSION *s, unsigned int *len) = NULL;
+int (*SSL_CTX_set_session_id_context_d)(SSL_CTX *ctx, const unsigned char *sid_ctx, unsigned int sid_ctx_len) = NULL;
+void (*SSL_CTX_sess_set_new_cb_d)(SSL_CTX *ctx, int (*new_session_cb)(SSL *ssl, SSL_SESSION *sess)) = NULL;
+void (*SSL_CTX_sess_set_get_cb_d)(SSL_CTX *ctx, SSL_SESSION *(*get_session_cb)(SSL *ssl, unsigned char *data, int len, int *copy)) = NULL;
+void (*SSL_CTX_sess_set_remove_cb_d)(SSL_CTX *ctx, void (*remove_session_cb)(SSL_CTX *ctx, SSL_SESSION *sess)) = NULL;
+void (*SSL_set_quiet_shutdown_d)(SSL *ssl, int mode) = NULL;
 unsigned char * (*ASN1_STRING_data_d)(ASN1_STRING *x) = NULL;
 int (*BN_bn2mpi_d)(const BIGNUM *a, unsigned char *to) = NULL;
 int (*SSL_CTX_check_private_key_d)(const SSL_CTX *ctx) = NULL;
@@ -449,6 +466,7 @@ bool (*tchdbtune_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t
 bool (*tchdboptimize_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts) = NULL;
 bool (*tcndbputkeep_d)(TCNDB *ndb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
 bool (*tchdbputasync_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
+bool (*tchdbputcat_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
 const char * (*jansson_version_d)(void) = NULL;
 int (*json_array_append_d)(json_t *array, json_t *value) = NULL;
 int (*json_array_insert_d)(json_t *array, size_t index, json_t *value) = NULL;
@@ -806,6 +824,23 @@ if ((*(void **)&(BIO_new_fp_d) = dlsym(magma, "BIO_new_fp")) == NULL) return "BI
 if ((*(void **)&(X509_get_ext_d) = dlsym(magma, "X509_get_ext")) == NULL) return "X509_get_ext";
 if ((*(void **)&(SSL_CTX_new_d) = dlsym(magma, "SSL_CTX_new")) == NULL) return "SSL_CTX_new";
 if ((*(void **)&(SSL_set_bio_d) = dlsym(magma, "SSL_set_bio")) == NULL) return "SSL_set_bio";
+if ((*(void **)&(BIO_new_d) = dlsym(magma, "BIO_new")) == NULL) return "BIO_new";
+if ((*(void **)&(BIO_s_null_d) = dlsym(magma, "BIO_s_null")) == NULL) return "BIO_s_null";
+if ((*(void **)&(SSL_set_info_callback_d) = dlsym(magma, "SSL_set_info_callback")) == NULL) return "SSL_set_info_callback";
+if ((*(void **)&(SSL_SESSION_free_d) = dlsym(magma, "SSL_SESSION_free")) == NULL) return "SSL_SESSION_free";
+if ((*(void **)&(SSL_get1_session_d) = dlsym(magma, "SSL_get1_session")) == NULL) return "SSL_get1_session";
+if ((*(void **)&(SSL_set_session_d) = dlsym(magma, "SSL_set_session")) == NULL) return "SSL_set_session";
+if ((*(void **)&(SSL_CTX_set_timeout_d) = dlsym(magma, "SSL_CTX_set_timeout")) == NULL) return "SSL_CTX_set_timeout";
+if ((*(void **)&(i2d_SSL_SESSION_d) = dlsym(magma, "i2d_SSL_SESSION")) == NULL) return "i2d_SSL_SESSION";
+if ((*(void **)&(d2i_SSL_SESSION_d) = dlsym(magma, "d2i_SSL_SESSION")) == NULL) return "d2i_SSL_SESSION";
+if ((*(void **)&(SSL_SESSION_get_time_d) = dlsym(magma, "SSL_SESSION_get_time")) == NULL) return "SSL_SESSION_get_time";
+if ((*(void **)&(SSL_SESSION_get_timeout_d) = dlsym(magma, "SSL_SESSION_get_timeout")) == NULL) return "SSL_SESSION_get_timeout";
+if ((*(void **)&(SSL_SESSION_get_id_d) = dlsym(magma, "SSL_SESSION_get_id")) == NULL) return "SSL_SESSION_get_id";
+if ((*(void **)&(SSL_CTX_set_session_id_context_d) = dlsym(magma, "SSL_CTX_set_session_id_context")) == NULL) return "SSL_CTX_set_session_id_context";
+if ((*(void **)&(SSL_CTX_sess_set_new_cb_d) = dlsym(magma, "SSL_CTX_sess_set_new_cb")) == NULL) return "SSL_CTX_sess_set_new_cb";
+if ((*(void **)&(SSL_CTX_sess_set_get_cb_d) = dlsym(magma, "SSL_CTX_sess_set_get_cb")) == NULL) return "SSL_CTX_sess_set_get_cb";
+if ((*(void **)&(SSL_CTX_sess_set_remove_cb_d) = dlsym(magma, "SSL_CTX_sess_set_remove_cb")) == NULL) return "SSL_CTX_sess_set_remove_cb";
+if ((*(void **)&(SSL_set_quiet_shutdown_d) = dlsym(magma, "SSL_set_quiet_shutdown")) == NULL) return "SSL_set_quiet_shutdown";
 if ((*(void **)&(ASN1_STRING_data_d) = dlsym(magma, "ASN1_STRING_data")) == NULL) return "ASN1_STRING_data";
 if ((*(void **)&(BN_bn2mpi_d) = dlsym(magma, "BN_bn2mpi")) == NULL) return "BN_bn2mpi";
 if ((*(void **)&(SSL_CTX_check_private_key_d) = dlsym(magma, "SSL_CTX_check_private_key")) == NULL) return "SSL_CTX_check_private_key";
@@ -997,6 +1032,7 @@ if ((*(void **)&(tchdbtune_d) = dlsym(magma, "tchdbtune")) == NULL) return "tchd
 if ((*(void **)&(tchdboptimize_d) = dlsym(magma, "tchdboptimize")) == NULL) return "tchdboptimize";
 if ((*(void **)&(tcndbputkeep_d) = dlsym(magma, "tcndbputkeep")) == NULL) return "tcndbputkeep";
 if ((*(void **)&(tchdbputasync_d) = dlsym(magma, "tchdbputasync")) == NULL) return "tchdbputasync";
+if ((*(void **)&(tchdbputcat_d) = dlsym(magma, "tchdbputcat")) == NULL) return "tchdbputcat";
 if ((*(void **)&(jansson_version_d) = dlsym(magma, "jansson_version")) == NULL) return "jansson_version";
 if ((*(void **)&(json_array_append_d) = dlsym(magma, "json_array_append")) == NULL) return "json_array_append";
 if ((*(void **)&(json_array_insert_d) = dlsym(magma, "json_array_insert")) == NULL) return "json_array_insert";
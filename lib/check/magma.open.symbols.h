@@ -385,6 +385,23 @@ extern BIO * (*BIO_new_fp_d)(FILE *stream, int close_flag);
 extern X509_EXTENSION * (*X509_get_ext_d) (X509 *x, int loc);
 extern SSL_CTX * (*SSL_CTX_new_d)(const SSL_METHOD * method);
 extern void (*SSL_set_bio_d)(SSL *ssl, BIO *rbio, BIO *wbio);
+extern BIO * (*BIO_new_d)(BIO_METHOD *type);
+extern BIO_METHOD * (*BIO_s_null_d)(void);
+extern void (*SSL_set_info_callback_d)(SSL *ssl, void (*cb)(const SSL *ssl, int type, int val));
+extern void (*SSL_SESSION_free_d)(SSL_SESSION *ses);
+extern SSL_SESSION * (*SSL_get1_session_d)(SSL *ssl);
+extern int (*SSL_set_session_d)(SSL *to, SSL_SESSION *session);
+extern long (*SSL_CTX_set_timeout_d)(SSL_CTX *ctx, long t);
+extern int (*i2d_SSL_SESSION_d)(SSL_SESSION *in, unsigned char **pp);
+extern SSL_SESSION * (*d2i_SSL_SESSION_d)(SSL_SESSION **a, const unsigned char **pp, long length);
+extern long (*SSL_SESSION_get_time_d)(const SSL_SESSION *s);
+extern long (*SSL_SESSION_get_timeout_d)(const SSL_SESSION *s);
+extern const unsigned char * (*SSL_SESSION_get_id_d)(const SSL_SESSION *s, unsigned int *len);
+extern int (*SSL_CTX_set_session_id_context_d)(SSL_CTX *ctx, const unsigned char *sid_ctx, unsigned int sid_ctx_len);
+extern void (*SSL_CTX_sess_set_new_cb_d)(SSL_CTX *ctx, int (*new_session_cb)(SSL *ssl, SSL_SESSION *sess));
+extern void (*SSL_CTX_sess_set_get_cb_d)(SSL_CTX *ctx, SSL_SESSION *(*get_session_cb)(SSL *ssl, unsigned char *data, int len, int *copy));
+extern void (*SSL_CTX_sess_set_remove_cb_d)(SSL_CTX *ctx, void (*remove_session_cb)(SSL_CTX *ctx, SSL_SESSION *sess));
+extern void (*SSL_set_quiet_shutdown_d)(SSL *ssl, int mode);
 extern unsigned char * (*ASN1_STRING_data_d)(ASN1_STRING *x);
 extern int (*BN_bn2mpi_d)(const BIGNUM *a, unsigned char *to);
 extern int (*SSL_CTX_check_private_key_d)(const SSL_CTX *ctx);
@@ -583,6 +600,7 @@ extern bool (*tchdbtune_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, u
 extern bool (*tchdboptimize_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts);
 extern bool (*tcndbputkeep_d)(TCNDB *ndb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 extern bool (*tchdbputasync_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+extern bool (*tchdbputcat_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 
 //! Jansson
 extern const char * (*jansson_version_d)(void);
@@ -24,6 +24,7 @@ bool_t process_start(void);
 /// signal.c
 bool_t signal_start(void);
 bool_t signal_thread_start(void);
+void signal_recorder(int signal);
 void signal_segfault(int signal);
 void signal_shutdown(int signal);
 void signal_status(int signal);
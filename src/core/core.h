@@ -35,6 +35,8 @@
 #include <sys/utsname.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -234,6 +236,8 @@ typedef struct {
 		bool_t increase_resource_limits; /* Attempt to increase system limits. */
 		uint32_t thread_stack_size; /* How much memory should be allocated for thread stacks? */
 		uint32_t worker_threads; /* How many worker threads should we spawn? */
+		uint32_t handshake_threads; /* How many threads should be dedicated to TLS handshakes? */
+		uint32_t handshake_timeout; /* How many seconds does a client have to complete a TLS handshake? */
 		uint32_t network_buffer; /* The size of the network buffer? */
 
 		bool_t enable_core_dumps; /* Should fatal errors leave behind a core dump. */
@@ -67,6 +67,7 @@ int           tcp_read(int sockd, void *buffer, int length, bool_t block);
 int_t         tcp_status(int sockd);
 int           tcp_wait(int sockd);
 int           tcp_write(int sockd, const void *buffer, int length, bool_t block);
+ssize_t       tcp_writev(int sockd, const struct iovec *vector, int count, bool_t block);
 
 /// host.c
 stringer_t *  host_platform(stringer_t *output);
@@ -116,12 +116,6 @@ int tcp_read(int sockd, void *buffer, int length, bool_t block) {
 		return 0;
 	}
 
-#ifdef MAGMA_PEDANTIC
-	else if (!block) {
-		mclog_pedantic("Non-blocking TCP read calls have not been fully implemented yet.");
-	}
-#endif
-
 	do {
 		errno = 0;
 		result = recv(sockd, buffer, length, (block ? 0 : MSG_DONTWAIT));
@@ -161,6 +155,38 @@ int tcp_write(int sockd, const void *buffer, int length, bool_t block) {
 	return result;
 }
 
+/**
+ * @brief	Write several blocks of data to an open TCP/IP network socket using a single system call.
+ * @param	sockd	the socket file descriptor we'll write the data to.
+ * @param	vector	an array of buffers holding the data to be written, in order.
+ * @param	count	the number of buffers in the vector.
+ * @param	block	a boolean to indicating whether to make a blocking write call.
+ * @return	-1 on error, or the number of bytes written to the network connection, which may end part way through any of the buffers.
+ */
+ssize_t tcp_writev(int sockd, const struct iovec *vector, int count, bool_t block) {
+
+	int counter = 0;
+	ssize_t result = 0;
+	struct msghdr message;
+
+	if (sockd < 0 || !vector || count <= 0) {
+		mclog_pedantic("Passed invalid parameters for a call to the TCP vector write function.");
+		return 0;
+	}
+
+	// The message header lets us pass the same flags as tcp_write(), which writev() doesn't support.
+	mm_wipe(&message, sizeof(struct msghdr));
+	message.msg_iov = (struct iovec *)vector;
+	message.msg_iovlen = count;
+
+	do {
+		errno = 0;
+		result = sendmsg(sockd, &message, (block ? 0 : MSG_DONTWAIT));
+	} while (block && counter++ < 8 && !(result = tcp_continue(sockd, result, errno)));
+
+	return result;
+}
+
 ip_t * tcp_addr_ip(int sockd, ip_t *output) {
 
 	ip_t *result = NULL;
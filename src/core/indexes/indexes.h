@@ -18,6 +18,7 @@ typedef enum {
 	M_INX_LINKED = 4, //!< M_INX_LINKED
 	//M_INX_ALLOW_DUPE = 8, //!< M_INX_ALLOW_DUPE
 	M_INX_LOCK_MANUAL = 16, //!< M_INX_LOCK_MANUAL
+	M_INX_ARENA = 32, //!< M_INX_ARENA, linked list nodes come from the active memory arena, so the index must be freed before the arena is reset.
 
 } MAGMA_INDEX;
 
@@ -37,6 +38,7 @@ typedef struct {
 	void *index, *last;
 	pthread_rwlock_t lock;
 	uint64_t count, serial, automatic, options, references;
+	arena_t *arena; /* The arena supplying the index nodes, or NULL if they're allocated off the heap. */
 
 	// Index function pointers.
 	void (*data_free)(void *data);
@@ -75,21 +75,48 @@ void linked_record_free(inx_t *index, linked_record_t *record) {
 	if (!record) return;
 	if (index && index->data_free) index->data_free(record->data);
 	mt_free(record->key);
-	mm_free(record);
+	if (!index || !index->arena) mm_free(record);
+	return;
+}
+
+/**
+ * @brief	Allocate memory for a linked list node or record, using the index arena, if it has one.
+ * @param	index	a pointer to the linked list which will own the memory.
+ * @param	len		the number of bytes to allocate.
+ * @return	NULL on failure, or a pointer to the zeroed memory on success.
+ */
+void * linked_node_alloc(inx_t *index, size_t len) {
+
+	return index->arena ? arena_get(index->arena, len) : mm_alloc(len);
+}
+
+/**
+ * @brief	Free a linked list node, unless it belongs to the index arena, in which case it's reclaimed when the arena is reset.
+ * @param	index	a pointer to the linked list which owns the node.
+ * @param	node	a pointer to the node being freed.
+ * @return	This function returns no value.
+ */
+void linked_node_free(inx_t *index, void *node) {
+
+	if (!index->arena) {
+		mm_free(node);
+	}
+
 	return;
 }
 
 /**
  * @brief	Create a new linked list record object.
+ * @param	index	a pointer to the linked list which will own the record.
  * @param	key		the multi-type key value of the record to be used for data searches.
  * @param	data	a pointer to the data to be associated with the record.
  * @return	a pointer to the newly allocated and initialized linked record object.
  */
-linked_record_t * linked_record_alloc(multi_t key, void *data) {
+linked_record_t * linked_record_alloc(inx_t *index, multi_t key, void *data) {
 
 	linked_record_t *record;
 
-	if ((record = mm_alloc(sizeof(linked_record_t))) == NULL) return NULL;
+	if ((record = linked_node_alloc(index, sizeof(linked_record_t))) == NULL) return NULL;
 
 	record->key = mt_dupe(key);
 	record->data = data;
@@ -175,7 +202,7 @@ bool_t linked_delete(void *inx, multi_t key) {
 	}
 
 	linked_record_free(index, node->record);
-	mm_free(node);
+	linked_node_free(index, node);
 	index->count--;
 	index->serial++;
 	return true;
@@ -194,13 +221,13 @@ bool_t linked_insert(void *inx, multi_t key, void *data) {
 	inx_t *index = inx;
 	linked_node_t *holder, *node;
 
-	if ((node = mm_alloc(sizeof(linked_node_t))) == NULL) {
+	if ((node = linked_node_alloc(index, sizeof(linked_node_t))) == NULL) {
 		mclog_info("Unable to allocate %zu bytes for a linked node.", sizeof(linked_node_t));
 		return false;
 	}
-	else if ((node->record = linked_record_alloc(key, data)) == NULL) {
+	else if ((node->record = linked_record_alloc(index, key, data)) == NULL) {
 		mclog_info("Unable to allocate an index record.");
-		mm_free(node);
+		linked_node_free(index, node);
 		return false;
 	}
 
@@ -246,13 +273,13 @@ bool_t linked_append(void *inx, multi_t key, void *data) {
 	inx_t *index = inx;
 	linked_node_t *holder, *node;
 
-	if ((node = mm_alloc(sizeof(linked_node_t))) == NULL) {
+	if ((node = linked_node_alloc(index, sizeof(linked_node_t))) == NULL) {
 		mclog_info("Unable to allocate %zu bytes for a linked node.", sizeof(linked_node_t));
 		return false;
 	}
-	else if ((node->record = linked_record_alloc(key, data)) == NULL) {
+	else if ((node->record = linked_record_alloc(index, key, data)) == NULL) {
 		mclog_info("Unable to allocate an index record.");
-		mm_free(node);
+		linked_node_free(index, node);
 		return false;
 	}
 
@@ -491,7 +518,7 @@ void linked_truncate(void *inx) {
 	while (node != NULL) {
 		next = (linked_node_t *)node->next;
 		linked_record_free(index, node->record);
-		mm_free(node);
+		linked_node_free(index, node);
 		node = next;
 	}
 
@@ -524,6 +551,8 @@ void linked_free(void *inx) {
 
 /**
  * @brief	Allocate a new linked list instance.
+ * @note	If M_INX_ARENA is set, and the current thread has an active arena, the nodes are allocated from that arena, and the list must
+ * 			be freed before the arena is reset. Otherwise the nodes are allocated off the heap.
  * @param	options		an options value for the newly created linked list object.
  * @param	data_free	a pointer to a function used to free linked list items.
  * @return	NULL on failure or a pointer to the newly allocated linked list object on success.
@@ -538,6 +567,7 @@ inx_t * linked_alloc(uint64_t options, void *data_free) {
 	result->index = NULL;
 
 	result->options = options;
+	result->arena = options & M_INX_ARENA ? arena_current() : NULL;
 	result->data_free = data_free;
 	result->index_free = linked_free;
 	result->index_truncate = linked_truncate;
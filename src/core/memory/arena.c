@@ -0,0 +1,239 @@
+
+/**
+ * @file /magma/core/memory/arena.c
+ *
+ * @brief	A bump pointer arena, used to hold the short lived allocations made while a protocol command is being handled.
+ *
+ * An arena hands out memory by advancing a pointer through a list of blocks, and releases everything it handed out at once, when it's
+ * reset, so the individual allocations never need to be freed. The first block is kept by a reset, so a connection which handles a
+ * steady stream of commands stops touching the system allocator once its arena has warmed up. Requests which are too large to share
+ * a block get a dedicated block, which is released by the next reset. Arenas aren't thread safe, and are only meant to be used by
+ * the thread handling the command which owns them.
+ */
+
+#include "../core.h"
+
+// The alignment of every allocation handed out by an arena.
+#define ARENA_ALIGNMENT 16
+
+typedef struct arena_block_t {
+	size_t length; /* The number of usable bytes in the block. */
+	size_t used; /* The number of bytes handed out from the block. */
+	size_t base; /* The position of the arena when the block was added, which is where its first byte sits. */
+	struct arena_block_t *next; /* The previous, older, block. */
+	uchr_t data[] __attribute__ ((aligned (ARENA_ALIGNMENT)));
+} arena_block_t;
+
+struct arena_t {
+	size_t block; /* The length of a regular block. */
+	arena_block_t *head; /* The block currently being carved up, which is also the newest. */
+};
+
+/// The arena being used by the current thread, or NULL if allocations should come from the heap.
+static __thread arena_t *arena_active = NULL;
+
+/**
+ * @brief	Allocate a new block, and push it onto the front of an arena's block list.
+ * @param	arena	the arena which will own the block.
+ * @param	len		the number of usable bytes in the block.
+ * @return	NULL on failure, or a pointer to the new block on success.
+ */
+static arena_block_t * arena_block_push(arena_t *arena, size_t len) {
+
+	arena_block_t *block;
+
+	if (!(block = mm_alloc(sizeof(arena_block_t) + len))) {
+		mclog_pedantic("Unable to allocate a memory arena block. { length = %zu }", len);
+		return NULL;
+	}
+
+	block->length = len;
+	block->used = 0;
+
+	// The blocks are chained newest first, and the position of the arena keeps growing as blocks are added, so a mark taken
+	// before the block was added can be found by comparing it against the block base.
+	if ((block->next = arena->head)) {
+		block->base = arena->head->base + arena->head->used;
+	}
+
+	arena->head = block;
+
+	return block;
+}
+
+/**
+ * @brief	Allocate an arena.
+ * @param	block	the length of each regular block, which is also the amount of memory the arena keeps between resets.
+ * @return	NULL on failure, or a pointer to the new arena on success.
+ */
+arena_t * arena_alloc(size_t block) {
+
+	arena_t *arena;
+
+	if (!(arena = mm_alloc(sizeof(arena_t)))) {
+		mclog_pedantic("Unable to allocate a memory arena.");
+		return NULL;
+	}
+
+	arena->block = align(ARENA_ALIGNMENT, block ? block : MM_ARENA_BLOCK);
+
+	if (!arena_block_push(arena, arena->block)) {
+		mm_free(arena);
+		return NULL;
+	}
+
+	return arena;
+}
+
+/**
+ * @brief	Free an arena, and every block it holds.
+ * @note	Any allocations handed out by the arena become invalid. The arena must not be the active arena of any thread.
+ * @param	arena	the arena to be freed, which may be NULL.
+ * @return	This function returns no value.
+ */
+void arena_free(arena_t *arena) {
+
+	arena_block_t *block;
+
+	if (!arena) {
+		return;
+	}
+
+	while ((block = arena->head)) {
+		arena->head = block->next;
+		mm_free(block);
+	}
+
+	mm_free(arena);
+
+	return;
+}
+
+/**
+ * @brief	Hand out a block of zeroed memory from an arena.
+ * @note	The memory is aligned to 16 bytes, and is released when the arena is rewound past it, reset, or freed.
+ * @param	arena	the arena supplying the memory.
+ * @param	len		the number of bytes requested, which must be non-zero.
+ * @return	NULL on failure, or a pointer to the zeroed memory on success.
+ */
+void * arena_get(arena_t *arena, size_t len) {
+
+	void *result;
+	arena_block_t *block;
+
+	if (!arena || !len) {
+		mclog_pedantic("Invalid parameters were passed to the memory arena allocator.");
+		return NULL;
+	}
+
+	len = align(ARENA_ALIGNMENT, len);
+	block = arena->head;
+
+	if (block->length - block->used < len) {
+
+		// Requests larger than a quarter of a block would waste too much of a shared block, so they get one of their own.
+		if (!(block = arena_block_push(arena, len > (arena->block / 4) ? len : arena->block))) {
+			return NULL;
+		}
+	}
+
+	result = block->data + block->used;
+	block->used += len;
+
+	return mm_set(result, 0, len);
+}
+
+/**
+ * @brief	Get the current position of an arena, so the memory handed out after this point can be reclaimed by arena_rewind().
+ * @param	arena	the arena.
+ * @return	the number of bytes the arena has handed out, including any padding.
+ */
+size_t arena_mark(arena_t *arena) {
+	return arena ? arena->head->base + arena->head->used : 0;
+}
+
+/**
+ * @brief	Reclaim the memory an arena has handed out since a mark was taken.
+ * @note	Blocks added after the mark are released. The memory handed out before the mark remains valid.
+ * @param	arena	the arena.
+ * @param	mark	a position previously returned by arena_mark(), which hasn't been invalidated by an earlier rewind or reset.
+ * @return	This function returns no value.
+ */
+void arena_rewind(arena_t *arena, size_t mark) {
+
+	arena_block_t *block;
+
+	if (!arena) {
+		return;
+	}
+
+	while ((block = arena->head)->next && block->base >= mark) {
+		arena->head = block->next;
+		mm_free(block);
+	}
+
+	if (mark >= block->base && mark - block->base < block->used) {
+		block->used = mark - block->base;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Reclaim everything an arena has handed out, releasing every block except the first.
+ * @param	arena	the arena.
+ * @return	This function returns no value.
+ */
+void arena_reset(arena_t *arena) {
+	arena_rewind(arena, 0);
+	return;
+}
+
+/**
+ * @brief	Make an arena the active arena of the current thread, so it supplies the allocations which opt into using an arena.
+ * @param	arena	the arena to be activated, or NULL to send those allocations back to the heap.
+ * @return	the arena which was active before the call, which should be restored once the caller is finished.
+ */
+arena_t * arena_enter(arena_t *arena) {
+
+	arena_t *previous = arena_active;
+
+	arena_active = arena;
+
+	return previous;
+}
+
+/**
+ * @brief	Get the active arena of the current thread.
+ * @return	NULL if no arena is active, or a pointer to the active arena.
+ */
+arena_t * arena_current(void) {
+	return arena_active;
+}
+
+/**
+ * @brief	Allocate a block of zeroed memory from the active arena of the current thread.
+ * @see		arena_get()
+ * @param	len		the number of bytes requested.
+ * @return	NULL on failure, or if no arena is active, or a pointer to the zeroed memory on success.
+ */
+void * mm_arena_alloc(size_t len) {
+
+	if (!arena_active) {
+		mclog_pedantic("Attempted to allocate %zu bytes from a memory arena, but no arena is active.", len);
+		return NULL;
+	}
+
+	return arena_get(arena_active, len);
+}
+
+/**
+ * @brief	Release a block of memory handed out by an arena.
+ * @note	Arena memory is only reclaimed when the arena is rewound, reset, or freed, so this function does nothing. It exists so
+ * 			arena allocations can be released through the same function pointers as the other allocators.
+ * @param	block	the block of memory.
+ * @return	This function returns no value.
+ */
+void mm_arena_free(void *block) {
+	return;
+}
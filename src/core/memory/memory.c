@@ -7,6 +7,9 @@
 
 #include "../core.h"
 
+/// The number of blocks the current thread has allocated using mm_alloc().
+static __thread uint64_t mm_allocated = 0;
+
 /**
  * @brief	A checked cleanup function which can be used free a variable number memory buffers.
  * @see		mm_free
@@ -188,6 +191,7 @@ void * mm_alloc(size_t len) {
 	}
 	else if ((result = malloc(len))) {
 		mm_set(result, 0, len);
+		mm_allocated++;
 	}
 	else {
 		mclog_pedantic("Unable to allocate a block of %zu bytes.", len);
@@ -195,3 +199,12 @@ void * mm_alloc(size_t len) {
 
 	return result;
 }
+
+/**
+ * @brief	Get the number of blocks the current thread has allocated using mm_alloc().
+ * @note	The count is kept per thread, so it can be sampled before and after a unit of work to measure how much it allocated.
+ * @return	the number of successful allocations made by the current thread.
+ */
+uint64_t mm_alloc_count(void) {
+	return mm_allocated;
+}
@@ -8,9 +8,42 @@
 #ifndef MAGMA_CORE_MEMORY_H
 #define MAGMA_CORE_MEMORY_H
 
+typedef struct arena_t arena_t;
+
+typedef struct slab_t {
+	chr_t *name; /* The name of the cache, which is used to name its statistics. */
+	size_t size; /* The length of the objects held by the cache. */
+	bool_t ready; /* Whether the cache has been setup. Caches are setup the first time they're used. */
+	size_t stride, offset, capacity; /* The spacing of the objects in a slab, the offset of the first object, and the objects per slab. */
+	pthread_key_t key; /* Holds the magazine each thread uses for the cache. */
+	pthread_mutex_t lock; /* Protects the slabs, the magazine list, and the counters. */
+	void *partial; /* The slabs which have free objects. */
+	void *pages; /* Every slab held by the cache, including the full slabs, which is used to verify an object belongs to the cache. */
+	void *magazines; /* The magazines of the running threads. */
+	uint64_t slabs, idle; /* The number of slabs held by the cache, and the number of them which are empty. */
+	uint64_t gets, puts; /* The objects taken and returned by threads which have exited, or which couldn't allocate a magazine. */
+	chr_t names[2][96]; /* The names of the statistics reported for the cache. */
+	struct slab_t *next;
+} slab_t;
+
+// Usage: static slab_t cache = SLAB_CACHE("name", sizeof(object_t));
+#define SLAB_CACHE(n, s) { .name = n, .size = s, .ready = false, .lock = PTHREAD_MUTEX_INITIALIZER, .pages = NULL, .next = NULL }
+
 /// align.c
 size_t align(size_t alignment, size_t len);
 
+/// arena.c
+arena_t * arena_alloc(size_t block);
+arena_t * arena_current(void);
+arena_t * arena_enter(arena_t *arena);
+void      arena_free(arena_t *arena);
+void *    arena_get(arena_t *arena, size_t len);
+size_t    arena_mark(arena_t *arena);
+void      arena_reset(arena_t *arena);
+void      arena_rewind(arena_t *arena, size_t mark);
+void *    mm_arena_alloc(size_t len);
+void      mm_arena_free(void *block);
+
 /// bitwise.c
 uint_t bitwise_count(uint64_t value);
 uchr_t bitwise_or(uchr_t a, uchr_t b);
@@ -29,6 +62,7 @@ bool_t mm_sec_stats(size_t *total, size_t *bytes, size_t *items);
 
 /// memory.c
 void *   mm_alloc(size_t len);
+uint64_t mm_alloc_count(void);
 void     mm_cleanup_variadic(ssize_t len, ...);
 void *   mm_copy(void *dst, const void *src, size_t len);
 void *   mm_dupe(void *block, size_t len);
@@ -38,8 +72,35 @@ void *   mm_move(void *dst, void *src, size_t len);
 void *   mm_set(void *block, uint8_t set, size_t len);
 void *   mm_wipe(void *block, size_t len);
 
-// Allocation requests are aligned to 12 bytes, which is also the length of the secured_t.
-#define MM_SEC_REQUEST_ALIGNMENT 12
+/// slab.c
+void *   slab_get(slab_t *cache);
+void     slab_put(slab_t *cache, void *object);
+bool_t   slab_stats(slab_t *cache, uint64_t *objects, uint64_t *bytes);
+uint64_t slab_stats_count(void);
+chr_t *  slab_stats_name(uint64_t position);
+uint64_t slab_stats_value(uint64_t position);
+
+// Allocation requests are aligned to 16 bytes, which is also the length of the secured_t.
+#define MM_SEC_REQUEST_ALIGNMENT 16
+
+// The number of secure memory size classes, and the longest chunk with a size class of its own. Longer chunks are grouped into classes
+// which each cover a power of two range of lengths.
+#define MM_SEC_CLASSES 64
+#define MM_SEC_CLASS_SMALL 512
+
+// The longest chunk held by the per-thread secure memory caches, and the number of chunks of each length a thread will hold.
+#define MM_SEC_CACHE_LENGTH 256
+#define MM_SEC_CACHE_DEPTH 4
+
+// The default length of each memory arena block, which is also the amount of memory an arena keeps between resets.
+#define MM_ARENA_BLOCK 16384
+
+// The length, and alignment, of each slab, the longest object a slab cache will hold, the number of free objects held by each
+// per-thread magazine, and the number of empty slabs a cache keeps before handing them back to the kernel.
+#define MM_SLAB_LENGTH 65536
+#define MM_SLAB_OBJECT_MAX 4096
+#define MM_SLAB_MAGAZINE 64
+#define MM_SLAB_IDLE 1
 
 // The page size should be at least one kilobyte.
 #define MM_SEC_PAGE_ALIGNMENT_MIN 1024
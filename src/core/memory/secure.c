@@ -3,20 +3,52 @@
  * @file /magma/core/memory/secure.c
  *
  * @brief	Functions for allocating secure memory. Secure buffers should always be used to hold sensitive information.
+ *
+ * The secure memory is a single slab, locked into memory, and surrounded by guard pages. Available chunks are kept in a list for their
+ * size class, and every chunk is bracketed by boundary tags, so finding a chunk, and merging a released chunk with its neighbors, never
+ * requires walking the slab. Each thread also keeps a few recently freed small chunks, which it can reuse without taking the slab lock.
+ * Chunks are always wiped when they're freed, and again when they're allocated.
  */
 
 #include "../core.h"
 
 enum {
 	MM_SEC_CHUNK_AVAILABLE = 0,
-	MM_SEC_CHUNK_ALLOCATED = 1
+	MM_SEC_CHUNK_ALLOCATED = 1,
+	MM_SEC_CHUNK_PREVIOUS = 2, /* The chunk before this one is available, so its length can be found just in front of this chunk. */
+	MM_SEC_CHUNK_CACHED = 4 /* The chunk has been freed, and is being held by a per-thread cache. */
 };
 
-typedef struct __attribute__ ((packed)) {
-	uint32_t flags;
+/// The boundary tag at the front of every chunk. An available chunk uses the first sixteen bytes of its data to link itself into the
+/// list for its size class, and repeats its length in the last eight bytes of its data, so the chunk which follows can find its front.
+typedef struct {
 	size_t length;
+	size_t flags;
 } secured_t;
 
+typedef struct {
+	secured_t *next;
+	secured_t *prev;
+} secured_link_t;
+
+/// The chunks freed by a thread, which are held back so the same thread can reuse them without taking the slab lock. The cached chunks
+/// have already been wiped, but are still marked as allocated, so they're never merged with their neighbors. They're also marked as
+/// cached, so freeing one a second time is caught, instead of placing it in a cache twice.
+typedef struct mm_sec_cache_t {
+	pthread_mutex_t lock;
+	struct mm_sec_cache_t *next, *prev;
+	struct {
+		size_t count;
+		secured_t *chunks[MM_SEC_CACHE_DEPTH];
+	} classes[MM_SEC_CACHE_LENGTH / MM_SEC_REQUEST_ALIGNMENT];
+} mm_sec_cache_t;
+
+// The smallest chunk, which must hold the free list links, and the trailing length.
+#define MM_SEC_CHUNK_MIN 32
+
+// The number of size classes which hold a single chunk length. The remaining classes each hold a power of two range of lengths.
+#define MM_SEC_CLASS_EXACT (MM_SEC_CLASS_SMALL / MM_SEC_REQUEST_ALIGNMENT)
+
 static struct {
 
 	struct {
@@ -27,6 +59,17 @@ static struct {
 		pthread_mutex_t lock;
 	} slab;
 
+	struct {
+		uint64_t map; /* A bit is set for every size class with at least one available chunk. */
+		secured_t *heads[MM_SEC_CLASSES];
+	} available;
+
+	struct {
+		bool_t enabled;
+		pthread_key_t key;
+		mm_sec_cache_t *list;
+	} caches;
+
 	struct {
 		size_t items;
 		size_t bytes;
@@ -42,6 +85,15 @@ static struct {
 	.lock = PTHREAD_MUTEX_INITIALIZER
 	},
 
+	.available = {
+		.map = 0
+	},
+
+	.caches = {
+		.enabled = false,
+		.list = NULL
+	},
+
 	.allocated = {
 		.items = 0,
 		.bytes = 0
@@ -50,8 +102,14 @@ static struct {
 	.enabled = false
 };
 
+/// The cache used by the current thread, and whether the thread is exiting, so a free which happens after the cache has been released
+/// doesn't create a new one.
+static __thread mm_sec_cache_t *mm_sec_cache = NULL;
+static __thread bool_t mm_sec_cache_exiting = false;
+
 /**
  * @brief	Get the collected secure memory statistics for the caller.
+ * @note	Chunks held by the per-thread caches aren't counted as allocated.
  * @param	total	a pointer to a size_t variable that will store the secure memory region length, in bytes.
  * @param	bytes	a pointer to a size_t variable that will store the number of secure bytes allocated by magma.
  * @param	items	a pointer to a size_t variable that will store the number of secure memory allocations requested by magma.
@@ -63,11 +121,9 @@ bool_t mm_sec_stats(size_t *total, size_t *bytes, size_t *items) {
 		return false;
 	}
 
-	mutex_lock(&secure.slab.lock);
 	*total = secure.slab.length;
-	*bytes = secure.allocated.bytes;
-	*items = secure.allocated.items;
-	mutex_unlock(&secure.slab.lock);
+	*bytes = __atomic_load_n(&secure.allocated.bytes, __ATOMIC_RELAXED);
+	*items = __atomic_load_n(&secure.allocated.items, __ATOMIC_RELAXED);
 
 	return true;
 }
@@ -94,12 +150,21 @@ bool_t mm_sec_secured(void *block) {
 	return input >= slab && input < (slab + secure.slab.length) ? true : false;
 }
 
+/**
+ * @brief	Get the free list links stored inside an available chunk.
+ * @param	chunk	the available chunk.
+ * @return	a pointer to the links.
+ */
+static secured_link_t * mm_sec_chunk_link(secured_t *chunk) {
+	return (secured_link_t *)((chr_t *)chunk + sizeof(secured_t));
+}
+
 /**
  * @brief	Get the next chunk of secure memory.
  * @param	chunk	the input secure chunk.
- * @return	a pointer to the next chunk of secure memory, or NULL on failure or if the end of the slab is reached.
+ * @return	a pointer to the next chunk of secure memory, or NULL if the end of the slab is reached.
  */
-secured_t * mm_sec_chunk_next(secured_t *chunk) {
+static secured_t * mm_sec_chunk_next(secured_t *chunk) {
 
 	secured_t *next;
 
@@ -110,93 +175,263 @@ secured_t * mm_sec_chunk_next(secured_t *chunk) {
 }
 
 /**
- * @brief	Get the previous chunk of secure memory.
+ * @brief	Get the previous chunk of secure memory, if it's available, using the length stored at the end of its data.
  * @param	chunk	the input secure chunk.
- * @return	a pointer to the previous chunk of secure memory, or NULL on failure or if the beginning of the slab is reached.
+ * @return	a pointer to the previous chunk, or NULL if the previous chunk is allocated, or the beginning of the slab is reached.
  */
-secured_t * mm_sec_chunk_prev(secured_t *chunk) {
+static secured_t * mm_sec_chunk_prev(secured_t *chunk) {
 
-	secured_t *prev, *next;
+	size_t length;
 
-	if (chunk == secure.slab.data) {
-		prev = NULL;
+	if (!(chunk->flags & MM_SEC_CHUNK_PREVIOUS)) {
+		return NULL;
 	}
-	else {
-		prev = (secured_t *)secure.slab.data;
-		while ((next = mm_sec_chunk_next(prev)) && next != chunk) prev = next;
+
+	length = *((size_t *)chunk - 1);
+
+	return (secured_t *)((chr_t *)chunk - length - sizeof(secured_t));
+}
+
+/**
+ * @brief	Find the size class for a chunk length.
+ * @note	Lengths up to MM_SEC_CLASS_SMALL each get their own class. Longer lengths are grouped by their highest set bit.
+ * @param	length	the chunk length, which must be a multiple of MM_SEC_REQUEST_ALIGNMENT.
+ * @return	the size class.
+ */
+static size_t mm_sec_class(size_t length) {
+
+	size_t class;
+
+	if (length <= MM_SEC_CLASS_SMALL) {
+		return (length / MM_SEC_REQUEST_ALIGNMENT) - 1;
 	}
 
-	return prev;
+	class = MM_SEC_CLASS_EXACT + (63 - __builtin_clzll(length)) - __builtin_ctzll(MM_SEC_CLASS_SMALL);
+
+	return class < MM_SEC_CLASSES ? class : MM_SEC_CLASSES - 1;
 }
 
 /**
- * @brief  If an adjacent region is available, merge them together.
+ * @brief	Mark a chunk as available, and add it to the list for its size class.
+ * @note	The caller must hold the slab lock, and the chunk must already have been merged with any available neighbors.
+ * @param	chunk	the chunk being made available.
+ * @return	This function returns no value.
  */
-void mm_sec_chunk_merge(secured_t *chunk) {
+static void mm_sec_chunk_insert(secured_t *chunk) {
+
+	secured_t *next;
+	size_t class = mm_sec_class(chunk->length);
+
+	chunk->flags &= ~(MM_SEC_CHUNK_ALLOCATED | MM_SEC_CHUNK_CACHED);
+	*((size_t *)((chr_t *)chunk + sizeof(secured_t) + chunk->length) - 1) = chunk->length;
+
+	mm_sec_chunk_link(chunk)->prev = NULL;
+	mm_sec_chunk_link(chunk)->next = secure.available.heads[class];
+
+	if (secure.available.heads[class]) {
+		mm_sec_chunk_link(secure.available.heads[class])->prev = chunk;
+	}
+
+	secure.available.heads[class] = chunk;
+	secure.available.map |= (1UL << class);
+
+	if ((next = mm_sec_chunk_next(chunk))) {
+		next->flags |= MM_SEC_CHUNK_PREVIOUS;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Remove an available chunk from the list for its size class.
+ * @note	The caller must hold the slab lock.
+ * @param	chunk	the available chunk.
+ * @return	This function returns no value.
+ */
+static void mm_sec_chunk_remove(secured_t *chunk) {
+
+	secured_link_t *link = mm_sec_chunk_link(chunk);
+	size_t class = mm_sec_class(chunk->length);
+
+	if (link->prev) mm_sec_chunk_link(link->prev)->next = link->next;
+	else secure.available.heads[class] = link->next;
+
+	if (link->next) mm_sec_chunk_link(link->next)->prev = link->prev;
+
+	if (!secure.available.heads[class]) {
+		secure.available.map &= ~(1UL << class);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Merge a chunk with its available neighbors, and make the result available.
+ * @note	The caller must hold the slab lock. Thanks to the boundary tags, both neighbors are found without walking the slab.
+ * @param	chunk	the chunk being released.
+ * @return	This function returns no value.
+ */
+static void mm_sec_chunk_release(secured_t *chunk) {
 
 	secured_t *prev, *next;
 
-	prev = mm_sec_chunk_prev(chunk);
-	next = mm_sec_chunk_next(chunk);
+	if ((next = mm_sec_chunk_next(chunk)) && !(next->flags & MM_SEC_CHUNK_ALLOCATED)) {
+		mm_sec_chunk_remove(next);
+		chunk->length += sizeof(secured_t) + next->length;
+	}
 
-	if (prev && (!(prev->flags & MM_SEC_CHUNK_ALLOCATED))) {
+	if ((prev = mm_sec_chunk_prev(chunk))) {
+		mm_sec_chunk_remove(prev);
 		prev->length += sizeof(secured_t) + chunk->length;
 		chunk = prev;
 	}
 
-	if (next && (!(next->flags & MM_SEC_CHUNK_ALLOCATED))) {
-		chunk->length += sizeof(secured_t) + next->length;
-	}
+	mm_sec_chunk_insert(chunk);
 
 	return;
 }
 
 /**
- * @brief  Locates a properly sized chunk of memory and reserves it.
+ * @brief	Locates a properly sized chunk of memory and reserves it.
+ * @note	The caller must hold the slab lock. Only the size class which matches the request is searched, and then only when the class
+ * 			holds a range of lengths. Any chunk in a larger class is long enough, so it's found using the class bitmap.
+ * @param	length	the length of the chunk, which must be a multiple of MM_SEC_REQUEST_ALIGNMENT, and at least MM_SEC_CHUNK_MIN bytes.
+ * @return	NULL if no chunk is long enough, or a pointer to the reserved chunk.
  */
-secured_t * mm_sec_chunk_new(secured_t *block, size_t size) {
+static secured_t * mm_sec_chunk_new(size_t length) {
 
-	bool_t loop = true;
-	secured_t *chunk, *split;
+	uint64_t map;
+	secured_t *chunk = NULL, *split, *next;
+	size_t class = mm_sec_class(length);
 
-	chunk = block;
-	while(loop && mm_sec_secured(chunk)) {
+	if (class >= MM_SEC_CLASS_EXACT) {
+		for (chunk = secure.available.heads[class]; chunk && chunk->length < length; chunk = mm_sec_chunk_link(chunk)->next);
+		class++;
+	}
 
-		if (!(chunk->flags & MM_SEC_CHUNK_ALLOCATED) && chunk->length >= size) {
+	if (!chunk && (class >= MM_SEC_CLASSES || !(map = secure.available.map & (UINT64_MAX << class)))) {
+		return NULL;
+	}
+	else if (!chunk) {
+		chunk = secure.available.heads[__builtin_ctzll(map)];
+	}
 
-			// Flag the chunk as allocated.
-			chunk->flags |= MM_SEC_CHUNK_ALLOCATED;
+	mm_sec_chunk_remove(chunk);
+	chunk->flags |= MM_SEC_CHUNK_ALLOCATED;
 
-			// If splitting the chunk would yield any bytes beyond the overhead.
-			if ((chunk->length - size) > sizeof(secured_t)) {
-				split = (secured_t *)(((chr_t *)chunk) + sizeof(secured_t) + size);
-				split->length = chunk->length - size - sizeof(secured_t);
-				split->flags = 0;
-				chunk->length = size;
-				mm_sec_chunk_merge(split);
-			}
+	// If splitting the chunk would yield a chunk large enough to hold its own boundary tags, return the remainder to the slab.
+	if ((chunk->length - length) >= (sizeof(secured_t) + MM_SEC_CHUNK_MIN)) {
+		split = (secured_t *)(((chr_t *)chunk) + sizeof(secured_t) + length);
+		split->length = chunk->length - length - sizeof(secured_t);
+		split->flags = 0;
+		chunk->length = length;
+		mm_sec_chunk_insert(split);
+	}
+	else if ((next = mm_sec_chunk_next(chunk))) {
+		next->flags &= ~MM_SEC_CHUNK_PREVIOUS;
+	}
 
-			loop = false;
-		}
-		else {
-			chunk = mm_sec_chunk_next(chunk);
+	return chunk;
+}
+
+/**
+ * @brief	Return every chunk held by a per-thread cache to the slab.
+ * @note	The caller must hold the slab lock, which is always taken before a cache lock.
+ * @param	cache	the cache being emptied.
+ * @param	release	true if the chunks should be returned to the slab, or false if the slab is gone and the chunks should be forgotten.
+ * @return	This function returns no value.
+ */
+static void mm_sec_cache_flush(mm_sec_cache_t *cache, bool_t release) {
+
+	mutex_lock(&cache->lock);
+
+	for (size_t i = 0; i < sizeof(cache->classes) / sizeof(cache->classes[0]); i++) {
+		while (cache->classes[i].count) {
+			cache->classes[i].count--;
+			if (release) mm_sec_chunk_release(cache->classes[i].chunks[cache->classes[i].count]);
 		}
 	}
 
-	// If we end up reaching the end of the secure address space, return NULL.
-	if (!mm_sec_secured(chunk))	chunk = NULL;
+	mutex_unlock(&cache->lock);
 
-	return chunk;
+	return;
+}
+
+/**
+ * @brief	Release the cache of a thread which is exiting, returning its chunks to the slab.
+ * @param	cache	the cache owned by the exiting thread.
+ * @return	This function returns no value.
+ */
+static void mm_sec_cache_release(void *cache) {
+
+	mm_sec_cache_t *local = cache;
+
+	mm_sec_cache_exiting = true;
+	mm_sec_cache = NULL;
+
+	mutex_lock(&secure.slab.lock);
+
+	mm_sec_cache_flush(local, secure.slab.data ? true : false);
+
+	if (local->prev) local->prev->next = local->next;
+	else secure.caches.list = local->next;
+
+	if (local->next) local->next->prev = local->prev;
+
+	mutex_unlock(&secure.slab.lock);
+
+	mutex_destroy(&local->lock);
+	mm_free(local);
+
+	return;
+}
+
+/**
+ * @brief	Get the cache for the current thread, creating it if necessary.
+ * @return	NULL if the caches are disabled, or the cache couldn't be created, otherwise a pointer to the cache of the current thread.
+ */
+static mm_sec_cache_t * mm_sec_cache_get(void) {
+
+	mm_sec_cache_t *cache;
+
+	if ((cache = mm_sec_cache) || mm_sec_cache_exiting || !secure.caches.enabled) {
+		return cache;
+	}
+	else if (!(cache = mm_alloc(sizeof(mm_sec_cache_t)))) {
+		mm_sec_cache_exiting = true;
+		return NULL;
+	}
+	else if (mutex_init(&cache->lock, NULL)) {
+		mm_sec_cache_exiting = true;
+		mm_free(cache);
+		return NULL;
+	}
+
+	mutex_lock(&secure.slab.lock);
+
+	if ((cache->next = secure.caches.list)) cache->next->prev = cache;
+	secure.caches.list = cache;
+
+	mutex_unlock(&secure.slab.lock);
+
+	tkey_set(secure.caches.key, cache);
+	mm_sec_cache = cache;
+
+	return cache;
 }
 
 /**
  * @brief	Free a secure memory block and perform a multi-pass wipe of its contents.
+ * @note	Small chunks are held by the cache of the calling thread, after they've been wiped, until the cache fills up, or the slab
+ * 			runs out of space.
  * @return	This function returns no value.
  */
 void mm_sec_free(void *block) {
 
 	size_t len;
 	secured_t *chunk;
+	bool_t cached = false;
+	mm_sec_cache_t *cache;
 
 #ifdef MAGMA_PEDANTIC
 	if (!mm_sec_secured(block)) {
@@ -208,20 +443,41 @@ void mm_sec_free(void *block) {
 		chunk = (secured_t *)((chr_t *)block - sizeof(secured_t));
 		len = chunk->length;
 
+		// Releasing a chunk which is already available would corrupt the free lists, and caching a chunk which is already cached would
+		// eventually hand the same chunk to two owners.
+		if (!(chunk->flags & MM_SEC_CHUNK_ALLOCATED) || (chunk->flags & MM_SEC_CHUNK_CACHED)) {
+#ifdef MAGMA_PEDANTIC
+			mclog_options(M_LOG_PEDANTIC | M_LOG_STACK_TRACE, "The secure memory system was asked to free a chunk which was already freed.");
+#endif
+			return;
+		}
+
 		// Wipe the data segment three times to ensure sensitive information isn't leaked.
 		mm_set(block, 255, len);
 		mm_set(block, 128, len);
 		mm_set(block, 0, len);
 
-		mutex_lock(&secure.slab.lock);
+		__atomic_sub_fetch(&secure.allocated.items, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&secure.allocated.bytes, len, __ATOMIC_RELAXED);
 
-		secure.allocated.items--;
-		secure.allocated.bytes -= len;
+		if (len <= MM_SEC_CACHE_LENGTH && (cache = mm_sec_cache_get())) {
 
-		chunk->flags &= ~MM_SEC_CHUNK_ALLOCATED;
-		mm_sec_chunk_merge(chunk);
+			mutex_lock(&cache->lock);
 
-		mutex_unlock(&secure.slab.lock);
+			if (cache->classes[mm_sec_class(len)].count < MM_SEC_CACHE_DEPTH) {
+				cache->classes[mm_sec_class(len)].chunks[cache->classes[mm_sec_class(len)].count++] = chunk;
+				chunk->flags |= MM_SEC_CHUNK_CACHED;
+				cached = true;
+			}
+
+			mutex_unlock(&cache->lock);
+		}
+
+		if (!cached) {
+			mutex_lock(&secure.slab.lock);
+			mm_sec_chunk_release(chunk);
+			mutex_unlock(&secure.slab.lock);
+		}
 	}
 
 	return;
@@ -244,34 +500,58 @@ void mm_sec_cleanup(void *block) {
 
 /**
  * @brief	Allocate a chunk of memory from the secure memory slab
+ * @note	Small requests are served by the cache of the calling thread when possible, which avoids the slab lock. If the slab runs out
+ * 			of space, the chunks held by every thread cache are returned to the slab, and the request is tried again.
  * @see		mm_sec_chunk_new()
  * @param	len		the length, in bytes, of the secure memory chunk to be allocated.
  * @return	NULL on failure, or a pointer to the freshly allocated chunk of secure memory on success.
  */
 void * mm_sec_alloc(size_t len) {
 
-	secured_t *chunk;
 	void *result = NULL;
+	secured_t *chunk = NULL;
+	mm_sec_cache_t *cache;
 
 	if (!secure.enabled || !secure.slab.data || !len) {
 		return NULL;
 	}
 
-	// Align allocations to a length of 12 bytes, which is the size of our secured_t structure.
-	len = align(16, len);
+	// Align allocations to a length of 16 bytes, which is also the size of our secured_t structure.
+	if ((len = align(MM_SEC_REQUEST_ALIGNMENT, len)) < MM_SEC_CHUNK_MIN) {
+		len = MM_SEC_CHUNK_MIN;
+	}
+
+	if (len <= MM_SEC_CACHE_LENGTH && (cache = mm_sec_cache_get())) {
 
-	mutex_lock(&secure.slab.lock);
+		mutex_lock(&cache->lock);
 
-	if ((chunk = mm_sec_chunk_new(secure.slab.data, len))) {
-		secure.allocated.items++;
-		secure.allocated.bytes += len;
+		if (cache->classes[mm_sec_class(len)].count) {
+			chunk = cache->classes[mm_sec_class(len)].chunks[--cache->classes[mm_sec_class(len)].count];
+			chunk->flags &= ~MM_SEC_CHUNK_CACHED;
+		}
+
+		mutex_unlock(&cache->lock);
 	}
 
-	mutex_unlock(&secure.slab.lock);
+	if (!chunk) {
+
+		mutex_lock(&secure.slab.lock);
+
+		if (!(chunk = mm_sec_chunk_new(len)) && secure.caches.list) {
+			for (cache = secure.caches.list; cache; cache = cache->next) {
+				mm_sec_cache_flush(cache, true);
+			}
+			chunk = mm_sec_chunk_new(len);
+		}
+
+		mutex_unlock(&secure.slab.lock);
+	}
 
 	if (chunk) {
+		__atomic_add_fetch(&secure.allocated.items, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&secure.allocated.bytes, chunk->length, __ATOMIC_RELAXED);
 		result = ((chr_t *)chunk + sizeof(secured_t));
-		mm_wipe(result, len);
+		mm_wipe(result, chunk->length);
 	}
 
 #ifdef MAGMA_PEDANTIC
@@ -329,6 +609,13 @@ void mm_sec_stop(void) {
 
 	if (secure.enabled && secure.slab.data) {
 
+		mutex_lock(&secure.slab.lock);
+
+		// The thread caches outlive the slab, so they need to forget the chunks they're holding.
+		for (mm_sec_cache_t *cache = secure.caches.list; cache; cache = cache->next) {
+			mm_sec_cache_flush(cache, false);
+		}
+
 		mm_set(secure.slab.data, 255, secure.slab.length);
 		mm_set(secure.slab.data, 128, secure.slab.length);
 		mm_set(secure.slab.data, 64, secure.slab.length);
@@ -343,6 +630,9 @@ void mm_sec_stop(void) {
 		secure.slab.data = secure.slab.data_true = NULL;
 		secure.slab.length = secure.slab.length_true = 0;
 
+		mm_wipe(&secure.available, sizeof(secure.available));
+
+		mutex_unlock(&secure.slab.lock);
 	}
 
 	return;
@@ -416,10 +706,17 @@ bool_t mm_sec_start(void) {
 	}
 
 	mm_wipe(secure.slab.data, secure.slab.length);
+	mm_wipe(&secure.available, sizeof(secure.available));
 
 	chunk = (secured_t *)secure.slab.data;
 	chunk->length = secure.slab.length - sizeof(secured_t);
 	chunk->flags = 0;
+	mm_sec_chunk_insert(chunk);
+
+	// The thread caches are optional, so if the key used to release them can't be created, every request goes to the slab.
+	if (!secure.caches.enabled && !tkey_init(&secure.caches.key, &mm_sec_cache_release)) {
+		secure.caches.enabled = true;
+	}
 
 	return true;
 }
@@ -0,0 +1,542 @@
+
+/**
+ * @file /magma/core/memory/slab.c
+ *
+ * @brief	Slab caches, which hold fixed size objects that are allocated and freed at a high rate.
+ *
+ * Each cache carves its objects out of slabs, which are aligned blocks of MM_SLAB_LENGTH bytes mapped directly from the kernel, so
+ * objects of the same type are packed together, and never fragment the general heap. A slab is found by masking the address of an
+ * object, and slabs which become empty are handed back to the kernel, keeping only MM_SLAB_IDLE empty slabs per cache in reserve.
+ *
+ * Each thread keeps a magazine of free objects for every cache it uses, so most allocations, and frees, never touch the cache lock.
+ * An empty magazine is refilled with half a magazine of objects, and a full magazine returns half of its objects, in a single trip
+ * to the cache. When a thread exits, its magazine is returned to the cache.
+ *
+ * Caches are declared statically using SLAB_CACHE(), and are setup the first time they're used, so they don't depend on the startup
+ * order. They live for the life of the process.
+ */
+
+#include "../core.h"
+
+#define SLAB_ALIGNMENT 16
+#define SLAB_PAGE(object) ((slab_page_t *)((uintptr_t)(object) & ~((uintptr_t)MM_SLAB_LENGTH - 1)))
+
+typedef struct slab_page_t {
+	slab_t *cache; /* The cache which owns the slab. */
+	void *free; /* The objects which have been returned to the slab, linked using their first word. */
+	bool_t listed; /* Whether the slab is on the partial list of its cache. Full slabs are left off the list. */
+	uint32_t used; /* The number of objects handed out from the slab, including those sitting in magazines. */
+	uint32_t carved; /* The number of objects which have been carved from the slab. Objects are carved as they're needed. */
+	struct slab_page_t *next, *prev; /* The links in the partial list of the cache. */
+	struct slab_page_t *older, *newer; /* The links in the list of every slab held by the cache. */
+} slab_page_t;
+
+typedef struct slab_magazine_t {
+	slab_t *cache; /* The cache the magazine belongs to. */
+	uint64_t gets, puts; /* The number of objects the owning thread has taken from, and returned to, the cache. */
+	uint32_t count; /* The number of free objects held by the magazine. */
+	struct slab_magazine_t *next, *prev;
+	void *objects[MM_SLAB_MAGAZINE];
+} slab_magazine_t;
+
+static struct {
+	pthread_mutex_t lock;
+	slab_t *head, *tail;
+} slabs = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.head = NULL,
+		.tail = NULL
+};
+
+/**
+ * @brief	Map a new slab, and add it to the partial list of a cache.
+ * @note	The caller must hold the cache lock.
+ * @param	cache	the cache which will own the slab.
+ * @return	NULL on failure, or a pointer to the new slab on success.
+ */
+static slab_page_t * slab_page_alloc(slab_t *cache) {
+
+	size_t lead;
+	uchr_t *region;
+	slab_page_t *page;
+
+	// Map twice the slab length, and then trim the excess, so the slab is aligned to its own length.
+	if ((region = mmap(NULL, MM_SLAB_LENGTH * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+		mclog_pedantic("Unable to map a slab for the %s cache. { error = %s }", cache->name, strerror_r(errno, MEMORYBUF(1024), 1024));
+		return NULL;
+	}
+
+	if ((lead = (MM_SLAB_LENGTH - ((uintptr_t)region & (MM_SLAB_LENGTH - 1))) & (MM_SLAB_LENGTH - 1))) {
+		munmap(region, lead);
+	}
+
+	munmap(region + lead + MM_SLAB_LENGTH, MM_SLAB_LENGTH - lead);
+
+	// Anonymous mappings are zeroed, so only the fields which aren't zero need to be set.
+	page = (slab_page_t *)(region + lead);
+	page->cache = cache;
+	page->listed = true;
+
+	if ((page->next = cache->partial)) {
+		((slab_page_t *)cache->partial)->prev = page;
+	}
+
+	cache->partial = page;
+
+	if ((page->older = cache->pages)) {
+		((slab_page_t *)cache->pages)->newer = page;
+	}
+
+	cache->pages = page;
+	cache->slabs++;
+	cache->idle++;
+
+	return page;
+}
+
+/**
+ * @brief	Remove a slab from the partial list of its cache.
+ * @note	The caller must hold the cache lock.
+ * @param	cache	the cache which owns the slab.
+ * @param	page	the slab.
+ * @return	This function returns no value.
+ */
+static void slab_page_unlink(slab_t *cache, slab_page_t *page) {
+
+	if (page->prev) page->prev->next = page->next;
+	else cache->partial = page->next;
+
+	if (page->next) page->next->prev = page->prev;
+
+	page->next = page->prev = NULL;
+	page->listed = false;
+
+	return;
+}
+
+/**
+ * @brief	Take a free object from the slabs of a cache, mapping a new slab if necessary.
+ * @note	The caller must hold the cache lock.
+ * @param	cache	the cache.
+ * @return	NULL on failure, or a pointer to the object, which isn't zeroed, on success.
+ */
+static void * slab_take(slab_t *cache) {
+
+	void *object;
+	slab_page_t *page;
+
+	if (!(page = cache->partial) && !(page = slab_page_alloc(cache))) {
+		return NULL;
+	}
+
+	if ((object = page->free)) {
+		page->free = *((void **)object);
+	}
+	else {
+		object = (uchr_t *)page + cache->offset + (page->carved++ * cache->stride);
+	}
+
+	if (!page->used++) {
+		cache->idle--;
+	}
+
+	if (page->used == cache->capacity) {
+		slab_page_unlink(cache, page);
+	}
+
+	return object;
+}
+
+/**
+ * @brief	Return an object to its slab, and hand the slab back to the kernel if it's empty, and the cache has enough empty slabs.
+ * @note	The caller must hold the cache lock.
+ * @param	cache	the cache.
+ * @param	object	the object being returned.
+ * @return	This function returns no value.
+ */
+static void slab_give(slab_t *cache, void *object) {
+
+	slab_page_t *page = SLAB_PAGE(object);
+
+	*((void **)object) = page->free;
+	page->free = object;
+
+	if (!page->listed) {
+
+		if ((page->next = cache->partial)) {
+			((slab_page_t *)cache->partial)->prev = page;
+		}
+
+		cache->partial = page;
+		page->listed = true;
+	}
+
+	if (!--page->used) {
+
+		if (cache->idle >= MM_SLAB_IDLE) {
+
+			slab_page_unlink(cache, page);
+
+			if (page->newer) page->newer->older = page->older;
+			else cache->pages = page->older;
+
+			if (page->older) page->older->newer = page->newer;
+
+			munmap(page, MM_SLAB_LENGTH);
+			cache->slabs--;
+		}
+		else {
+			cache->idle++;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Return the objects held by an exiting thread's magazine to the cache, and release the magazine.
+ * @note	This is the destructor of the thread key holding the magazines.
+ * @param	holder	the magazine.
+ * @return	This function returns no value.
+ */
+static void slab_magazine_release(void *holder) {
+
+	slab_magazine_t *magazine = holder;
+	slab_t *cache = magazine->cache;
+
+	mutex_lock(&(cache->lock));
+
+	while (magazine->count) {
+		slab_give(cache, magazine->objects[--magazine->count]);
+	}
+
+	// Keep the counters of the exiting thread, so the number of objects in use stays accurate.
+	cache->gets += magazine->gets;
+	cache->puts += magazine->puts;
+
+	if (magazine->prev) magazine->prev->next = magazine->next;
+	else cache->magazines = magazine->next;
+
+	if (magazine->next) magazine->next->prev = magazine->prev;
+
+	mutex_unlock(&(cache->lock));
+
+	mm_free(magazine);
+
+	return;
+}
+
+/**
+ * @brief	Setup a cache the first time it's used, and add it to the list of caches reported through the statistics interface.
+ * @param	cache	the cache.
+ * @return	true if the cache is ready to be used, or false on failure.
+ */
+static bool_t slab_setup(slab_t *cache) {
+
+	bool_t result = true;
+
+	mutex_lock(&(cache->lock));
+
+	if (cache->ready) {
+		mutex_unlock(&(cache->lock));
+		return true;
+	}
+
+	cache->stride = align(SLAB_ALIGNMENT, cache->size > sizeof(void *) ? cache->size : sizeof(void *));
+	cache->offset = align(SLAB_ALIGNMENT, sizeof(slab_page_t));
+	cache->capacity = (MM_SLAB_LENGTH - cache->offset) / cache->stride;
+
+	if (!cache->name || !cache->size || cache->size > MM_SLAB_OBJECT_MAX) {
+		mclog_pedantic("Invalid slab cache parameters. { name = %s / size = %zu }", cache->name ? cache->name : "NULL", cache->size);
+		result = false;
+	}
+	else if (tkey_init(&(cache->key), &slab_magazine_release)) {
+		mclog_pedantic("Unable to create the magazine key for the %s cache.", cache->name);
+		result = false;
+	}
+
+	if (result) {
+
+		snprintf(cache->names[0], sizeof(cache->names[0]), "system.slab.%s.objects", cache->name);
+		snprintf(cache->names[1], sizeof(cache->names[1]), "system.slab.%s.bytes", cache->name);
+
+		// The cache is appended, and published, only after it has been setup, so the list can be walked without the lock.
+		mutex_lock(&slabs.lock);
+
+		if (slabs.tail) __atomic_store_n(&(slabs.tail->next), cache, __ATOMIC_RELEASE);
+		else __atomic_store_n(&(slabs.head), cache, __ATOMIC_RELEASE);
+
+		slabs.tail = cache;
+
+		mutex_unlock(&slabs.lock);
+
+		__atomic_store_n(&(cache->ready), true, __ATOMIC_RELEASE);
+	}
+
+	mutex_unlock(&(cache->lock));
+
+	return result;
+}
+
+/**
+ * @brief	Get the magazine the current thread uses for a cache, allocating one if necessary.
+ * @param	cache	the cache, which must be setup.
+ * @return	NULL if a magazine couldn't be allocated, or a pointer to the magazine.
+ */
+static slab_magazine_t * slab_magazine(slab_t *cache) {
+
+	slab_magazine_t *magazine;
+
+	if ((magazine = tkey_get(cache->key))) {
+		return magazine;
+	}
+	else if (!(magazine = mm_alloc(sizeof(slab_magazine_t)))) {
+		return NULL;
+	}
+
+	magazine->cache = cache;
+
+	mutex_lock(&(cache->lock));
+
+	if ((magazine->next = cache->magazines)) {
+		((slab_magazine_t *)cache->magazines)->prev = magazine;
+	}
+
+	cache->magazines = magazine;
+
+	mutex_unlock(&(cache->lock));
+
+	if (tkey_set(cache->key, magazine)) {
+		slab_magazine_release(magazine);
+		return NULL;
+	}
+
+	return magazine;
+}
+
+#ifdef MAGMA_PEDANTIC
+/**
+ * @brief	Determine whether an object was handed out by a slab cache.
+ * @note	The slab holding the object is found by masking its address, so the slab is compared against the list of slabs held by the
+ * 			cache before it's trusted, since the masked address of an object which didn't come from the cache could point anywhere.
+ * @param	cache	the cache, which must be setup.
+ * @param	object	the object.
+ * @return	true if the object is on a slab held by the cache, and sits on an object boundary, otherwise false.
+ */
+static bool_t slab_owned(slab_t *cache, void *object) {
+
+	bool_t result = false;
+	slab_page_t *page = SLAB_PAGE(object);
+	size_t position = (uchr_t *)object - (uchr_t *)page;
+
+	if (position < cache->offset || (position - cache->offset) % cache->stride || (position - cache->offset) / cache->stride >= cache->capacity) {
+		return false;
+	}
+
+	mutex_lock(&(cache->lock));
+
+	for (slab_page_t *holder = cache->pages; holder && !result; holder = holder->older) {
+		if (holder == page) result = true;
+	}
+
+	mutex_unlock(&(cache->lock));
+
+	return result;
+}
+#endif
+
+/**
+ * @brief	Allocate a zeroed object from a slab cache.
+ * @param	cache	the cache.
+ * @return	NULL on failure, or a pointer to the zeroed object on success.
+ */
+void * slab_get(slab_t *cache) {
+
+	void *object = NULL;
+	slab_magazine_t *magazine;
+
+	if (!__atomic_load_n(&(cache->ready), __ATOMIC_ACQUIRE) && !slab_setup(cache)) {
+		return NULL;
+	}
+
+	// Without a magazine, the object is taken from the cache directly.
+	if (!(magazine = slab_magazine(cache))) {
+
+		mutex_lock(&(cache->lock));
+		if ((object = slab_take(cache))) cache->gets++;
+		mutex_unlock(&(cache->lock));
+
+		return object ? mm_set(object, 0, cache->size) : NULL;
+	}
+
+	// Refill an empty magazine with half a magazine of objects.
+	if (!magazine->count) {
+
+		mutex_lock(&(cache->lock));
+
+		while (magazine->count < MM_SLAB_MAGAZINE / 2 && (object = slab_take(cache))) {
+			magazine->objects[magazine->count++] = object;
+		}
+
+		mutex_unlock(&(cache->lock));
+
+		if (!magazine->count) {
+			return NULL;
+		}
+	}
+
+	object = magazine->objects[--magazine->count];
+	magazine->gets++;
+
+	return mm_set(object, 0, cache->size);
+}
+
+/**
+ * @brief	Return an object to the slab cache it was allocated from.
+ * @param	cache	the cache the object was allocated from.
+ * @param	object	the object, which may be NULL.
+ * @return	This function returns no value.
+ */
+void slab_put(slab_t *cache, void *object) {
+
+	slab_magazine_t *magazine;
+
+	if (!object) {
+		return;
+	}
+
+#ifdef MAGMA_PEDANTIC
+	if (!cache->ready || !slab_owned(cache, object)) {
+		mclog_pedantic("Attempted to return an object to a slab cache it wasn't allocated from. { cache = %s }", cache->name);
+		return;
+	}
+#endif
+
+	if (!(magazine = slab_magazine(cache))) {
+
+		mutex_lock(&(cache->lock));
+		slab_give(cache, object);
+		cache->puts++;
+		mutex_unlock(&(cache->lock));
+
+		return;
+	}
+
+	// Return half of a full magazine to the cache.
+	if (magazine->count == MM_SLAB_MAGAZINE) {
+
+		mutex_lock(&(cache->lock));
+
+		while (magazine->count > MM_SLAB_MAGAZINE / 2) {
+			slab_give(cache, magazine->objects[--magazine->count]);
+		}
+
+		mutex_unlock(&(cache->lock));
+	}
+
+	magazine->objects[magazine->count++] = object;
+	magazine->puts++;
+
+	return;
+}
+
+/**
+ * @brief	Get the number of objects allocated from a slab cache which haven't been returned, and the amount of memory it holds.
+ * @param	cache	the cache.
+ * @param	objects	a pointer to receive the number of objects in use.
+ * @param	bytes	a pointer to receive the number of bytes mapped by the cache's slabs.
+ * @return	true if the cache has been setup, otherwise false.
+ */
+bool_t slab_stats(slab_t *cache, uint64_t *objects, uint64_t *bytes) {
+
+	uint64_t gets, puts;
+
+	if (!cache || !__atomic_load_n(&(cache->ready), __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	mutex_lock(&(cache->lock));
+
+	gets = cache->gets;
+	puts = cache->puts;
+
+	// The magazine counters are read while their threads are updating them, so the result is only approximate.
+	for (slab_magazine_t *magazine = cache->magazines; magazine; magazine = magazine->next) {
+		gets += __atomic_load_n(&(magazine->gets), __ATOMIC_RELAXED);
+		puts += __atomic_load_n(&(magazine->puts), __ATOMIC_RELAXED);
+	}
+
+	*bytes = cache->slabs * MM_SLAB_LENGTH;
+
+	mutex_unlock(&(cache->lock));
+
+	*objects = gets > puts ? gets - puts : 0;
+
+	return true;
+}
+
+/**
+ * @brief	Get the number of slab cache statistics reported through the statistics interface.
+ * @note	Each cache which has been setup reports the number of objects in use, and the number of bytes mapped by its slabs.
+ * @return	the number of slab cache statistics.
+ */
+uint64_t slab_stats_count(void) {
+
+	uint64_t count = 0;
+
+	for (slab_t *cache = __atomic_load_n(&(slabs.head), __ATOMIC_ACQUIRE); cache; cache = __atomic_load_n(&(cache->next), __ATOMIC_ACQUIRE)) {
+		count += 2;
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Find a slab cache using the position of one of its statistics.
+ * @param	position	the zero-based position of the statistic.
+ * @return	NULL if the position is out of range, or a pointer to the cache.
+ */
+static slab_t * slab_stats_find(uint64_t position) {
+
+	slab_t *cache = __atomic_load_n(&(slabs.head), __ATOMIC_ACQUIRE);
+
+	while (cache && position >= 2) {
+		cache = __atomic_load_n(&(cache->next), __ATOMIC_ACQUIRE);
+		position -= 2;
+	}
+
+	return cache;
+}
+
+/**
+ * @brief	Get the name of a slab cache statistic.
+ * @param	position	the zero-based position of the statistic.
+ * @return	NULL on failure, or a pointer to a null-terminated string containing the name of the statistic.
+ */
+chr_t * slab_stats_name(uint64_t position) {
+
+	slab_t *cache;
+
+	if (!(cache = slab_stats_find(position))) {
+		return NULL;
+	}
+
+	return cache->names[position % 2];
+}
+
+/**
+ * @brief	Get the value of a slab cache statistic.
+ * @param	position	the zero-based position of the statistic.
+ * @return	the number of objects in use, or the number of bytes mapped, by the cache, or 0 on failure.
+ */
+uint64_t slab_stats_value(uint64_t position) {
+
+	slab_t *cache;
+	uint64_t objects = 0, bytes = 0;
+
+	if (!(cache = slab_stats_find(position)) || !slab_stats(cache, &objects, &bytes)) {
+		return 0;
+	}
+
+	return position % 2 ? bytes : objects;
+}
@@ -15,9 +15,42 @@ const char * build_version(void);
 /************  BUILD  ************/
 
 /************  PERFORMANCE  ************/
+bool_t perf_calibrate(void);
+uint64_t perf_elapsed(uint64_t start);
 uint64_t perf_rdtsc(void);
 /************  PERFORMANCE  ************/
 
+/************  RECORDER  ************/
+typedef enum {
+	RECORDER_COMMAND_START = 1,
+	RECORDER_COMMAND_END = 2,
+	RECORDER_QUEUE_DEQUEUE = 3,
+	RECORDER_LOCK_WAIT = 4,
+	RECORDER_SQL_STATEMENT = 5,
+	RECORDER_TANK_READ = 6,
+	RECORDER_COMMAND_DISPATCH = 7
+} recorder_type_t;
+
+void recorder_dump(bool_t (*output)(void *context, chr_t *line, size_t length), void *context);
+void recorder_dump_fd(int fd);
+void recorder_event(recorder_type_t type, uint32_t value, uint64_t data);
+void recorder_request(void);
+bool_t recorder_requested(void);
+/************  RECORDER  ************/
+
+/************  LATENCY  ************/
+typedef struct latency_t latency_t;
+
+latency_t * latency_alloc(chr_t *protocol, chr_t *command, size_t length);
+uint64_t latency_count(latency_t *histogram);
+latency_t * latency_find(chr_t *name);
+void latency_free(void);
+chr_t * latency_name(latency_t *histogram);
+latency_t * latency_next(latency_t *histogram);
+uint64_t latency_percentile(latency_t *histogram, uint64_t permille);
+void latency_record(latency_t *histogram, uint64_t start);
+/************  LATENCY  ************/
+
 /// status.c
 bool_t     status(void);
 int        status_get(void);
@@ -37,6 +70,8 @@ void stats_shutdown(void);
 
 uint64_t stats_get_count(void);
 char * stats_get_name(uint64_t position);
+uint64_t stats_get_name_pos(char *name);
+uint64_t stats_intern(uint64_t *cache, char *name);
 
 uint64_t stats_get_value_by_name(char *name);
 uint64_t stats_get_value_by_num(uint64_t position);
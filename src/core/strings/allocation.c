@@ -29,7 +29,7 @@
 void st_free(stringer_t *s) {
 
 	uint32_t opts = *((uint32_t *)s);
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
+	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_free : &mm_free;
 
 #ifdef MAGMA_PEDANTIC
 	if (!st_valid_free(opts)) {
@@ -47,7 +47,7 @@ void st_free(stringer_t *s) {
 	switch (opts & (NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CONTIGUOUS | JOINTED)) {
 		case (PLACER_T | JOINTED):
 			if (!(opts & FOREIGNDATA)) release(((placer_t *)s)->data);
-			if (opts & (HEAP | SECURE)) release(s);
+			if (opts & (HEAP | SECURE | ARENA)) release(s);
 			break;
 		case (NULLER_T | JOINTED):
 			release(((nuller_t *)s)->data);
@@ -469,6 +469,7 @@ int_t st_append_out(size_t align, stringer_t **s, stringer_t *append) {
  * 			The supported types are: placer, nuller, block, managed, and mapped.
  * 			The following logic is applied to requested string allocation options:
  * 			1. Any allocation options specified for strings to be allocated on the stack are IGNORED.
+ * 			   Strings which ask for the arena allocator are placed on the heap if the current thread doesn't have an active arena.
  * 			2. All jointed strings allocate memory for the header and data separately and then link them EXCEPT:
  * 				Jointed placers only allocate space for a header.
  * 				Jointed mapped strings allocate the data with an aligned mmap() operation.
@@ -487,12 +488,18 @@ stringer_t * st_alloc_opts(uint32_t opts, size_t len) {
 	int handle = -1;
 	size_t avail = 0;
 	stringer_t *result = NULL;
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
-	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : &mm_alloc;
+	void (*release)(void *buffer);
+	void * (*allocate)(size_t len);
 
 	// The logic below allocates memory off the heap, so if were passed options calling for the stack we silently replace it with instructions to use the heap.
 	opts = (opts & STACK ? (opts ^ STACK) | HEAP : opts);
 
+	// Arena strings are only released when the arena is reset, so if the thread doesn't have an active arena the heap is used instead.
+	opts = (opts & ARENA && !arena_current() ? (opts ^ ARENA) | HEAP : opts);
+
+	release = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_free : &mm_free;
+	allocate = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_alloc : &mm_alloc;
+
 #ifdef MAGMA_PEDANTIC
 	if (!st_valid_opts(opts)) {
 		mclog_pedantic("Invalid string options. { opt = %u = %s }", opts, st_info_opts(opts, MEMORYBUF(128), 128));
@@ -642,8 +649,8 @@ stringer_t * st_realloc(stringer_t *s, size_t len) {
 	size_t original, avail;
 	stringer_t *result = NULL;
 	uint32_t opts = *((uint32_t *)s);
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
-	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : &mm_alloc;
+	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_free : &mm_free;
+	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_alloc : &mm_alloc;
 
 #ifdef MAGMA_PEDANTIC
 	if (!st_valid_opts(opts)) {
@@ -31,7 +31,8 @@ chr_t *st_option_allocators[] = {
 	"UNKNOWN",
 	"STACK",
 	"HEAP",
-	"SECURE"
+	"SECURE",
+	"ARENA"
 };
 
 /**
@@ -97,7 +98,7 @@ const chr_t * st_info_allocator(uint32_t opts) {
 
 	chr_t *result = st_option_allocators[0];
 
-	switch (opts & (STACK | HEAP | SECURE)) {
+	switch (opts & (STACK | HEAP | SECURE | ARENA)) {
 		case (STACK):
 			result = st_option_allocators[1];
 			break;
@@ -107,6 +108,9 @@ const chr_t * st_info_allocator(uint32_t opts) {
 		case (SECURE):
 			result = st_option_allocators[3];
 			break;
+		case (ARENA):
+			result = st_option_allocators[4];
+			break;
 	}
 
 	return result;
@@ -19,8 +19,8 @@ bool_t st_valid_placer(uint32_t opts) {
 	if (!st_valid_opts(opts)) {
 		return false;
 	}
-	else if (!(opts & PLACER_T) && !(opts & JOINTED) && !(opts & (STACK | HEAP | SECURE)) &&
-			(opts & ~(PLACER_T | JOINTED | STACK | HEAP | SECURE))) {
+	else if (!(opts & PLACER_T) && !(opts & JOINTED) && !(opts & (STACK | HEAP | SECURE | ARENA)) &&
+			(opts & ~(PLACER_T | JOINTED | STACK | HEAP | SECURE | ARENA))) {
 		return false;
 	}
 
@@ -138,7 +138,7 @@ bool_t st_valid_avail(uint32_t opts) {
  * 			1. Each managed string must only be one of the following:
  * 				a. constant, nuller, block, placer, managed, or mapped.
  *				b. jointed or contiguous.
- *				c. allocated on the stack, heap, or secure.
+ *				c. allocated on the stack, heap, secure, or arena.
  *			2. A placer cannot be contiguous.
  *			3. A constant must be contiguous and be allocated on the stack.
  *			4. Mapped strings must be contiguous and on the heap.
@@ -159,7 +159,7 @@ bool_t st_valid_opts(uint32_t opts) {
 		result = false;
 	}
 	// Allocation
-	else if (bitwise_count(opts & (STACK | HEAP | SECURE)) != 1) {
+	else if (bitwise_count(opts & (STACK | HEAP | SECURE | ARENA)) != 1) {
 		result = false;
 	}
 
@@ -183,7 +183,7 @@ bool_t st_valid_opts(uint32_t opts) {
 		// Mapped containers must specify a jointed layout and use the heap allocator.
 		case (MAPPED_T):
 			if (opts & CONTIGUOUS) result = false;
-			else if (opts & STACK) result = false;
+			else if (opts & (STACK | ARENA)) result = false;
 			break;
 
 	}
@@ -30,22 +30,31 @@ int mutex_init(pthread_mutex_t *lock, pthread_mutexattr_t *attr) {
 
 /**
  * @brief	Acquire a pthread mutex, blocking if necessary.
+ * @note	An uncontended mutex is acquired without touching the cycle counter. If the mutex is already held, the time spent waiting
+ * 			for it is recorded by the flight recorder of the calling thread.
  * @see		pthread_mutex_lock()
  * @param	lock	a pointer to the mutex to be locked.
  * @return	0 on success, or an error number on failure.
  */
 int mutex_lock(pthread_mutex_t *lock) {
 
+	int result;
+	uint64_t start, waited;
+
+	if ((result = pthread_mutex_trylock(lock)) == EBUSY) {
+		start = perf_rdtsc();
+		result = pthread_mutex_lock(lock);
+		waited = perf_elapsed(start) / 1000;
+		recorder_event(RECORDER_LOCK_WAIT, waited > UINT32_MAX ? UINT32_MAX : waited, (uintptr_t)lock);
+	}
+
 #ifdef MAGMA_PEDANTIC
-	int result = pthread_mutex_lock(lock);
 	if (result) {
 		mclog_options(M_LOG_PEDANTIC | M_LOG_STACK_TRACE, "Could not lock the mutex. {pthread_mutex_lock = %i / error = %s}", result, strerror_r(errno, MEMORYBUF(1024), 1024));
 	}
-	return result;
-#else
-	return pthread_mutex_lock(lock);
 #endif
 
+	return result;
 }
 
 /**
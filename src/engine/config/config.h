@@ -37,9 +37,126 @@
 // The maximum number of server instances.
 #define MAGMA_SERVER_INSTANCES 32
 
+// The maximum number of listening sockets, each with its own accept thread, a single server instance can open using SO_REUSEPORT.
+#define MAGMA_SERVER_ACCEPTORS 64
+
+// The default group commit window, in milliseconds, for message deliveries.
+#define MAGMA_STORAGE_SYNC_WINDOW 2
+
+// The maximum number of message files flushed by a single group commit.
+#define MAGMA_STORAGE_SYNC_BATCH 256
+
+// The number of delivered messages the full text search index holds before writing them as a single batch, and the number of seconds a
+// message may wait in a partial batch before the next delivery writes it.
+#define MAGMA_STORAGE_SEARCH_BATCH 32
+#define MAGMA_STORAGE_SEARCH_DELAY 30
+
+// The number of deleted messages allowed to accumulate for a user before they're compacted out of the full text search index.
+#define MAGMA_STORAGE_SEARCH_COMPACT 64
+
+// The default amount of memory, in bytes, the shared message cache may use to hold decompressed messages.
+#define MAGMA_STORAGE_CACHE_SIZE 67108864
+
+// The number of independently locked shards in the shared message cache, and the number of hash buckets in each shard.
+#define MAGMA_STORAGE_CACHE_SHARDS 16
+#define MAGMA_STORAGE_CACHE_BUCKETS 256
+
+// The number of hash buckets in the mailbox notification table, and the number of flag changes remembered for each idle session.
+#define MAGMA_NOTIFY_BUCKETS 256
+#define MAGMA_NOTIFY_CHANGES 64
+
+// The number of independently locked shards in the TLS session cache, the number of hash buckets in each shard, and the number of
+// sessions each shard will hold before the least recently used sessions are evicted.
+#define MAGMA_TLS_SESSION_SHARDS 16
+#define MAGMA_TLS_SESSION_BUCKETS 1024
+#define MAGMA_TLS_SESSION_LIMIT 4096
+
+// The number of seconds a TLS session may be resumed, and the number of seconds between TLS session ticket key rotations. Tickets
+// encrypted with the previous key are still accepted, but are replaced, so a ticket is never honored for more than two rotations.
+#define MAGMA_TLS_SESSION_TIMEOUT 3600
+#define MAGMA_TLS_TICKET_ROTATE 3600
+
+// The number of work items each worker thread can hold in its private deque. Must be a power of two.
+#define MAGMA_QUEUE_DEQUE_SIZE 4096
+
+// The number of consecutive items a worker thread may pop off the newest end of its own deque, before it has to take the oldest item
+// in its inbox, or deque, instead. This bounds how long older work can wait behind work which keeps requeueing itself.
+#define MAGMA_QUEUE_LIFO_RUN 16
+
+// The number of priority classes in the worker queue, and the share of worker turns each class receives when every class has work
+// waiting. A class with nothing waiting gives its turns to the others, so the weights only matter when the queue is backed up.
+#define MAGMA_QUEUE_PRIORITIES 3
+#define MAGMA_QUEUE_WEIGHT_INTERACTIVE 8
+#define MAGMA_QUEUE_WEIGHT_DELIVERY 4
+#define MAGMA_QUEUE_WEIGHT_BACKGROUND 1
+
+// The number of seconds covered by each window of the queue wait histograms. Wait percentiles cover the current and previous windows.
+#define MAGMA_QUEUE_WAIT_WINDOW 10
+
+// The number of power of two buckets in each queue wait histogram. The last bucket holds every wait longer than 2^30 microseconds.
+#define MAGMA_QUEUE_WAIT_BUCKETS 32
+
+// The resolution of the timer wheel in milliseconds, the number of bits used to index the slots on each level of the wheel, and the
+// number of levels. With 10 millisecond ticks, four levels of 256 slots can hold timers which expire up to 497 days in the future.
+#define MAGMA_TIMER_TICK 10
+#define MAGMA_TIMER_BITS 8
+#define MAGMA_TIMER_LEVELS 4
+
+// The number of seconds between the periodic maintenance tasks the timer wheel hands to the worker pool.
+#define MAGMA_TIMER_MAINTENANCE 300
+
+// The number of bits used to split each power of two range of the command latency histograms into linear sub-buckets, and the number
+// of bits needed to hold the longest latency, in nanoseconds, the histograms track. With 4 and 40 bits, the histograms are accurate to
+// within 6.25%, and every command which takes longer than 18 minutes is counted by the last bucket.
+#define MAGMA_LATENCY_PRECISION 4
+#define MAGMA_LATENCY_RANGE 40
+
+// The number of milliseconds spent measuring the processor time stamp counter against the monotonic clock during startup.
+#define MAGMA_LATENCY_CALIBRATION 20
+
+// The number of events each thread keeps in its flight recorder. Must be a power of two. Each event takes 24 bytes.
+#define MAGMA_RECORDER_EVENTS 2048
+
+// The size of the ring buffer each thread uses to hand its log messages to the log writer thread, which must be a power of two, and the
+// longest log message, after formatting. Longer messages are truncated.
+#define MAGMA_LOG_RING_SIZE 65536
+#define MAGMA_LOG_MESSAGE_MAX 8192
+
+// The number of buffers the log writer hands to a single writev() call, and the number of milliseconds it sleeps when it isn't woken.
+#define MAGMA_LOG_BATCH 256
+#define MAGMA_LOG_WAIT 100
+
+// The size of a processor cache line, used to keep the statistics counters of different threads apart.
+#define MAGMA_CACHE_LINE_SIZE 64
+
+// The maximum number of readiness events collected by the network event loop in a single pass.
+#define MAGMA_EVENTS_BATCH 128
+
+// The number of independently locked shards in the reverse DNS cache, the number of hash buckets in each shard, and the number of
+// results each shard will hold before the least recently used results are evicted.
+#define MAGMA_RESOLVER_SHARDS 16
+#define MAGMA_RESOLVER_BUCKETS 1024
+#define MAGMA_RESOLVER_LIMIT 4096
+
+// The number of reverse DNS queries which may be outstanding at once. Lookups beyond the limit fail immediately, instead of queuing.
+#define MAGMA_RESOLVER_PENDING 1024
+
+// The number of milliseconds to wait for a reverse DNS reply before retrying, and the number of attempts before a lookup fails. Each
+// retry is sent to the next name server.
+#define MAGMA_RESOLVER_TIMEOUT 2000
+#define MAGMA_RESOLVER_ATTEMPTS 3
+
+// The longest time, in seconds, a PTR record is cached no matter what its TTL says, and how long a missing PTR record is remembered.
+#define MAGMA_RESOLVER_TTL_MAX 86400
+#define MAGMA_RESOLVER_TTL_NEGATIVE 300
+
 // The default size of connection buffer. Can be changed via the config.
 #define MAGMA_CONNECTION_BUFFER_SIZE 8192
 
+// The size of the per connection output buffer. Responses are collected until the buffer reaches this size, or the command finishes,
+// and then sent using a single system call. It matches the largest TLS record payload, so a flush is always a single record.
+#define MAGMA_CONNECTION_OUTPUT_SIZE 16384
+
 // The maximum size of the HELO/EHLO string.
 // RFC 2821, section 4.5.3.1 dictates a max length of 255 characters for a domain
 #define MAGMA_SMTP_MAX_HELO_SIZE MAGMA_HOSTNAME_MAX
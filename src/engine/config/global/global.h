@@ -40,12 +40,15 @@ typedef struct {
 		bool_t time; /* Output time that the log entry was recorded. */
 		bool_t stack; /* Output the stack that triggered the log entry. */
 		bool_t function; /* Output the function that made the log entry. */
+		bool_t block; /* Wait for room in the log buffer when it's full, instead of dropping the message. */
 	} log;
 
 	struct {
 		chr_t *tank; /* The path of the storage tank. */
 		stringer_t *active; /* The default storage server used by the legacy mail storage logic. */
 		stringer_t *root; /* The root portion of the storage server directory paths. */
+		uint32_t sync_window; /* How long, in milliseconds, message deliveries wait to share a single disk flush. Zero flushes each message separately. */
+		uint64_t cache_size; /* The amount of memory, in bytes, the shared cache of decompressed messages may use. Zero disables the cache. */
 	} storage;
 
 	struct {
@@ -115,6 +118,7 @@ typedef struct {
 			uint32_t seed_length; /* How much data should be used to seed the random number generator. */
 			bool_t dhparams_rotate; /* Should we generate new a DH prime parameter periodically. */
 			bool_t dhparams_large_keys; /* Should we use large DH session keys. */
+			bool_t tls_offload; /* Should the kernel encrypt the output of TLS connections, when it's supported. */
 		} cryptography;
 
 		struct {
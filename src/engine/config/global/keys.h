@@ -75,6 +75,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = true
 	},
+	{
+		.store = (void *)&(magma.storage.sync_window),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = MAGMA_STORAGE_SYNC_WINDOW,
+		.name = "magma.storage.sync_window",
+		.description = "The number of milliseconds a message delivery will wait for others to join a group commit before flushing the message data to disk. Set to zero to flush every message individually.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.storage.cache_size),
+		.norm.type = M_TYPE_UINT64,
+		.norm.val.u64 = MAGMA_STORAGE_CACHE_SIZE,
+		.name = "magma.storage.cache_size",
+		.description = "The amount of memory, in bytes, used to cache decompressed messages so they can be shared between worker threads. Set to zero to disable the shared cache.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.daemonize),
 		.norm.type = M_TYPE_BOOLEAN,
@@ -99,6 +123,30 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.system.handshake_threads),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 4,
+		.name = "magma.system.handshake_threads",
+		.description = "The number of threads the system should dedicate to TLS handshakes.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
+	{
+		.store = (void *)&(magma.system.handshake_timeout),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 10,
+		.name = "magma.system.handshake_timeout",
+		.description = "The number of seconds a client has to complete a TLS handshake.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.system.network_buffer),
 		.norm.type = M_TYPE_UINT32,
@@ -244,6 +292,18 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.iface.cryptography.tls_offload),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = false,
+		.name = "magma.iface.cryptography.tls_offload",
+		.description = "Controls whether the kernel should encrypt the output of TLS connections, when the kernel and cipher suite support it.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.secure.sessions),
 		.norm.type = M_TYPE_STRINGER,
@@ -508,6 +568,18 @@ magma_keys_t magma_keys[] = {
 		.set = false,
 		.required = false
 	},
+	{
+		.store = (void *)&(magma.log.block),
+		.norm.type = M_TYPE_BOOLEAN,
+		.norm.val.binary = false,
+		.name = "magma.log.block",
+		.description = "Wait for the log writer when a thread fills its log buffer, instead of dropping the message.",
+		.file = true,
+		.database = true,
+		.overwrite = true,
+		.set = false,
+		.required = false
+	},
 	{
 		.store = (void *)&(magma.config.output_config),
 		.norm.type = M_TYPE_BOOLEAN,
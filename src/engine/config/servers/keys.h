@@ -82,6 +82,14 @@ server_keys_t server_keys[] = {
 		.description = "The size of the listen queue used by the instance.",
 		.required = false
 	},
+	{
+		.offset = offsetof (server_t, network.acceptors),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 1,
+		.name = ".network.acceptors",
+		.description = "The number of listening sockets opened with SO_REUSEPORT, each with its own accept thread pinned to a processor core.",
+		.required = false
+	},
 	{
 		.offset = offsetof (server_t, network.type),
 		.norm.type = M_TYPE_ENUM,
@@ -105,6 +113,22 @@ server_keys_t server_keys[] = {
 		.name = ".violations.delay",
 		.description = "The number of protocol or authentication errors allowed before terminating a connection.",
 		.required = false
+	},
+	{
+		.offset = offsetof (server_t, admission.depth),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 16384,
+		.name = ".admission.depth",
+		.description = "The worker queue depth above which new connections are turned away with a busy response. Zero disables the limit.",
+		.required = false
+	},
+	{
+		.offset = offsetof (server_t, admission.wait),
+		.norm.type = M_TYPE_UINT32,
+		.norm.val.u32 = 5000,
+		.name = ".admission.wait",
+		.description = "The 99th percentile worker queue wait, in milliseconds, above which new connections are turned away. Zero disables the limit.",
+		.required = false
 	}
 };
 
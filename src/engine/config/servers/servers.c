@@ -99,6 +99,12 @@ bool_t servers_network_start(void) {
  * @return	true on success or false on failure.
  */
 bool_t servers_encryption_start(void) {
+
+	// The session cache and ticket keys are shared by all of the server instances.
+	if (!tls_sessions_start()) {
+		return false;
+	}
+
 	// Loop through and setup the transport security layer for all of the server instances that provided TLS certificates.
 	for (uint32_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
 
@@ -135,6 +141,7 @@ void servers_encryption_stop(void) {
 			tls_server_destroy(magma.servers[i]);
 		}
 	}
+	tls_sessions_stop();
 	return;
 }
 
@@ -209,6 +216,10 @@ server_t * servers_alloc(uint32_t number) {
 	// Set the default value to -1 so the shutdown function can detect uninitialized sockets.
 	magma.servers[number]->network.sockd = -1;
 
+	for (uint32_t i = 0; i < MAGMA_SERVER_ACCEPTORS; i++) {
+		magma.servers[number]->acceptors[i].sockd = -1;
+	}
+
 	return magma.servers[number];
 }
 
@@ -233,6 +244,11 @@ bool_t servers_validate(void) {
 			result = false;
 		}
 
+		if (magma.servers[i] && (magma.servers[i]->network.acceptors < 1 || magma.servers[i]->network.acceptors > MAGMA_SERVER_ACCEPTORS)) {
+			log_critical("magma.servers[%u].network.acceptors must be between 1 and %i.", i, MAGMA_SERVER_ACCEPTORS);
+			result = false;
+		}
+
 		for (uint64_t j = 0; magma.servers[i] && j < sizeof(server_keys) / sizeof(server_keys_t); j++) {
 
 			// Do some very basic file-system validation on TLS certificates
@@ -43,12 +43,22 @@ typedef struct {
 		uint32_t port;
 		uint32_t timeout;
 		uint32_t listen_queue;
+		uint32_t acceptors;
 		M_PORT type;
 	} network;
+	struct {
+		int sockd; /* The listening socket. The first acceptor uses the same socket as network.sockd. */
+		uint64_t accepted; /* The number of connections accepted, which is only updated by the acceptor thread. */
+		chr_t name[64]; /* The name used to report the accept count through the statistics interface. */
+	} __attribute__ ((aligned (MAGMA_CACHE_LINE_SIZE))) acceptors[MAGMA_SERVER_ACCEPTORS];
 	struct {
 		uint32_t delay;
 		uint32_t cutoff;
 	} violations;
+	struct {
+		uint32_t depth; /* The worker queue depth above which new connections are turned away, or zero to disable the limit. */
+		uint32_t wait; /* The 99th percentile queue wait, in milliseconds, above which new connections are turned away, or zero to disable. */
+	} admission;
 	bool_t enabled;
 	stringer_t *name, *domain;
 	M_PROTOCOL protocol;
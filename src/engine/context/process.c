@@ -11,10 +11,27 @@ extern bool_t exit_and_dump;
 uint64_t day = 0;
 pthread_t *maint = NULL;
 
+/**
+ * @brief	Run the periodic maintenance tasks which are handed to the worker pool by the timer wheel, and then schedule the next run.
+ * @note	Executed every MAGMA_TIMER_MAINTENANCE seconds: prune the object cache, and rotate the TLS session ticket key.
+ * @return	This function returns no value.
+ */
+void process_periodic(void) {
+
+	obj_cache_prune();
+	tls_tickets_rotate();
+
+	if (status()) {
+		timer_enqueue(MAGMA_TIMER_MAINTENANCE * 1000, &process_periodic, NULL);
+	}
+
+	return;
+}
+
 /**
  * @brief	The entry point for the process maintenance thread, which runs in a continuous loop unless canceled.
  * @note	Execute once daily: rotate the log files, update the warehouse, and perform tank maintenance.
- * 			Execute every few (0-10) minutes: refresh the virus engine and prune the object cache.
+ * 			Execute every few (0-10) minutes: refresh the virus engine.
  * @return	This function returns no value.
  */
 void process_maint(void) {
@@ -37,7 +54,6 @@ void process_maint(void) {
 
 		// Execute these functions every few minutes.
 		virus_engine_refresh();
-		obj_cache_prune();
 
 		// If were close to midnight, sleep until midnight, otherwise sleep a random number of seconds up to ten minutes.
 		if (status()) {
@@ -105,12 +121,17 @@ void process_stop(void) {
 
 		obj_cache_stop,
 		mail_cache_stop,
+		notify_stop,
 		warehouse_stop,
 		http_content_stop,
-		NULL, /* Protocol handlers. */
+		protocol_stop,
 		servers_encryption_stop,
 		queue_shutdown, /* Shutdown the thread pool. */
-		NULL /* Logging */
+		handshake_shutdown, /* Shutdown the handshake pool, which hands finished handshakes to the thread pool. */
+		timer_shutdown, /* Shutdown the timer wheel, and enqueue any deferred work so it isn't lost. */
+		net_resolver_stop, /* Shutdown the reverse DNS resolver, and fail any outstanding lookups. */
+		net_events_stop, /* Shutdown the network event loop, and dispatch any parked connections so they can be closed. */
+		log_stop /* Shutdown the log writer thread, and flush any messages which haven't been written yet. */
 	};
 
 #ifdef MAGMA_PEDANTIC
@@ -203,11 +224,16 @@ bool_t process_start(void) {
 
 		(void *)&obj_cache_start,
 		(void *)&mail_cache_start,
+		(void *)&notify_start,
 		(void *)&warehouse_start,
 		(void *)&http_content_start,
 		(void *)&protocol_init,
 		(void *)&servers_encryption_start,
 		(void *)&queue_init,
+		(void *)&handshake_init,
+		(void *)&timer_init,
+		(void *)&net_resolver_start,
+		(void *)&net_events_start,
 		(void *)&log_start
 	};
 
@@ -249,12 +275,17 @@ bool_t process_start(void) {
 		"Unable to initialize the storage system. Exiting.",
 
 		"Unable to initialize the local object cache. Exiting.",
-		"Unable to initialize the thread local mail cache. Exiting.",
+		"Unable to initialize the mail cache. Exiting.",
+		"Unable to initialize the mailbox notification table. Exiting.",
 		"Unable to initialize the data warehouse engine. Exiting.",
 		"Unable to initialize the web content cache. Exiting.",
 		"Unable to initialize the protocol handlers. Exiting.",
 		"Unable to initialize the server encryption context. Exiting.",
 		"Unable to initialize the thread pool. Exiting.",
+		"Unable to initialize the handshake pool. Exiting.",
+		"Unable to initialize the timer wheel. Exiting.",
+		"Unable to initialize the reverse DNS resolver. Exiting.",
+		"Unable to initialize the network event loop. Exiting.",
 		"Initialization of the log configuration failed. Exiting."
 	};
 
@@ -331,6 +362,9 @@ bool_t process_start(void) {
 		magma.init++;
 	}
 
+	// Schedule the periodic maintenance tasks, which are run by the worker pool.
+	timer_enqueue(MAGMA_TIMER_MAINTENANCE * 1000, &process_periodic, NULL);
+
 	// Spawn the maintenance thread.
 	if ((maint = mm_alloc(sizeof(pthread_t))) && thread_launch(maint, &process_maint, NULL)) {
 		log_critical("Could not start the maintenance thread.");
@@ -25,6 +25,9 @@ void signal_segfault(int signal) {
 	log_options(M_LOG_CRITICAL | M_LOG_STACK_TRACE, "Memory corruption has been detected. Attempting to print a back trace and exit. { signal = %s }",
 			signal_name(signal, signame, 32));
 
+	// Dump the flight recorders, so the events leading up to the crash are preserved.
+	recorder_dump_fd(STDOUT_FILENO);
+
 	// Configure the structure to return a signal to its default handler via the sigaction call below.
 	mm_wipe(&clear, sizeof(struct sigaction));
 	sigemptyset(&clear.sa_mask);
@@ -72,8 +75,10 @@ void signal_shutdown(int signal) {
 
 	// Loop through and shutdown all of the socket descriptors used to listen for incomoing connections.
 	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
-		if ((server = magma.servers[i]) && server->enabled && server->network.sockd > 0) {
-			shutdown(server->network.sockd, SHUT_RDWR);
+		for (uint32_t j = 0; (server = magma.servers[i]) && server->enabled && j < server->network.acceptors; j++) {
+			if (server->acceptors[j].sockd > 0) {
+				shutdown(server->acceptors[j].sockd, SHUT_RDWR);
+			}
 		}
 	}
 //
@@ -177,6 +182,18 @@ void signal_refresh(int signal) {
 	return;
 }
 
+/**
+ * @brief	A function to handle receipt of SIGUSR2 and request a dump of the flight recorder of every thread.
+ * @note	Formatting the events isn't safe inside a signal handler, so the dump is performed by the log writer thread.
+ * @see		recorder_request()
+ * @param	signal	the number of the delivered signal (should only be SIGUSR2).
+ * @return	This function returns no value.
+ */
+void signal_recorder(int signal) {
+	recorder_request();
+	return;
+}
+
 /**
  * @brief	Bind a SIGALRM handler for the calling thread.
  * @see		signal_status()
@@ -205,12 +222,14 @@ bool_t signal_thread_start(void) {
  * 			signal_shutdown:	SIGINT, SIGQUIT, SIGTERM, SIGHUP
  * 			signal_segfault:	SIGSEGV, SIGFPE, SIGBUS, SIGSYS
  * 			signal_refresh:		SIGHUP
+ * 			signal_recorder:	SIGUSR2
  * 			[ignored]:			SIGPIPE
  * @return	true if all siginal handlers were successfully registered, or false on failure.
  */
 bool_t signal_start(void) {
 
 	struct sigaction hup;
+	struct sigaction usr2;
 	struct sigaction normal;
 	struct sigaction ignored;
 	struct sigaction segfault;
@@ -255,5 +274,14 @@ bool_t signal_start(void) {
 		return false;
 	}
 
+	// Zero out the signal structure and setup the SIGUSR2 handler, which dumps the flight recorders.
+	mm_wipe(&usr2, sizeof(struct sigaction));
+	usr2.sa_handler = signal_recorder;
+	usr2.sa_flags = SA_RESTART;
+	if (sigemptyset(&usr2.sa_mask) || sigaction(SIGUSR2, &usr2, NULL)) {
+		log_info("Could not setup the flight recorder signal handler.");
+		return false;
+	}
+
 	return true;
 }
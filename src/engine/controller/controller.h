@@ -8,16 +8,79 @@
 #ifndef MAGMA_ENGINE_CONTROLLER_H
 #define MAGMA_ENGINE_CONTROLLER_H
 
+typedef struct {
+	int64_t top __attribute__ ((aligned (64))); /* The index of the oldest item, which is advanced by thieves. */
+	int64_t bottom __attribute__ ((aligned (64))); /* The index of the next free slot, which is only moved by the owner. */
+	void *items[MAGMA_QUEUE_DEQUE_SIZE];
+} deque_t;
+
+/**
+ * @typedef queue_priority_t
+ */
+typedef enum {
+	QUEUE_INTERACTIVE = 0,                /**< Work a client is actively waiting on, like an IMAP or POP command, or a web request. >*/
+	QUEUE_DELIVERY = 1,                   /**< Inbound and outbound mail delivery, which can tolerate a little more latency. >*/
+	QUEUE_BACKGROUND = 2                  /**< Bulk, and housekeeping, work which nobody is waiting on. >*/
+} queue_priority_t;
+
+typedef struct {
+	uint64_t window; /* The window the buckets are counting, which is the monotonic clock divided by the window length. */
+	uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS]; /* Bucket N counts the samples shorter than 2^N microseconds, and longer than the bucket before it. */
+} histogram_t;
+
+typedef struct timer_event_t {
+	uint64_t expiration; /* The tick when the timer fires. */
+	void *function, *data; /* The function, and its argument, which are enqueued when the timer fires. */
+	bool_t allocated; /* Whether the timer was allocated by the wheel, and should be freed once it fires. */
+	struct timer_event_t **slot, *prev, *next; /* The wheel slot holding the timer, which is NULL unless the timer is pending. */
+} timer_event_t;
+
+/// deque.c
+deque_t *  deque_alloc(void);
+uint64_t   deque_count(deque_t *deque);
+void       deque_free(deque_t *deque);
+void *     deque_pop(deque_t *deque);
+bool_t     deque_push(deque_t *deque, void *item);
+void *     deque_steal(deque_t *deque);
+
+/// handshakes.c
+uint64_t   handshake_depth(void);
+void       handshake_enqueue(void *function, void *data);
+bool_t     handshake_init(void);
+uint64_t   handshake_latency(uint64_t percentile);
+void       handshake_loop(void);
+void       handshake_shutdown(void);
+uint64_t   handshake_wait(uint64_t percentile);
+
+/// histogram.c
+uint64_t   histogram_percentile(uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS], uint64_t total, uint64_t percentile);
+void       histogram_record(histogram_t *histogram, uint64_t now, uint64_t elapsed);
+uint64_t   histogram_sum(histogram_t *histogram, uint64_t now, uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS]);
+
 /// queue.c
-void     dequeue(void);
-void     enqueue(void *function, void *data);
-bool_t   queue_init(void);
-void     queue_shutdown(void);
-void     queue_signal(void);
-void     requeue(void *function, void *requeue, void *data);
+void       dequeue(void);
+void       enqueue(void *function, void *data);
+void       enqueue_priority(queue_priority_t priority, void *function, void *data);
+uint64_t   queue_depth(void);
+bool_t     queue_init(void);
+void       queue_shutdown(void);
+void       queue_signal(void);
+uint64_t   queue_wait(uint64_t percentile);
+void       requeue(void *function, void *requeue, void *data);
+void       requeue_priority(queue_priority_t priority, void *function, void *requeue, void *data);
+
+/// timers.c
+bool_t     timer_cancel(timer_event_t *timer);
+void       timer_enqueue(uint64_t delay, void *function, void *data);
+bool_t     timer_init(void);
+void       timer_loop(void);
+bool_t     timer_schedule(timer_event_t *timer, uint64_t delay, void *function, void *data);
+void       timer_shutdown(void);
 
 /// protocol.c
+bool_t protocol_admit(server_t *server, int sockd);
 bool_t protocol_init(void);
 void protocol_process(server_t *server, int sockd);
+void protocol_stop(void);
 
 #endif
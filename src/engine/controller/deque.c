@@ -0,0 +1,154 @@
+
+/**
+ * @file /magma/engine/controller/deque.c
+ *
+ * @brief	A bounded, lock-free work stealing deque, based upon the Chase-Lev algorithm.
+ *
+ * The owner thread pushes and pops items from the bottom of the deque, while any other thread may steal items from the top. Only the steal
+ * operation, and the pop of the final item, need to resolve a race using compare and swap, so the owner thread normally never contends with
+ * the other workers.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Allocate a new work stealing deque.
+ * @return	NULL on failure, or a pointer to the newly allocated deque.
+ */
+deque_t * deque_alloc(void) {
+
+	deque_t *result;
+
+	if (!(result = mm_alloc(sizeof(deque_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a work stealing deque.", sizeof(deque_t));
+		return NULL;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Free a work stealing deque.
+ * @note	Any items left inside the deque are not freed.
+ * @param	deque	the deque to be freed.
+ * @return	This function returns no value.
+ */
+void deque_free(deque_t *deque) {
+
+	if (deque) {
+		mm_free(deque);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Get the number of items inside a deque.
+ * @note	The result is only an estimate, since other threads may be stealing items while the count is taken.
+ * @param	deque	the deque to be inspected.
+ * @return	the approximate number of items in the deque.
+ */
+uint64_t deque_count(deque_t *deque) {
+
+	int64_t top, bottom;
+
+	if (!deque) {
+		return 0;
+	}
+
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	return bottom > top ? (uint64_t)(bottom - top) : 0;
+}
+
+/**
+ * @brief	Push an item onto the bottom of a deque.
+ * @note	This function may only be called by the thread which owns the deque.
+ * @param	deque	the deque which will hold the item.
+ * @param	item	the item to be pushed onto the deque.
+ * @return	false if the deque is full, or true if the item was pushed.
+ */
+bool_t deque_push(deque_t *deque, void *item) {
+
+	int64_t top, bottom;
+
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+
+	if (bottom - top >= MAGMA_QUEUE_DEQUE_SIZE) {
+		return false;
+	}
+
+	__atomic_store_n(&deque->items[bottom & (MAGMA_QUEUE_DEQUE_SIZE - 1)], item, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+/**
+ * @brief	Pop the most recently pushed item off the bottom of a deque.
+ * @note	This function may only be called by the thread which owns the deque.
+ * @param	deque	the deque to be popped.
+ * @return	NULL if the deque is empty, or the last item lost a race with a thief, otherwise the popped item.
+ */
+void * deque_pop(deque_t *deque) {
+
+	void *item = NULL;
+	int64_t top, bottom;
+
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if (top <= bottom) {
+
+		item = __atomic_load_n(&deque->items[bottom & (MAGMA_QUEUE_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+		// When taking the last item, we have to race any thieves for it.
+		if (top == bottom) {
+
+			if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+				item = NULL;
+			}
+
+			__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		}
+
+	}
+	else {
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return item;
+}
+
+/**
+ * @brief	Steal the oldest item from the top of a deque.
+ * @note	This function may be called by any thread.
+ * @param	deque	the deque to be robbed.
+ * @return	NULL if the deque was empty, or another thread won the race for the item, otherwise the stolen item.
+ */
+void * deque_steal(deque_t *deque) {
+
+	void *item = NULL;
+	int64_t top, bottom;
+
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if (top < bottom) {
+
+		item = __atomic_load_n(&deque->items[top & (MAGMA_QUEUE_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+		if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			item = NULL;
+		}
+
+	}
+
+	return item;
+}
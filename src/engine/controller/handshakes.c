@@ -0,0 +1,261 @@
+
+/**
+ * @file /magma/engine/controller/handshakes.c
+ *
+ * @brief	A separately sized pool of threads, with its own queue, used to perform TLS handshakes.
+ *
+ * The key agreement performed by a full handshake is expensive, so a flood of new TLS connections could easily tie up every worker
+ * thread, and starve the sessions which are already established. Handshakes are instead queued for this pool, and once a handshake
+ * finishes, the connection is handed back to the worker queue. The pool records how long each handshake waited to be started, and
+ * how long it took, so the handshake pool, and the worker pool, can be sized independently.
+ */
+
+#include "magma.h"
+
+typedef struct handshake_t {
+	void (*function)(void *data), *data;
+	uint64_t stamp; /* When the work was queued, in nanoseconds, according to the monotonic clock. */
+	struct handshake_t *next;
+} handshake_t;
+
+struct {
+	sem_t sema;
+	uint32_t count;
+	uint64_t depth;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	handshake_t *head, *tail;
+	histogram_t waits[2], latencies[2];
+} handshakes = {
+		.count = 0,
+		.depth = 0,
+		.threads = NULL,
+		.head = NULL,
+		.tail = NULL
+};
+
+/**
+ * @brief	Get the value of the monotonic clock in nanoseconds.
+ * @return	the number of nanoseconds since an arbitrary point in the past.
+ */
+static uint64_t handshake_clock(void) {
+
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief	Queue a handshake to be performed by the handshake pool.
+ * @note	Warning: If this function fails to allocate a new handshake_t object, the work unit is lost forever. The function should
+ * 			hand the connection back to the worker queue once the handshake finishes.
+ * @param	function	a pointer to the function which performs the handshake.
+ * @param	data		a pointer to an arbitrary block of data to be passed to the function.
+ * @return	This function returns no value.
+ */
+void handshake_enqueue(void *function, void *data) {
+
+	handshake_t *work;
+
+	if (!handshakes.threads) {
+		log_critical("The handshake pool hasn't been initialized. Work request is lost forever!");
+		return;
+	}
+	else if (!(work = mm_alloc(sizeof(handshake_t)))) {
+		log_critical("Failed to allocate a handshake_t structure. Work request is lost forever!");
+		return;
+	}
+
+	work->function = function;
+	work->data = data;
+	work->stamp = handshake_clock();
+
+	mutex_lock(&handshakes.lock);
+
+	if (handshakes.tail) handshakes.tail->next = work;
+	else handshakes.head = work;
+
+	handshakes.tail = work;
+	handshakes.depth++;
+
+	mutex_unlock(&handshakes.lock);
+
+	sem_post(&handshakes.sema);
+
+	return;
+}
+
+/**
+ * @brief	Wait for handshakes to appear on the queue, and perform them.
+ * @note	This is the thread pool entry point called from handshake_init().
+ * @return	This function returns no value.
+ */
+void handshake_loop(void) {
+
+	handshake_t *work;
+	uint64_t started, finished;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	do {
+
+		sem_wait(&handshakes.sema);
+
+		mutex_lock(&handshakes.lock);
+
+		if ((work = handshakes.head) && !(handshakes.head = work->next)) {
+			handshakes.tail = NULL;
+		}
+
+		if (work) {
+			handshakes.depth--;
+		}
+
+		mutex_unlock(&handshakes.lock);
+
+		if (work) {
+
+			started = handshake_clock();
+			histogram_record(handshakes.waits, started, started > work->stamp ? started - work->stamp : 0);
+
+			work->function(work->data);
+
+			finished = handshake_clock();
+			histogram_record(handshakes.latencies, finished, finished > started ? finished - started : 0);
+
+			mm_free(work);
+		}
+
+	// Continue processing until the queue is empty and the status tracker indicates a shutdown.
+	} while (work || status());
+
+	thread_stop();
+	pthread_exit(NULL);
+
+	return;
+}
+
+/**
+ * @brief	Get the number of handshakes waiting in the queue.
+ * @return	the number of handshakes which have been queued, but not yet started.
+ */
+uint64_t handshake_depth(void) {
+	return __atomic_load_n(&handshakes.depth, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	Estimate a percentile of the time recent handshakes took, once they were started.
+ * @param	percentile	the percentile to be estimated, between 1 and 100.
+ * @return	the estimated handshake time, in microseconds, which is accurate to within a factor of two, or 0 if no handshakes were recently performed.
+ */
+uint64_t handshake_latency(uint64_t percentile) {
+
+	uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS], total;
+
+	mm_wipe(buckets, sizeof(buckets));
+	total = histogram_sum(handshakes.latencies, handshake_clock(), buckets);
+
+	return histogram_percentile(buckets, total, percentile);
+}
+
+/**
+ * @brief	Estimate a percentile of the time recent handshakes spent waiting in the queue.
+ * @param	percentile	the percentile to be estimated, between 1 and 100.
+ * @return	the estimated wait, in microseconds, which is accurate to within a factor of two, or 0 if no handshakes were recently performed.
+ */
+uint64_t handshake_wait(uint64_t percentile) {
+
+	uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS], total;
+
+	mm_wipe(buckets, sizeof(buckets));
+	total = histogram_sum(handshakes.waits, handshake_clock(), buckets);
+
+	return histogram_percentile(buckets, total, percentile);
+}
+
+/**
+ * @brief	Create the handshake pool and set the threads into motion.
+ * @note	Up to magma.system.handshake_threads number of threads will be created.
+ * @return	false on failure or true on success.
+ */
+bool_t handshake_init(void) {
+
+	if (!magma.system.handshake_threads) {
+		log_critical("The handshake pool requires at least one thread.");
+		return false;
+	}
+	else if (!magma.system.handshake_timeout) {
+		log_critical("The handshake pool requires a handshake timeout of at least one second.");
+		return false;
+	}
+	else if (sem_init(&handshakes.sema, 0, 0)) {
+		return false;
+	}
+	else if (mutex_init(&handshakes.lock, NULL)) {
+		sem_destroy(&handshakes.sema);
+		return false;
+	}
+	else if (!(handshakes.threads = mm_alloc(sizeof(pthread_t) * magma.system.handshake_threads))) {
+		mutex_destroy(&handshakes.lock);
+		sem_destroy(&handshakes.sema);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < magma.system.handshake_threads; i++) {
+
+		if (thread_launch(handshakes.threads + i, &handshake_loop, NULL)) {
+			log_error("Unable to launch the configured number of handshake threads. {threads = %u / configured = %u}", i, magma.system.handshake_threads);
+			handshake_shutdown();
+			return false;
+		}
+
+		handshakes.count++;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Wake the handshake threads, wait for them to exit, and destroy the handshake queue.
+ * @note	This must be called before the worker pool is shutdown, since a finished handshake hands its connection to the worker queue.
+ * @return	This function returns no value.
+ */
+void handshake_shutdown(void) {
+
+	handshake_t *work;
+
+	for (uint32_t i = 0; handshakes.threads && i < handshakes.count + 128; i++) {
+		sem_post(&handshakes.sema);
+	}
+
+	for (uint32_t i = 0; handshakes.threads && i < handshakes.count; i++) {
+		thread_join(*(handshakes.threads + i));
+	}
+
+	// Release any work items which were never executed.
+	while ((work = handshakes.head)) {
+		handshakes.head = work->next;
+		mm_free(work);
+	}
+
+	if (handshakes.threads) {
+		mutex_destroy(&handshakes.lock);
+		sem_destroy(&handshakes.sema);
+	}
+
+	mm_cleanup(handshakes.threads);
+
+	handshakes.threads = NULL;
+	handshakes.tail = NULL;
+	handshakes.count = 0;
+	handshakes.depth = 0;
+
+	return;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file /magma/engine/controller/histogram.c
+ *
+ * @brief	Rotating histograms used to estimate how long recent work waited, or took.
+ *
+ * Each histogram is kept as a pair of windows. Samples are added to the window belonging to the current value of the monotonic clock,
+ * and the older window is reset whenever a new one begins, so an estimate always covers the current, and previous, windows. Bucket N
+ * counts the samples shorter than 2^N microseconds, and longer than the bucket before it, so an estimate is only accurate to within
+ * a factor of two.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Get the window a value of the monotonic clock falls into.
+ * @param	now		the value of the monotonic clock, in nanoseconds.
+ * @return	the monotonic clock divided by the window length.
+ */
+static uint64_t histogram_window(uint64_t now) {
+	return now / (MAGMA_QUEUE_WAIT_WINDOW * 1000000000UL);
+}
+
+/**
+ * @brief	Add a sample to a pair of rotating histograms.
+ * @note	The buckets are updated atomically, so a pair may be shared by several threads. A sample which races with the reset of an
+ * 			older window may be lost, which doesn't matter for an estimate.
+ * @param	histogram	the pair of histograms.
+ * @param	now			the current value of the monotonic clock, in nanoseconds.
+ * @param	elapsed		the sample, in nanoseconds.
+ * @return	This function returns no value.
+ */
+void histogram_record(histogram_t *histogram, uint64_t now, uint64_t elapsed) {
+
+	uint64_t window, previous, bucket = 0;
+
+	window = histogram_window(now);
+	histogram += window & 1;
+
+	if ((previous = __atomic_load_n(&histogram->window, __ATOMIC_ACQUIRE)) != window &&
+		__atomic_compare_exchange_n(&histogram->window, &previous, window, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		for (uint64_t i = 0; i < MAGMA_QUEUE_WAIT_BUCKETS; i++) {
+			__atomic_store_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+		}
+	}
+
+	// Samples shorter than a microsecond land in the first bucket, while the last bucket holds everything too long for the others.
+	if ((elapsed /= 1000) && (bucket = 64 - __builtin_clzll(elapsed)) >= MAGMA_QUEUE_WAIT_BUCKETS) {
+		bucket = MAGMA_QUEUE_WAIT_BUCKETS - 1;
+	}
+
+	__atomic_add_fetch(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief	Add the current, and previous, windows of a pair of rotating histograms to a set of buckets.
+ * @param	histogram	the pair of histograms.
+ * @param	now			the current value of the monotonic clock, in nanoseconds.
+ * @param	buckets		the buckets which will receive the counts.
+ * @return	the number of samples which were added to the buckets.
+ */
+uint64_t histogram_sum(histogram_t *histogram, uint64_t now, uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS]) {
+
+	uint64_t window = histogram_window(now), count, total = 0;
+
+	for (uint64_t i = 0; i < 2; i++) {
+
+		// Skip a histogram which is older than the previous window.
+		if (__atomic_load_n(&histogram[i].window, __ATOMIC_ACQUIRE) + 1 < window) {
+			continue;
+		}
+
+		for (uint64_t k = 0; k < MAGMA_QUEUE_WAIT_BUCKETS; k++) {
+			count = __atomic_load_n(&histogram[i].buckets[k], __ATOMIC_RELAXED);
+			buckets[k] += count;
+			total += count;
+		}
+	}
+
+	return total;
+}
+
+/**
+ * @brief	Estimate a percentile using a set of buckets collected by histogram_sum().
+ * @param	buckets		the buckets.
+ * @param	total		the number of samples held by the buckets.
+ * @param	percentile	the percentile to be estimated, between 1 and 100.
+ * @return	the upper bound, in microseconds, of the bucket holding the percentile, or 0 if the buckets are empty.
+ */
+uint64_t histogram_percentile(uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS], uint64_t total, uint64_t percentile) {
+
+	uint64_t target, counted = 0;
+
+	if (!total) {
+		return 0;
+	}
+
+	target = ((total * (percentile > 100 ? 100 : percentile)) + 99) / 100;
+
+	for (uint64_t k = 0; k < MAGMA_QUEUE_WAIT_BUCKETS; k++) {
+		if ((counted += buckets[k]) >= target) {
+			return 1UL << k;
+		}
+	}
+
+	return 1UL << (MAGMA_QUEUE_WAIT_BUCKETS - 1);
+}
@@ -81,9 +81,16 @@ stringer_t * protocol_type(connection_t *con) {
 
 /**
  * @brief	Initialize all protocol modules, and prime their command arrays for binary searching.
+ * @note	The processor cycle counter is calibrated first, since it's used to time the commands. If the calibration fails, the command
+ * 			latencies simply aren't recorded.
  * @return	This function always returns true.
  */
 bool_t protocol_init(void) {
+
+	if (!perf_calibrate()) {
+		log_info("The CPU cycle counter could not be calibrated, so command latencies won't be recorded.");
+	}
+
 	pop_sort();
 	imap_sort();
 	smtp_sort();
@@ -93,6 +100,16 @@ bool_t protocol_init(void) {
 	return true;
 }
 
+/**
+ * @brief	Release the latency histograms allocated for the protocol command tables.
+ * @note	This must be called after the worker pool has been shutdown.
+ * @return	This function returns no value.
+ */
+void protocol_stop(void) {
+	latency_free();
+	return;
+}
+
 /**
  * @brief	Enqueue a protocol-specific handler to service a specified connection, and update any statistics accordingly.
  * @note	If an invalid protocol is specified, the connection will be destroyed gracefully.
@@ -150,14 +167,14 @@ void protocol_enqueue(connection_t *con) {
 			return;
 	}
 
-	enqueue(function, con);
+	enqueue_priority(con_priority(con), function, con);
 	return;
 
 }
 
 /**
- * @brief	Establish a secure channel for an inbound TLS connection before passing it off to the general server request handler.
- * @see		protocol_enqueue()
+ * @brief	Pass an inbound TLS connection off to the general server request handler, once the handshake pool has established a secure channel.
+ * @see		protocol_enqueue(), con_secure_enqueue()
  * @note	This function destroys the client connection completely and returns silently upon any TLS-related failure.
  * @param	con		the The connection object associated with the inbound TLS connection.
  * @return	This function returns no value.
@@ -168,8 +185,8 @@ void protocol_secure(connection_t *con) {
 	log_check(con == NULL);
 	log_check(con->server == NULL);
 
-	// Create a new TLS object.
-	if (!(con->network.tls = tls_server_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
+	// The handshake pool leaves the TLS object empty if the handshake failed.
+	if (!con->network.tls) {
 
 		log_pedantic("The TLS connection attempt failed. { ip = %s / port = %u / protocol = %.*s }", st_char_get(con_addr_presentation(con, MANAGEDBUF(256))),
 			con->server->network.port, st_length_int(protocol_type(con)), st_char_get(protocol_type(con)));
@@ -187,6 +204,53 @@ void protocol_secure(connection_t *con) {
 	return;
 }
 
+/**
+ * @brief	Decide whether a newly accepted connection should be admitted, or turned away because the worker queue is backed up.
+ * @note	Only SMTP, IMAP and POP connections are subject to admission control. A rejected client is sent a busy response directly
+ * 			from the accept thread, using a non-blocking write, and then the socket is closed. Connections arriving on a TLS port are
+ * 			closed without a response, since a plain text reply would be meaningless before the handshake.
+ * @param	server	the server instance which accepted the connection.
+ * @param	sockd	the socket descriptor of the newly accepted connection.
+ * @return	true if the connection should be admitted, or false if the connection was turned away and closed.
+ */
+bool_t protocol_admit(server_t *server, int sockd) {
+
+	chr_t *response, *name;
+
+	switch (server->protocol) {
+		case (SMTP):
+		case (SUBMISSION):
+			response = "421 4.3.2 The server is too busy to accept connections. Please try again later.\r\n";
+			name = "smtp.connections.shed";
+			break;
+		case (IMAP):
+			response = "* BYE The server is too busy to accept connections. Please try again later.\r\n";
+			name = "imap.connections.shed";
+			break;
+		case (POP):
+			response = "-ERR [SYS/TEMP] The server is too busy to accept connections. Please try again later.\r\n";
+			name = "pop.connections.shed";
+			break;
+		default:
+			return true;
+	}
+
+	// Checking the queue depth is cheap, so it goes first, and the wait percentile is only estimated when the depth is within bounds.
+	if ((!server->admission.depth || queue_depth() <= server->admission.depth) &&
+		(!server->admission.wait || queue_wait(99) <= ((uint64_t)server->admission.wait * 1000))) {
+		return true;
+	}
+
+	if (server->network.type != TLS_PORT && send(sockd, response, ns_length_get(response), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+		log_pedantic("Unable to send the busy response. { sockd = %i / error = %s }", sockd, strerror_r(errno, bufptr, buflen));
+	}
+
+	stats_increment_by_name(name);
+	close(sockd);
+
+	return false;
+}
+
 /**
  * @brief	Create a connection object for an accepted connection, and enqueue it to be handled.
  * @see		protocol_secure(), protocol_enqueue()
@@ -205,11 +269,17 @@ void protocol_process(server_t *server, int sockd) {
 		return;
 	}
 
+	// When the worker queue is backed up, the connection is turned away now, instead of timing out in the queue along with everyone else.
+	if (!protocol_admit(server, sockd)) {
+		return;
+	}
+
 	if (!(con = con_init(sockd, server))) {
 		close(sockd);
 		return;
 	}
 
-	server->network.type == TLS_PORT && server->tls.context ? enqueue(&protocol_secure, con) : enqueue(&protocol_enqueue, con);
+	// TLS handshakes are performed by their own pool, so a flood of new connections can't starve the worker threads.
+	server->network.type == TLS_PORT && server->tls.context ? con_secure_enqueue(con, &protocol_secure) : enqueue(&protocol_enqueue, con);
 	return;
 }
@@ -9,32 +9,217 @@
 
 typedef struct {
 	void (*function)(void *data), (*requeue)(void *data), *data;
+	uint64_t stamp; /* When the work was queued, in nanoseconds, according to the monotonic clock. */
+	queue_priority_t priority; /* The priority class the work was queued with. */
 	struct queue_t *next;
 } queue_t;
 
+typedef struct {
+	deque_t *deques[MAGMA_QUEUE_PRIORITIES]; /* Work pushed by the owning worker thread, which other workers may steal, for each priority class. */
+	pthread_mutex_t lock; /* Protects the inboxes. */
+	queue_t *heads[MAGMA_QUEUE_PRIORITIES], *tails[MAGMA_QUEUE_PRIORITIES]; /* The inboxes hold work submitted by other threads, or work which overflowed a deque. */
+	histogram_t waits[2]; /* How long the work taken by this worker waited, which is only updated by the owning worker thread. */
+	uint64_t turn; /* The position of the owning worker thread in the weighted priority schedule. */
+	uint64_t runs[MAGMA_QUEUE_PRIORITIES]; /* How many items in a row the owning worker has popped off the newest end of each deque. */
+} queue_local_t;
+
 struct {
 	sem_t sema;
 	pthread_t *workers;
-	pthread_mutex_t lock;
-	queue_t *items;
+	queue_local_t *locals;
+	uint64_t count, started, next, depth;
 } queue = {
 		.workers = NULL,
-		.items = NULL
+		.locals = NULL,
+		.count = 0,
+		.started = 0,
+		.next = 0,
+		.depth = 0
 };
 
+// Work items are allocated by the threads queuing work, and freed by the worker threads, at a high rate, so they're held by a slab cache.
+static slab_t queue_slab = SLAB_CACHE("queue.work", sizeof(queue_t));
+
+// The offset of the worker thread inside the locals array, or -1 if the current thread isn't a worker.
+static __thread int64_t queue_self = -1;
+
+// The interned id of the busy worker statistic, which is updated for every work item.
+static uint64_t queue_working = 0;
+
+/**
+ * @brief	Get the value of the monotonic clock in nanoseconds.
+ * @return	the number of nanoseconds since an arbitrary point in the past.
+ */
+static uint64_t queue_clock(void) {
+
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief	Append a work item to the inbox of a worker thread.
+ * @param	local	the worker thread that will receive the item.
+ * @param	work	the work item, which is placed in the inbox for its priority class.
+ * @return	This function returns no value.
+ */
+static void queue_inbox_push(queue_local_t *local, queue_t *work) {
+
+	mutex_lock(&local->lock);
+
+	if (local->tails[work->priority]) {
+		local->tails[work->priority]->next = (struct queue_t *)work;
+	}
+	else {
+		local->heads[work->priority] = work;
+	}
+
+	local->tails[work->priority] = work;
+
+	mutex_unlock(&local->lock);
+
+	return;
+}
+
+/**
+ * @brief	Remove the oldest work item from one of the inboxes of a worker thread.
+ * @param	local		the worker thread whose inbox will be checked.
+ * @param	priority	the priority class of the inbox.
+ * @return	NULL if the inbox is empty, otherwise the work item.
+ */
+static queue_t * queue_inbox_pop(queue_local_t *local, queue_priority_t priority) {
+
+	queue_t *work = NULL;
+
+	// Avoid taking the lock if the inbox appears to be empty.
+	if (!__atomic_load_n(&local->heads[priority], __ATOMIC_RELAXED)) {
+		return NULL;
+	}
+
+	mutex_lock(&local->lock);
+
+	if ((work = local->heads[priority]) && !(local->heads[priority] = (queue_t *)work->next)) {
+		local->tails[priority] = NULL;
+	}
+
+	mutex_unlock(&local->lock);
+
+	return work;
+}
+
 /**
- * @brief	Push a function on the job queue to be executed asynchronously.
+ * @brief	Find the next work item of a given priority class for a worker thread.
+ * @note	A worker checks its own deque first, then its inbox, and then tries to steal work from the other workers, starting with its neighbor.
+ * 			The newest item on the deque is normally taken, since it's the most likely to still be cached, but work which keeps requeueing
+ * 			itself would then sit on top of everything else forever. So after MAGMA_QUEUE_LIFO_RUN items in a row, the worker takes the
+ * 			oldest item in its inbox, or on its deque, instead.
+ * @param	self		the offset of the worker thread searching for work.
+ * @param	priority	the priority class being searched.
+ * @return	NULL if no work of the given class was found, otherwise the work item.
+ */
+static queue_t * queue_take_priority(uint64_t self, queue_priority_t priority) {
+
+	queue_t *work = NULL;
+	queue_local_t *local = queue.locals + self;
+
+	if (local->runs[priority] >= MAGMA_QUEUE_LIFO_RUN) {
+
+		local->runs[priority] = 0;
+
+		if ((work = queue_inbox_pop(local, priority)) || (work = deque_steal(local->deques[priority]))) {
+			return work;
+		}
+	}
+
+	if ((work = deque_pop(local->deques[priority]))) {
+		local->runs[priority]++;
+		return work;
+	}
+	else if ((work = queue_inbox_pop(local, priority))) {
+		local->runs[priority] = 0;
+		return work;
+	}
+
+	for (uint64_t i = 1; i < queue.count; i++) {
+		local = queue.locals + ((self + i) % queue.count);
+
+		if ((work = deque_steal(local->deques[priority])) || (work = queue_inbox_pop(local, priority))) {
+			return work;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Find the next work item for a worker thread.
+ * @note	Each worker walks a weighted schedule, which decides the priority class it prefers for each item it takes. When every class has
+ * 			work waiting, the classes receive worker time in proportion to their weights, so background work always makes progress, but
+ * 			can never crowd out the foreground. If the preferred class is empty, the other classes are checked in order of priority, so a
+ * 			worker never sits idle while work is waiting. Since every queued item is paired with a semaphore post, a worker which has
+ * 			consumed a post will always find an item, unless the posts were made by the shutdown logic.
+ * @param	self	the offset of the worker thread searching for work.
+ * @return	NULL if no work was available and the daemon is shutting down, otherwise the work item.
+ */
+static queue_t * queue_take(uint64_t self) {
+
+	uint64_t turn;
+	queue_t *work = NULL;
+	queue_priority_t preferred;
+
+	turn = queue.locals[self].turn++ % (MAGMA_QUEUE_WEIGHT_INTERACTIVE + MAGMA_QUEUE_WEIGHT_DELIVERY + MAGMA_QUEUE_WEIGHT_BACKGROUND);
+
+	if (turn < MAGMA_QUEUE_WEIGHT_INTERACTIVE) preferred = QUEUE_INTERACTIVE;
+	else if (turn < MAGMA_QUEUE_WEIGHT_INTERACTIVE + MAGMA_QUEUE_WEIGHT_DELIVERY) preferred = QUEUE_DELIVERY;
+	else preferred = QUEUE_BACKGROUND;
+
+	do {
+
+		if ((work = queue_take_priority(self, preferred))) {
+			return work;
+		}
+
+		for (queue_priority_t priority = QUEUE_INTERACTIVE; priority < MAGMA_QUEUE_PRIORITIES; priority++) {
+			if (priority != preferred && (work = queue_take_priority(self, priority))) {
+				return work;
+			}
+		}
+
+		// An item may be held by a thief which has yet to finish stealing it, so we yield before checking again.
+		if (status()) {
+			sched_yield();
+		}
+
+	} while (status());
+
+	return NULL;
+}
+
+/**
+ * @brief	Push a function on the job queue, using the given priority class, to be executed asynchronously.
  * @note	Warning: If this function fails to allocate a new queue_t object, the work unit is lost forever.
+ * 			Work queued by a worker thread is pushed onto that worker's private deque, where it will be picked up by the same thread, unless
+ * 			another worker runs out of work and steals it. Work queued by any other thread is distributed across the worker inboxes.
+ * @param	priority	the priority class of the work, which is QUEUE_INTERACTIVE, QUEUE_DELIVERY, or QUEUE_BACKGROUND.
  * @param	function	a pointer to a function to be executed by the next available worker thread.
  * @param	requeue		an optional pointer to a requeue function to be called after function is executed.
  * @param	data		a pointer to an arbitrary block of data to be passed to function and/or requeue upon execution.
  * @return	This function returns no value.
  */
-void requeue(void *function, void *requeue, void *data) {
+void requeue_priority(queue_priority_t priority, void *function, void *requeue, void *data) {
 
-	queue_t *local, *work;
+	queue_t *work;
+	uint64_t target;
 
-	if (!(work = mm_alloc(sizeof(queue_t)))) {
+	if (!queue.locals || !queue.count) {
+		log_critical("The worker queue hasn't been initialized. Work request is lost forever!");
+		return;
+	}
+	else if (!(work = slab_get(&queue_slab))) {
 		log_critical("Failed to allocate a queue_t structure. Work request is lost forever!");
 		return;
 	}
@@ -42,32 +227,57 @@ void requeue(void *function, void *requeue, void *data) {
 	work->function = function;
 	work->requeue = requeue;
 	work->data = data;
+	work->stamp = queue_clock();
+	work->priority = priority < MAGMA_QUEUE_PRIORITIES ? priority : QUEUE_BACKGROUND;
 
-	mutex_lock(&queue.lock);
+	__atomic_add_fetch(&queue.depth, 1, __ATOMIC_RELAXED);
 
-	if ((local = queue.items)) {
-		while (local->next) local = (queue_t *)local->next;
-		local->next = (struct queue_t *)work;
-	}
-	else {
-		queue.items = work;
+	// Worker threads push onto their own deque, and only fall back to the inbox if the deque is full.
+	if (queue_self < 0 || !deque_push(queue.locals[queue_self].deques[work->priority], work)) {
+		target = queue_self >= 0 ? (uint64_t)queue_self : __atomic_fetch_add(&queue.next, 1, __ATOMIC_RELAXED) % queue.count;
+		queue_inbox_push(queue.locals + target, work);
 	}
 
-	mutex_unlock(&queue.lock);
 	sem_post(&queue.sema);
 
 	return;
 }
 
 /**
- * @brief	Push a function on the job queue to be executed asynchronously.
+ * @brief	Push a function on the job queue, using the interactive priority class, to be executed asynchronously.
+ * @see		requeue_priority()
+ * @param	function	a pointer to a function to be executed by the next available worker thread.
+ * @param	requeue		an optional pointer to a requeue function to be called after function is executed.
+ * @param	data		a pointer to an arbitrary block of data to be passed to function and/or requeue upon execution.
+ * @return	This function returns no value.
+ */
+void requeue(void *function, void *requeue, void *data) {
+	requeue_priority(QUEUE_INTERACTIVE, function, requeue, data);
+	return;
+}
+
+/**
+ * @brief	Push a function on the job queue, using the given priority class, to be executed asynchronously.
+ * @see		requeue_priority()
+ * @param	priority	the priority class of the work, which is QUEUE_INTERACTIVE, QUEUE_DELIVERY, or QUEUE_BACKGROUND.
+ * @param	function	a pointer to a function to be executed by the next available worker thread.
+ * @param	data		a pointer to an arbitrary block of data to be passed to the specified function on execution.
+ * @return	This function returns no value.
+ */
+void enqueue_priority(queue_priority_t priority, void *function, void *data) {
+	requeue_priority(priority, function, NULL, data);
+	return;
+}
+
+/**
+ * @brief	Push a function on the job queue, using the interactive priority class, to be executed asynchronously.
  * @note	Warning: If this function fails to allocate a new queue_t object, the work unit is lost forever.
  * @param	function	a pointer to a function to be executed by the next available worker thread.
  * @param	data		a pointer to an arbitrary block of data to be passed to the specified function on execution.
  * @return	This function returns no value.
  */
 void enqueue(void *function, void *data) {
-	requeue(function, NULL, data);
+	requeue_priority(QUEUE_INTERACTIVE, function, NULL, data);
 	return;
 }
 
@@ -78,6 +288,7 @@ void enqueue(void *function, void *data) {
  */
 void dequeue(void) {
 
+	uint64_t now;
 	queue_t *work;
 
 	if (!thread_start()) {
@@ -85,36 +296,38 @@ void dequeue(void) {
 		pthread_exit(NULL);
 	}
 
+	// Claim one of the worker slots.
+	queue_self = __atomic_fetch_add(&queue.started, 1, __ATOMIC_RELAXED);
+
 	do {
 
 		// Wait until the semaphore indicates a job is queued.
 		sem_wait(&queue.sema);
 
 		// Track how many worker threads are being used.
-		stats_increment_by_name("core.threads.working");
-
-		// Lock the queue stack until we finish with it.
-		mutex_lock(&queue.lock);
-		work = queue.items;
+		stats_increment_by_num(stats_intern(&queue_working, "core.threads.working"));
 
-		if (work) {
-			queue.items = (queue_t *)work->next;
-		}
+		if ((work = queue_take(queue_self))) {
+			__atomic_sub_fetch(&queue.depth, 1, __ATOMIC_RELAXED);
 
-		mutex_unlock(&queue.lock);
+			// Background work is expected to wait, so only the foreground waits are used to decide whether the queue is backed up.
+			if (work->priority != QUEUE_BACKGROUND) {
+				now = queue_clock();
+				histogram_record(queue.locals[queue_self].waits, now, now > work->stamp ? now - work->stamp : 0);
+			}
 
-		if (work) {
+			recorder_event(RECORDER_QUEUE_DEQUEUE, work->priority, (uintptr_t)work->function);
 			work->function(work->data);
 
 			if (work->requeue) {
 				work->requeue(work->data);
 			}
 
-			mm_free(work);
+			slab_put(&queue_slab, work);
 		}
 
 		// Decrement the busy thread counter.
-		stats_decrement_by_name("core.threads.working");
+		stats_decrement_by_num(stats_intern(&queue_working, "core.threads.working"));
 
 	// Continue processing until the work queue is empty and the status tracker indicates a shutdown.
 	} while (work || status());
@@ -126,6 +339,35 @@ void dequeue(void) {
 	return;
 }
 
+/**
+ * @brief	Get the number of work items waiting in the queue.
+ * @return	the number of work items which have been queued, but not yet taken by a worker thread.
+ */
+uint64_t queue_depth(void) {
+	return __atomic_load_n(&queue.depth, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	Estimate a percentile of the time work items recently spent waiting in the queue.
+ * @note	The estimate covers the current, and previous, histogram windows of every worker, and is the upper bound of the histogram
+ * 			bucket holding the percentile, so it's accurate to within a factor of two.
+ * @param	percentile	the percentile to be estimated, between 1 and 100.
+ * @return	the estimated wait, in microseconds, or 0 if no work was recently taken from the queue.
+ */
+uint64_t queue_wait(uint64_t percentile) {
+
+	uint64_t now = queue_clock(), total = 0;
+	uint64_t buckets[MAGMA_QUEUE_WAIT_BUCKETS];
+
+	mm_wipe(buckets, sizeof(buckets));
+
+	for (uint64_t i = 0; queue.locals && i < queue.count; i++) {
+		total += histogram_sum(queue.locals[i].waits, now, buckets);
+	}
+
+	return histogram_percentile(buckets, total, percentile);
+}
+
 /**
  * @brief	Signal all worker threads with SIGALRM to force their return.
  * @return	This function returns no value.
@@ -156,11 +398,35 @@ bool_t queue_init(void) {
 		return false;
 	}
 
-	if (mutex_init(&queue.lock, NULL)) {
+	if (!(queue.locals = mm_alloc(sizeof(queue_local_t) * magma.system.worker_threads))) {
 		sem_destroy(&queue.sema);
 		return false;
 	}
 
+	// The local queues must all exist before the first worker is launched, since idle workers will try to steal from them.
+	for (uint64_t i = 0; i < magma.system.worker_threads; i++) {
+
+		for (uint64_t j = 0; j < MAGMA_QUEUE_PRIORITIES; j++) {
+			if (!(queue.locals[i].deques[j] = deque_alloc())) {
+				for (uint64_t k = 0; k < j; k++) {
+					deque_free(queue.locals[i].deques[k]);
+				}
+				queue_shutdown();
+				return false;
+			}
+		}
+
+		if (mutex_init(&queue.locals[i].lock, NULL)) {
+			for (uint64_t j = 0; j < MAGMA_QUEUE_PRIORITIES; j++) {
+				deque_free(queue.locals[i].deques[j]);
+			}
+			queue_shutdown();
+			return false;
+		}
+
+		queue.count++;
+	}
+
 	if (!(queue.workers = mm_alloc(sizeof(pthread_t) * magma.system.worker_threads))) {
 		queue_shutdown();
 		return false;
@@ -186,6 +452,8 @@ bool_t queue_init(void) {
  */
 void queue_shutdown(void) {
 
+	queue_t *work;
+
 	for (uint64_t i = 0; queue.workers && i < magma.system.worker_threads + 128; i++) {
 		sem_post(&queue.sema);
 	}
@@ -199,9 +467,28 @@ void queue_shutdown(void) {
 
 	}
 
+	// Release the local queues, along with any work items which were never executed.
+	for (uint64_t i = 0; queue.locals && i < queue.count; i++) {
+
+		for (queue_priority_t priority = QUEUE_INTERACTIVE; priority < MAGMA_QUEUE_PRIORITIES; priority++) {
+
+			while ((work = deque_pop(queue.locals[i].deques[priority])) || (work = queue_inbox_pop(queue.locals + i, priority))) {
+				slab_put(&queue_slab, work);
+			}
+
+			deque_free(queue.locals[i].deques[priority]);
+		}
+
+		mutex_destroy(&queue.locals[i].lock);
+	}
+
 	mm_cleanup(queue.workers);
-	mutex_destroy(&queue.lock);
+	mm_cleanup(queue.locals);
 	sem_destroy(&queue.sema);
 
+	queue.workers = NULL;
+	queue.locals = NULL;
+	queue.count = queue.started = queue.depth = 0;
+
 	return;
 }
@@ -0,0 +1,370 @@
+
+/**
+ * @file /magma/engine/controller/timers.c
+ *
+ * @brief	A hashed hierarchical timer wheel, used to enqueue work at some point in the future without tying up a worker thread.
+ *
+ * The wheel is made up of several levels, each with a fixed number of slots. The first level holds the timers which will expire
+ * within one full rotation, with one slot per tick. Each level above it covers a range which is one rotation of the level below it
+ * per slot. Scheduling and cancelling a timer are constant time operations, since they only link or unlink the timer from a slot. As
+ * the first level wraps around, the timers in the next slot of the level above are cascaded down into the lower level. When a timer
+ * expires, its function is enqueued, so the work is always performed by the worker pool, and never by the timer thread.
+ */
+
+#include "magma.h"
+
+#define TIMER_SLOTS (1UL << MAGMA_TIMER_BITS)
+#define TIMER_MASK (TIMER_SLOTS - 1)
+
+struct {
+	bool_t running;
+	uint64_t epoch; /* The monotonic clock, in milliseconds, when the wheel was started. */
+	uint64_t current; /* The next tick to be processed. */
+	pthread_t *thread;
+	pthread_mutex_t lock;
+	timer_event_t *slots[MAGMA_TIMER_LEVELS][TIMER_SLOTS];
+} timers = {
+		.running = false,
+		.thread = NULL
+};
+
+// The interned ids of the timer statistics, which are updated whenever a timer is added, cancelled or fired.
+static uint64_t timers_pending = 0, timers_expired = 0;
+
+/**
+ * @brief	Get the value of the monotonic clock in milliseconds.
+ * @return	the number of milliseconds since an arbitrary point in the past.
+ */
+static uint64_t timer_clock(void) {
+
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000) + ((uint64_t)now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief	Link a timer into the wheel slot which covers its expiration tick.
+ * @note	The caller must hold the wheel lock. Timers which have already expired are placed in the slot processed next, while timers
+ * 			which expire beyond the range of the wheel are clamped to the last tick it can hold.
+ * @param	timer	the timer to be linked.
+ * @return	This function returns no value.
+ */
+static void timer_link(timer_event_t *timer) {
+
+	uint64_t ticks;
+	uint_t level = 0;
+
+	if (timer->expiration < timers.current) {
+		timer->expiration = timers.current;
+	}
+	else if ((ticks = timer->expiration - timers.current) >= (1UL << (MAGMA_TIMER_BITS * MAGMA_TIMER_LEVELS))) {
+		timer->expiration = timers.current + (1UL << (MAGMA_TIMER_BITS * MAGMA_TIMER_LEVELS)) - 1;
+	}
+
+	ticks = timer->expiration - timers.current;
+
+	while (level < (MAGMA_TIMER_LEVELS - 1) && ticks >= (1UL << (MAGMA_TIMER_BITS * (level + 1)))) {
+		level++;
+	}
+
+	timer->slot = &(timers.slots[level][(timer->expiration >> (MAGMA_TIMER_BITS * level)) & TIMER_MASK]);
+	timer->prev = NULL;
+
+	if ((timer->next = *(timer->slot))) {
+		timer->next->prev = timer;
+	}
+
+	*(timer->slot) = timer;
+
+	return;
+}
+
+/**
+ * @brief	Remove a timer from its wheel slot.
+ * @note	The caller must hold the wheel lock.
+ * @param	timer	the timer to be removed.
+ * @return	This function returns no value.
+ */
+static void timer_unlink(timer_event_t *timer) {
+
+	if (timer->prev) {
+		timer->prev->next = timer->next;
+	}
+	else {
+		*(timer->slot) = timer->next;
+	}
+
+	if (timer->next) {
+		timer->next->prev = timer->prev;
+	}
+
+	timer->slot = NULL;
+	timer->prev = timer->next = NULL;
+
+	return;
+}
+
+/**
+ * @brief	Move the timers held by a slot on an upper level of the wheel down to the levels below it.
+ * @note	The caller must hold the wheel lock.
+ * @param	level	the level of the wheel being cascaded.
+ * @return	the offset of the slot which was cascaded, which is zero if the level has wrapped around, and the next level should be cascaded.
+ */
+static uint64_t timer_cascade(uint_t level) {
+
+	timer_event_t *timer, *next;
+	uint64_t index = (timers.current >> (MAGMA_TIMER_BITS * level)) & TIMER_MASK;
+
+	timer = timers.slots[level][index];
+	timers.slots[level][index] = NULL;
+
+	while (timer) {
+		next = timer->next;
+		timer_link(timer);
+		timer = next;
+	}
+
+	return index;
+}
+
+/**
+ * @brief	Process the next tick of the wheel, and enqueue the function of every timer which expired.
+ * @note	The caller must hold the wheel lock. The functions are enqueued while the lock is held, so once timer_cancel() returns, the
+ * 			wheel no longer holds a reference to the timer, or its data.
+ * @return	the number of timers which expired.
+ */
+static uint64_t timer_advance(void) {
+
+	uint64_t fired = 0;
+	timer_event_t *timer;
+	uint64_t index = timers.current & TIMER_MASK;
+
+	// When the first level wraps, the next slot on each level above it is cascaded down, until we reach a level which hasn't wrapped.
+	for (uint_t level = 1; !index && level < MAGMA_TIMER_LEVELS; level++) {
+		index = timer_cascade(level);
+	}
+
+	while ((timer = timers.slots[0][timers.current & TIMER_MASK])) {
+
+		timer_unlink(timer);
+		enqueue(timer->function, timer->data);
+		fired++;
+
+		if (timer->allocated) {
+			mm_free(timer);
+		}
+	}
+
+	timers.current++;
+
+	return fired;
+}
+
+/**
+ * @brief	Schedule a function to be enqueued after a delay.
+ * @note	The timer is owned by the caller, and must remain valid until it fires, or is cancelled. If the timer is already pending, it's
+ * 			moved to the new expiration.
+ * @param	timer		the timer used to track the function.
+ * @param	delay		the number of milliseconds to wait before enqueuing the function.
+ * @param	function	the function to be enqueued.
+ * @param	data		the data passed to the function when it's executed.
+ * @return	true if the timer was scheduled, or false if the timer wheel isn't running.
+ */
+bool_t timer_schedule(timer_event_t *timer, uint64_t delay, void *function, void *data) {
+
+	// Round up, so the timer never fires early.
+	uint64_t expiration = ((timer_clock() - timers.epoch) + delay + MAGMA_TIMER_TICK - 1) / MAGMA_TIMER_TICK;
+
+	if (!timer || !function) {
+		return false;
+	}
+
+	mutex_lock(&timers.lock);
+
+	if (!timers.running) {
+		mutex_unlock(&timers.lock);
+		log_pedantic("The timer wheel isn't running, so the timer can't be scheduled.");
+		return false;
+	}
+
+	if (timer->slot) {
+		timer_unlink(timer);
+	}
+	else {
+		stats_increment_by_num(stats_intern(&timers_pending, "core.timers.pending"));
+	}
+
+	timer->expiration = expiration;
+	timer->function = function;
+	timer->data = data;
+	timer_link(timer);
+
+	mutex_unlock(&timers.lock);
+
+	return true;
+}
+
+/**
+ * @brief	Cancel a pending timer.
+ * @param	timer	the timer to be cancelled.
+ * @return	true if the timer was cancelled before it fired, or false if the timer wasn't pending.
+ */
+bool_t timer_cancel(timer_event_t *timer) {
+
+	bool_t result = false;
+
+	if (!timer) {
+		return false;
+	}
+
+	mutex_lock(&timers.lock);
+
+	if (timer->slot) {
+		timer_unlink(timer);
+		stats_decrement_by_num(stats_intern(&timers_pending, "core.timers.pending"));
+		result = true;
+	}
+
+	mutex_unlock(&timers.lock);
+
+	return result;
+}
+
+/**
+ * @brief	Enqueue a function after a delay, using a timer allocated, and released, by the timer wheel.
+ * @note	If the timer can't be scheduled, the function is enqueued immediately, so the work is never lost.
+ * @param	delay		the number of milliseconds to wait before enqueuing the function.
+ * @param	function	the function to be enqueued.
+ * @param	data		the data passed to the function when it's executed.
+ * @return	This function returns no value.
+ */
+void timer_enqueue(uint64_t delay, void *function, void *data) {
+
+	timer_event_t *timer;
+
+	if (!(timer = mm_alloc(sizeof(timer_event_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a timer. The work is being enqueued immediately.", sizeof(timer_event_t));
+		enqueue(function, data);
+		return;
+	}
+
+	timer->allocated = true;
+
+	if (!timer_schedule(timer, delay, function, data)) {
+		mm_free(timer);
+		enqueue(function, data);
+	}
+
+	return;
+}
+
+/**
+ * @brief	The timer thread, which advances the wheel in step with the monotonic clock.
+ * @note	If the thread falls behind, every tick it missed is processed, so timers are only ever late, and never lost.
+ * @return	This function returns no value.
+ */
+void timer_loop(void) {
+
+	uint64_t target, fired;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	while (__atomic_load_n(&timers.running, __ATOMIC_RELAXED)) {
+
+		usleep(MAGMA_TIMER_TICK * 1000);
+		target = (timer_clock() - timers.epoch) / MAGMA_TIMER_TICK;
+		fired = 0;
+
+		mutex_lock(&timers.lock);
+
+		while (timers.current <= target) {
+			fired += timer_advance();
+		}
+
+		mutex_unlock(&timers.lock);
+
+		if (fired) {
+			stats_adjust_by_num(stats_intern(&timers_pending, "core.timers.pending"), -((int32_t)fired));
+			stats_adjust_by_num(stats_intern(&timers_expired, "core.timers.expired"), (int32_t)fired);
+		}
+	}
+
+	thread_stop();
+	pthread_exit(NULL);
+
+	return;
+}
+
+/**
+ * @brief	Initialize the timer wheel and launch the timer thread.
+ * @return	true on success, or false on failure.
+ */
+bool_t timer_init(void) {
+
+	if (mutex_init(&timers.lock, NULL)) {
+		return false;
+	}
+
+	mm_wipe(timers.slots, sizeof(timers.slots));
+	timers.epoch = timer_clock();
+	timers.current = 0;
+	timers.running = true;
+
+	if (!(timers.thread = thread_alloc(timer_loop, NULL))) {
+		log_critical("Unable to launch the timer wheel thread.");
+		timers.running = false;
+		mutex_destroy(&timers.lock);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the timer thread, and enqueue the functions of any timers the wheel allocated, so the deferred work isn't lost.
+ * @note	This must be called before the worker pool is shutdown. Timers owned by their callers are simply discarded.
+ * @return	This function returns no value.
+ */
+void timer_shutdown(void) {
+
+	timer_event_t *timer;
+
+	mutex_lock(&timers.lock);
+	timers.running = false;
+	mutex_unlock(&timers.lock);
+
+	if (timers.thread) {
+		thread_join(*timers.thread);
+		mm_free(timers.thread);
+		timers.thread = NULL;
+	}
+
+	mutex_lock(&timers.lock);
+
+	for (uint_t level = 0; level < MAGMA_TIMER_LEVELS; level++) {
+		for (uint64_t index = 0; index < TIMER_SLOTS; index++) {
+			while ((timer = timers.slots[level][index])) {
+
+				timer_unlink(timer);
+				stats_decrement_by_num(stats_intern(&timers_pending, "core.timers.pending"));
+
+				if (timer->allocated) {
+					enqueue(timer->function, timer->data);
+					mm_free(timer);
+				}
+			}
+		}
+	}
+
+	mutex_unlock(&timers.lock);
+	mutex_destroy(&timers.lock);
+
+	return;
+}
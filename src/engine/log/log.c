@@ -2,22 +2,62 @@
  * @file /magma/engine/log/log.c
  *
  * @brief	Internal logging functions. This function should be accessed using the appropriate macro.
+ *
+ * Log messages are formatted by the calling thread, and copied into a ring buffer owned by that thread, so logging never waits on a
+ * lock, or the log device. A single writer thread drains the ring buffers, and sends whatever it finds to the log using a single
+ * writev() call. When a ring buffer fills up, the message is either dropped, and counted, or the caller waits for the writer to catch
+ * up, depending on the magma.log.block setting. Critical messages are never dropped, and are flushed before the call returns, as is
+ * every message logged while the writer thread isn't running.
  */
 
 #include "magma.h"
 
+#define LOG_RING_MASK (MAGMA_LOG_RING_SIZE - 1)
+
+typedef struct log_ring_t {
+	uint64_t head __attribute__ ((aligned (MAGMA_CACHE_LINE_SIZE))); /* The total number of bytes consumed by the writer. */
+	uint64_t tail __attribute__ ((aligned (MAGMA_CACHE_LINE_SIZE))); /* The total number of bytes produced by the owning thread. */
+	bool_t owned; /* Whether a thread is using the ring. The ring is released when its thread exits, and reused by the next new thread. */
+	struct log_ring_t *next;
+	chr_t data[MAGMA_LOG_RING_SIZE];
+} log_ring_t;
+
+struct {
+	sem_t wake;
+	bool_t running; /* Whether the writer thread is draining the ring buffers. */
+	bool_t sleeping; /* Whether the writer thread is waiting for a producer to wake it. */
+	uint64_t count; /* The number of ring buffers which have been allocated. */
+	uint64_t dropped; /* The number of messages dropped because a ring buffer was full. */
+	uint64_t reported; /* The number of dropped messages which have already been reported in the log. */
+	pthread_t *thread;
+	pthread_key_t key;
+	pthread_once_t once;
+	log_ring_t *rings, *cursor;
+} log_writer = {
+		.running = false,
+		.sleeping = false,
+		.count = 0,
+		.dropped = 0,
+		.reported = 0,
+		.thread = NULL,
+		.once = PTHREAD_ONCE_INIT,
+		.rings = NULL,
+		.cursor = NULL
+};
+
 uint64_t log_date;
 bool_t log_enabled = true;
 pthread_mutex_t log_mutex =	PTHREAD_MUTEX_INITIALIZER;
 
+/// The ring buffer owned by the current thread.
+static __thread log_ring_t *log_ring = NULL;
+
 /**
  * @brief	Disable logging.
  * @return	This function returns no value.
  */
 void log_disable(void) {
-	mutex_lock(&log_mutex);
-	log_enabled = false;
-	mutex_unlock(&log_mutex);
+	__atomic_store_n(&log_enabled, false, __ATOMIC_RELEASE);
 	return;
 }
 
@@ -26,9 +66,345 @@ void log_disable(void) {
  * @return	This function returns no value.
  */
 void log_enable(void) {
+	__atomic_store_n(&log_enabled, true, __ATOMIC_RELEASE);
+	return;
+}
+
+/**
+ * @brief	Get the number of log messages dropped because a ring buffer was full.
+ * @return	the number of messages dropped since the process started.
+ */
+uint64_t log_dropped(void) {
+	return __atomic_load_n(&log_writer.dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	Release the ring buffer of a thread which is exiting, so it can be reused by another thread.
+ * @note	Any messages still in the ring buffer will be written by the writer thread, just like they would have been otherwise.
+ * @param	ring	the ring buffer owned by the exiting thread.
+ * @return	This function returns no value.
+ */
+static void log_release(void *ring) {
+	__atomic_store_n(&(((log_ring_t *)ring)->owned), false, __ATOMIC_RELEASE);
+	return;
+}
+
+/**
+ * @brief	Make sure the log mutex isn't held, and the ring buffers are empty, when the process forks.
+ * @return	This function returns no value.
+ */
+static void log_fork_prepare(void) {
+
+	mutex_lock(&log_mutex);
+
+	// Anything still in the ring buffers would otherwise be written twice, once by each process.
+	while (log_drain());
+
+	return;
+}
+
+/**
+ * @brief	Release the log mutex in the parent process once a fork has finished.
+ * @return	This function returns no value.
+ */
+static void log_fork_parent(void) {
+	mutex_unlock(&log_mutex);
+	return;
+}
+
+/**
+ * @brief	Release the log mutex in a child process. The writer thread doesn't exist in the child, so the child logs synchronously.
+ * @return	This function returns no value.
+ */
+static void log_fork_child(void) {
+	__atomic_store_n(&log_writer.running, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_writer.sleeping, false, __ATOMIC_RELEASE);
+	log_writer.thread = NULL;
+	mutex_unlock(&log_mutex);
+	return;
+}
+
+/**
+ * @brief	Create the key used to release ring buffers when their thread exits, and register the fork handlers.
+ * @return	This function returns no value.
+ */
+static void log_once(void) {
+	pthread_key_create(&log_writer.key, &log_release);
+	pthread_atfork(&log_fork_prepare, &log_fork_parent, &log_fork_child);
+	return;
+}
+
+/**
+ * @brief	Get the ring buffer owned by the current thread, reusing a released ring buffer, or allocating a new one, if necessary.
+ * @return	NULL if a ring buffer couldn't be allocated, or a pointer to the ring buffer owned by the current thread.
+ */
+static log_ring_t * log_ring_get(void) {
+
+	bool_t owned;
+	log_ring_t *ring;
+
+	if (log_ring) {
+		return log_ring;
+	}
+
+	pthread_once(&log_writer.once, &log_once);
+
+	for (ring = __atomic_load_n(&log_writer.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+		owned = false;
+		if (__atomic_compare_exchange_n(&(ring->owned), &owned, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	// Ring buffers are only ever added to the front of the list, and never removed, so the writer can walk the list without a lock.
+	if (!ring) {
+
+		if (!(ring = mm_alloc(sizeof(log_ring_t)))) {
+			return NULL;
+		}
+
+		ring->owned = true;
+		ring->next = __atomic_load_n(&log_writer.rings, __ATOMIC_RELAXED);
+
+		while (!__atomic_compare_exchange_n(&log_writer.rings, &(ring->next), ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		__atomic_add_fetch(&log_writer.count, 1, __ATOMIC_RELEASE);
+	}
+
+	pthread_setspecific(log_writer.key, ring);
+	log_ring = ring;
+
+	return ring;
+}
+
+/**
+ * @brief	Copy a message into a ring buffer.
+ * @note	Only the thread which owns the ring buffer may call this function.
+ * @param	ring	the ring buffer.
+ * @param	message	the formatted message.
+ * @param	length	the length of the message.
+ * @return	true if the message was copied, or false if the ring buffer doesn't have enough room.
+ */
+static bool_t log_push(log_ring_t *ring, chr_t *message, size_t length) {
+
+	size_t offset, first;
+	uint64_t tail = ring->tail, head = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+
+	if (MAGMA_LOG_RING_SIZE - (tail - head) < length) {
+		return false;
+	}
+
+	offset = tail & LOG_RING_MASK;
+	first = (length < MAGMA_LOG_RING_SIZE - offset) ? length : MAGMA_LOG_RING_SIZE - offset;
+
+	mm_copy(ring->data + offset, message, first);
+	if (first < length) mm_copy(ring->data, message + first, length - first);
+
+	// The store is sequentially consistent, so a sleeping writer either sees the message, or we see that the writer is sleeping.
+	__atomic_store_n(&(ring->tail), tail + length, __ATOMIC_SEQ_CST);
+
+	return true;
+}
+
+/**
+ * @brief	Wake the writer thread, if it's sleeping.
+ * @return	This function returns no value.
+ */
+static void log_wake(void) {
+
+	if (__atomic_load_n(&log_writer.sleeping, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&log_writer.sleeping, false, __ATOMIC_SEQ_CST)) {
+		sem_post(&log_writer.wake);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether any of the ring buffers are holding messages.
+ * @return	true if there are messages waiting to be written, otherwise false.
+ */
+static bool_t log_pending(void) {
+
+	for (log_ring_t *ring = __atomic_load_n(&log_writer.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+		if (__atomic_load_n(&(ring->tail), __ATOMIC_SEQ_CST) != __atomic_load_n(&(ring->head), __ATOMIC_RELAXED)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Write a list of buffers to the log, retrying until everything has been written.
+ * @note	If the log can't be written, the output is discarded, since there's nowhere to report the problem.
+ * @param	vectors	the buffers to be written, which are updated as the output is written.
+ * @param	count	the number of buffers.
+ * @return	This function returns no value.
+ */
+static void log_write(struct iovec *vectors, int_t count) {
+
+	ssize_t written;
+
+	// Anything printed directly to standard output needs to go first, so the output stays in order.
+	fflush(stdout);
+
+	while (count) {
+
+		if ((written = writev(STDOUT_FILENO, vectors, count)) <= 0) {
+			if (written < 0 && errno == EINTR) continue;
+			return;
+		}
+
+		while (count && (size_t)written >= vectors->iov_len) {
+			written -= vectors->iov_len;
+			vectors++;
+			count--;
+		}
+
+		if (count) {
+			vectors->iov_base = (chr_t *)vectors->iov_base + written;
+			vectors->iov_len -= written;
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Write the messages waiting in the ring buffers to the log, using a single system call.
+ * @note	The caller must hold the log mutex. Each pass picks up where the previous pass left off, so a few busy threads can't keep the
+ * 			others from being written when there are more ring buffers than fit in a single batch.
+ * @return	the number of bytes written.
+ */
+uint64_t log_drain(void) {
+
+	log_ring_t *ring;
+	chr_t notice[128];
+	int_t count = 0;
+	struct iovec vectors[MAGMA_LOG_BATCH + 1];
+	size_t offset, first, used = 0;
+	log_ring_t *rings[MAGMA_LOG_BATCH / 2];
+	uint64_t head, tail, dropped, written = 0, total, tails[MAGMA_LOG_BATCH / 2];
+
+	// Report any dropped messages before the messages which made it into the ring buffers.
+	if ((dropped = __atomic_load_n(&log_writer.dropped, __ATOMIC_RELAXED)) != log_writer.reported) {
+		vectors[count].iov_base = notice;
+		vectors[count].iov_len = snprintf(notice, sizeof(notice), "%lu log messages were dropped because the log buffers were full.\n",
+			dropped - log_writer.reported);
+		written += vectors[count++].iov_len;
+		log_writer.reported = dropped;
+	}
+
+	total = __atomic_load_n(&log_writer.count, __ATOMIC_ACQUIRE);
+
+	if (!(ring = log_writer.cursor)) {
+		ring = __atomic_load_n(&log_writer.rings, __ATOMIC_ACQUIRE);
+	}
+
+	for (uint64_t visited = 0; ring && visited < total && used < (MAGMA_LOG_BATCH / 2); visited++) {
+
+		head = ring->head;
+		tail = __atomic_load_n(&(ring->tail), __ATOMIC_ACQUIRE);
+
+		if (head != tail) {
+
+			offset = head & LOG_RING_MASK;
+			first = ((tail - head) < MAGMA_LOG_RING_SIZE - offset) ? (tail - head) : MAGMA_LOG_RING_SIZE - offset;
+
+			// A message which wraps around the end of the ring buffer takes two vectors.
+			vectors[count].iov_base = ring->data + offset;
+			vectors[count++].iov_len = first;
+
+			if (first < (tail - head)) {
+				vectors[count].iov_base = ring->data;
+				vectors[count++].iov_len = (tail - head) - first;
+			}
+
+			written += tail - head;
+			rings[used] = ring;
+			tails[used++] = tail;
+		}
+
+		if (!(ring = ring->next)) {
+			ring = __atomic_load_n(&log_writer.rings, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	log_writer.cursor = ring;
+
+	if (count) {
+		log_write(vectors, count);
+	}
+
+	// The space is only handed back to the producers once the messages have been written.
+	for (size_t i = 0; i < used; i++) {
+		__atomic_store_n(&(rings[i]->head), tails[i], __ATOMIC_RELEASE);
+	}
+
+	return written;
+}
+
+/**
+ * @brief	Write every message waiting in the ring buffers to the log, before returning.
+ * @note	This is used for critical messages, by threads logging while the writer thread isn't running, and during shutdown.
+ * @return	This function returns no value.
+ */
+void log_flush(void) {
+
 	mutex_lock(&log_mutex);
-	log_enabled = true;
+	while (log_drain());
 	mutex_unlock(&log_mutex);
+
+	return;
+}
+
+/**
+ * @brief	The writer thread, which drains the ring buffers, and sleeps when they're empty.
+ * @return	This function returns no value.
+ */
+void log_loop(void) {
+
+	struct timespec timeout;
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	while (__atomic_load_n(&log_writer.running, __ATOMIC_ACQUIRE)) {
+
+		mutex_lock(&log_mutex);
+
+		// A flight recorder dump requested by SIGUSR2 is written here, after the pending messages, so the lines don't interleave.
+		if (recorder_requested()) {
+			while (log_drain());
+			recorder_dump_fd(STDOUT_FILENO);
+		}
+
+		if (log_drain()) {
+			mutex_unlock(&log_mutex);
+			continue;
+		}
+
+		mutex_unlock(&log_mutex);
+
+		// The sleeping flag is set before the final check, so a message which arrives after the check will always wake us.
+		__atomic_store_n(&log_writer.sleeping, true, __ATOMIC_SEQ_CST);
+
+		if (!log_pending() && !clock_gettime(CLOCK_REALTIME, &timeout)) {
+
+			timeout.tv_nsec += MAGMA_LOG_WAIT * 1000000;
+			timeout.tv_sec += timeout.tv_nsec / 1000000000;
+			timeout.tv_nsec %= 1000000000;
+
+			sem_timedwait(&log_writer.wake, &timeout);
+		}
+
+		__atomic_store_n(&log_writer.sleeping, false, __ATOMIC_SEQ_CST);
+	}
+
+	thread_stop();
+	pthread_exit(NULL);
+
 	return;
 }
 
@@ -96,9 +472,45 @@ int_t print_backtrace(void) {
 	return result;
 }
 
+/**
+ * @brief	Append formatted output to a log message, without overrunning the message buffer.
+ * @param	message	the message buffer, which is MAGMA_LOG_MESSAGE_MAX bytes long.
+ * @param	length	the length of the message so far.
+ * @param	format	the printf style format for the output.
+ * @param	args	the data items used by the format string.
+ * @return	the new length of the message, which always leaves room for a line feed.
+ */
+static size_t log_append(chr_t *message, size_t length, const chr_t *format, va_list args) {
+
+	int_t written;
+
+	if (length < MAGMA_LOG_MESSAGE_MAX - 1 && (written = vsnprintf(message + length, MAGMA_LOG_MESSAGE_MAX - 1 - length, format, args)) > 0) {
+		length += written;
+	}
+
+	return (length < MAGMA_LOG_MESSAGE_MAX - 2) ? length : MAGMA_LOG_MESSAGE_MAX - 2;
+}
+
+/**
+ * @brief	Append formatted output to a log message, using a variadic argument list.
+ * @see		log_append()
+ */
+static size_t log_print(chr_t *message, size_t length, const chr_t *format, ...) {
+
+	va_list args;
+
+	va_start(args, format);
+	length = log_append(message, length, format, args);
+	va_end(args);
+
+	return length;
+}
+
 /**
  *
  * @brief	Logs the message described by format, and provided as a variadic argument list.
+ * @note	The message is formatted by the calling thread, and handed to the writer thread. Critical messages, and stack traces, are written
+ * 			before the function returns.
  * @param	file	The log macros set this to the caller's filename.
  * @param	function	The log macros set this to the caller's function.
  * @param	line	The log macros set this to the line number where the log function was called.
@@ -112,16 +524,14 @@ void log_internal(const char *file, const char *function, const int line, M_LOG_
 	time_t now;
 	va_list args;
 	struct tm local;
-	bool_t output = false;
-	char buffer[128];
-
-	va_start(args, format);
-
-	mutex_lock(&log_mutex);
+	log_ring_t *ring;
+	size_t length = 0;
+	bool_t output = false, urgent, stack;
+	char buffer[128], message[MAGMA_LOG_MESSAGE_MAX];
+	struct iovec vector;
 
 	// Someone has disabled the log output.
-	if (!log_enabled) {
-		mutex_unlock(&log_mutex);
+	if (!__atomic_load_n(&log_enabled, __ATOMIC_ACQUIRE)) {
 		return;
 	}
 
@@ -130,58 +540,84 @@ void log_internal(const char *file, const char *function, const int line, M_LOG_
 		localtime_r(&now, &local);
 		strftime(buffer, 128, "%T", &local);
 
-		fprintf(stdout, "%s%s", (output ? " - " : "["), buffer);
+		length = log_print(message, length, "%s%s", (output ? " - " : "["), buffer);
 		output = true;
 	}
 
 	if ((magma.log.file || M_LOG_FILE == (options & M_LOG_FILE)) && !(M_LOG_FILE_DISABLE == (options & M_LOG_FILE_DISABLE))) {
-		fprintf(stdout, "%s%s", (output ? " - " : "["), file);
+		length = log_print(message, length, "%s%s", (output ? " - " : "["), file);
 		output = true;
 	}
 
 	if ((magma.log.function || M_LOG_FUNCTION == (options & M_LOG_FUNCTION)) && !(M_LOG_FUNCTION_DISABLE == (options & M_LOG_FUNCTION_DISABLE))) {
-		fprintf(stdout, "%s%s%s", (output ? " - " : "["), function, "()");
+		length = log_print(message, length, "%s%s%s", (output ? " - " : "["), function, "()");
 		output = true;
 	}
 
 	if ((magma.log.line || M_LOG_LINE == (options & M_LOG_LINE)) && !(M_LOG_LINE_DISABLE == (options & M_LOG_LINE_DISABLE))) {
-		fprintf(stdout, "%s%i", (output ? " - " : "["), line);
+		length = log_print(message, length, "%s%i", (output ? " - " : "["), line);
 		output = true;
 	}
 
 	if (output)
-		fprintf(stdout, "] = ");
+		length = log_print(message, length, "] = ");
 
-	vfprintf(stdout, format, args);
+	va_start(args, format);
+	length = log_append(message, length, format, args);
+	va_end(args);
 
 	if (!(M_LOG_LINE_FEED_DISABLE == (options & M_LOG_LINE_FEED_DISABLE))) {
-		fprintf(stdout, "\n");
+		message[length++] = '\n';
 	}
 
-	if ((magma.log.stack || M_LOG_STACK_TRACE == (options & M_LOG_STACK_TRACE)) && !(M_LOG_STACK_TRACE_DISABLE == (options & M_LOG_STACK_TRACE_DISABLE))) {
+	urgent = (M_LOG_CRITICAL == (options & M_LOG_CRITICAL));
+	stack = (magma.log.stack || M_LOG_STACK_TRACE == (options & M_LOG_STACK_TRACE)) && !(M_LOG_STACK_TRACE_DISABLE == (options & M_LOG_STACK_TRACE_DISABLE));
 
-		if (print_backtrace() < 0) {
-			fprintf(stdout, "Error printing stack backtrace to stdout!\n");
-		}
+	// Without a ring buffer, the message is written directly, behind whatever the writer thread is currently working on.
+	if (!(ring = log_ring_get())) {
+		vector.iov_base = message;
+		vector.iov_len = length;
+		mutex_lock(&log_mutex);
+		log_write(&vector, 1);
+		mutex_unlock(&log_mutex);
+	}
+	else {
 
-		/***
-		size = backtrace(array, 1024);
-		strings = backtrace_symbols(array, size);
+		while (!log_push(ring, message, length)) {
 
-		for (uint64_t i = 0; i < size; i++) {
-			fprintf(stdout, "   %s\n", strings[i]);
+			// Critical messages, and messages logged while the writer isn't running, are never dropped.
+			if (!__atomic_load_n(&log_writer.running, __ATOMIC_ACQUIRE)) {
+				log_flush();
+			}
+			else if (!urgent && !magma.log.block) {
+				__atomic_add_fetch(&log_writer.dropped, 1, __ATOMIC_RELAXED);
+				return;
+			}
+			else {
+				log_wake();
+				usleep(100);
+			}
 		}
 
-		if (strings)
-			free(strings);
-
-		***/
+		if (urgent || stack || !__atomic_load_n(&log_writer.running, __ATOMIC_ACQUIRE)) {
+			log_flush();
+		}
+		else {
+			log_wake();
+		}
 	}
 
-	fflush(stdout);
-	mutex_unlock(&log_mutex);
+	if (stack) {
 
-	va_end(args);
+		mutex_lock(&log_mutex);
+
+		if (print_backtrace() < 0) {
+			fprintf(stdout, "Error printing stack backtrace to stdout!\n");
+			fflush(stdout);
+		}
+
+		mutex_unlock(&log_mutex);
+	}
 
 	return;
 }
@@ -206,10 +642,15 @@ void log_rotate(void) {
 		}
 
 		pthread_mutex_lock(&log_mutex);
+
+		// Messages logged before the rotation belong in the old file. The lock has to be released before logging a failure, since a
+		// critical message is flushed before the log function returns.
+		while (log_drain());
+
 		if (!(stdout = freopen64(log_file, "a", stdout))) {
 			stdout = orig_out;
-			log_critical("Unable to rotate the error log. { file = %s }", log_file);
 			pthread_mutex_unlock(&log_mutex);
+			log_critical("Unable to rotate the error log. { file = %s }", log_file);
 			return;
 		}
 
@@ -218,8 +659,8 @@ void log_rotate(void) {
 			fclose(stdout);
 			stdout = orig_out;
 			stderr = orig_err;
-			log_critical("Unable to rotate the error log. { file = %s }", log_file);
 			pthread_mutex_unlock(&log_mutex);
+			log_critical("Unable to rotate the error log. { file = %s }", log_file);
 			return;
 		}
 		pthread_mutex_unlock(&log_mutex);
@@ -266,6 +707,57 @@ bool_t log_start(void) {
 	}
 
 	fclose(stdin);
+
+	// Launch the writer thread, so messages are no longer written by the threads which log them.
+	return log_launch();
+}
+
+/**
+ * @brief	Launch the writer thread, unless it's already running.
+ * @note	This is called by log_start(), and may be used to restart the writer after log_stop().
+ * @return	true if the writer thread is running, or false on failure.
+ */
+bool_t log_launch(void) {
+
+	if (log_writer.thread) {
+		return true;
+	}
+	else if (sem_init(&log_writer.wake, 0, 0)) {
+		log_critical("Unable to initialize the log writer semaphore.");
+		return false;
+	}
+
+	__atomic_store_n(&log_writer.running, true, __ATOMIC_RELEASE);
+
+	if (!(log_writer.thread = thread_alloc(&log_loop, NULL))) {
+		__atomic_store_n(&log_writer.running, false, __ATOMIC_RELEASE);
+		sem_destroy(&log_writer.wake);
+		log_critical("Unable to launch the log writer thread.");
+		return false;
+	}
+
 	return true;
 }
 
+/**
+ * @brief	Stop the writer thread, and flush any messages still waiting in the ring buffers.
+ * @note	Messages logged after the writer stops are written synchronously. The ring buffers are never released, since a thread which is
+ * 			still running may log a message at any point up until the process exits.
+ * @return	This function returns no value.
+ */
+void log_stop(void) {
+
+	if (log_writer.thread) {
+		__atomic_store_n(&log_writer.running, false, __ATOMIC_RELEASE);
+		sem_post(&log_writer.wake);
+		thread_join(*log_writer.thread);
+		mm_free(log_writer.thread);
+		log_writer.thread = NULL;
+		sem_destroy(&log_writer.wake);
+	}
+
+	log_flush();
+
+	return;
+}
+
@@ -14,9 +14,15 @@
 int_t    print_backtrace();
 void     log_internal(const char *file, const char *function, const int line, M_LOG_OPTIONS options, const char *format, ...) __attribute__((format (printf, 5, 6)));
 void     log_disable(void);
+uint64_t log_drain(void);
+uint64_t log_dropped(void);
 void     log_enable(void);
+void     log_flush(void);
+bool_t   log_launch(void);
+void     log_loop(void);
 void     log_rotate(void);
 bool_t   log_start(void);
+void     log_stop(void);
 
 #undef log_pedantic
 #undef log_check
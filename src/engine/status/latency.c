@@ -0,0 +1,237 @@
+
+/**
+ * @file /magma/engine/status/latency.c
+ *
+ * @brief	Log-linear latency histograms, used to track how long each protocol command takes to execute.
+ *
+ * Each power of two range of latencies is split into a fixed number of equally sized sub-buckets, so every bucket is accurate to within
+ * the same percentage of the value it holds, no matter whether a command took a few microseconds, or a few minutes. The samples are
+ * measured in nanoseconds using the calibrated processor cycle counter, and the buckets are updated atomically, so the histograms can
+ * be shared by every worker thread without a lock. The histograms cover the entire life of the process.
+ */
+
+#include "magma.h"
+
+#define LATENCY_SUB_BUCKETS (1UL << MAGMA_LATENCY_PRECISION)
+#define LATENCY_BUCKETS ((MAGMA_LATENCY_RANGE - MAGMA_LATENCY_PRECISION + 1) << MAGMA_LATENCY_PRECISION)
+
+struct latency_t {
+	chr_t name[64]; /* The protocol and command name, in lower case, like imap.fetch. */
+	uint64_t buckets[LATENCY_BUCKETS];
+	struct latency_t *next;
+};
+
+struct {
+	pthread_mutex_t lock;
+	latency_t *head, *tail;
+} latencies = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.head = NULL,
+		.tail = NULL
+};
+
+/**
+ * @brief	Find the bucket which counts a latency.
+ * @param	elapsed	the latency, in nanoseconds.
+ * @return	the index of the bucket.
+ */
+static uint64_t latency_bucket(uint64_t elapsed) {
+
+	uint64_t exponent;
+
+	// The smallest values each get their own bucket.
+	if (elapsed < LATENCY_SUB_BUCKETS) {
+		return elapsed;
+	}
+	else if ((exponent = 63 - __builtin_clzll(elapsed)) >= MAGMA_LATENCY_RANGE) {
+		return LATENCY_BUCKETS - 1;
+	}
+
+	return ((exponent - MAGMA_LATENCY_PRECISION + 1) << MAGMA_LATENCY_PRECISION) + ((elapsed >> (exponent - MAGMA_LATENCY_PRECISION)) - LATENCY_SUB_BUCKETS);
+}
+
+/**
+ * @brief	Find the largest latency counted by a bucket.
+ * @param	bucket	the index of the bucket.
+ * @return	the upper bound of the bucket, in nanoseconds.
+ */
+static uint64_t latency_bound(uint64_t bucket) {
+
+	uint64_t exponent, width;
+
+	if (bucket < LATENCY_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	exponent = (bucket >> MAGMA_LATENCY_PRECISION) + MAGMA_LATENCY_PRECISION - 1;
+	width = 1UL << (exponent - MAGMA_LATENCY_PRECISION);
+
+	return ((LATENCY_SUB_BUCKETS + (bucket & (LATENCY_SUB_BUCKETS - 1))) * width) + width - 1;
+}
+
+/**
+ * @brief	Allocate a latency histogram for a protocol command, and add it to the list of histograms.
+ * @note	The histograms are only released by latency_free(), when the process is shutting down.
+ * @param	protocol	the name of the protocol, in lower case.
+ * @param	command		the name of the command, which isn't required to be NULL terminated.
+ * @param	length		the length of the command name.
+ * @return	NULL on failure, or a pointer to the new histogram on success.
+ */
+latency_t * latency_alloc(chr_t *protocol, chr_t *command, size_t length) {
+
+	size_t used;
+	latency_t *histogram;
+
+	if (!protocol || !command || !length) {
+		log_pedantic("Invalid parameters were passed to the latency histogram allocator.");
+		return NULL;
+	}
+	else if (!(histogram = mm_alloc(sizeof(latency_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a latency histogram.", sizeof(latency_t));
+		return NULL;
+	}
+
+	used = snprintf(histogram->name, sizeof(histogram->name), "%s.%.*s", protocol, (int)length, command);
+
+	for (size_t i = 0; i < used && i < sizeof(histogram->name); i++) {
+		histogram->name[i] = lower_chr(histogram->name[i]);
+	}
+
+	// The histogram is appended, and published, only after it has been initialized, so the list can be walked without the lock.
+	mutex_lock(&latencies.lock);
+
+	if (latencies.tail) __atomic_store_n(&(latencies.tail->next), histogram, __ATOMIC_RELEASE);
+	else __atomic_store_n(&(latencies.head), histogram, __ATOMIC_RELEASE);
+
+	latencies.tail = histogram;
+
+	mutex_unlock(&latencies.lock);
+
+	return histogram;
+}
+
+/**
+ * @brief	Release every latency histogram.
+ * @note	This must only be called once the worker pool has been shutdown, since the command tables still point at the histograms.
+ * @return	This function returns no value.
+ */
+void latency_free(void) {
+
+	latency_t *histogram;
+
+	mutex_lock(&latencies.lock);
+
+	while ((histogram = latencies.head)) {
+		latencies.head = histogram->next;
+		mm_free(histogram);
+	}
+
+	latencies.tail = NULL;
+
+	mutex_unlock(&latencies.lock);
+
+	return;
+}
+
+/**
+ * @brief	Record the time a command took, if the command is being tracked.
+ * @param	histogram	the histogram of the command, or NULL if the command isn't being tracked.
+ * @param	start		the value returned by perf_rdtsc() when the command was dispatched, or 0 if the start wasn't recorded.
+ * @return	This function returns no value.
+ */
+void latency_record(latency_t *histogram, uint64_t start) {
+
+	if (!histogram || !start) {
+		return;
+	}
+
+	__atomic_add_fetch(&(histogram->buckets[latency_bucket(perf_elapsed(start))]), 1, __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief	Get the number of samples recorded by a histogram.
+ * @param	histogram	the histogram.
+ * @return	the number of samples recorded.
+ */
+uint64_t latency_count(latency_t *histogram) {
+
+	uint64_t total = 0;
+
+	for (uint64_t i = 0; histogram && i < LATENCY_BUCKETS; i++) {
+		total += __atomic_load_n(&(histogram->buckets[i]), __ATOMIC_RELAXED);
+	}
+
+	return total;
+}
+
+/**
+ * @brief	Estimate a percentile of the latencies recorded by a histogram.
+ * @param	histogram	the histogram.
+ * @param	permille	the percentile to be estimated, in tenths of a percent, so 999 estimates the 99.9th percentile.
+ * @return	the upper bound, in nanoseconds, of the bucket holding the percentile, or 0 if no samples were recorded.
+ */
+uint64_t latency_percentile(latency_t *histogram, uint64_t permille) {
+
+	uint64_t buckets[LATENCY_BUCKETS], total = 0, target, counted = 0;
+
+	if (!histogram) {
+		return 0;
+	}
+
+	// Take a snapshot, so the buckets can't change between the total being counted, and the target being found.
+	for (uint64_t i = 0; i < LATENCY_BUCKETS; i++) {
+		total += (buckets[i] = __atomic_load_n(&(histogram->buckets[i]), __ATOMIC_RELAXED));
+	}
+
+	if (!total) {
+		return 0;
+	}
+
+	target = ((total * (permille > 1000 ? 1000 : permille)) + 999) / 1000;
+
+	for (uint64_t i = 0; i < LATENCY_BUCKETS; i++) {
+		if ((counted += buckets[i]) >= target) {
+			return latency_bound(i);
+		}
+	}
+
+	return latency_bound(LATENCY_BUCKETS - 1);
+}
+
+/**
+ * @brief	Get the name of a histogram.
+ * @param	histogram	the histogram.
+ * @return	the protocol and command name, like imap.fetch, or NULL if the histogram is invalid.
+ */
+chr_t * latency_name(latency_t *histogram) {
+	return histogram ? histogram->name : NULL;
+}
+
+/**
+ * @brief	Iterate over the list of histograms.
+ * @param	histogram	the previous histogram, or NULL to start at the beginning of the list.
+ * @return	the next histogram, or NULL once the end of the list has been reached.
+ */
+latency_t * latency_next(latency_t *histogram) {
+	return histogram ? __atomic_load_n(&(histogram->next), __ATOMIC_ACQUIRE) : __atomic_load_n(&(latencies.head), __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief	Find a histogram using its name.
+ * @param	name	the protocol and command name, like imap.fetch, which is compared without regard to case.
+ * @return	the histogram, or NULL if no histogram was found with the given name.
+ */
+latency_t * latency_find(chr_t *name) {
+
+	latency_t *histogram = NULL;
+
+	while (name && (histogram = latency_next(histogram))) {
+		if (!st_cmp_ci_eq(NULLER(histogram->name), NULLER(name))) {
+			return histogram;
+		}
+	}
+
+	return NULL;
+}
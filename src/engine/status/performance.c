@@ -183,3 +183,62 @@ uint64_t perf_rdtsc(void) {
 	return ((uint64_t)lo)|(((uint64_t)hi) << 32);
 }
 
+/// The number of cycle counter ticks per nanosecond, as measured by perf_calibrate(). Zero until the counter has been calibrated.
+static double perf_frequency = 0;
+
+/**
+ * @brief	Measure the rate of the CPU cycle counter against the monotonic clock, so elapsed ticks can be converted into nanoseconds.
+ * @note	The calibration relies on the counter running at a constant rate, no matter what the processor clock speed is, which is true
+ * 			of every processor made in the last decade. The function sleeps for MAGMA_LATENCY_CALIBRATION milliseconds.
+ * @return	true if the counter was calibrated, or false if the counter, or the monotonic clock, appear to be unusable.
+ */
+bool_t perf_calibrate(void) {
+
+	uint64_t ticks, nanoseconds;
+	struct timespec start, finish;
+
+	if (perf_frequency) {
+		return true;
+	}
+
+	ticks = perf_rdtsc();
+	if (clock_gettime(CLOCK_MONOTONIC, &start)) {
+		return false;
+	}
+
+	usleep(MAGMA_LATENCY_CALIBRATION * 1000);
+
+	ticks = perf_rdtsc() - ticks;
+	if (clock_gettime(CLOCK_MONOTONIC, &finish)) {
+		return false;
+	}
+
+	nanoseconds = ((uint64_t)(finish.tv_sec - start.tv_sec) * 1000000000) + finish.tv_nsec - start.tv_nsec;
+
+	if (!ticks || !nanoseconds || ticks > (nanoseconds << 10)) {
+		log_pedantic("The CPU cycle counter could not be calibrated. { ticks = %lu / nanoseconds = %lu }", ticks, nanoseconds);
+		return false;
+	}
+
+	perf_frequency = (double)ticks / (double)nanoseconds;
+
+	return true;
+}
+
+/**
+ * @brief	Convert the number of CPU cycles elapsed since a previous reading of the cycle counter into nanoseconds.
+ * @param	start	the value returned by perf_rdtsc() when the interval began.
+ * @return	the number of nanoseconds which have elapsed, or 0 if the counter hasn't been calibrated.
+ */
+uint64_t perf_elapsed(uint64_t start) {
+
+	uint64_t now = perf_rdtsc();
+
+	// The counters on different cores are synchronized, but they can still disagree by a few ticks.
+	if (!perf_frequency || now <= start) {
+		return 0;
+	}
+
+	return (uint64_t)((double)(now - start) / perf_frequency);
+}
+
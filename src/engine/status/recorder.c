@@ -0,0 +1,310 @@
+
+/**
+ * @file /magma/engine/status/recorder.c
+ *
+ * @brief	An always on flight recorder, which keeps the most recent events recorded by each thread in memory.
+ *
+ * Each thread records compact binary events in a fixed size ring buffer it owns, so recording an event is a handful of stores, and a read
+ * of the processor cycle counter, without any locks, or atomic read-modify-write operations. Once the ring buffer is full, the oldest
+ * events are overwritten. The ring buffers are only formatted when they're dumped, which happens after the process receives SIGUSR2,
+ * when a molten client sends the RECORDER command, and when the process crashes. A dump reads the ring buffers while their threads are
+ * still writing to them, so each copied event is checked against the position of its ring buffer, like a sequence lock, and an event
+ * which may have been overwritten while it was being copied is skipped, rather than formatted using a pointer from a different event.
+ */
+
+#include "magma.h"
+
+#define RECORDER_MASK (MAGMA_RECORDER_EVENTS - 1)
+
+typedef struct {
+	uint64_t stamp; /* The cycle counter when the event was recorded. */
+	uint64_t data; /* A pointer, or number, identifying the subject of the event. */
+	uint32_t type; /* The type of event, which is a recorder_type_t value. */
+	uint32_t value; /* A detail specific to the type of event. */
+} recorder_event_t;
+
+typedef struct recorder_ring_t {
+	pid_t tid; /* The kernel thread id of the thread which owns the ring buffer. */
+	bool_t owned; /* Whether a thread is using the ring. The ring is released when its thread exits, and reused by the next new thread. */
+	uint64_t position; /* The total number of events recorded. */
+	struct recorder_ring_t *next;
+	recorder_event_t events[MAGMA_RECORDER_EVENTS];
+} recorder_ring_t;
+
+struct {
+	bool_t requested; /* Set by the SIGUSR2 handler, and cleared by the log writer thread once it performs the dump. */
+	pthread_key_t key;
+	pthread_once_t once;
+	recorder_ring_t *rings;
+} recorder = {
+		.requested = false,
+		.once = PTHREAD_ONCE_INIT,
+		.rings = NULL
+};
+
+/// The ring buffer owned by the current thread, and whether allocating one failed, so a failure isn't retried with every event.
+static __thread recorder_ring_t *recorder_ring = NULL;
+static __thread bool_t recorder_failed = false;
+
+/**
+ * @brief	Release the ring buffer of a thread which is exiting, so it can be reused by another thread.
+ * @param	ring	the ring buffer owned by the exiting thread.
+ * @return	This function returns no value.
+ */
+static void recorder_release(void *ring) {
+	__atomic_store_n(&(((recorder_ring_t *)ring)->owned), false, __ATOMIC_RELEASE);
+	return;
+}
+
+/**
+ * @brief	Create the key used to release ring buffers when their thread exits.
+ * @return	This function returns no value.
+ */
+static void recorder_once(void) {
+	pthread_key_create(&recorder.key, &recorder_release);
+	return;
+}
+
+/**
+ * @brief	Get a ring buffer for the current thread, reusing a released ring buffer, or allocating a new one, if necessary.
+ * @note	A reused ring buffer keeps the events of its previous thread, until they're overwritten.
+ * @return	NULL if a ring buffer couldn't be allocated, or a pointer to the ring buffer owned by the current thread.
+ */
+static recorder_ring_t * recorder_ring_get(void) {
+
+	bool_t owned;
+	recorder_ring_t *ring;
+
+	if (recorder_failed) {
+		return NULL;
+	}
+
+	pthread_once(&recorder.once, &recorder_once);
+
+	for (ring = __atomic_load_n(&recorder.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+		owned = false;
+		if (__atomic_compare_exchange_n(&(ring->owned), &owned, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	// Ring buffers are only ever added to the front of the list, and never removed, so a dump can walk the list without a lock.
+	if (!ring) {
+
+		if (!(ring = mm_alloc(sizeof(recorder_ring_t)))) {
+			recorder_failed = true;
+			return NULL;
+		}
+
+		ring->owned = true;
+		ring->next = __atomic_load_n(&recorder.rings, __ATOMIC_RELAXED);
+
+		while (!__atomic_compare_exchange_n(&recorder.rings, &(ring->next), ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	ring->tid = syscall(SYS_gettid);
+	pthread_setspecific(recorder.key, ring);
+	recorder_ring = ring;
+
+	return ring;
+}
+
+/**
+ * @brief	Record an event in the flight recorder of the current thread.
+ * @note	This function is called on hot paths, so it does as little as possible. The event is only interpreted when it's dumped.
+ * @param	type	the type of event.
+ * @param	value	a detail specific to the type of event.
+ * @param	data	a pointer, or number, identifying the subject of the event.
+ * @return	This function returns no value.
+ */
+void recorder_event(recorder_type_t type, uint32_t value, uint64_t data) {
+
+	uint64_t position;
+	recorder_ring_t *ring;
+	recorder_event_t *event;
+
+	if (!(ring = recorder_ring) && !(ring = recorder_ring_get())) {
+		return;
+	}
+
+	position = ring->position;
+	event = ring->events + (position & RECORDER_MASK);
+
+	// The fence keeps the stores below from becoming visible before the position published by the previous event, so a dump which
+	// copies any part of this event will also see a position telling it the slot is being overwritten.
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&(event->stamp), perf_rdtsc(), __ATOMIC_RELAXED);
+	__atomic_store_n(&(event->data), data, __ATOMIC_RELAXED);
+	__atomic_store_n(&(event->type), type, __ATOMIC_RELAXED);
+	__atomic_store_n(&(event->value), value, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&(ring->position), position + 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Describe the function a work item was dequeued to execute.
+ * @param	function	the address of the function.
+ * @param	output		a buffer to hold the description.
+ * @param	length		the length of the output buffer.
+ * @return	a pointer to the output buffer.
+ */
+static chr_t * recorder_symbol(void *function, chr_t *output, size_t length) {
+
+	Dl_info info;
+
+	if (dladdr(function, &info) && info.dli_sname) {
+		snprintf(output, length, "%s", info.dli_sname);
+	}
+	else {
+		snprintf(output, length, "%p", function);
+	}
+
+	return output;
+}
+
+/**
+ * @brief	Format an event, and hand it to the output function.
+ * @param	tid		the kernel thread id which recorded the event.
+ * @param	event	a copy of the event.
+ * @param	output	the function which receives the formatted line.
+ * @param	context	the context passed to the output function.
+ * @return	the value returned by the output function, which is false if the dump should be stopped.
+ */
+static bool_t recorder_print(pid_t tid, recorder_event_t *event, bool_t (*output)(void *context, chr_t *line, size_t length),
+	void *context) {
+
+	int_t length;
+	chr_t *query, line[256], symbol[128];
+	uint64_t age = perf_elapsed(event->stamp) / 1000;
+
+	switch (event->type) {
+		case (RECORDER_COMMAND_START):
+			length = snprintf(line, sizeof(line), "%i %lu command.start %s\n", tid, age, event->data ? (chr_t *)event->data : "UNKNOWN");
+			break;
+		case (RECORDER_COMMAND_END):
+			length = snprintf(line, sizeof(line), "%i %lu command.end %s\n", tid, age, event->data ? (chr_t *)event->data : "UNKNOWN");
+			break;
+		case (RECORDER_COMMAND_DISPATCH):
+			length = snprintf(line, sizeof(line), "%i %lu command.dispatch %s\n", tid, age,
+				recorder_symbol((void *)event->data, symbol, sizeof(symbol)));
+			break;
+		case (RECORDER_QUEUE_DEQUEUE):
+			length = snprintf(line, sizeof(line), "%i %lu queue.dequeue %s priority = %u\n", tid, age,
+				recorder_symbol((void *)event->data, symbol, sizeof(symbol)), event->value);
+			break;
+		case (RECORDER_LOCK_WAIT):
+			length = snprintf(line, sizeof(line), "%i %lu lock.wait %p waited = %u us\n", tid, age, (void *)event->data, event->value);
+			break;
+		case (RECORDER_SQL_STATEMENT):
+			query = stmt_query((MYSQL_STMT **)event->data);
+			length = snprintf(line, sizeof(line), "%i %lu sql.statement connection = %u %.160s\n", tid, age, event->value, query ? query : "UNKNOWN");
+			break;
+		case (RECORDER_TANK_READ):
+			length = snprintf(line, sizeof(line), "%i %lu tank.read tank = %u object = %lu\n", tid, age, event->value, event->data);
+			break;
+		default:
+			length = snprintf(line, sizeof(line), "%i %lu unknown type = %u\n", tid, age, event->type);
+			break;
+	}
+
+	if (length <= 0) {
+		return true;
+	}
+
+	return output(context, line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+}
+
+/**
+ * @brief	Copy an event out of a ring buffer, and make sure it wasn't overwritten while it was being copied.
+ * @param	ring		the ring buffer.
+ * @param	position	the position of the event being copied.
+ * @param	event		a pointer to the event which receives the copy.
+ * @return	true if the copy holds a single, complete event, or false if the slot was reused by a newer event.
+ */
+static bool_t recorder_copy(recorder_ring_t *ring, uint64_t position, recorder_event_t *event) {
+
+	recorder_event_t *slot = ring->events + (position & RECORDER_MASK);
+
+	event->stamp = __atomic_load_n(&(slot->stamp), __ATOMIC_RELAXED);
+	event->data = __atomic_load_n(&(slot->data), __ATOMIC_RELAXED);
+	event->type = __atomic_load_n(&(slot->type), __ATOMIC_RELAXED);
+	event->value = __atomic_load_n(&(slot->value), __ATOMIC_RELAXED);
+
+	// Pairs with the fence in recorder_event(). The slot is reused by the event at position + MAGMA_RECORDER_EVENTS, so if the owning
+	// thread has reached that event, the copy could pair the type of one event with the data of another.
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(&(ring->position), __ATOMIC_RELAXED) - position < MAGMA_RECORDER_EVENTS;
+}
+
+/**
+ * @brief	Format the events held by every flight recorder, oldest first, one thread at a time.
+ * @note	Each line holds the kernel thread id, the number of microseconds since the event was recorded, the event type, and the event
+ * 			details. Events overwritten while the dump is running are skipped. This function is called by the crash handler, so it avoids
+ * 			allocating memory, and taking locks.
+ * @param	output	the function which receives each formatted line, and returns false to stop the dump.
+ * @param	context	an arbitrary pointer passed to the output function.
+ * @return	This function returns no value.
+ */
+void recorder_dump(bool_t (*output)(void *context, chr_t *line, size_t length), void *context) {
+
+	uint64_t position;
+	recorder_event_t event;
+
+	for (recorder_ring_t *ring = __atomic_load_n(&recorder.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+
+		position = __atomic_load_n(&(ring->position), __ATOMIC_ACQUIRE);
+
+		for (uint64_t i = position > MAGMA_RECORDER_EVENTS ? position - MAGMA_RECORDER_EVENTS : 0; i < position; i++) {
+			if (recorder_copy(ring, i, &event) && !recorder_print(ring->tid, &event, output, context)) {
+				return;
+			}
+		}
+	}
+
+	return;
+}
+
+/**
+ * @brief	Ask for the flight recorders to be dumped by the log writer thread.
+ * @note	This function only sets a flag, so it's safe to call from a signal handler. The log writer thread checks the flag each time it
+ * 			wakes up, which happens at least every MAGMA_LOG_WAIT milliseconds.
+ * @return	This function returns no value.
+ */
+void recorder_request(void) {
+	__atomic_store_n(&recorder.requested, true, __ATOMIC_RELAXED);
+	return;
+}
+
+/**
+ * @brief	Check for, and clear, a request to dump the flight recorders.
+ * @return	true if a dump was requested since the last call, otherwise false.
+ */
+bool_t recorder_requested(void) {
+	return __atomic_load_n(&recorder.requested, __ATOMIC_RELAXED) && __atomic_exchange_n(&recorder.requested, false, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief	Write a formatted line to a file descriptor.
+ * @param	context	the file descriptor, cast to a pointer.
+ * @param	line	the formatted line.
+ * @param	length	the length of the line.
+ * @return	true if the line was written, otherwise false.
+ */
+static bool_t recorder_write(void *context, chr_t *line, size_t length) {
+	return write((int)(intptr_t)context, line, length) == (ssize_t)length;
+}
+
+/**
+ * @brief	Write the events held by every flight recorder to a file descriptor.
+ * @see		recorder_dump()
+ * @param	fd	the file descriptor.
+ * @return	This function returns no value.
+ */
+void recorder_dump_fd(int fd) {
+	recorder_dump(&recorder_write, (void *)(intptr_t)fd);
+	return;
+}
@@ -1,123 +1,176 @@
-
 /**
  * @file /magma/engine/status/statistics.c
  *
  * @brief	A collection of functions used to track and access system statistics.
+ *
+ * The statistic names are interned into a hash table when the interface is initialized, so a lookup by name never takes a lock. Each
+ * thread updates its own block of counters, which is padded to fill whole cache lines, and the blocks are only summed when a value is
+ * read. When a thread exits, its counters are folded into the retired totals.
  */
 
 #include "magma.h"
 
+typedef struct stats_shard_t {
+	struct stats_shard_t *next;
+	chr_t padding[MAGMA_CACHE_LINE_SIZE - sizeof(struct stats_shard_t *)];
+	uint64_t values[];
+} stats_shard_t;
+
+// The names of the tracked statistics. An entry's position in this list is the numerical id the name is interned as.
+static char *tracked[] = {
+	"default",
+
+	// Core Statistics
+	"core.threads.allocated",
+	"core.threads.working",
+	"core.timers.pending",
+	"core.timers.expired",
+
+	// SMTP Statistics
+	"smtp.connections.total",
+	"smtp.connections.secure",
+	"smtp.connections.shed",
+
+	// DMTP Statistics
+	"dmtp.connections.total",
+	"dmtp.connections.secure",
+
+	// HTTP Statistics
+	"http.connections.total",
+	"http.connections.secure",
+
+	// IMAP Statistics
+	"imap.connections.total",
+	"imap.connections.secure",
+	"imap.connections.shed",
+	"imap.connections.idle",
+
+	// POP Statistics
+	"pop.connections.total",
+	"pop.connections.secure",
+	"pop.connections.shed",
+
+	// Molten Statistics
+	"molten.connections.total",
+	"molten.connections.secure",
+
+	// Network Statistics
+	"network.output.syscalls",
+	"network.output.flushes",
+	"network.tls.offloaded.total",
+	"network.tls.offloaded.active",
+	"network.reverse.queries",
+	"network.reverse.timeouts",
+	"network.reverse.cache.hits",
+	"network.reverse.cache.misses",
+	"network.reverse.cache.evicted",
+
+	// Provider Statistics
+	"provider.virus.available",
+	"provider.virus.error",
+	"provider.virus.scan.total",
+	"provider.virus.scan.clean",
+	"provider.virus.scan.infected",
+	"provider.virus.scan.phishing",
+	"provider.virus.signatures.total",
+	"provider.virus.signatures.loaded",
+
+	"provider.spf.checked",
+	"provider.spf.missing",
+	"provider.spf.neutral",
+	"provider.spf.error",
+	"provider.spf.fail",
+	"provider.spf.pass",
+
+	"provider.dkim.signed",
+	"provider.dkim.checked",
+	"provider.dkim.missing",
+	"provider.dkim.neutral",
+	"provider.dkim.error",
+	"provider.dkim.fail",
+	"provider.dkim.pass",
+
+	"provider.tls.handshakes.full",
+	"provider.tls.handshakes.resumed",
+	"provider.tls.sessions.evicted",
+	"provider.tls.tickets.rotated",
+
+	// Objects
+	"objects.meta.total",
+	"objects.meta.expired",
+	"objects.sessions.total",
+	"objects.sessions.expired",
+	"objects.messages.cache.hits",
+	"objects.messages.cache.misses",
+	"objects.messages.cache.evictions",
+	"objects.messages.flags.batches",
+
+	// Patterns
+	"objects.patterns.checked",
+	"objects.patterns.error",
+	"objects.patterns.fail",
+	"objects.patterns.pass",
+
+	// Web Applications
+	"web.register.blocked",
+
+	// TODO: Add stubs for derived statistics like uptime, CPU, memory and secure memory stats.
+	// system.pid
+	// system.time
+	// system.uptime
+	// system.load (1, 5, 15, or all?)
+	// system.cpu.total
+	// system.cpu.users
+	// system.cpu.system
+	// system.mem.peak
+	// system.mem.size
+	// system.mem.locked
+	// system.mem.resident
+	// system.mem.data
+	// system.mem.stack
+	// system.mem.executable
+	// system.mem.libraries
+	// system.mem.PTE? HWM?
+	// system.mem.swap
+	// system.heap.total
+	// system.heap.allocated
+	// system.heap.items
+	// system.secure.total
+	// system.secure.allocated
+	// system.secure.items
+	// system.handles.total
+	// system.handles.pipe
+	// system.handles.files
+	// system.handles.sockets
+	// network...
+};
+
 struct {
-	size_t count;
-	pthread_mutex_t locks[128][2];
-	uint64_t values[128];
-	char *names[128];
+	bool_t ready;
+	uint64_t generation;
+	size_t count, buckets;
+	uint32_t *table;
+	uint64_t *retired;
+	pthread_key_t key;
+	pthread_mutex_t lock;
+	stats_shard_t *shards;
 } stats = {
-		.names = {
-			"default",
-
-			// Core Statistics
-			"core.threads.allocated",
-			"core.threads.working",
-
-			// SMTP Statistics
-			"smtp.connections.total",
-			"smtp.connections.secure",
-
-			// DMTP Statistics
-			"dmtp.connections.total",
-			"dmtp.connections.secure",
-
-			// HTTP Statistics
-			"http.connections.total",
-			"http.connections.secure",
-
-			// IMAP Statistics
-			"imap.connections.total",
-			"imap.connections.secure",
-
-			// POP Statistics
-			"pop.connections.total",
-			"pop.connections.secure",
-
-			// Molten Statistics
-			"molten.connections.total",
-			"molten.connections.secure",
-
-			// Provider Statistics
-			"provider.virus.available",
-			"provider.virus.error",
-			"provider.virus.scan.total",
-			"provider.virus.scan.clean",
-			"provider.virus.scan.infected",
-			"provider.virus.scan.phishing",
-			"provider.virus.signatures.total",
-			"provider.virus.signatures.loaded",
-
-			"provider.spf.checked",
-			"provider.spf.missing",
-			"provider.spf.neutral",
-			"provider.spf.error",
-			"provider.spf.fail",
-			"provider.spf.pass",
-
-			"provider.dkim.signed",
-			"provider.dkim.checked",
-			"provider.dkim.missing",
-			"provider.dkim.neutral",
-			"provider.dkim.error",
-			"provider.dkim.fail",
-			"provider.dkim.pass",
-
-			// Objects
-			"objects.meta.total",
-			"objects.meta.expired",
-			"objects.sessions.total",
-			"objects.sessions.expired",
-
-			// Patterns
-			"objects.patterns.checked",
-			"objects.patterns.error",
-			"objects.patterns.fail",
-			"objects.patterns.pass",
-
-			// Web Applications
-			"web.register.blocked",
-
-			// TODO: Add stubs for derived statistics like uptime, CPU, memory and secure memory stats.
-			// system.pid
-			// system.time
-			// system.uptime
-			// system.load (1, 5, 15, or all?)
-			// system.cpu.total
-			// system.cpu.users
-			// system.cpu.system
-			// system.mem.peak
-			// system.mem.size
-			// system.mem.locked
-			// system.mem.resident
-			// system.mem.data
-			// system.mem.stack
-			// system.mem.executable
-			// system.mem.libraries
-			// system.mem.PTE? HWM?
-			// system.mem.swap
-			// system.heap.total
-			// system.heap.allocated
-			// system.heap.items
-			// system.secure.total
-			// system.secure.allocated
-			// system.secure.items
-			// system.handles.total
-			// system.handles.pipe
-			// system.handles.files
-			// system.handles.sockets
-			// network...
-		}
+	.ready = false,
+	.generation = 0,
+	.count = 0,
+	.buckets = 0,
+	.table = NULL,
+	.retired = NULL,
+	.shards = NULL
 };
 
+// The generation is compared with the interface generation before the counters are used, since the counters held by other threads
+// are freed when the interface is shutdown, and the pointer is only cleared for the thread which performed the shutdown.
+static __thread stats_shard_t *stats_local = NULL;
+static __thread uint64_t stats_local_generation = 0;
+
 // If the position of an entry changes, you must update all of the relevant switch statements.
-char *derived[] = {
+static char *derived[] = {
 
 	// System Statistics
 	"system.secure.total",
@@ -126,7 +179,20 @@ char *derived[] = {
 
 	// Error Statistics
 	"core.spool.errors",
-	"errors.total"
+	"errors.total",
+
+	// Queue Statistics
+	"core.queue.depth",
+	"core.queue.wait.p99",
+
+	// Handshake Statistics
+	"core.handshakes.depth",
+	"core.handshakes.wait.p99",
+	"core.handshakes.latency.p50",
+	"core.handshakes.latency.p99",
+
+	// Log Statistics
+	"log.dropped"
 };
 
 /**
@@ -178,11 +244,13 @@ uint64_t stats_sum_errors(void) {
 
 /**
  * @brief	Get the number of derived statistics that are tracked.
+ * @note	The accept counter of each listening socket is reported as a derived statistic, after the entries in the derived list, and
+ * 			the object and byte counts of each slab cache are reported after the accept counters.
  * @return	the number of derived statistics being maintained by magma.
  */
 uint64_t stats_derived_count(void) {
 
-	return sizeof(derived) / sizeof(char *);
+	return (sizeof(derived) / sizeof(char *)) + net_acceptors_count() + slab_stats_count();
 }
 
 /**
@@ -195,6 +263,12 @@ char * stats_derived_name(uint64_t position) {
 	if (position >= stats_derived_count()) {
 		return NULL;
 	}
+	else if (position >= (sizeof(derived) / sizeof(char *)) + net_acceptors_count()) {
+		return slab_stats_name(position - (sizeof(derived) / sizeof(char *)) - net_acceptors_count());
+	}
+	else if (position >= sizeof(derived) / sizeof(char *)) {
+		return net_acceptors_name(position - (sizeof(derived) / sizeof(char *)));
+	}
 
 	return derived[position];
 }
@@ -202,6 +276,7 @@ char * stats_derived_name(uint64_t position) {
 /**
  * @brief	Get the value of a derived statistic by index.
  * @see		mm_sec_stats()
+ * @see		slab_stats_value()
  * @param	position	the zero-based index of the derived statistic to be queried.
  * @return	0 on failure, or the value of the specified derived statistic on success.
  */
@@ -210,6 +285,16 @@ uint64_t stats_derived_value(uint64_t position) {
 	uint64_t result = 0;
 	size_t total, bytes, items;
 
+	// Slab cache object and byte counts.
+	if (position >= (sizeof(derived) / sizeof(char *)) + net_acceptors_count()) {
+		return slab_stats_value(position - (sizeof(derived) / sizeof(char *)) - net_acceptors_count());
+	}
+
+	// Listening socket accept counters.
+	else if (position >= sizeof(derived) / sizeof(char *)) {
+		return net_acceptors_value(position - (sizeof(derived) / sizeof(char *)));
+	}
+
 	switch (position) {
 
 	// Secure subsystem statistics
@@ -233,6 +318,33 @@ uint64_t stats_derived_value(uint64_t position) {
 		result = stats_sum_errors();
 		break;
 
+	// The worker queue depth, and the 99th percentile wait in microseconds.
+	case (5):
+		result = queue_depth();
+		break;
+	case (6):
+		result = queue_wait(99);
+		break;
+
+	// The handshake queue depth, the 99th percentile wait, and the median and 99th percentile handshake times, in microseconds.
+	case (7):
+		result = handshake_depth();
+		break;
+	case (8):
+		result = handshake_wait(99);
+		break;
+	case (9):
+		result = handshake_latency(50);
+		break;
+	case (10):
+		result = handshake_latency(99);
+		break;
+
+	// The number of log messages dropped because a log buffer was full.
+	case (11):
+		result = log_dropped();
+		break;
+
 	default:
 		log_pedantic("We don't know how to calculate the derived value requested! {position = %lu}", position);
 		break;
@@ -241,22 +353,31 @@ uint64_t stats_derived_value(uint64_t position) {
 	return result;
 }
 
-// LOW: There should be some index validation for functions that reference statistics by index.
-
 /**
- * @brief	Get the index of a statistic by name.
+ * @brief	Get the index of a statistic by name, using the table of interned names.
  * @param	name	the name of the statistic to be queried.
  * @return	0 on failure, or the zero-based index of the requested statistic on success.
  */
 uint64_t stats_get_name_pos(char *name) {
 
-	bool_t match = false;
+	size_t length;
+	uint32_t bucket, position;
+
+	if (!stats.table || !name) {
+		return 0;
+	}
+
+	length = ns_length_get(name);
+	bucket = hash_murmur32(name, length) & (stats.buckets - 1);
+
+	// The table is never changed after the interface is initialized, so it can be searched without holding a lock.
+	while ((position = stats.table[bucket])) {
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		mutex_lock(&stats.locks[i][0]);
-		match = !st_cmp_cs_eq(NULLER(name), NULLER(stats.names[i]));
-		mutex_unlock(&stats.locks[i][0]);
-		if (match) return i;
+		if (!st_cmp_cs_eq(PLACER(name, length), NULLER(tracked[position]))) {
+			return position;
+		}
+
+		bucket = (bucket + 1) & (stats.buckets - 1);
 	}
 
 	log_info("Could not find the statistic requested. {name = %s}", name);
@@ -264,6 +385,25 @@ uint64_t stats_get_name_pos(char *name) {
 	return 0;
 }
 
+/**
+ * @brief	Get the index of a statistic by name, and keep it, so later calls don't need to search the table of interned names.
+ * @note	The index of a name never changes, even if the interface is shutdown and initialized again, so a call site can keep the index
+ * 			in a static variable. If the name can't be found, the cache is left empty, and the search is repeated by the next call.
+ * @param	cache	a pointer to the variable holding the index, which should be 0 until the first call.
+ * @param	name	the name of the statistic to be queried.
+ * @return	0 on failure, or the zero-based index of the requested statistic on success.
+ */
+uint64_t stats_intern(uint64_t *cache, char *name) {
+
+	uint64_t position;
+
+	if (!(position = __atomic_load_n(cache, __ATOMIC_RELAXED)) && (position = stats_get_name_pos(name))) {
+		__atomic_store_n(cache, position, __ATOMIC_RELAXED);
+	}
+
+	return position;
+}
+
 /**
  * @brief	Get the name of a statistic by its index.
  * @param	position	the zero-based index of the statistic to be queried.
@@ -271,13 +411,118 @@ uint64_t stats_get_name_pos(char *name) {
  */
 char * stats_get_name(uint64_t position) {
 
-	char *name;
+	if (position >= stats.count) {
+		return NULL;
+	}
+
+	return tracked[position];
+}
+
+/**
+ * @brief	Get the calling thread's block of counters, allocating and registering it if necessary.
+ * @return	NULL on failure, or a pointer to the calling thread's counters.
+ */
+static stats_shard_t * stats_shard(void) {
+
+	size_t length;
+	stats_shard_t *shard;
+
+	if (!__atomic_load_n(&(stats.ready), __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	else if (stats_local && stats_local_generation == __atomic_load_n(&(stats.generation), __ATOMIC_RELAXED)) {
+		return stats_local;
+	}
+
+	// Round the counters up to a whole number of cache lines, and leave a spare line at the end, so no other allocation shares them.
+	length = sizeof(stats_shard_t) + ((((stats.count * sizeof(uint64_t)) / MAGMA_CACHE_LINE_SIZE) + 2) * MAGMA_CACHE_LINE_SIZE);
+
+	if (!(shard = mm_alloc(length))) {
+		log_pedantic("Unable to allocate the thread local statistics counters.");
+		return NULL;
+	}
+
+	mutex_lock(&(stats.lock));
+	shard->next = stats.shards;
+	stats.shards = shard;
+	mutex_unlock(&(stats.lock));
+
+	tkey_set(stats.key, shard);
+	stats_local_generation = __atomic_load_n(&(stats.generation), __ATOMIC_RELAXED);
+
+	return (stats_local = shard);
+}
+
+/**
+ * @brief	Fold the counters of an exiting thread into the retired totals, and release them.
+ * @param	data	the thread's block of counters.
+ * @return	This function returns no value.
+ */
+static void stats_shard_destroy(void *data) {
+
+	stats_shard_t *shard = data, **chain;
+
+	if (!shard) {
+		return;
+	}
+
+	mutex_lock(&(stats.lock));
+
+	for (chain = &(stats.shards); *chain && *chain != shard; chain = &((*chain)->next));
+
+	if (*chain) {
 
-	mutex_lock(&stats.locks[position][0]);
-	name = stats.names[position];
-	mutex_unlock(&stats.locks[position][0]);
+		*chain = shard->next;
 
-	return name;
+		for (uint64_t i = 0; i < stats.count; i++) {
+			stats.retired[i] += __atomic_load_n(&(shard->values[i]), __ATOMIC_RELAXED);
+		}
+	}
+
+	mutex_unlock(&(stats.lock));
+
+	mm_free(shard);
+	stats_local = NULL;
+
+	return;
+}
+
+/**
+ * @brief	Add a value to one of the calling thread's counters.
+ * @note	Only the owning thread writes to its counters, so the update doesn't need a locked instruction. The atomic load and store
+ * 			only ensure a reader summing the counters never sees a torn value.
+ * @param	position	the zero-based index of the statistic to be updated.
+ * @param	value		the amount to be added, which will wrap around for negative adjustments.
+ * @return	This function returns no value.
+ */
+static void stats_shard_add(uint64_t position, uint64_t value) {
+
+	stats_shard_t *shard;
+
+	if (!position || position >= stats.count || !(shard = stats_shard())) {
+		return;
+	}
+
+	__atomic_store_n(&(shard->values[position]), __atomic_load_n(&(shard->values[position]), __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+
+	return;
+}
+
+/**
+ * @brief	Sum the retired total and the counters of every live thread for a statistic.
+ * @note	The caller must hold the statistics lock.
+ * @param	position	the zero-based index of the statistic to be summed.
+ * @return	the current value of the statistic.
+ */
+static uint64_t stats_shard_sum(uint64_t position) {
+
+	uint64_t value = stats.retired[position];
+
+	for (stats_shard_t *shard = stats.shards; shard; shard = shard->next) {
+		value += __atomic_load_n(&(shard->values[position]), __ATOMIC_RELAXED);
+	}
+
+	return value;
 }
 
 /**
@@ -294,23 +539,26 @@ void stats_set_by_name(char *name, uint64_t value) {
 		return;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] = value;
-	mutex_unlock(&stats.locks[position][1]);
+	stats_set_by_num(position, value);
 	return;
 }
 
 /**
  * @brief	Provided a statistic by index, set its value.
+ * @note	The thread counters are left alone, and the retired total is adjusted so the counters sum to the new value.
  * @param	position	the zero-based index of the statistic to be set.
  * @param	value		the new value of the specified statistic.
  * @return	This function returns no value.
  */
 void stats_set_by_num(uint64_t position, uint64_t value) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] = value;
-	mutex_unlock(&stats.locks[position][1]);
+	if (!position || position >= stats.count || !stats.retired) {
+		return;
+	}
+
+	mutex_lock(&(stats.lock));
+	stats.retired[position] += value - stats_shard_sum(position);
+	mutex_unlock(&(stats.lock));
 
 	return;
 }
@@ -322,17 +570,13 @@ void stats_set_by_num(uint64_t position, uint64_t value) {
  */
 uint64_t stats_get_value_by_name(char *name) {
 
-	uint64_t position, value;
+	uint64_t position;
 
 	if (!(position = stats_get_name_pos(name))) {
 			return 0;
 	}
 
-	mutex_lock(&stats.locks[position][1]);
-	value = stats.values[position];
-	mutex_unlock(&stats.locks[position][1]);
-
-	return value;
+	return stats_get_value_by_num(position);
 }
 
 /**
@@ -344,9 +588,13 @@ uint64_t stats_get_value_by_num(uint64_t position) {
 
 	uint64_t value;
 
-	mutex_lock(&stats.locks[position][1]);
-	value = stats.values[position];
-	mutex_unlock(&stats.locks[position][1]);
+	if (position >= stats.count || !stats.retired) {
+		return 0;
+	}
+
+	mutex_lock(&(stats.lock));
+	value = stats_shard_sum(position);
+	mutex_unlock(&(stats.lock));
 
 	return value;
 }
@@ -359,16 +607,7 @@ uint64_t stats_get_value_by_num(uint64_t position) {
  */
 void stats_adjust_by_name(char *name, int32_t value) {
 
-	uint64_t position;
-
-	if (!(position = stats_get_name_pos(name))) {
-		return;
-	}
-
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] += value;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(stats_get_name_pos(name), (uint64_t)((int64_t)value));
 	return;
 }
 
@@ -380,10 +619,7 @@ void stats_adjust_by_name(char *name, int32_t value) {
  */
 void stats_adjust_by_num(uint64_t position, int32_t value) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position] += value;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(position, (uint64_t)((int64_t)value));
 	return;
 }
 
@@ -394,16 +630,7 @@ void stats_adjust_by_num(uint64_t position, int32_t value) {
  */
 void stats_increment_by_name(char *name) {
 
-	uint64_t position;
-
-	if (!(position = stats_get_name_pos(name))) {
-		return;
-	}
-
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]++;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(stats_get_name_pos(name), 1);
 	return;
 }
 
@@ -414,10 +641,7 @@ void stats_increment_by_name(char *name) {
  */
 void stats_increment_by_num(uint64_t position) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]++;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(position, 1);
 	return;
 }
 
@@ -428,16 +652,7 @@ void stats_increment_by_num(uint64_t position) {
  */
 void stats_decrement_by_name(char *name) {
 
-	uint64_t position;
-
-	if (!(position = stats_get_name_pos(name))) {
-		return;
-	}
-
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]--;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(stats_get_name_pos(name), UINT64_MAX);
 	return;
 }
 
@@ -448,10 +663,7 @@ void stats_decrement_by_name(char *name) {
  */
 void stats_decrement_by_num(uint64_t position) {
 
-	mutex_lock(&stats.locks[position][1]);
-	stats.values[position]--;
-	mutex_unlock(&stats.locks[position][1]);
-
+	stats_shard_add(position, UINT64_MAX);
 	return;
 }
 
@@ -465,38 +677,80 @@ uint64_t stats_get_count(void) {
 }
 
 /**
- * @brief	Initialize and reset all statistics counters.
+ * @brief	Initialize and reset all statistics counters, and intern the statistic names.
  * @return	false on failure or true on success.
  */
 bool_t stats_init(void) {
 
-	mm_wipe(stats.locks, sizeof(stats.locks));
-	mm_wipe(stats.values, sizeof(stats.values));
+	uint32_t bucket;
+
+	stats.count = sizeof(tracked) / sizeof(char *);
+
+	// Size the table to a power of two, which is at least twice the number of names, so the probe sequences stay short.
+	for (stats.buckets = 16; stats.buckets < stats.count * 2; stats.buckets <<= 1);
 
-	for (uint64_t i = 0; i < sizeof(stats.names) / sizeof(char *); i++) {
-		if (stats.names[i]) stats.count++;
+	if (!(stats.table = mm_alloc(stats.buckets * sizeof(uint32_t))) || !(stats.retired = mm_alloc(stats.count * sizeof(uint64_t)))) {
+		log_critical("Could not allocate the statistics tables.");
+		mm_cleanup(stats.table);
+		stats.table = NULL;
+		return false;
 	}
+	else if (mutex_init(&(stats.lock), NULL) || tkey_init(&(stats.key), &stats_shard_destroy)) {
+		log_critical("Could not initialize the statistic locks.");
+		return false;
+	}
+
+	// The default entry holds position zero, which doubles as the empty bucket marker, so it is never interned.
+	for (uint32_t i = 1; i < stats.count; i++) {
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		if (mutex_init(&stats.locks[i][0], NULL) || mutex_init(&stats.locks[i][1], NULL)) {
-			log_critical("Could not initialize the statistic locks.");
-			return false;
+		bucket = hash_murmur32(tracked[i], ns_length_get(tracked[i])) & (stats.buckets - 1);
+
+		while (stats.table[bucket]) {
+			bucket = (bucket + 1) & (stats.buckets - 1);
 		}
+
+		stats.table[bucket] = i;
 	}
 
+	// Any counters a thread kept from a previous initialization were freed by the shutdown, so advancing the generation retires them.
+	__atomic_add_fetch(&(stats.generation), 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&(stats.ready), true, __ATOMIC_RELEASE);
+
 	return true;
 }
 
 /**
- * @brief	Destroy all statistics locks.
+ * @brief	Release the statistics counters and destroy the statistics locks.
+ * @note	Threads which are still running keep a pointer to their freed counters. The pointer is never followed while the interface is
+ * 			shutdown, and it's replaced if the interface is initialized again, since the generation will no longer match.
  * @return	This function returns no value.
  */
 void stats_shutdown(void) {
 
-	for (uint64_t i = 0; i < stats.count; i++) {
-		mutex_destroy(&stats.locks[i][0]);
-		mutex_destroy(&stats.locks[i][1]);
+	stats_shard_t *shard;
+
+	if (!__atomic_exchange_n(&(stats.ready), false, __ATOMIC_ACQ_REL)) {
+		return;
 	}
 
+	// Deleting the key first ensures the thread exit destructor won't touch the counters after they're freed.
+	pthread_key_delete(stats.key);
+
+	mutex_lock(&(stats.lock));
+
+	while ((shard = stats.shards)) {
+		stats.shards = shard->next;
+		mm_free(shard);
+	}
+
+	mutex_unlock(&(stats.lock));
+	mutex_destroy(&(stats.lock));
+
+	mm_cleanup(stats.table);
+	mm_cleanup(stats.retired);
+	stats.table = NULL;
+	stats.retired = NULL;
+	stats_local = NULL;
+
 	return;
 }
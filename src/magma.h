@@ -36,6 +36,7 @@
 #include <sys/utsname.h>
 #include <sys/prctl.h>
 #include <sys/epoll.h>
+#include <poll.h>
 #include <sys/sysctl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -24,6 +24,80 @@ int_t con_secure(connection_t *con) {
 	return -1;
 }
 
+/**
+ * @brief	Hand the encryption of a TLS connection's output to the kernel, if the kernel and the negotiated cipher suite support it.
+ * @note	This function should be called as soon as the TLS handshake finishes. Connections which can't be offloaded continue
+ * 			writing through the OpenSSL record layer.
+ * @param	con		the connection which just completed a TLS handshake.
+ * @return	true if the connection output will be written directly to the socket, otherwise false.
+ */
+bool_t con_offload(connection_t *con) {
+
+	if (!con || !con->network.tls || con->network.offloaded || !magma.iface.cryptography.tls_offload) {
+		return false;
+	}
+	else if (!tls_offload(con->network.tls)) {
+		return false;
+	}
+
+	con->network.offloaded = true;
+	stats_increment_by_name("network.tls.offloaded.total");
+	stats_increment_by_name("network.tls.offloaded.active");
+
+	return true;
+}
+
+/**
+ * @brief	Get the worker queue priority class used for the work performed on behalf of a connection.
+ * @note	Mail relayed by other servers is handled as delivery work, while connections with a user waiting on a response, which includes
+ * 			message submission, are handled as interactive work.
+ * @param	con		the connection being queued.
+ * @return	QUEUE_DELIVERY for SMTP and DMTP connections, otherwise QUEUE_INTERACTIVE.
+ */
+queue_priority_t con_priority(connection_t *con) {
+
+	if (con && con->server && (con->server->protocol == SMTP || con->server->protocol == DMTP)) {
+		return QUEUE_DELIVERY;
+	}
+
+	return QUEUE_INTERACTIVE;
+}
+
+/**
+ * @brief	Hand a connection to the handshake pool, so the TLS handshake doesn't tie up a worker thread.
+ * @note	Once the handshake finishes, the function is enqueued on the worker queue. If the handshake failed, the connection's TLS
+ * 			object will still be NULL, and the function is responsible for reporting the failure.
+ * @param	con			the connection which should be secured.
+ * @param	function	the function to be enqueued once the handshake finishes.
+ * @return	This function returns no value.
+ */
+void con_secure_enqueue(connection_t *con, void *function) {
+
+	con->network.secured = function;
+	handshake_enqueue(&con_secure_handshake, con);
+
+	return;
+}
+
+/**
+ * @brief	Perform the server side of a TLS handshake, and then hand the connection back to the worker queue.
+ * @note	This function is executed by the handshake pool.
+ * @see		con_secure_enqueue()
+ * @param	con		the connection which should be secured.
+ * @return	This function returns no value.
+ */
+void con_secure_handshake(connection_t *con) {
+
+	// The handshake deadline is much shorter than the network timeout, so a few idle clients can't tie up the handshake pool.
+	if ((con->network.tls = tls_server_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE, magma.system.handshake_timeout))) {
+		con_offload(con);
+	}
+
+	enqueue_priority(con_priority(con), con->network.secured, con);
+
+	return;
+}
+
 /**
  * @brief	Determine whether a client connection is from the same machine, using the loopback adapter, or a remote machine.
  * @see		ip_localhost()
@@ -90,6 +164,9 @@ void con_destroy(connection_t *con) {
 
 	if (con && !con_decrement_refs(con)) {
 
+		// Send anything still sitting in the output buffer, like a farewell message, before the connection is closed.
+		con_flush(con);
+
 		switch (con->server->protocol) {
 			case (POP):
 
@@ -156,13 +233,18 @@ void con_destroy(connection_t *con) {
 			tls_free(con->network.tls);
 		}
 
+		if (con->network.offloaded) {
+			stats_decrement_by_name("network.tls.offloaded.active");
+		}
+
 		if (con->network.sockd != -1) {
 			close(con->network.sockd);
 		}
 
-		st_cleanup(con->network.buffer);
+		st_cleanup(con->network.buffer, con->network.output);
 		mm_cleanup(con->network.reverse.ip);
 		st_cleanup(con->network.reverse.domain);
+		arena_free(con->arena);
 		mutex_destroy(&(con->lock));
 		mm_free(con);
 	}
@@ -0,0 +1,328 @@
+
+/**
+ * @file /magma/network/events.c
+ *
+ * @brief	An edge triggered event loop used to park idle client connections until they have input waiting, so they don't tie up a worker thread.
+ */
+
+#include "magma.h"
+
+struct {
+	int ed;
+	pthread_t *thread;
+	pthread_mutex_t lock;
+	inx_t *parked;
+} events = {
+		.ed = -1,
+		.thread = NULL,
+		.parked = NULL
+};
+
+/**
+ * @brief	Hand a parked connection back to the worker pool, and let the protocol handler deal with whatever it finds.
+ * @param	con		the connection to be dispatched.
+ * @return	This function returns no value.
+ */
+void net_events_dispatch(connection_t *con) {
+
+	void *function = con->network.events.function;
+
+	// Once the connection has been removed from the parked index, its idle timer is no longer needed.
+	timer_cancel(&(con->network.events.timer));
+
+	con->network.events.function = NULL;
+	con->network.events.expiration = 0;
+	enqueue_priority(con_priority(con), function, con);
+
+	return;
+}
+
+/**
+ * @brief	Wait for a connection to have input available, and then enqueue the specified protocol handler.
+ * @note	If the connection already has a complete line waiting, or the event loop isn't running, the handler is enqueued immediately.
+ * 			Otherwise the connection is added to the epoll descriptor using edge triggered, one shot notifications, so only a single
+ * 			worker will ever be handed the connection.
+ * @param	con			the connection which needs more input.
+ * @param	function	the protocol function to be called once input is available.
+ * @return	This function returns no value.
+ */
+void con_events_wait(connection_t *con, void *function) {
+
+	uint32_t delay;
+	struct epoll_event event;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (uint64_t)con->network.sockd };
+
+	// A protocol violation penalty is served by the timer wheel, instead of a sleeping worker, and the response is held until it ends.
+	if ((delay = con->protocol.delay) && status()) {
+		con->protocol.delay = 0;
+		con->network.events.function = function;
+		timer_enqueue(delay / 1000, &net_events_resume, con);
+		return;
+	}
+
+	// The command is finished, so send the response before waiting for the next one.
+	con_flush(con);
+
+	// We can't wait on a connection unless the event loop is running, and the connection is still viable.
+	if (events.ed == -1 || !status() || con_read_ready(con) != 0) {
+		timer_cancel(&(con->network.events.timer));
+		enqueue_priority(con_priority(con), function, con);
+		return;
+	}
+
+	con->network.events.function = function;
+	con->network.events.expiration = time(NULL) + (con->server ? con->server->network.timeout : 0);
+
+	// The output buffer has been flushed, and is released now, since another worker may pick the connection up once it's registered.
+	con_release(con);
+
+	mm_wipe(&event, sizeof(struct epoll_event));
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+	event.data.fd = con->network.sockd;
+
+	mutex_lock(&events.lock);
+
+	if (!inx_insert(events.parked, key, con)) {
+		mutex_unlock(&events.lock);
+		log_pedantic("Unable to park the connection. { sockd = %i }", con->network.sockd);
+		net_events_dispatch(con);
+		return;
+	}
+
+	// The descriptor may still be registered from a previous wait, so we try to rearm it before adding it.
+	else if (epoll_ctl(events.ed, EPOLL_CTL_MOD, con->network.sockd, &event) && (errno != ENOENT ||
+		epoll_ctl(events.ed, EPOLL_CTL_ADD, con->network.sockd, &event))) {
+		log_pedantic("The epoll_ctl() call returned an error. { sockd = %i / error = %s }", con->network.sockd, strerror_r(errno, bufptr, buflen));
+		inx_delete(events.parked, key);
+		mutex_unlock(&events.lock);
+		net_events_dispatch(con);
+		return;
+	}
+
+	// The idle timer is armed while the lock is held, so the connection can't be dispatched, and the timer cancelled, before it's armed.
+	timer_schedule(&(con->network.events.timer), (uint64_t)(con->server ? con->server->network.timeout : 0) * 1000, &net_events_expire,
+		(void *)(uintptr_t)con->network.sockd);
+
+	mutex_unlock(&events.lock);
+
+	return;
+}
+
+/**
+ * @brief	Resume waiting on a connection once its protocol violation penalty has been served.
+ * @param	con		the connection which was penalized.
+ * @return	This function returns no value.
+ */
+void net_events_resume(connection_t *con) {
+
+	void *function = con->network.events.function;
+
+	con->network.events.function = NULL;
+	con_events_wait(con, function);
+
+	return;
+}
+
+/**
+ * @brief	Dispatch a parked connection before it has any input, so the protocol handler can deliver an update.
+ * @note	Only the thread which removes the connection from the parked index is allowed to dispatch it, so if the event loop got to the
+ * 			connection first, or it isn't parked, nothing happens.
+ * @param	con		the connection to be woken.
+ * @return	true if the connection was dispatched, or false if it wasn't parked.
+ */
+bool_t con_events_wake(connection_t *con) {
+
+	bool_t found = false;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (uint64_t)con->network.sockd };
+
+	mutex_lock(&events.lock);
+
+	if (events.ed != -1 && inx_find(events.parked, key) == con && (found = inx_delete(events.parked, key))) {
+		epoll_ctl(events.ed, EPOLL_CTL_DEL, con->network.sockd, NULL);
+	}
+
+	mutex_unlock(&events.lock);
+
+	if (found) {
+		net_events_dispatch(con);
+	}
+
+	return found;
+}
+
+/**
+ * @brief	Dispatch a parked connection whose idle timer fired, so the protocol handler can close it.
+ * @note	The timer only carries the socket descriptor, since the connection may have been dispatched, and freed, while the timer was
+ * 			waiting in the worker queue. If the descriptor was reused by a connection which was parked afterwards, its own expiration is
+ * 			honored, and the timer is rescheduled. The connection status is set to -1, so the protocol handler will close the connection.
+ * @param	data	the socket descriptor of the connection, cast to a pointer.
+ * @return	This function returns no value.
+ */
+void net_events_expire(void *data) {
+
+	time_t now;
+	bool_t found = false;
+	connection_t *con = NULL;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (uint64_t)(uintptr_t)data };
+
+	mutex_lock(&events.lock);
+
+	if (events.ed != -1 && events.parked && (con = inx_find(events.parked, key))) {
+
+		if (con->network.events.expiration > (now = time(NULL))) {
+			timer_schedule(&(con->network.events.timer), (uint64_t)(con->network.events.expiration - now) * 1000, &net_events_expire, data);
+		}
+		else if ((found = inx_delete(events.parked, key))) {
+			epoll_ctl(events.ed, EPOLL_CTL_DEL, con->network.sockd, NULL);
+		}
+	}
+
+	mutex_unlock(&events.lock);
+
+	if (found) {
+		con->network.status = -1;
+		net_events_dispatch(con);
+	}
+
+	return;
+}
+
+/**
+ * @brief	The event loop thread; waits for parked connections to become readable and hands them back to the worker pool.
+ * @note	Events only carry the socket descriptor, since a connection may be woken, or expired, and then freed, after its event was
+ * 			queued. The connection is looked up in the parked index, and it's only touched if it's still there. If the descriptor was
+ * 			reused by a connection which was parked afterwards, it's dispatched only if it really has input, and otherwise rearmed.
+ * @return	This function returns no value.
+ */
+void net_events_loop(void) {
+
+	int count;
+	connection_t *con;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+	struct epoll_event ready[MAGMA_EVENTS_BATCH];
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	while (status()) {
+
+		if ((count = epoll_wait(events.ed, ready, MAGMA_EVENTS_BATCH, 1000)) == -1 && errno != EINTR) {
+			log_pedantic("The epoll_wait() call returned an error. { error = %s }", strerror_r(errno, bufptr, buflen));
+		}
+
+		for (int i = 0; i < count; i++) {
+
+			key.val.u64 = (uint64_t)ready[i].data.fd;
+
+			// Only the thread which removes the connection from the parked index is allowed to dispatch it.
+			mutex_lock(&events.lock);
+
+			if ((con = inx_find(events.parked, key)) && !inx_delete(events.parked, key)) {
+				con = NULL;
+			}
+
+			mutex_unlock(&events.lock);
+
+			if (!con) {
+				continue;
+			}
+
+			// A hangup or error is also caught by the read, and handed to the protocol handler, which will notice the failure. The
+			// event flags aren't trusted, since they may belong to an earlier connection which used the same descriptor.
+			else if (con_read_ready(con) != 0) {
+				net_events_dispatch(con);
+			}
+
+			// A partial line was read, so the connection goes back to waiting for the rest of it.
+			else {
+				con_events_wait(con, con->network.events.function);
+			}
+		}
+	}
+
+	thread_stop();
+	pthread_exit(NULL);
+
+	return;
+}
+
+/**
+ * @brief	Create the epoll descriptor and launch the event loop thread.
+ * @return	true on success, or false on failure.
+ */
+bool_t net_events_start(void) {
+
+	if (mutex_init(&events.lock, NULL)) {
+		return false;
+	}
+
+	else if (!(events.parked = inx_alloc(M_INX_HASHED | M_INX_LOCK_MANUAL, NULL))) {
+		mutex_destroy(&events.lock);
+		return false;
+	}
+
+	else if ((events.ed = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		log_critical("The epoll_create1() call returned an error. { error = %s }", strerror_r(errno, bufptr, buflen));
+		inx_cleanup(events.parked);
+		mutex_destroy(&events.lock);
+		events.parked = NULL;
+		return false;
+	}
+
+	else if (!(events.thread = thread_alloc(net_events_loop, NULL))) {
+		log_critical("Unable to launch the network event loop thread.");
+		close(events.ed);
+		inx_cleanup(events.parked);
+		mutex_destroy(&events.lock);
+		events.parked = NULL;
+		events.ed = -1;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the event loop thread, and hand any connections still parked back to the worker pool so they can be closed.
+ * @note	This must be called before the worker pool is shutdown, since the parked connections are dispatched as regular work.
+ * @return	This function returns no value.
+ */
+void net_events_stop(void) {
+
+	int ed = events.ed;
+	connection_t *con;
+	inx_cursor_t *cursor;
+
+	if (events.thread) {
+		thread_join(*events.thread);
+		mm_free(events.thread);
+		events.thread = NULL;
+	}
+
+	// Once the descriptor is invalidated, any calls to con_events_wait() will enqueue the handler directly.
+	mutex_lock(&events.lock);
+	events.ed = -1;
+
+	if (events.parked && (cursor = inx_cursor_alloc(events.parked))) {
+
+		while ((con = inx_cursor_value_next(cursor))) {
+			net_events_dispatch(con);
+		}
+
+		inx_cursor_free(cursor);
+	}
+
+	inx_cleanup(events.parked);
+	events.parked = NULL;
+	mutex_unlock(&events.lock);
+
+	if (ed != -1) {
+		close(ed);
+	}
+
+	mutex_destroy(&events.lock);
+
+	return;
+}
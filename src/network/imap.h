@@ -22,11 +22,13 @@ typedef struct {
 
 typedef struct {
 	stringer_t *key, *value;
+	bool_t arena; /* Whether the node was allocated from the connection arena, which reclaims it when the arena is reset. */
 	struct imap_fetch_response_t *next;
 } imap_fetch_response_t;
 
 typedef struct __attribute__ ((packed)) {
 	meta_user_t *user;
+	notify_subscriber_t *idle;
 	imap_arguments_t *arguments;
 	stringer_t *tag, *command, *username;
 	int_t read_only, uid, session_state;
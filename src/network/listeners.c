@@ -7,16 +7,45 @@
 
 #include "magma.h"
 
-void net_accept(server_t *server) {
+typedef struct {
+	server_t *server;
+	uint32_t number;
+} net_acceptor_t;
 
+/**
+ * @brief	Accept connections on one of a server's listening sockets, and hand them to the protocol handler.
+ * @note	When a server has more than one acceptor, the thread is pinned to a processor core, so the kernel's SO_REUSEPORT load
+ * 			balancing spreads the accept work across the cores.
+ * @param	acceptor	the server instance, and the position of the listening socket this thread is responsible for.
+ * @return	This function returns no value.
+ */
+void net_accept(net_acceptor_t *acceptor) {
+
+	cpu_set_t cores;
 	int connection = 0;
+	long available;
+	server_t *server = acceptor->server;
+	uint32_t number = acceptor->number;
 
 	thread_start();
 
+	if (server->network.acceptors > 1 && (available = sysconf(_SC_NPROCESSORS_ONLN)) > 0) {
+
+		CPU_ZERO(&cores);
+		CPU_SET(number % available, &cores);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cores)) {
+			log_pedantic("Unable to pin the accept thread to a processor core. { port = %u / acceptor = %u / core = %li }",
+				server->network.port, number, number % available);
+		}
+	}
+
 	do {
 
 		// Keep calling accept until it fails.
-		if ((connection = accept(server->network.sockd, NULL, NULL)) != -1) {
+		if ((connection = accept(server->acceptors[number].sockd, NULL, NULL)) != -1) {
+			__atomic_store_n(&(server->acceptors[number].accepted), __atomic_load_n(&(server->acceptors[number].accepted), __ATOMIC_RELAXED) + 1,
+				__ATOMIC_RELAXED);
 			protocol_process(server, connection);
 		}
 
@@ -29,30 +58,134 @@ void net_accept(server_t *server) {
 
 void net_listen(void) {
 
+	uint64_t count = 0;
 	server_t *server = NULL;
-	pthread_t *threads[MAGMA_SERVER_INSTANCES];
+	pthread_t **threads = NULL;
+	net_acceptor_t *acceptors = NULL;
 
-	mm_wipe(threads, sizeof(threads));
-
-	// Loop through and launch listener threads for all of the server sockets.
 	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
-		if ((server = magma.servers[i]) && server->enabled && server->network.sockd) {
-			threads[i] = thread_alloc(net_accept, server);
+		if ((server = magma.servers[i]) && server->enabled && server->network.sockd != -1) {
+			count += server->network.acceptors;
 		}
 	}
 
-	// Loop through again and wait for the listener threads to exit.
+	if (!count) {
+		return;
+	}
+	else if (!(threads = mm_alloc(sizeof(pthread_t *) * count)) || !(acceptors = mm_alloc(sizeof(net_acceptor_t) * count))) {
+		log_critical("Unable to allocate the accept thread table.");
+		mm_cleanup(threads);
+		return;
+	}
+
+	count = 0;
+
+	// Loop through and launch an accept thread for each of the listening sockets, on every server.
 	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
-		if ((server = magma.servers[i]) && server->enabled && server->network.sockd && threads[i] != NULL) {
+		for (uint32_t j = 0; (server = magma.servers[i]) && server->enabled && server->network.sockd != -1 && j < server->network.acceptors; j++) {
+			acceptors[count].server = server;
+			acceptors[count].number = j;
+			threads[count] = thread_alloc(net_accept, &(acceptors[count]));
+			count++;
+		}
+	}
+
+	// Loop through again and wait for the accept threads to exit.
+	for (uint64_t i = 0; i < count; i++) {
+		if (threads[i]) {
 			thread_join(*threads[i]);
 			mm_free(threads[i]);
 		}
 	}
 
+	mm_free(acceptors);
+	mm_free(threads);
+
 	return;
 }
 
-bool_t net_init(server_t *server) {
+/**
+ * @brief	Get the number of accept counters reported through the statistics interface.
+ * @return	the total number of listening sockets, across all of the running servers.
+ */
+uint64_t net_acceptors_count(void) {
+
+	uint64_t count = 0;
+
+	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
+		if (magma.servers[i] && magma.servers[i]->enabled && magma.servers[i]->network.sockd != -1) {
+			count += magma.servers[i]->network.acceptors;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Find a listening socket using its position in the statistics interface.
+ * @param	position	the zero-based position of the listening socket, counting across all of the running servers.
+ * @param	server		a pointer to receive the server instance which owns the socket.
+ * @return	-1 on failure, or the number of the socket within its server.
+ */
+static int64_t net_acceptors_find(uint64_t position, server_t **server) {
+
+	for (uint64_t i = 0; i < MAGMA_SERVER_INSTANCES; i++) {
+
+		if (!magma.servers[i] || !magma.servers[i]->enabled || magma.servers[i]->network.sockd == -1) {
+			continue;
+		}
+		else if (position < magma.servers[i]->network.acceptors) {
+			*server = magma.servers[i];
+			return position;
+		}
+
+		position -= magma.servers[i]->network.acceptors;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief	Get the statistic name of a listening socket's accept counter.
+ * @param	position	the zero-based position of the listening socket, counting across all of the running servers.
+ * @return	NULL on failure, or a pointer to a null-terminated string containing the name of the counter.
+ */
+char * net_acceptors_name(uint64_t position) {
+
+	int64_t number;
+	server_t *server;
+
+	if ((number = net_acceptors_find(position, &server)) < 0) {
+		return NULL;
+	}
+
+	return server->acceptors[number].name;
+}
+
+/**
+ * @brief	Get the number of connections accepted by a listening socket.
+ * @param	position	the zero-based position of the listening socket, counting across all of the running servers.
+ * @return	the number of connections accepted by the socket.
+ */
+uint64_t net_acceptors_value(uint64_t position) {
+
+	int64_t number;
+	server_t *server;
+
+	if ((number = net_acceptors_find(position, &server)) < 0) {
+		return 0;
+	}
+
+	return __atomic_load_n(&(server->acceptors[number].accepted), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	Create, bind, and listen on a single socket for a server.
+ * @param	server		the server instance.
+ * @param	shared		if true, the socket is bound with SO_REUSEPORT so several sockets can share the same port.
+ * @return	-1 on failure, or the socket descriptor.
+ */
+static int net_init_socket(server_t *server, bool_t shared) {
 
 	int sd;
 	struct sockaddr_in sin4;
@@ -61,7 +194,7 @@ bool_t net_init(server_t *server) {
 	// Create the socket.
 	if ((sd = socket(server->network.ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0)) == -1) {
 		log_critical("Error while calling socket.");
-		return false;
+		return -1;
 	}
 
 	// Set non-blocking IO.
@@ -73,12 +206,21 @@ bool_t net_init(server_t *server) {
 	// Make this a reusable socket.
 	if (!net_set_reuseable_address(sd, true)) {
 		log_critical("Could not make the socket reusable.");
-		return false;
+		close(sd);
+		return -1;
+	}
+
+	// Let the other acceptors for this server bind to the same port.
+	if (shared && !net_set_reuseable_port(sd, true)) {
+		log_critical("Could not allow the socket to share its port. Attempting to use port %u.", server->network.port);
+		close(sd);
+		return -1;
 	}
 
 	if (!net_set_buffer_length(sd, magma.system.network_buffer, magma.system.network_buffer)) {
 		log_critical("Could not configure the socket buffer size.");
-		return false;
+		close(sd);
+		return -1;
 	}
 
 	// Zero out the server socket structure, and set the values.
@@ -91,7 +233,8 @@ bool_t net_init(server_t *server) {
 		// Bind the socket.
 		if (bind(sd, (struct sockaddr *)&sin6, sizeof(sin6)) == -1) {
 			log_critical("Error while binding to socket. Attempting to use port %u.", server->network.port);
-			return false;
+			close(sd);
+			return -1;
 		}
 	}
 	else {
@@ -103,24 +246,47 @@ bool_t net_init(server_t *server) {
 		// Bind the socket.
 		if (bind(sd, (struct sockaddr *)&sin4, sizeof(sin4)) == -1) {
 			log_critical("Error while binding to socket. Attempting to use port %u.", server->network.port);
-			return false;
+			close(sd);
+			return -1;
 		}
 	}
 
 	// Start listening for incoming connections. We set the queue to our config file listen queue value.
 	if (listen(sd, server->network.listen_queue) == -1) {
 		log_critical("Error while listening to socket. Attempting to use port %u.", server->network.port);
-		return false;
+		close(sd);
+		return -1;
+	}
+
+	return sd;
+}
+
+/**
+ * @brief	Open the listening sockets for a server.
+ * @note	If more than one acceptor is configured, each socket is bound to the same port using SO_REUSEPORT, and the kernel spreads
+ * 			incoming connections across them.
+ * @param	server	a pointer to the server object to be initialized.
+ * @return	true on successful initialization of the server, or false on failure.
+ */
+bool_t net_init(server_t *server) {
+
+	for (uint32_t i = 0; i < server->network.acceptors; i++) {
+
+		if ((server->acceptors[i].sockd = net_init_socket(server, server->network.acceptors > 1)) == -1) {
+			net_shutdown(server);
+			return false;
+		}
+
+		server->acceptors[i].accepted = 0;
+		snprintf(server->acceptors[i].name, sizeof(server->acceptors[i].name), "network.acceptors.%u.%u.accepted", server->network.port, i);
 	}
 
 	// Store the socket descriptor elsewhere, so it can be shutdown later.
-	server->network.sockd = sd;
+	server->network.sockd = server->acceptors[0].sockd;
 
 	return true;
 }
 
-
-
 /**
  * @brief	The main network handler entry point; poll the listening socket of each configured protocol server, and dispatch the
  * 			protocol-specific handler for any inbound client connection that is accepted.
@@ -291,10 +457,18 @@ bool_t net_init(server_t *server) {
 //}
 
 /**
- * @brief	Close the listening socket associated with a server.
+ * @brief	Close the listening sockets associated with a server.
  * @return	This function returns no value.
  */
 void net_shutdown(server_t *server) {
-	close(server->network.sockd);
+
+	for (uint32_t i = 0; i < MAGMA_SERVER_ACCEPTORS; i++) {
+		if (server->acceptors[i].sockd != -1) {
+			close(server->acceptors[i].sockd);
+			server->acceptors[i].sockd = -1;
+		}
+	}
+
+	server->network.sockd = -1;
 	return;
 }
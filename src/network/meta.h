@@ -85,12 +85,43 @@ typedef struct {
 	uint64_t messagenum, foldernum, sequencenum, signum, sigkey, created;
 } meta_message_t;
 
+/***
+ * @struct meta_index_t
+ * @brief	A struct of arrays view of a user's messages, sorted by folder and then message number, so a folder is a contiguous slice which
+ * 			can be searched by UID in logarithmic time, and scanned without chasing list pointers. Once published, only the flags of an index
+ * 			are changed in place, so readers may keep using it while a newer index replaces it. The flags array is authoritative.
+ */
+typedef struct meta_index {
+	size_t count, capacity;
+	uint64_t highest; /* The highest message number in any folder. */
+	uint64_t *messagenums, *foldernums, *created;
+	uint32_t *flags, *sizes;
+	meta_message_t **messages; /* The message objects, for callers that need the complete record. */
+	struct meta_index *retired; /* Links replaced indexes which may still be in use, until the user is write locked. */
+} meta_index_t;
+
 typedef struct {
 	chr_t name[128]; // Even though we limit folder names to 16 characters, with modified UTF-7 escaping, the string could be longer.
 	uint32_t order;
 	uint64_t parent, foldernum;
 } meta_folder_t;
 
+/***
+ * @struct notify_subscriber_t
+ * @brief	A session waiting for changes to a user's mailbox, registered with the in-process notification table.
+ */
+typedef struct notify_subscriber {
+	uint64_t usernum; /* The user being watched. */
+	uint64_t foldernum; /* Flag changes are only recorded for messages in this folder. */
+	uint32_t pending; /* A mask of the object types which changed, using one bit per OBJECT_* value. */
+	bool_t overflow; /* Set when more messages had their flags changed than the changed array can hold. */
+	size_t count; /* The number of message numbers held in the changed array. */
+	uint64_t changed[MAGMA_NOTIFY_CHANGES]; /* The messages whose flags changed. */
+	bool_t (*wake)(void *data); /* Called, while the table is locked, whenever an event is published for the user. */
+	void *data; /* The value passed to the wake function. */
+	struct notify_subscriber *next;
+} notify_subscriber_t;
+
 // All of a user's information is stored using this structure.
 typedef struct {
 
@@ -100,6 +131,15 @@ typedef struct {
 	stringer_t *username, *verification;
 	inx_t *aliases, *messages, *message_folders, *folders, *contacts;
 
+	// The current message index, and the indexes it replaced.
+	struct {
+		inx_t *source; /* The messages collection the current index was built from. */
+		uint64_t serial; /* The serial number of the messages collection when the current index was built. */
+		bool_t stale; /* Set when a message changed folders, but the index couldn't be updated to match. */
+		meta_index_t *current, *retired;
+		pthread_mutex_t lock;
+	} index;
+
 	// The symmetric realm keys.
 	struct {
 		stringer_t *mail;
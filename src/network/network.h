@@ -27,6 +27,7 @@ typedef struct {
 	char *string;
 	size_t length;
 	void *function;
+	latency_t *latency; /* The latency histogram for the command, or NULL if the protocol doesn't track command latencies. */
 } command_t;
 
 // Setup the structure of variables used to relay and bounce messages.
@@ -51,14 +52,19 @@ typedef struct {
 	struct {
 		uint32_t spins;
 		uint32_t violations;
+		uint32_t delay; /* A protocol violation penalty, in microseconds, served before the connection waits for its next command. */
+		uint64_t dispatched; /* The cycle counter when the current command was dispatched, or 0 if the command isn't being timed. */
 	} protocol;
 
 	struct {
 		void *tls; /* The TLS connection object. */
 		int sockd; /* The socket connection. */
 		int status; /* Track whether the last network operation generated an error. */
+		bool_t offloaded; /* Whether the kernel encrypts the output of a TLS connection, so it can be written directly to the socket. */
+		void *secured; /* The function enqueued once the handshake pool has finished the TLS handshake. */
 		placer_t line; /* The current line being processed. */
 		stringer_t *buffer; /* The connection buffer. */
+		stringer_t *output; /* Output waiting to be sent, which is flushed when the command finishes, or the buffer fills up, and released when the connection is parked. */
 
 		struct {
 			ip_t *ip;
@@ -66,11 +72,18 @@ typedef struct {
 			stringer_t *domain;
 		} reverse;
 
+		struct {
+			void *function; /* The protocol handler to enqueue once input arrives. */
+			time_t expiration; /* When a parked connection should be handed back to its handler as timed out. */
+			timer_event_t timer; /* The timer used to expire a parked connection once it has been idle too long. */
+		} events;
+
 	} network;
 	uint64_t refs; /* The number of memory references or threads pointing at this structure. */
 	pthread_mutex_t lock; /* The mutex used for locking during non-thread save operations. */
 	server_t *server; /* The server instance that accepted the connection. */
 	command_t *command; /* The command structure. */
+	arena_t *arena; /* The memory arena holding the temporary allocations of the current command, which is reset when the command finishes. */
 } connection_t;
 
 /// addresses.c
@@ -84,15 +97,19 @@ stringer_t *  con_addr_subnet(connection_t *con, stringer_t *output);
 uint32_t      con_addr_word(connection_t *con, int_t position);
 
 /// connections.c
-uint64_t        con_decrement_refs(connection_t *con);
-void            con_destroy(connection_t *con);
-uint64_t        con_increment_refs(connection_t *con);
-connection_t *  con_init(int cond, server_t *server);
-bool_t          con_init_network_buffer(connection_t *con);
-bool_t          con_localhost(connection_t *con);
-bool_t          con_private(connection_t *con);
-int_t           con_secure(connection_t *con);
-int_t           con_status(connection_t *con);
+uint64_t          con_decrement_refs(connection_t *con);
+void              con_destroy(connection_t *con);
+uint64_t          con_increment_refs(connection_t *con);
+connection_t *    con_init(int cond, server_t *server);
+bool_t            con_init_network_buffer(connection_t *con);
+bool_t            con_localhost(connection_t *con);
+bool_t            con_offload(connection_t *con);
+queue_priority_t  con_priority(connection_t *con);
+bool_t            con_private(connection_t *con);
+int_t             con_secure(connection_t *con);
+void              con_secure_enqueue(connection_t *con, void *function);
+void              con_secure_handshake(connection_t *con);
+int_t             con_status(connection_t *con);
 
 /// clients.c
 void        client_close(client_t *client);
@@ -102,11 +119,13 @@ int_t       client_status(client_t *client);
 
 /// options.c
 bool_t   net_set_buffer_length(int sd, int buffer_recv, int buffer_send);
+bool_t   net_set_cork(int sd, bool_t cork);
 bool_t   net_set_keepalive(int sd, bool_t keepalive, int_t idle, int_t interval, int_t tolerance);
 bool_t   net_set_linger(int sd, bool_t linger, int_t timeout);
 bool_t   net_set_nodelay(int sd, bool_t nodelay);
 bool_t   net_set_blocking(int sd, bool_t blocking);
 bool_t   net_set_reuseable_address(int sd, bool_t reuse);
+bool_t   net_set_reuseable_port(int sd, bool_t reuse);
 bool_t   net_set_timeout(int sd, uint32_t timeout_recv, uint32_t timeout_send);
 
 /// read.c
@@ -114,23 +133,46 @@ int64_t   client_read(client_t *client);
 int64_t   client_read_line(client_t *client);
 int64_t   con_read(connection_t *con);
 int64_t   con_read_line(connection_t *con, bool_t block);
+int_t     con_read_ready(connection_t *con);
+
+/// events.c
+void     con_events_wait(connection_t *con, void *function);
+bool_t   con_events_wake(connection_t *con);
+void     net_events_dispatch(connection_t *con);
+void     net_events_expire(void *data);
+void     net_events_loop(void);
+void     net_events_resume(connection_t *con);
+bool_t   net_events_start(void);
+void     net_events_stop(void);
 
 /// reverse.c
 stringer_t *  con_reverse_check(connection_t *con, uint32_t timeout);
+void          con_reverse_complete(connection_t *con, stringer_t *domain);
 void          con_reverse_domain(connection_t *con, stringer_t *domain, int_t status);
 void          con_reverse_enqueue(connection_t *con);
-void          con_reverse_lookup(connection_t *con);
 void          con_reverse_status(connection_t *con, int_t status);
 
+/// resolver.c
+void     net_resolver_lookup(ip_t *ip, void *function, void *data);
+void     net_resolver_loop(void);
+void     net_resolver_nameserver(struct sockaddr_in *address);
+bool_t   net_resolver_start(void);
+void     net_resolver_stop(void);
+
 /// listeners.c
-bool_t   net_init(server_t *server);
-void     net_listen(void);
-void     net_shutdown(server_t *server);
+uint64_t   net_acceptors_count(void);
+char *     net_acceptors_name(uint64_t position);
+uint64_t   net_acceptors_value(uint64_t position);
+bool_t     net_init(server_t *server);
+void       net_listen(void);
+void       net_shutdown(server_t *server);
 
 /// write.c
 int64_t   client_print(client_t *client, chr_t *format, ...);
 int64_t   client_write(client_t *client, stringer_t *s);
+int64_t   con_flush(connection_t *con);
 int64_t   con_print(connection_t *con, chr_t *format, ...);
+void      con_release(connection_t *con);
 int64_t   con_write_bl(connection_t *con, char *block, size_t length);
 int64_t   con_write_ns(connection_t *con, char *string);
 int64_t   con_write_pl(connection_t *con, placer_t string);
@@ -93,6 +93,43 @@ bool_t net_set_reuseable_address(int sd, bool_t reuse) {
 	return true;
 }
 
+/**
+ * @brief	Set the cork flag for a socket, which holds back partial frames until the flag is cleared or a full frame is queued.
+ * @param	sd		the socket descriptor to be adjusted.
+ * @param	cork	a boolean variable specifying whether partial frames should be held back.
+ * @return	true if the flag was successfully set or false on failure.
+ */
+bool_t net_set_cork(int sd, bool_t cork) {
+
+	int val = (cork ? 1 : 0);
+
+	if (setsockopt(sd, IPPROTO_TCP, TCP_CORK, &val, sizeof(val)))  {
+		log_pedantic("Socket cork configuration failed. {%s}", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Set the port reuse flag for a socket, which lets several listening sockets bind to the same port.
+ * @note	The kernel balances incoming connections across all of the sockets bound to the port.
+ * @param	sd		the socket descriptor to be adjusted.
+ * @param	reuse	a boolean variable specifying whether the port may be shared by other listening sockets.
+ * @return	true if the flag was successfully set or false on failure.
+ */
+bool_t net_set_reuseable_port(int sd, bool_t reuse) {
+
+	int val = (reuse ? 1 : 0);
+
+	if (setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)))  {
+		log_pedantic("Socket port reuse configuration failed. {%s}", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * @brief	Set the blocking flag for a socket.
  * @param	sd			the socket descriptor to be adjusted.
@@ -7,6 +7,101 @@
 
 #include "magma.h"
 
+/**
+ * @brief	Discard the input a connection has already consumed, and move any unconsumed data to the front of the buffer.
+ * @note	A zero length line anchored at the start of the buffer marks data which has been received, but not yet returned to a
+ * 			protocol handler. This is how partial lines, and the input collected by the event loop, survive until a worker reads them.
+ * @param	con		the network connection whose buffer will be compacted.
+ * @return	the number of unconsumed bytes sitting at the front of the network buffer.
+ */
+static size_t con_read_compact(connection_t *con) {
+
+	size_t consumed = pl_length_get(con->network.line);
+
+	// Move the data received after the line we returned last time to the front of the buffer.
+	if (consumed && st_length_get(con->network.buffer) > consumed) {
+		mm_move(st_data_get(con->network.buffer), st_data_get(con->network.buffer) + consumed, st_length_get(con->network.buffer) - consumed);
+		st_length_set(con->network.buffer, st_length_get(con->network.buffer) - consumed);
+	}
+	// Otherwise, unless the buffer is holding unconsumed data, everything in it has been processed.
+	else if (consumed || pl_data_get(con->network.line) != st_data_get(con->network.buffer)) {
+		st_length_set(con->network.buffer, 0);
+	}
+
+	con->network.line = pl_init(st_data_get(con->network.buffer), 0);
+
+	return st_length_get(con->network.buffer);
+}
+
+/**
+ * @brief	Collect whatever input is waiting on a connection without blocking, and report whether a complete line is available.
+ * @note	This function is used by the network event loop, so the data is left unconsumed in the connection buffer; the next call
+ * 			to con_read_line() or con_read() will return it without touching the socket. TLS connections are temporarily switched into
+ * 			non-blocking mode, so a partial record will be held inside the TLS object until the rest of it arrives.
+ * @param	con		the network connection to be read.
+ * @return	-1 if the connection failed or was closed, 0 if more data is needed, or 1 if a complete line is waiting, or the buffer is full.
+ */
+int_t con_read_ready(connection_t *con) {
+
+	ssize_t bytes = 0;
+	int_t result = 0;
+	chr_t *start;
+
+	if (!con || con->network.sockd == -1 || con->network.status < 0) {
+		return -1;
+	}
+	else if (!con->network.buffer && !con_init_network_buffer(con)) {
+		con->network.status = -1;
+		return -1;
+	}
+
+	// Check whether the data already in the buffer holds a complete line.
+	if (con_read_compact(con) && memchr(st_data_get(con->network.buffer), '\n', st_length_get(con->network.buffer))) {
+		return 1;
+	}
+
+	// Keep reading until we find a line break, the socket runs dry, or the buffer fills up.
+	while (!result && st_length_get(con->network.buffer) != st_avail_get(con->network.buffer)) {
+
+		start = st_char_get(con->network.buffer) + st_length_get(con->network.buffer);
+
+		if (con->network.tls) {
+			net_set_blocking(con->network.sockd, false);
+			bytes = tls_read(con->network.tls, start, st_avail_get(con->network.buffer) - st_length_get(con->network.buffer), false);
+			if (bytes <= 0) bytes = tls_continue(con->network.tls, bytes, errno);
+			net_set_blocking(con->network.sockd, true);
+		}
+		else if (!(bytes = tcp_read(con->network.sockd, start, st_avail_get(con->network.buffer) - st_length_get(con->network.buffer), false))) {
+			bytes = -1;
+		}
+		else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			bytes = 0;
+		}
+
+		// A zero means the socket is out of data, while a negative value means the connection is no longer viable.
+		if (bytes <= 0) {
+			result = bytes < 0 ? -1 : 0;
+			break;
+		}
+
+		st_length_set(con->network.buffer, st_length_get(con->network.buffer) + bytes);
+
+		if (memchr(start, '\n', bytes)) {
+			result = 1;
+		}
+	}
+
+	// A full buffer has to be handed off, even if it doesn't contain a line break.
+	if (!result && st_length_get(con->network.buffer) == st_avail_get(con->network.buffer)) {
+		result = 1;
+	}
+	else if (result < 0) {
+		con->network.status = -1;
+	}
+
+	return result;
+}
+
 /**
  * @brief	Read a line of input from a network connection.
  * @note	This function handles reading data from both regular and ssl connections.
@@ -36,29 +131,15 @@ int64_t con_read_line(connection_t *con, bool_t block) {
 		return -1;
 	}
 
-	// Check if we have received more data than just what is in the current line of input.
-	else if (pl_length_get(con->network.line) && st_length_get(con->network.buffer) > pl_length_get(con->network.line)) {
-
-		// If so, move the unused "new" data after the current line marker to the front of the buffer.
-		mm_move(st_data_get(con->network.buffer), st_data_get(con->network.buffer) + pl_length_get(con->network.line),
-			st_length_get(con->network.buffer) - pl_length_get(con->network.line));
-
-		// Update the buffer length.
-		st_length_set(con->network.buffer, st_length_get(con->network.buffer) - pl_length_get(con->network.line));
-
-		// Check whether the data we just moved contains a complete line.
-		if (!pl_empty((con->network.line = line_pl_st(con->network.buffer, 0)))) {
-			con->network.status = 1;
-			return pl_length_get(con->network.line);
-		}
-
-	}
-	// Otherwise reset the buffer and line lengths to zero.
-	else {
-		st_length_set(con->network.buffer, 0);
-		con->network.line = pl_null();
+	// Discard the previous line, and check whether the unconsumed data left in the buffer already contains a complete line.
+	else if (con_read_compact(con) && !pl_empty((con->network.line = line_pl_st(con->network.buffer, 0)))) {
+		con->network.status = 1;
+		return pl_length_get(con->network.line);
 	}
 
+	// The client may be waiting for our response before it sends anything else.
+	con_flush(con);
+
 	// Loop until we get a complete line, an error, or the buffer is filled.
 	do {
 //		blocking = st_length_get(con->network.buffer) ? false : true;
@@ -96,6 +177,11 @@ int64_t con_read_line(connection_t *con, bool_t block) {
 		con->network.status = 1;
 	}
 
+	// Hold onto a partial line so the data isn't discarded by the next call.
+	if (!line) {
+		con->network.line = pl_init(st_data_get(con->network.buffer), 0);
+	}
+
 	return pl_length_get(con->network.line);
 
 //	do {
@@ -187,29 +273,16 @@ int64_t con_read(connection_t *con) {
 		return -1;
 	}
 
-	// Check for data past the current line buffer.
-	else if (pl_length_get(con->network.line) && st_length_get(con->network.buffer) > pl_length_get(con->network.line)) {
-
-		// Move the unused data to the front of the buffer.
-		mm_move(st_data_get(con->network.buffer), st_data_get(con->network.buffer) + pl_length_get(con->network.line),
-			st_length_get(con->network.buffer) - pl_length_get(con->network.line));
-
-		// Update the length.
-		st_length_set(con->network.buffer, st_length_get(con->network.buffer) - pl_length_get(con->network.line));
-
-		// Clear the line buffer.
+	// Return any unconsumed data left in the buffer before reading more. Clearing the line marks the buffer as consumed.
+	else if (con_read_compact(con)) {
 		con->network.line = pl_null();
+		return st_length_get(con->network.buffer);
+	}
 
-		if (st_length_get(con->network.buffer)) {
-			return st_length_get(con->network.buffer);
-		}
+	con->network.line = pl_null();
 
-	}
-	// Otherwise reset the buffer and line lengths to zero.
-	else {
-		st_length_set(con->network.buffer, 0);
-		con->network.line = pl_null();
-	}
+	// The client may be waiting for our response before it sends anything else.
+	con_flush(con);
 
 	// Loop until the buffer has data or we get an error.
 	do {
@@ -0,0 +1,748 @@
+/**
+ * @file /magma/network/resolver.c
+ *
+ * @brief	An asynchronous reverse DNS resolver, with a cache of PTR results which is shared by every connection.
+ *
+ * Lookups are answered from the cache whenever possible. On a miss, a PTR query is sent to the name server over UDP, and the caller
+ * is notified by the resolver thread once the reply arrives, so a worker thread never blocks waiting on the network. Concurrent lookups
+ * for the same address share a single query, which is found by hashing the address. Each query is sent from its own socket, bound to
+ * a port picked at random by the kernel, so a forged reply has to guess the port, as well as the message id. Results are cached for as long as the record TTL allows, up to MAGMA_RESOLVER_TTL_MAX
+ * seconds, and addresses without a PTR record are remembered for MAGMA_RESOLVER_TTL_NEGATIVE seconds. The cache is split into
+ * independently locked shards, each of which evicts its least recently used results once it holds MAGMA_RESOLVER_LIMIT entries.
+ * Only the IPv4 name servers listed in the system resolver configuration are used.
+ */
+
+#include "magma.h"
+
+typedef struct net_resolver_entry {
+	ip_t ip;
+	time_t expiration;
+	stringer_t *domain; /* The PTR result, or NULL if the address doesn't have a PTR record. */
+	struct net_resolver_entry *prev, *next, *chain;
+} net_resolver_entry_t;
+
+typedef struct {
+	uint64_t count;
+	pthread_mutex_t lock;
+	net_resolver_entry_t *head, *tail;
+	net_resolver_entry_t *buckets[MAGMA_RESOLVER_BUCKETS];
+} net_resolver_shard_t;
+
+typedef struct net_resolver_waiter {
+	void (*function)(void *data, stringer_t *domain), *data;
+	struct net_resolver_waiter *next;
+} net_resolver_waiter_t;
+
+typedef struct net_resolver_query {
+	ip_t ip;
+	int sockd; /* The socket the query is sent from, which is only used by this query. */
+	uint16_t id;
+	size_t length;
+	uint32_t attempts;
+	uint64_t deadline; /* When the current attempt times out, in milliseconds, according to the monotonic clock. */
+	chr_t name[128]; /* The in-addr.arpa, or ip6.arpa, name being queried. */
+	uchr_t packet[256];
+	net_resolver_waiter_t *waiters;
+	struct net_resolver_query *prev, *next; /* The outstanding queries, ordered by deadline. */
+	struct net_resolver_query *chain; /* The next outstanding query in the same address bucket. */
+} net_resolver_query_t;
+
+struct {
+	int ed; /* The epoll descriptor watching the query sockets. */
+	bool_t running;
+	pthread_t *thread;
+	pthread_mutex_t lock;
+	uint32_t servers, pending;
+	struct sockaddr_in nameservers[MAXNS];
+	net_resolver_query_t *head, *tail;
+	net_resolver_query_t *queries[MAGMA_RESOLVER_PENDING]; /* The outstanding queries, hashed by address. */
+	net_resolver_shard_t shards[MAGMA_RESOLVER_SHARDS];
+} resolver = {
+		.ed = -1,
+		.running = false,
+		.thread = NULL
+};
+
+// The interned ids of the cache statistics, which are updated by every lookup.
+static uint64_t resolver_hits = 0, resolver_misses = 0;
+
+/**
+ * @brief	Get the value of the monotonic clock in milliseconds.
+ * @return	the number of milliseconds since an arbitrary point in the past.
+ */
+static uint64_t net_resolver_clock(void) {
+
+	struct timespec now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000) + ((uint64_t)now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief	Hash an IP address, so results are spread evenly across the cache shards and their buckets.
+ */
+static uint64_t net_resolver_hash(ip_t *ip) {
+	return ip->family == AF_INET ? hash_murmur64(&(ip->ip4), sizeof(struct in_addr)) : hash_murmur64(&(ip->ip6), sizeof(struct in6_addr));
+}
+
+/**
+ * @brief	Remove an entry from its shard's hash chain and recently used list, and then free it.
+ * @note	The shard lock must be held by the caller.
+ * @param	shard	the shard holding the entry.
+ * @param	entry	the entry to be removed.
+ * @return	This function returns no value.
+ */
+static void net_resolver_entry_remove(net_resolver_shard_t *shard, net_resolver_entry_t *entry) {
+
+	net_resolver_entry_t **chain = &(shard->buckets[(net_resolver_hash(&(entry->ip)) / MAGMA_RESOLVER_SHARDS) % MAGMA_RESOLVER_BUCKETS]);
+
+	while (*chain && *chain != entry) {
+		chain = &((*chain)->chain);
+	}
+
+	if (*chain) {
+		*chain = entry->chain;
+	}
+
+	if (entry->prev) entry->prev->next = entry->next;
+	else shard->head = entry->next;
+
+	if (entry->next) entry->next->prev = entry->prev;
+	else shard->tail = entry->prev;
+
+	shard->count--;
+	st_cleanup(entry->domain);
+	mm_free(entry);
+
+	return;
+}
+
+/**
+ * @brief	Find the cached PTR result for an address.
+ * @note	Expired results are removed as they're found, and a result which is found is moved to the front of the recently used list.
+ * @param	ip		the address being looked up.
+ * @param	domain	a pointer which will receive a copy of the cached domain name, or NULL if the address is known not to have one.
+ * @return	true if a result was found in the cache, otherwise false.
+ */
+static bool_t net_resolver_cache_find(ip_t *ip, stringer_t **domain) {
+
+	bool_t result = false;
+	uint64_t hash = net_resolver_hash(ip);
+	net_resolver_entry_t *entry;
+	net_resolver_shard_t *shard = &(resolver.shards[hash % MAGMA_RESOLVER_SHARDS]);
+
+	*domain = NULL;
+
+	mutex_lock(&(shard->lock));
+
+	entry = shard->buckets[(hash / MAGMA_RESOLVER_SHARDS) % MAGMA_RESOLVER_BUCKETS];
+
+	while (entry && !ip_addr_eq(&(entry->ip), ip)) {
+		entry = entry->chain;
+	}
+
+	if (entry && entry->expiration <= time(NULL)) {
+		net_resolver_entry_remove(shard, entry);
+	}
+	else if (entry) {
+
+		// Move the entry to the front of the recently used list.
+		if (entry->prev) {
+			entry->prev->next = entry->next;
+			if (entry->next) entry->next->prev = entry->prev;
+			else shard->tail = entry->prev;
+			entry->prev = NULL;
+			entry->next = shard->head;
+			shard->head->prev = entry;
+			shard->head = entry;
+		}
+
+		// If the copy fails, the lookup is treated as a miss, so the caller will query the name server instead.
+		result = !entry->domain || (*domain = st_dupe(entry->domain));
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	return result;
+}
+
+/**
+ * @brief	Store the PTR result for an address in the cache, replacing any previous result.
+ * @param	ip		the address which was looked up.
+ * @param	domain	the domain name, or NULL if the address doesn't have a PTR record.
+ * @param	ttl		the number of seconds the result may be cached.
+ * @return	This function returns no value.
+ */
+static void net_resolver_cache_store(ip_t *ip, stringer_t *domain, uint32_t ttl) {
+
+	net_resolver_entry_t *entry;
+	net_resolver_shard_t *shard;
+	uint64_t hash = net_resolver_hash(ip), bucket = (hash / MAGMA_RESOLVER_SHARDS) % MAGMA_RESOLVER_BUCKETS;
+
+	if (!ttl || !(entry = mm_alloc(sizeof(net_resolver_entry_t)))) {
+		return;
+	}
+	else if (domain && !(entry->domain = st_dupe(domain))) {
+		mm_free(entry);
+		return;
+	}
+
+	ip_copy(&(entry->ip), ip);
+	entry->expiration = time(NULL) + (ttl < MAGMA_RESOLVER_TTL_MAX ? ttl : MAGMA_RESOLVER_TTL_MAX);
+
+	shard = &(resolver.shards[hash % MAGMA_RESOLVER_SHARDS]);
+	mutex_lock(&(shard->lock));
+
+	// A concurrent query may have already stored a result for this address.
+	for (net_resolver_entry_t *current = shard->buckets[bucket]; current; current = current->chain) {
+		if (ip_addr_eq(&(current->ip), ip)) {
+			net_resolver_entry_remove(shard, current);
+			break;
+		}
+	}
+
+	while (shard->count >= MAGMA_RESOLVER_LIMIT && shard->tail) {
+		net_resolver_entry_remove(shard, shard->tail);
+		stats_increment_by_name("network.reverse.cache.evicted");
+	}
+
+	entry->chain = shard->buckets[bucket];
+	shard->buckets[bucket] = entry;
+
+	if ((entry->next = shard->head)) entry->next->prev = entry;
+	else shard->tail = entry;
+
+	shard->head = entry;
+	shard->count++;
+
+	mutex_unlock(&(shard->lock));
+
+	return;
+}
+
+/**
+ * @brief	Encode a PTR query into a DNS message.
+ * @param	query	the query, which supplies the message id and the name, and receives the encoded message.
+ * @return	true on success, or false if the name doesn't fit.
+ */
+static bool_t net_resolver_packet(net_resolver_query_t *query) {
+
+	size_t label;
+	uchr_t *packet = query->packet;
+	chr_t *name = query->name, *dot;
+
+	// The header asks for recursion, and holds a single question.
+	mm_wipe(packet, 12);
+	packet[0] = query->id >> 8;
+	packet[1] = query->id & 0xff;
+	packet[2] = 0x01;
+	packet[5] = 1;
+	query->length = 12;
+
+	while (*name) {
+
+		label = (dot = strchr(name, '.')) ? (size_t)(dot - name) : ns_length_get(name);
+
+		if (!label || label > 63 || query->length + label + 6 > sizeof(query->packet)) {
+			return false;
+		}
+
+		packet[query->length++] = label;
+		mm_copy(packet + query->length, name, label);
+		query->length += label;
+		name += label + (dot ? 1 : 0);
+	}
+
+	// The root label, followed by the PTR type and the IN class.
+	packet[query->length++] = 0;
+	packet[query->length++] = 0;
+	packet[query->length++] = ns_t_ptr;
+	packet[query->length++] = 0;
+	packet[query->length++] = ns_c_in;
+
+	return true;
+}
+
+/**
+ * @brief	Send the next attempt of a query, and move it to the end of the outstanding list.
+ * @note	The resolver lock must be held by the caller. Each attempt goes to the next name server in the list.
+ * @param	query	the query to be sent.
+ * @return	This function returns no value.
+ */
+static void net_resolver_send(net_resolver_query_t *query) {
+
+	struct sockaddr_in *nameserver = &(resolver.nameservers[(query->id + query->attempts) % resolver.servers]);
+
+	query->attempts++;
+	query->deadline = net_resolver_clock() + MAGMA_RESOLVER_TIMEOUT;
+
+	// A failed send is handled just like a lost reply, and the query will be retried once it times out.
+	if (sendto(query->sockd, query->packet, query->length, MSG_DONTWAIT | MSG_NOSIGNAL, (struct sockaddr *)nameserver,
+		sizeof(struct sockaddr_in)) != (ssize_t)query->length) {
+		log_pedantic("Unable to send the reverse DNS query. { name = %s / error = %s }", query->name, strerror_r(errno, MEMORYBUF(256), 256));
+	}
+
+	stats_increment_by_name("network.reverse.queries");
+
+	query->next = NULL;
+
+	if ((query->prev = resolver.tail)) resolver.tail->next = query;
+	else resolver.head = query;
+
+	resolver.tail = query;
+
+	return;
+}
+
+/**
+ * @brief	Remove a query from the outstanding list.
+ * @note	The resolver lock must be held by the caller.
+ * @param	query	the query to be removed.
+ * @return	This function returns no value.
+ */
+static void net_resolver_unlink(net_resolver_query_t *query) {
+
+	if (query->prev) query->prev->next = query->next;
+	else resolver.head = query->next;
+
+	if (query->next) query->next->prev = query->prev;
+	else resolver.tail = query->prev;
+
+	query->prev = query->next = NULL;
+
+	return;
+}
+
+/**
+ * @brief	Get the address bucket an outstanding query belongs in.
+ * @param	ip	the address being looked up.
+ * @return	a pointer to the head of the bucket.
+ */
+static net_resolver_query_t ** net_resolver_bucket(ip_t *ip) {
+	return &(resolver.queries[net_resolver_hash(ip) % MAGMA_RESOLVER_PENDING]);
+}
+
+/**
+ * @brief	Remove a finished query from the outstanding list and its address bucket, and close its socket.
+ * @note	The resolver lock must be held by the caller. Closing the socket also removes it from the epoll descriptor.
+ * @param	query	the query to be removed.
+ * @return	This function returns no value.
+ */
+static void net_resolver_forget(net_resolver_query_t *query) {
+
+	net_resolver_query_t **chain = net_resolver_bucket(&(query->ip));
+
+	net_resolver_unlink(query);
+
+	while (*chain && *chain != query) {
+		chain = &((*chain)->chain);
+	}
+
+	if (*chain) {
+		*chain = query->chain;
+	}
+
+	close(query->sockd);
+	query->sockd = -1;
+	query->chain = NULL;
+	resolver.pending--;
+
+	return;
+}
+
+/**
+ * @brief	Notify everyone waiting on a query of the result, and then free the query.
+ * @param	query	the finished query, which must already be removed from the outstanding list.
+ * @param	domain	the domain name, or NULL if the lookup failed, or the address doesn't have a PTR record.
+ * @return	This function returns no value.
+ */
+static void net_resolver_complete(net_resolver_query_t *query, stringer_t *domain) {
+
+	net_resolver_waiter_t *waiter;
+
+	while ((waiter = query->waiters)) {
+		query->waiters = waiter->next;
+		waiter->function(waiter->data, domain);
+		mm_free(waiter);
+	}
+
+	mm_free(query);
+
+	return;
+}
+
+/**
+ * @brief	Process a reply received on the socket of an outstanding query.
+ * @note	Replies which don't come from a configured name server, or don't match the query, are ignored. Only the resolver thread frees
+ * 			queries, so the query is still outstanding when this function is called.
+ * @param	query	the query which owns the socket the reply arrived on.
+ * @param	packet	the reply.
+ * @param	length	the length, in bytes, of the reply.
+ * @param	source	the address the reply came from.
+ * @return	true if the reply finished the query, which will have been freed, or false if it was ignored.
+ */
+static bool_t net_resolver_receive(net_resolver_query_t *query, uchr_t *packet, size_t length, struct sockaddr_in *source) {
+
+	ns_rr rr;
+	ns_msg handle;
+	bool_t trusted = false;
+	uint32_t ttl = MAGMA_RESOLVER_TTL_NEGATIVE;
+	stringer_t *domain = NULL;
+	chr_t name[NS_MAXDNAME];
+
+	if (ns_initparse(packet, length, &handle) < 0 || !ns_msg_getflag(handle, ns_f_qr)) {
+		return false;
+	}
+
+	mutex_lock(&resolver.lock);
+
+	for (uint32_t i = 0; i < resolver.servers && !trusted; i++) {
+		trusted = resolver.nameservers[i].sin_addr.s_addr == source->sin_addr.s_addr && resolver.nameservers[i].sin_port == source->sin_port;
+	}
+
+	// The question must match the outstanding query, as well as the id, before the reply is accepted.
+	if (!trusted || ns_msg_id(handle) != query->id || ns_msg_count(handle, ns_s_qd) != 1 || ns_parserr(&handle, ns_s_qd, 0, &rr) ||
+		strcasecmp(ns_rr_name(rr), query->name)) {
+		mutex_unlock(&resolver.lock);
+		return false;
+	}
+
+	net_resolver_forget(query);
+
+	mutex_unlock(&resolver.lock);
+
+	// Only a missing name, or a successful reply without a PTR record, is cached as a negative result.
+	if (ns_msg_getflag(handle, ns_f_rcode) == ns_r_noerror) {
+
+		for (int i = 0; !domain && i < ns_msg_count(handle, ns_s_an); i++) {
+			if (!ns_parserr(&handle, ns_s_an, i, &rr) && ns_rr_type(rr) == ns_t_ptr && ns_rr_class(rr) == ns_c_in &&
+				dn_expand(ns_msg_base(handle), ns_msg_end(handle), ns_rr_rdata(rr), name, sizeof(name)) > 0 && ns_length_get(name)) {
+				domain = st_import(name, ns_length_get(name));
+				ttl = ns_rr_ttl(rr);
+			}
+		}
+
+		net_resolver_cache_store(&(query->ip), domain, ttl);
+	}
+	else if (ns_msg_getflag(handle, ns_f_rcode) == ns_r_nxdomain) {
+		net_resolver_cache_store(&(query->ip), NULL, ttl);
+	}
+
+	net_resolver_complete(query, domain);
+	st_cleanup(domain);
+
+	return true;
+}
+
+/**
+ * @brief	Retry any queries which have timed out, and fail those which have run out of attempts.
+ * @return	This function returns no value.
+ */
+static void net_resolver_expire(void) {
+
+	uint64_t now = net_resolver_clock();
+	net_resolver_query_t *query, *failed = NULL;
+
+	mutex_lock(&resolver.lock);
+
+	// The outstanding list is ordered by deadline, so only the queries at the front need to be checked.
+	while ((query = resolver.head) && query->deadline <= now) {
+
+		if (query->attempts < MAGMA_RESOLVER_ATTEMPTS) {
+			net_resolver_unlink(query);
+			net_resolver_send(query);
+		}
+		else {
+			net_resolver_forget(query);
+			query->next = failed;
+			failed = query;
+		}
+	}
+
+	mutex_unlock(&resolver.lock);
+
+	while ((query = failed)) {
+		failed = query->next;
+		stats_increment_by_name("network.reverse.timeouts");
+		net_resolver_complete(query, NULL);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Look up the domain name of an address, using the PTR record found in the reverse DNS zone.
+ * @note	The function is always called exactly once. It's called before this function returns if the result is cached, or the lookup
+ * 			can't be started, and otherwise it's called by the resolver thread once the reply arrives, or the lookup times out. The domain
+ * 			name passed to the function is only valid until it returns, and is NULL if the address doesn't have a PTR record, or the
+ * 			lookup failed. Since the resolver thread must never block, the function should do as little as possible.
+ * @param	ip			the address to be looked up.
+ * @param	function	the function which receives the result, along with data.
+ * @param	data		an arbitrary pointer passed back to the function.
+ * @return	This function returns no value.
+ */
+void net_resolver_lookup(ip_t *ip, void *function, void *data) {
+
+	stringer_t *domain = NULL;
+	net_resolver_waiter_t *waiter;
+	net_resolver_query_t *query = NULL, **bucket;
+	struct epoll_event event = { .events = EPOLLIN };
+	struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = 0, .sin_addr.s_addr = htonl(INADDR_ANY) };
+	void (*callback)(void *data, stringer_t *domain) = function;
+
+	if (!ip || (ip->family != AF_INET && ip->family != AF_INET6)) {
+		callback(data, NULL);
+		return;
+	}
+	else if (net_resolver_cache_find(ip, &domain)) {
+		stats_increment_by_num(stats_intern(&resolver_hits, "network.reverse.cache.hits"));
+		callback(data, domain);
+		st_cleanup(domain);
+		return;
+	}
+
+	stats_increment_by_num(stats_intern(&resolver_misses, "network.reverse.cache.misses"));
+
+	if (!(waiter = mm_alloc(sizeof(net_resolver_waiter_t)))) {
+		callback(data, NULL);
+		return;
+	}
+
+	waiter->function = callback;
+	waiter->data = data;
+
+	mutex_lock(&resolver.lock);
+
+	// If the address is already being looked up, we simply wait for the same reply.
+	bucket = net_resolver_bucket(ip);
+	for (query = *bucket; resolver.running && query && !ip_addr_eq(&(query->ip), ip); query = query->chain);
+
+	if (resolver.running && query) {
+		waiter->next = query->waiters;
+		query->waiters = waiter;
+		mutex_unlock(&resolver.lock);
+		return;
+	}
+	else if (!resolver.running || resolver.pending >= MAGMA_RESOLVER_PENDING || !(query = mm_alloc(sizeof(net_resolver_query_t)))) {
+		mutex_unlock(&resolver.lock);
+		mm_free(waiter);
+		callback(data, NULL);
+		return;
+	}
+
+	ip_copy(&(query->ip), ip);
+	query->waiters = waiter;
+	query->sockd = -1;
+
+	// The message id is random, and the socket is bound to a port chosen at random by the kernel, which makes spoofing a reply much harder.
+	query->id = rand_get_uint16();
+	event.data.ptr = query;
+
+	if (!(domain = ip_reversed(ip, MANAGEDBUF(64))) || snprintf(query->name, sizeof(query->name), "%.*s.%s", st_length_int(domain),
+		st_char_get(domain), ip->family == AF_INET ? "in-addr.arpa" : "ip6.arpa") >= (int)sizeof(query->name) || !net_resolver_packet(query) ||
+		(query->sockd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+		bind(query->sockd, (struct sockaddr *)&local, sizeof(struct sockaddr_in)) || epoll_ctl(resolver.ed, EPOLL_CTL_ADD, query->sockd, &event)) {
+		mutex_unlock(&resolver.lock);
+		if (query->sockd != -1) close(query->sockd);
+		query->waiters = NULL;
+		mm_free(query);
+		mm_free(waiter);
+		callback(data, NULL);
+		return;
+	}
+
+	query->chain = *bucket;
+	*bucket = query;
+	resolver.pending++;
+	net_resolver_send(query);
+
+	mutex_unlock(&resolver.lock);
+
+	return;
+}
+
+/**
+ * @brief	Set the name servers used by the resolver.
+ * @note	If an address isn't supplied, the IPv4 name servers are loaded from the system resolver configuration, and if none are found,
+ * 			the local host is used.
+ * @param	address		the address of the only name server which should be used, or NULL to use the system name servers.
+ * @return	This function returns no value.
+ */
+void net_resolver_nameserver(struct sockaddr_in *address) {
+
+	struct __res_state state;
+
+	mutex_lock(&resolver.lock);
+
+	resolver.servers = 0;
+
+	if (address) {
+		mm_copy(&(resolver.nameservers[resolver.servers++]), address, sizeof(struct sockaddr_in));
+	}
+	else {
+
+		mm_wipe(&state, sizeof(struct __res_state));
+
+		if (!res_ninit(&state)) {
+			for (int i = 0; i < state.nscount && resolver.servers < MAXNS; i++) {
+				if (state.nsaddr_list[i].sin_family == AF_INET) {
+					mm_copy(&(resolver.nameservers[resolver.servers++]), &(state.nsaddr_list[i]), sizeof(struct sockaddr_in));
+				}
+			}
+			res_nclose(&state);
+		}
+
+		if (!resolver.servers) {
+			mm_wipe(&(resolver.nameservers[0]), sizeof(struct sockaddr_in));
+			resolver.nameservers[0].sin_family = AF_INET;
+			resolver.nameservers[0].sin_port = htons(NS_DEFAULTPORT);
+			resolver.nameservers[0].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			resolver.servers = 1;
+		}
+	}
+
+	mutex_unlock(&resolver.lock);
+
+	return;
+}
+
+/**
+ * @brief	The resolver thread, which receives the replies from the name server, and retries any queries which time out.
+ * @return	This function returns no value.
+ */
+void net_resolver_loop(void) {
+
+	int count;
+	ssize_t length;
+	socklen_t size;
+	struct sockaddr_in source;
+	net_resolver_query_t *query;
+	uchr_t packet[NS_PACKETSZ];
+	struct epoll_event events[MAGMA_EVENTS_BATCH];
+
+	if (!thread_start()) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+	}
+
+	while (__atomic_load_n(&resolver.running, __ATOMIC_RELAXED)) {
+
+		// The wait times out, so the outstanding queries are checked at least every tenth of a second.
+		if ((count = epoll_wait(resolver.ed, events, MAGMA_EVENTS_BATCH, 100)) < 0 && errno != EINTR) {
+			log_pedantic("The epoll_wait() call returned an error. { error = %s }", strerror_r(errno, bufptr, buflen));
+		}
+
+		// Every datagram waiting on a socket is read, until one of them finishes the query, which also closes the socket.
+		for (int i = 0; i < count; i++) {
+
+			query = events[i].data.ptr;
+
+			do {
+				size = sizeof(struct sockaddr_in);
+				length = recvfrom(query->sockd, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr *)&source, &size);
+			} while (length > 0 && (size != sizeof(struct sockaddr_in) || !net_resolver_receive(query, packet, length, &source)));
+		}
+
+		net_resolver_expire();
+	}
+
+	thread_stop();
+	pthread_exit(NULL);
+
+	return;
+}
+
+/**
+ * @brief	Initialize the reverse DNS cache, open the resolver socket, and launch the resolver thread.
+ * @return	true on success, or false on failure.
+ */
+bool_t net_resolver_start(void) {
+
+	for (uint64_t i = 0; i < MAGMA_RESOLVER_SHARDS; i++) {
+		mm_wipe(&(resolver.shards[i]), sizeof(net_resolver_shard_t));
+		if (mutex_init(&(resolver.shards[i].lock), NULL)) {
+			log_pedantic("Unable to initialize the reverse DNS cache locks.");
+			return false;
+		}
+	}
+
+	if (mutex_init(&resolver.lock, NULL)) {
+		return false;
+	}
+
+	mm_wipe(resolver.queries, sizeof(resolver.queries));
+	net_resolver_nameserver(NULL);
+
+	if ((resolver.ed = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		log_critical("Unable to create the reverse DNS resolver epoll descriptor. { error = %s }", strerror_r(errno, bufptr, buflen));
+		return false;
+	}
+
+	resolver.running = true;
+
+	if (!(resolver.thread = thread_alloc(net_resolver_loop, NULL))) {
+		log_critical("Unable to launch the reverse DNS resolver thread.");
+		resolver.running = false;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Stop the resolver thread, fail any outstanding lookups, and free the reverse DNS cache.
+ * @note	This must be called before the worker pool is shutdown, since the lookup functions may hand work to the worker pool.
+ * @return	This function returns no value.
+ */
+void net_resolver_stop(void) {
+
+	net_resolver_query_t *query, *failed = NULL;
+
+	mutex_lock(&resolver.lock);
+	resolver.running = false;
+	mutex_unlock(&resolver.lock);
+
+	if (resolver.thread) {
+		thread_join(*resolver.thread);
+		mm_free(resolver.thread);
+		resolver.thread = NULL;
+	}
+
+	mutex_lock(&resolver.lock);
+
+	while ((query = resolver.head)) {
+		net_resolver_forget(query);
+		query->next = failed;
+		failed = query;
+	}
+
+	mutex_unlock(&resolver.lock);
+
+	while ((query = failed)) {
+		failed = query->next;
+		net_resolver_complete(query, NULL);
+	}
+
+	if (resolver.ed != -1) {
+		close(resolver.ed);
+		resolver.ed = -1;
+	}
+
+	for (uint64_t i = 0; i < MAGMA_RESOLVER_SHARDS; i++) {
+
+		mutex_lock(&(resolver.shards[i].lock));
+		while (resolver.shards[i].head) {
+			net_resolver_entry_remove(&(resolver.shards[i]), resolver.shards[i].head);
+		}
+		mutex_unlock(&(resolver.shards[i].lock));
+
+		mutex_destroy(&(resolver.shards[i].lock));
+	}
+
+	mutex_destroy(&resolver.lock);
+
+	return;
+}
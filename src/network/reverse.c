@@ -25,8 +25,9 @@ void con_reverse_enqueue(connection_t *con) {
 
 	mutex_unlock(&(con->lock));
 
+	// The lookup is answered from the resolver cache if possible, and otherwise the result arrives without tying up a worker.
 	if (pending == REVERSE_EMPTY) {
-		enqueue(&con_reverse_lookup, con);
+		net_resolver_lookup(con->network.reverse.ip, &con_reverse_complete, con);
 	}
 
 	return;
@@ -100,50 +101,23 @@ stringer_t * con_reverse_check(connection_t *con, uint32_t timeout) {
 }
 
 /**
- * @brief	Perform a reverse DNS lookup on the remote end of a connection, and save the hostname.
- * @param	con		the connection object to be queried.
+ * @brief	Save the result of the reverse DNS lookup for a connection, and release the reference held by the lookup.
+ * @note	This function is called by the resolver, which may be running on its own thread, so the reference is released by a worker.
+ * @param	con		the connection object which was looked up.
+ * @param	domain	the hostname of the remote end of the connection, or NULL if the lookup failed.
  * @return	This function returns no value.
  */
-void con_reverse_lookup(connection_t *con) {
-
-	int_t ecode;
-	void *addr = NULL;
-	stringer_t *domain;
-	struct hostent host, *hostp;
-	sa_family_t family = AF_UNSPEC;
-	socklen_t len = sizeof(struct sockaddr_in6);
-	struct sockaddr *address = MEMORYBUF(sizeof(struct sockaddr_in6));
-
-	// Perform the lookup.
-	if (getpeername(con->network.sockd, address, &len)) {
-		con_reverse_status(con, REVERSE_ERROR);
-		con_destroy(con);
-		return;
-	}
+void con_reverse_complete(connection_t *con, stringer_t *domain) {
 
-	else if (len == sizeof(struct sockaddr_in6) && ((struct sockaddr_in6 *)address)->sin6_family == AF_INET6) {
-		family = ((struct sockaddr_in6 *)address)->sin6_family;
-		addr = &(((struct sockaddr_in6 *)address)->sin6_addr);
-	}
-	else if (len == sizeof(struct sockaddr_in) && ((struct sockaddr_in *)address)->sin_family == AF_INET) {
-		family = ((struct sockaddr_in *)address)->sin_family;
-		addr = &(((struct sockaddr_in *)address)->sin_addr);
-	}
-	else {
-		con_reverse_status(con, REVERSE_ERROR);
-		con_destroy(con);
-		return;
-	}
+	stringer_t *copy;
 
-	// Only perform the reverse address lookup if the socket IP address is determined above.
-	if (!(gethostbyaddr_r(addr, len, family, &host, MEMORYBUF(1024), 1024, &hostp, &ecode)) &&
-		(len = ns_length_get(host.h_name)) && (domain = st_import(host.h_name, len))) {
-		con_reverse_domain(con, domain, REVERSE_COMPLETE);
+	if (domain && (copy = st_dupe(domain))) {
+		con_reverse_domain(con, copy, REVERSE_COMPLETE);
 	}
 	else {
 		con_reverse_status(con, REVERSE_ERROR);
 	}
 
-	con_destroy(con);
+	enqueue_priority(QUEUE_BACKGROUND, &con_destroy, con);
 	return;
 }
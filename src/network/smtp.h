@@ -53,7 +53,14 @@ enum {
 	SMTP_OUTCOME_BOUNCE_VIRUS = 64,
 	SMTP_OUTCOME_BOUNCE_PHISH = 128,
 	SMTP_OUTCOME_BOUNCE_SPAM = 256,
-	SMTP_OUTCOME_BOUNCE_RBL = 512
+	SMTP_OUTCOME_BOUNCE_RBL = 512,
+
+	// The line states used while reading message data. The first four match the states used by smtp_data_finish().
+	SMTP_DATA_LINE_MIDDLE = 0,
+	SMTP_DATA_LINE_START = 1,
+	SMTP_DATA_LINE_DOT = 2,
+	SMTP_DATA_LINE_DOT_CR = 3,
+	SMTP_DATA_LINE_CR = 5
 };
 
 typedef struct {
@@ -66,6 +73,14 @@ typedef struct {
 	size_t header_length;
 } smtp_message_t;
 
+// The state carried between calls to smtp_data_scan(), since a line may be split across network reads.
+typedef struct {
+	int_t line; /* Where the scanner is relative to the start of the current line. */
+	bool_t header; /* Set until the blank line which ends the message header is found. */
+	bool_t carriage; /* Set if the last byte written to the output was a carriage return. */
+	bool_t done; /* Set once the terminating line has been found. */
+} smtp_data_t;
+
 // A linked list of recipients.
 typedef struct {
 	stringer_t *address;
@@ -7,49 +7,77 @@
 
 #include "magma.h"
 
+// The statistics updated by every write are looked up by name once, and their interned ids are kept here.
+static uint64_t write_syscalls = 0, write_flushes = 0;
+
 /// HIGH: Create a simpler method of triggering a queue event following a connection write operation, and audit the code
 /// to ensure write calls do not accidently orphan a connection by not queuing the connection upon completion.
 /// In other words, always ensure that enqueue() is being called on a connection after all processing is performed,
 /// so that it is not lost (whether it is to be kept or not).
 
 /**
- * @brief	Write data to a network connection.
+ * @brief	Send data across a network connection immediately, bypassing the output buffer.
  * @note	This function works regardless of whether or not the connection is ssl-enabled.
  * 			If the network write requires multiple system calls, then this code will loop until all the data has been transmitted.
+ * 			For plain TCP connections, a second block can be provided, and the two will be sent together using a vectored write.
  * @param	con		the connection across which the supplied data will be written.
  * @param	block	a pointer to a data buffer containing the data to be written to the connection's remote client.
  * @param	length	the length, in bytes, of the data buffer to be written.
- * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ * @param	tail	an optional pointer to a second data buffer, which will be written after the first.
+ * @param	extra	the length, in bytes, of the second data buffer.
+ * @return	-1 on general network failure, or the number of bytes that were written across the connection.
  */
-int64_t con_write_bl(connection_t *con, char *block, size_t length) {
+static int64_t con_write_direct(connection_t *con, char *block, size_t length, char *tail, size_t extra) {
 
 	int_t counter = 0;
+	struct iovec vector[2];
 	ssize_t bytes = 0, position = 0;
 //	stringer_t *ip = NULL, *cipher = NULL, *error = NULL;
 
-	if (!con || con->network.sockd == -1 || con_status(con) < 0) {
-		return -1;
-	}
-	else if (!block || !length) {
-		con->network.status = 0;
-		return 0;
-	}
-
 	// Loop until all of the bytes have been sent to the client.
 	do {
 
-		if (con->network.tls) {
-			bytes = tls_write(con->network.tls, block + position, length, true);
+		// Once the first block has been sent, or if it was empty, move on to the second block.
+		if (!length && extra) {
+			block = tail;
+			length = extra;
+			tail = NULL;
+			extra = 0;
+		}
+
+		// Offloaded connections are encrypted by the kernel, so they're written just like a plain TCP connection.
+		if (con->network.tls && !con->network.offloaded) {
+			bytes = tls_write(con->network.tls, block, length, true);
+		}
+		else if (extra) {
+			vector[0].iov_base = block;
+			vector[0].iov_len = length;
+			vector[1].iov_base = tail;
+			vector[1].iov_len = extra;
+			bytes = tcp_writev(con->network.sockd, vector, 2, true);
 		}
 		else {
-			bytes = tcp_write(con->network.sockd, block + position, length, true);
+			bytes = tcp_write(con->network.sockd, block, length, true);
 		}
 
-		// Handle progress by advancing our position tracker.
+		stats_increment_by_num(stats_intern(&write_syscalls, "network.output.syscalls"));
+
+		// Handle progress by advancing our position tracker. A vectored write may finish part way into the second block.
 		if (bytes > 0) {
 			counter = 0;
-			length -= bytes;
 			position += bytes;
+
+			if ((size_t)bytes >= length) {
+				bytes -= length;
+				block = tail + bytes;
+				length = extra - bytes;
+				tail = NULL;
+				extra = 0;
+			}
+			else {
+				block += bytes;
+				length -= bytes;
+			}
 		}
 		else if (bytes == 0) {
 			usleep(1000);
@@ -59,9 +87,9 @@ int64_t con_write_bl(connection_t *con, char *block, size_t length) {
 			return -1;
 		}
 
-	} while (length && counter++ < 128 && status());
+	} while ((length || extra) && counter++ < 128 && status());
 
-	if (bytes > 0) {
+	if (position > 0) {
 		con->network.status = 1;
 	}
 
@@ -106,6 +134,104 @@ int64_t con_write_bl(connection_t *con, char *block, size_t length) {
 
 }
 
+/**
+ * @brief	Send any output being held in a connection's output buffer.
+ * @note	This function is called when a protocol handler finishes a command, before the connection waits for more input, and before
+ * 			a connection switches to TLS or is closed, so a response is never left sitting in the buffer.
+ * @param	con		the connection whose pending output should be sent.
+ * @return	-1 on general network failure, or the number of bytes that were written across the connection.
+ */
+int64_t con_flush(connection_t *con) {
+
+	int64_t result;
+
+	if (!con || !con->network.output || !st_length_get(con->network.output)) {
+		return 0;
+	}
+	else if (con->network.sockd == -1 || con->network.status < 0) {
+		st_length_set(con->network.output, 0);
+		return -1;
+	}
+
+	result = con_write_direct(con, st_char_get(con->network.output), st_length_get(con->network.output), NULL, 0);
+	st_length_set(con->network.output, 0);
+	stats_increment_by_num(stats_intern(&write_flushes, "network.output.flushes"));
+
+	return result;
+}
+
+/**
+ * @brief	Release the output buffer of a connection which is about to be parked.
+ * @note	A parked connection can wait indefinitely for its next command, so rather than holding MAGMA_CONNECTION_OUTPUT_SIZE bytes for
+ * 			every idle client, the buffer is freed, and allocated again by the first write of the next command. The caller must flush
+ * 			the buffer first, and must release it before the connection can be handed to another worker.
+ * @param	con		the connection being parked.
+ * @return	This function returns no value.
+ */
+void con_release(connection_t *con) {
+
+	if (con && con->network.output && !st_length_get(con->network.output)) {
+		st_free(con->network.output);
+		con->network.output = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Write data to a network connection.
+ * @note	Small writes are collected in the connection's output buffer, and sent once the command finishes. If the data won't fit in the
+ * 			buffer, the pending output and the new data are sent together, with the socket corked so the kernel builds full frames out of
+ * 			the pieces, and the trailing partial frame is released as soon as the last piece has been handed over.
+ * @param	con		the connection across which the supplied data will be written.
+ * @param	block	a pointer to a data buffer containing the data to be written to the connection's remote client.
+ * @param	length	the length, in bytes, of the data buffer to be written.
+ * @return	-1 on general network failure, -2 if the connection was reset or closed, or the number of bytes that were written across the connection.
+ */
+int64_t con_write_bl(connection_t *con, char *block, size_t length) {
+
+	int64_t result;
+	stringer_t *output;
+
+	// Only the cached status is checked, since querying the socket would cost more system calls than buffering the output saves.
+	if (!con || con->network.sockd == -1 || con->network.status < 0) {
+		return -1;
+	}
+	else if (!block || !length) {
+		con->network.status = 0;
+		return 0;
+	}
+
+	// If the output buffer can't be allocated, fall back to sending the data immediately.
+	if (!(output = con->network.output) && !(output = con->network.output = st_alloc(MAGMA_CONNECTION_OUTPUT_SIZE))) {
+		return con_write_direct(con, block, length, NULL, 0);
+	}
+
+	// The data fits, so hold onto it until the command finishes.
+	if (st_length_get(output) + length <= st_avail_get(output)) {
+		mm_copy(st_char_get(output) + st_length_get(output), block, length);
+		st_length_set(output, st_length_get(output) + length);
+		return length;
+	}
+
+	// The buffer has reached its high water mark, so send the pending output along with the new data.
+	net_set_cork(con->network.sockd, true);
+
+	if (con->network.tls && !con->network.offloaded) {
+		result = st_length_get(output) && con_write_direct(con, st_char_get(output), st_length_get(output), NULL, 0) < 0 ? -1 :
+			con_write_direct(con, block, length, NULL, 0);
+	}
+	else if ((result = con_write_direct(con, st_char_get(output), st_length_get(output), block, length)) > 0) {
+		result -= st_length_get(output);
+	}
+
+	net_set_cork(con->network.sockd, false);
+	st_length_set(output, 0);
+	stats_increment_by_num(stats_intern(&write_flushes, "network.output.flushes"));
+
+	return result;
+}
+
 /**
  * @brief	Write a managed string to a network connection.
  * @see		con_write_bl()
@@ -165,6 +291,25 @@ int64_t con_print(connection_t *con, chr_t *format, ...) {
 		con->network.status = 0;
 		return 0;
 	}
+	else if (con->network.status < 0) {
+		return -1;
+	}
+
+	// Try formatting the string directly into the output buffer, which avoids copying it when the result fits.
+	if (con->network.output && st_avail_get(con->network.output) - st_length_get(con->network.output) > 1) {
+
+		buffer = st_char_get(con->network.output) + st_length_get(con->network.output);
+		bytes = st_avail_get(con->network.output) - st_length_get(con->network.output);
+
+		va_start(args, format);
+		length = vsnprintf(buffer, bytes, format, args);
+		va_end(args);
+
+		if (length < bytes) {
+			st_length_set(con->network.output, st_length_get(con->network.output) + length);
+			return length;
+		}
+	}
 
 	// See if the string will fit inside the standard thread buffer.
 	va_start(args, format);
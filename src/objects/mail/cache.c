@@ -1,14 +1,101 @@
-
 /**
  * @file /magma/objects/mail/cache.c
  *
- * @brief	Functions used to cache a mail message in its parsed form.
+ * @brief	Functions used to cache a mail message in its decompressed form.
+ *
+ * Messages are cached at two levels. Each thread remembers the last message it loaded, which serves the common case of a client pulling
+ * a message in small pieces over a single connection. Behind that sits a process wide cache, split into independently locked shards,
+ * which lets a message decompressed by one worker be reused by the others. Each shard keeps its entries on a least recently used list,
+ * and evicts from the tail whenever its share of magma.storage.cache_size is exceeded. Entries are reference counted, so a reader copying
+ * a message out of the cache keeps it valid even if the entry is evicted, and freed, in the meantime.
  */
 
 #include "magma.h"
 
 static pthread_key_t mail_cache;
 
+typedef struct {
+	size_t bytes;
+	pthread_mutex_t lock;
+	mail_cache_entry_t *head, *tail;
+	mail_cache_entry_t *buckets[MAGMA_STORAGE_CACHE_BUCKETS];
+} mail_cache_shard_t;
+
+struct {
+	size_t limit;
+	mail_cache_shard_t shards[MAGMA_STORAGE_CACHE_SHARDS];
+} mail_shared = {
+	.limit = 0
+};
+
+// The interned ids of the cache statistics, which are updated by every lookup.
+static uint64_t mail_cache_hits = 0, mail_cache_misses = 0, mail_cache_evictions = 0;
+
+/**
+ * @brief	Hash a message key, so entries are spread evenly across the shards and their buckets.
+ */
+static uint64_t mail_cache_hash(uint64_t usernum, uint64_t messagenum) {
+
+	uint64_t hash = (usernum * 0x9E3779B97F4A7C15ULL) ^ messagenum;
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/**
+ * @brief	Free a shared cache entry.
+ * @param	entry	the entry to be freed.
+ * @return	This function returns no value.
+ */
+static void mail_cache_entry_free(mail_cache_entry_t *entry) {
+
+	if (entry) {
+		st_cleanup(entry->text);
+		mm_free(entry);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Remove an entry from its shard's hash chain and recently used list.
+ * @note	The shard lock must be held by the caller. The entry is only freed if no readers are still holding a reference to it.
+ * @param	shard	the shard holding the entry.
+ * @param	entry	the entry to be removed.
+ * @return	This function returns no value.
+ */
+static void mail_cache_entry_remove(mail_cache_shard_t *shard, mail_cache_entry_t *entry) {
+
+	mail_cache_entry_t **chain = &(shard->buckets[(mail_cache_hash(entry->usernum, entry->messagenum) / MAGMA_STORAGE_CACHE_SHARDS) % MAGMA_STORAGE_CACHE_BUCKETS]);
+
+	while (*chain && *chain != entry) {
+		chain = &((*chain)->chain);
+	}
+
+	if (*chain) {
+		*chain = entry->chain;
+	}
+
+	if (entry->prev) entry->prev->next = entry->next;
+	else shard->head = entry->next;
+
+	if (entry->next) entry->next->prev = entry->prev;
+	else shard->tail = entry->prev;
+
+	shard->bytes -= st_length_get(entry->text);
+	entry->prev = entry->next = entry->chain = NULL;
+	entry->detached = true;
+
+	if (!entry->refs) {
+		mail_cache_entry_free(entry);
+	}
+
+	return;
+}
+
 /**
  * @brief	Free a cached mail message.
  * @param	holder	a pointer to the cached mail message object to be freed.
@@ -27,7 +114,7 @@ void mail_cache_destroy(void *holder) {
 }
 
 /**
- * @brief	Initialize the thread-specific data key used for the mail message cache.
+ * @brief	Initialize the thread-specific data key used for the mail message cache, and the shared message cache.
  * @return	true on success or false on failure.
  */
 bool_t mail_cache_start(void) {
@@ -37,19 +124,44 @@ bool_t mail_cache_start(void) {
 		 return false;
 	 }
 
+	 for (uint64_t i = 0; i < MAGMA_STORAGE_CACHE_SHARDS; i++) {
+		 mm_wipe(&(mail_shared.shards[i]), sizeof(mail_cache_shard_t));
+		 if (mutex_init(&(mail_shared.shards[i].lock), NULL)) {
+			 log_pedantic("Unable to initialize the shared message cache locks.");
+			 return false;
+		 }
+	 }
+
+	 mail_shared.limit = magma.storage.cache_size;
+
 	 return true;
 }
 
 /**
- * @brief	Destroy the thread-specific data key used for the mail message cache.
+ * @brief	Destroy the thread-specific data key used for the mail message cache, and free the shared message cache.
  * @return	This function returns no value.
  */
 void mail_cache_stop(void) {
 
+	mail_cache_entry_t *entry;
+
 	if (pthread_key_delete(mail_cache) != 0) {
 		log_pedantic("Unable to delete the thread local message cache.");
 	}
 
+	mail_shared.limit = 0;
+
+	for (uint64_t i = 0; i < MAGMA_STORAGE_CACHE_SHARDS; i++) {
+
+		mutex_lock(&(mail_shared.shards[i].lock));
+		while ((entry = mail_shared.shards[i].head)) {
+			mail_cache_entry_remove(&(mail_shared.shards[i]), entry);
+		}
+		mutex_unlock(&(mail_shared.shards[i].lock));
+
+		mutex_destroy(&(mail_shared.shards[i].lock));
+	}
+
 	return;
 }
 
@@ -70,24 +182,116 @@ void mail_cache_thread_stop(void) {
 }
 
 /**
- * @brief	Attempt to retrieve the contents of a message from the thread's cached data.
- * @note	The thread's cache only has the capacity to store a single message.
+ * @brief	Attempt to retrieve the contents of a message from the thread's cached data, or the shared message cache.
+ * @note	The message is copied out of the shared cache without holding the shard lock. The reference held during the copy keeps the
+ * 			entry alive if it gets evicted by another thread.
+ * @param	usernum			the numerical id of the user who owns the message.
  * @param	messagenum		the id of the message to be retrieved.
+ * @param	shared			if false, only the thread's cached data is checked, which is the case for encrypted messages.
  * @return	NULL on failure or a managed string containing the message data on success.
  */
-stringer_t * mail_cache_get(uint64_t messagenum) {
+stringer_t * mail_cache_get(uint64_t usernum, uint64_t messagenum, bool_t shared) {
 
+	uint64_t hash;
+	stringer_t *result;
 	mail_cache_t *message;
+	mail_cache_shard_t *shard;
+	mail_cache_entry_t *entry;
 
-	if (!(message = pthread_getspecific(mail_cache))) {
+	if ((message = pthread_getspecific(mail_cache)) && message->usernum == usernum && message->messagenum == messagenum) {
+		stats_increment_by_num(stats_intern(&mail_cache_hits, "objects.messages.cache.hits"));
+		return st_dupe(message->text);
+	}
+	else if (!shared || !mail_shared.limit) {
 		return NULL;
 	}
 
-	if (message->messagenum == messagenum) {
-		return st_dupe(message->text);
+	hash = mail_cache_hash(usernum, messagenum);
+	shard = &(mail_shared.shards[hash % MAGMA_STORAGE_CACHE_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+
+	entry = shard->buckets[(hash / MAGMA_STORAGE_CACHE_SHARDS) % MAGMA_STORAGE_CACHE_BUCKETS];
+	while (entry && (entry->usernum != usernum || entry->messagenum != messagenum)) {
+		entry = entry->chain;
 	}
 
-	return NULL;
+	if (!entry) {
+		mutex_unlock(&(shard->lock));
+		stats_increment_by_num(stats_intern(&mail_cache_misses, "objects.messages.cache.misses"));
+		return NULL;
+	}
+
+	// Move the entry to the front of the recently used list.
+	if (entry != shard->head) {
+
+		entry->prev->next = entry->next;
+		if (entry->next) entry->next->prev = entry->prev;
+		else shard->tail = entry->prev;
+
+		entry->prev = NULL;
+		entry->next = shard->head;
+		shard->head->prev = entry;
+		shard->head = entry;
+	}
+
+	entry->refs++;
+	mutex_unlock(&(shard->lock));
+
+	result = st_dupe(entry->text);
+
+	// If the entry was evicted while we were copying it, the last reference is responsible for freeing it.
+	mutex_lock(&(shard->lock));
+	if (!--entry->refs && entry->detached) {
+		mail_cache_entry_free(entry);
+	}
+	mutex_unlock(&(shard->lock));
+
+	stats_increment_by_num(stats_intern(&mail_cache_hits, "objects.messages.cache.hits"));
+	return result;
+}
+
+/**
+ * @brief	Remove a message from the thread's cached data, and the shared message cache.
+ * @note	This must be called whenever the stored form of a message changes, or the message is deleted, so a stale copy of the plain
+ * 			text isn't returned by a later load. A reader already copying the message out of the shared cache keeps its reference, and
+ * 			frees the entry once it finishes.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message.
+ * @return	This function returns no value.
+ */
+void mail_cache_remove(uint64_t usernum, uint64_t messagenum) {
+
+	uint64_t hash;
+	mail_cache_t *message;
+	mail_cache_shard_t *shard;
+	mail_cache_entry_t *entry;
+
+	if ((message = pthread_getspecific(mail_cache)) && message->usernum == usernum && message->messagenum == messagenum) {
+		mail_cache_reset();
+	}
+
+	if (!mail_shared.limit) {
+		return;
+	}
+
+	hash = mail_cache_hash(usernum, messagenum);
+	shard = &(mail_shared.shards[hash % MAGMA_STORAGE_CACHE_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+
+	entry = shard->buckets[(hash / MAGMA_STORAGE_CACHE_SHARDS) % MAGMA_STORAGE_CACHE_BUCKETS];
+	while (entry && (entry->usernum != usernum || entry->messagenum != messagenum)) {
+		entry = entry->chain;
+	}
+
+	if (entry) {
+		mail_cache_entry_remove(shard, entry);
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	return;
 }
 
 /**
@@ -101,6 +305,7 @@ void mail_cache_reset(void) {
 	if ((message = pthread_getspecific(mail_cache))) {
 		st_cleanup(message->text);
 		message->text = NULL;
+		message->usernum = 0;
 		message->messagenum = 0;
 		mm_free(message);
 		pthread_setspecific(mail_cache, NULL);
@@ -110,15 +315,91 @@ void mail_cache_reset(void) {
 }
 
 /**
- * @brief	Set the contents of the thread's mail cache.
+ * @brief	Add a message to the shared message cache, evicting the least recently used messages if the shard is over its limit.
+ * @param	usernum		the numerical id of the user who owns the message.
  * @param	messagenum	the numerical id of the message to be cached.
- * @text	a managed string containing the contents of the specified message to be cached.
+ * @param	text		a managed string containing the decompressed message.
  * @return	This function returns no value.
  */
-void mail_cache_set(uint64_t messagenum, stringer_t *text) {
+static void mail_cache_share(uint64_t usernum, uint64_t messagenum, stringer_t *text) {
+
+	uint64_t hash;
+	size_t evicted = 0;
+	mail_cache_shard_t *shard;
+	mail_cache_entry_t *entry, *existing, **bucket;
+
+	// Messages which would take up more than a quarter of a shard would only push everything else out.
+	if (!mail_shared.limit || st_length_get(text) > (mail_shared.limit / MAGMA_STORAGE_CACHE_SHARDS) / 4) {
+		return;
+	}
+
+	// Copy the message before taking the lock.
+	if (!(entry = mm_alloc(sizeof(mail_cache_entry_t))) || !(entry->text = st_dupe_opts(MANAGED_T | HEAP | CONTIGUOUS, text))) {
+		mm_cleanup(entry);
+		return;
+	}
+
+	entry->usernum = usernum;
+	entry->messagenum = messagenum;
+
+	hash = mail_cache_hash(usernum, messagenum);
+	shard = &(mail_shared.shards[hash % MAGMA_STORAGE_CACHE_SHARDS]);
+	bucket = &(shard->buckets[(hash / MAGMA_STORAGE_CACHE_SHARDS) % MAGMA_STORAGE_CACHE_BUCKETS]);
+
+	mutex_lock(&(shard->lock));
+
+	// Another thread may have loaded, and cached, the same message while we were working.
+	existing = *bucket;
+	while (existing && (existing->usernum != usernum || existing->messagenum != messagenum)) {
+		existing = existing->chain;
+	}
+
+	if (existing) {
+		mutex_unlock(&(shard->lock));
+		mail_cache_entry_free(entry);
+		return;
+	}
+
+	entry->chain = *bucket;
+	*bucket = entry;
+
+	entry->next = shard->head;
+	if (shard->head) shard->head->prev = entry;
+	else shard->tail = entry;
+	shard->head = entry;
+
+	shard->bytes += st_length_get(entry->text);
+
+	while (shard->bytes > mail_shared.limit / MAGMA_STORAGE_CACHE_SHARDS && shard->tail != entry) {
+		mail_cache_entry_remove(shard, shard->tail);
+		evicted++;
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	if (evicted) {
+		stats_adjust_by_num(stats_intern(&mail_cache_evictions, "objects.messages.cache.evictions"), evicted);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Set the contents of the thread's mail cache, and optionally add the message to the shared message cache.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message to be cached.
+ * @param	text		a managed string containing the contents of the specified message to be cached.
+ * @param	shared		if true, the message is also made available to the other threads.
+ * @return	This function returns no value.
+ */
+void mail_cache_set(uint64_t usernum, uint64_t messagenum, stringer_t *text, bool_t shared) {
 
 	mail_cache_t *message;
 
+	if (shared) {
+		mail_cache_share(usernum, messagenum, text);
+	}
+
 	if (!(message = pthread_getspecific(mail_cache))) {
 
 		if (!(message = mm_alloc(sizeof(mail_cache_t)))) {
@@ -135,6 +416,7 @@ void mail_cache_set(uint64_t messagenum, stringer_t *text) {
 		st_cleanup(message->text);
 	}
 
+	message->usernum = usernum;
 	message->messagenum = messagenum;
 	message->text = st_dupe_opts(MANAGED_T | HEAP | CONTIGUOUS, text);
 
@@ -23,7 +23,7 @@ void mail_destroy_header(stringer_t *header) {
  * @note	This function fixes broken line separators by making sure each \r is followed by \n and vice versa.
  * 			All Return-Path: header lines are also removed.
  * 			New lines are begun whenever the current length of any line reaches the configuration value set in magma.smtp.wrap_line_length.
- * 			The trailing dot at the end of the smtp DATA command is also stripped.
+ * 			The terminating dot, and any dot stuffing, should already have been removed by smtp_data_scan().
  * @note	If the original message ends with \r, it will have \n appended to it.
  * @param	message		a pointer to a managed string that contains the message input, and will also store the cleaned output on success.
  * @return	true on success or false on failure.
@@ -118,18 +118,12 @@ bool_t mail_message_cleanup(stringer_t **message) {
 				header = 0;
 			}
 
-			// Look for the return path and dotstuffs.
+			// Look for the return path.
 			if (next == 1 && *orig != '\n') {
 
 				if (length - increment >= 12 && mm_cmp_ci_eq(orig, "Return-Path:", 12) == 0) {
 					skip = 1;
 				}
-				else if (length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
-					skip = 1;
-				}
-				else if (length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
-					skip = 2;
-				}
 				else if (skip != 0) {
 					skip = 0;
 				}
@@ -142,28 +136,9 @@ bool_t mail_message_cleanup(stringer_t **message) {
 				next = 1;
 			}
 		}
-		else {
-			// Now were just looking for dotstuffs.
-			if (next == 1 && *orig != '\n') {
-
-				if (length - increment >= 2 && *orig == '.' && (*(orig + 1) == '\r' || *(orig + 1) == '\n')) {
-					skip = 1;
-				}
-				else if (length - increment >= 2 && *orig == '.' && *(orig + 1) == '.') {
-					skip = 2;
-				}
-				else if (skip != 0) {
-					skip = 0;
-				}
-
-				next = 0;
-			}
-
-			// So we check the start of the next line for the return path.
-			if (next == 0 && (*orig == '\n' || *orig == '\r')) {
-				next = 1;
-			}
-
+		// The header has ended, so stop skipping the return path.
+		else if (skip != 0) {
+			skip = 0;
 		}
 
 		// Copy into the new buffer, replacing invalid sequences as we go, and skipping the rejected lines.
@@ -212,9 +187,6 @@ bool_t mail_message_cleanup(stringer_t **message) {
 			}*/
 
 		}
-		else if (skip == 2) {
-			skip = 0;
-		}
 
 		orig++;
 	}
@@ -8,41 +8,20 @@
 #include "magma.h"
 
 /**
- * @brief	Load a stored mail message from disk.
- * @note	The mail message will always, at the very least, be compressed using the lzo algorithm; however, on-disk encryption may be enabled.
- 			If parsing is enabled, a spam signature training link may be embedded in the message.
+ * @brief	Read a stored mail message from disk, and decrypt or decompress it.
  * @param	meta	the meta message object of the message to be loaded from disk.
  * @param	user	the meta user object of the user that owns the requested message.
- * @param	server	the server object of the web server where the spam teacher application is hosted.
- * @param	parse	if true, the header's Subject line is branded with any applicable labels such as JUNK, INFECTED, SPOOFED, BLACKHOLED, PHISHING.
- * @return	NULL on failure or a a mail message object containing the retrieved mail message data on success.
+ * @return	NULL on failure or a managed string containing the message text on success.
  */
-mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, server_t *server, bool_t parse) {
+static stringer_t * mail_load_message_data(meta_message_t *meta, meta_user_t *user) {
 
 	int_t fd;
 	chr_t *path;
 	size_t data_len;
 	struct stat file_info;
 	compress_t *compressed;
-	mail_message_t *result;
 	message_header_t header;
-	stringer_t *raw, *message;
-
-	if (!meta || (parse && (!user || !server))) {
-		log_pedantic("Invalid parameter combination passed in.");
-		return NULL;
-	}
-
-	// Check the thread local message cache first.
-	if ((message = mail_cache_get(meta->messagenum))) {
-
-		if (!(result = mail_message(message))) {
-			log_pedantic("Unable to build the message structure.");
-			return NULL;
-		}
-
-		return result;
-	}
+	stringer_t *raw, *message = NULL;
 
 	if (!(path = mail_message_path(meta->messagenum, meta->server))) {
 		log_pedantic("Could not build the message path.");
@@ -176,7 +155,46 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 	// Finally free the path.
 	ns_free(path);
 
-	// Only modify and cache the message if parsing is enabled.
+	return message;
+}
+
+/**
+ * @brief	Load a stored mail message from disk.
+ * @note	The mail message will always, at the very least, be compressed using the lzo algorithm; however, on-disk encryption may be enabled.
+ 			If parsing is enabled, a spam signature training link may be embedded in the message.
+ * @param	meta	the meta message object of the message to be loaded from disk.
+ * @param	user	the meta user object of the user that owns the requested message.
+ * @param	server	the server object of the web server where the spam teacher application is hosted.
+ * @param	parse	if true, the header's Subject line is branded with any applicable labels such as JUNK, INFECTED, SPOOFED, BLACKHOLED, PHISHING.
+ * @return	NULL on failure or a a mail message object containing the retrieved mail message data on success.
+ */
+mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, server_t *server, bool_t parse) {
+
+	mail_message_t *result;
+	stringer_t *message;
+
+	if (!meta || (parse && (!user || !server))) {
+		log_pedantic("Invalid parameter combination passed in.");
+		return NULL;
+	}
+
+	// Check the message caches first. The caches hold the message as it was stored, so the subject and signature changes below are
+	// applied every time the message is loaded. Encrypted messages are never looked up in the shared cache, so a plain text copy left
+	// there before the message was encrypted can't be returned.
+	if (!(message = mail_cache_get(user ? user->usernum : 0, meta->messagenum, user && !(meta->status & MAIL_STATUS_ENCRYPTED)))) {
+
+		if (!(message = mail_load_message_data(meta, user))) {
+			return NULL;
+		}
+
+		// Set the caches. We use a thread cache since some IMAP clients like to pull messages in chunks leading to lots of serialized
+		// requests for small pieces of the same message. The shared cache lets other threads skip the disk read and decompression when
+		// those requests land on a different worker. Encrypted messages are kept out of the shared cache, so their plain text only ever
+		// lives on the thread that decrypted it.
+		mail_cache_set(user ? user->usernum : 0, meta->messagenum, message, user && !(meta->status & MAIL_STATUS_ENCRYPTED));
+	}
+
+	// Only modify the message if parsing is enabled.
 	if (parse) {
 
 		// Modify the subject, if necessary.
@@ -214,11 +232,6 @@ mail_message_t * mail_load_message(meta_message_t *meta, meta_user_t *user, serv
 		return NULL;
 	}
 
-	// Set thread cache. We use a thread cache since some IMAP clients like to pull messages in chunks leading to
-	// lots of serialized requests for small pieces of the same message. Thread caching avoids having to process the
-	// message repeatedly.
-	mail_cache_set(meta->messagenum, result->text);
-
 	return result;
 }
 
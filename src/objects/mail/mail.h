@@ -12,10 +12,19 @@
 #define MAIL_SIGNATURES_RECURSION_LIMIT 16
 
 typedef struct {
+	uint64_t usernum;
 	uint64_t messagenum;
 	stringer_t *text;
 } mail_cache_t;
 
+typedef struct mail_cache_entry {
+	uint64_t refs; /* The number of readers currently copying the message text. */
+	bool_t detached; /* Set once the entry has been evicted, so the last reader knows to free it. */
+	uint64_t usernum, messagenum;
+	stringer_t *text;
+	struct mail_cache_entry *prev, *next, *chain;
+} mail_cache_entry_t;
+
 typedef struct {
 	placer_t to;
 	placer_t from;
@@ -46,9 +55,10 @@ typedef struct {
 
 /// cache.c
 void          mail_cache_destroy(void *holder);
-stringer_t *  mail_cache_get(uint64_t messagenum);
+stringer_t *  mail_cache_get(uint64_t usernum, uint64_t messagenum, bool_t shared);
+void          mail_cache_remove(uint64_t usernum, uint64_t messagenum);
 void          mail_cache_reset(void);
-void          mail_cache_set(uint64_t messagenum, stringer_t *text);
+void          mail_cache_set(uint64_t usernum, uint64_t messagenum, stringer_t *text, bool_t shared);
 bool_t        mail_cache_start(void);
 void          mail_cache_stop(void);
 void          mail_cache_thread_stop(void);
@@ -101,6 +111,7 @@ stringer_t *   mail_mime_type_group(placer_t header);
 array_t *      mail_mime_type_parameters(placer_t header);
 stringer_t *   mail_mime_type_parameters_key(stringer_t *parameter);
 stringer_t *   mail_mime_type_parameters_value(stringer_t *parameter);
+stringer_t *   mail_mime_text(mail_mime_t *mime);
 stringer_t *   mail_mime_type_sub(placer_t header);
 int_t          mail_mime_update(mail_message_t *message);
 media_type_t * mail_mime_get_media_type (chr_t *extension);
@@ -146,4 +157,8 @@ int_t      mail_move_message(uint64_t usernum, uint64_t messagenum, uint64_t sou
 uint64_t   mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernum, uint32_t *status, uint64_t signum, uint64_t sigkey, stringer_t *message);
 bool_t     mail_store_message_data(uint64_t messagenum, uint8_t fflags, stringer_t *data, chr_t **pathptr);
 
+/// sync.c
+bool_t   mail_sync_commit(int fd);
+void     mail_sync_flush(int *fds, int_t *results, size_t count);
+
 #endif
@@ -1007,6 +1007,89 @@ int_t mail_mime_update(mail_message_t *message) {
 	return 1;
 }
 
+/**
+ * @brief	Append the searchable text of a MIME part, and its children, to a managed string.
+ * @param	mime	the MIME part being appended.
+ * @param	output	a pointer to the managed string which receives the text, and which is allocated if it's NULL.
+ * @return	true on success, or false on failure.
+ */
+static bool_t mail_mime_text_append(mail_mime_t *mime, stringer_t **output) {
+
+	mail_mime_t *child;
+	stringer_t *holder, *decoded = NULL;
+
+	// The headers of each child part are kept, since they hold the names of any attachments.
+	if (mime->children) {
+
+		for (size_t i = 0; i < ar_length_get(mime->children); i++) {
+
+			if (!(child = (mail_mime_t *)ar_field_ptr(mime->children, i))) {
+				continue;
+			}
+			else if (!pl_empty(child->header) && !(holder = st_append(*output, &(child->header)))) {
+				return false;
+			}
+			else if (!pl_empty(child->header)) {
+				*output = holder;
+			}
+
+			if (!mail_mime_text_append(child, output)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Attachments are skipped, because the decoded data isn't text, and the encoded data would only match by accident.
+	else if (mime->type == MESSAGE_TYPE_UNKNOWN || pl_empty(mime->body)) {
+		return true;
+	}
+	else if (mime->encoding == MESSAGE_ENCODING_BASE64 && !(decoded = base64_decode(&(mime->body), NULL))) {
+		return false;
+	}
+	else if (mime->encoding == MESSAGE_ENCODING_QUOTED_PRINTABLE && !(decoded = qp_decode(&(mime->body)))) {
+		return false;
+	}
+
+	if (decoded && st_empty(decoded)) {
+		st_free(decoded);
+		return true;
+	}
+	else if (!(holder = st_append(*output, decoded ? decoded : &(mime->body)))) {
+		st_cleanup(decoded);
+		return false;
+	}
+
+	*output = holder;
+	st_cleanup(decoded);
+
+	return true;
+}
+
+/**
+ * @brief	Get the text of a message body which is matched by searches, with the base64 and quoted-printable encoded parts decoded.
+ * @note	The result holds the decoded text parts, along with the headers of any child parts, but the top level header isn't included.
+ * 			The full text search index is built from the same text, so the index and the search agree on what a message contains.
+ * @param	mime	the parsed MIME structure of the message.
+ * @return	NULL if the message has no searchable text, or on failure, otherwise a managed string which must be freed by the caller.
+ */
+stringer_t * mail_mime_text(mail_mime_t *mime) {
+
+	stringer_t *result = NULL;
+
+	if (!mime) {
+		return NULL;
+	}
+	else if (!mail_mime_text_append(mime, &result)) {
+		log_pedantic("Unable to decode the searchable text of a message.");
+		st_cleanup(result);
+		return NULL;
+	}
+
+	return result;
+}
+
 /**
  * @brief	Generate a MIME boundary string that is unique to a collection of content.
  * @param	parts	a pointer to an array of managed strings containing the MIME children data to be separated by the boundary.
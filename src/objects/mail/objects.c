@@ -7,6 +7,9 @@
 
 #include "magma.h"
 
+/// Mail message shells are created, and destroyed, every time a message is loaded, so they're held by a slab cache.
+static slab_t mail_message_slab = SLAB_CACHE("mail.messages", sizeof(mail_message_t));
+
 /**
  * @brief	Destroy an smtp message and free all of its underlying data.
  * @param	message		a pointer to the smtp message to be destroyed.
@@ -84,7 +87,7 @@ void mail_destroy(mail_message_t *message) {
 			mail_mime_free(message->mime);
 		}
 
-		mm_free(message);
+		slab_put(&mail_message_slab, message);
 	}
 
 	return;
@@ -108,8 +111,8 @@ mail_message_t * mail_message(stringer_t *text) {
 		return NULL;
 	}
 
-	if (!(result = mm_alloc(sizeof(mail_message_t)))) {
-		log_pedantic("Unable to allocate %zu bytes for the SMTP message structure.", sizeof(smtp_message_t));
+	if (!(result = slab_get(&mail_message_slab))) {
+		log_pedantic("Unable to allocate %zu bytes for the mail message structure.", sizeof(mail_message_t));
 		return NULL;
 	}
 
@@ -122,7 +125,7 @@ mail_message_t * mail_message(stringer_t *text) {
 
 	if (length > st_length_get(result->text)) {
 		log_pedantic("The header length is longer than the message.");
-		mm_free(result);
+		slab_put(&mail_message_slab, result);
 		return NULL;
 	}
 
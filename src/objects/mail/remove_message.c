@@ -48,6 +48,10 @@ bool_t mail_remove_message(uint64_t usernum, uint64_t messagenum, uint32_t size,
 		return false;
 	}
 
+	// The message number can now be compacted out of the full text search index, and any cached copies can be dropped.
+	fulltext_remove(usernum, messagenum);
+	mail_cache_remove(usernum, messagenum);
+
 	// Unlink the file. We return success even if the unlink operation fails because the database record has already been removed. The result
 	// is an orphaned file that will someday need to be cleaned.
 	if ((state = unlink(path)) != 0) {
@@ -39,10 +39,10 @@ bool_t mail_store_message_data(uint64_t messagenum, uint8_t flags, stringer_t *d
 	}
 
 	// If we can't open the file, try creating the directory, and then opening the file again.
-	if ((fd = open(path, O_CREAT | O_WRONLY | O_TRUNC | O_SYNC, S_IRUSR | S_IWUSR)) < 0) {
+	if ((fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR)) < 0) {
 
 		if (mail_create_directory(messagenum, NULL)) {
-			fd = open(path, O_CREAT | O_WRONLY | O_TRUNC | O_SYNC, S_IRUSR | S_IWUSR);
+			fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
 		}
 
 	}
@@ -64,8 +64,8 @@ bool_t mail_store_message_data(uint64_t messagenum, uint8_t flags, stringer_t *d
 		return false;
 	}
 
-	// Flush the buffer.
-	if (fsync(fd) != 0) {
+	// Wait for the data to reach the disk. Concurrent deliveries are flushed together using a single group commit.
+	if (!mail_sync_commit(fd)) {
 		log_error("Could not flush the write buffers to disk. { errno = %i }", errno);
 		close(fd);
 		unlink(path);
@@ -105,8 +105,9 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 	chr_t *path;
 	uint64_t messagenum;
 	bool_t store_result;
+	mail_mime_t *mime = NULL;
 	compress_t *reduced = NULL;
-	stringer_t *encrypted = NULL;
+	stringer_t *encrypted = NULL, *text = NULL, *searchable = NULL, *raw = NULL;
 	int64_t transaction = -1, result = 0;
 	uint8_t flags = 0;
 
@@ -176,6 +177,23 @@ uint64_t mail_store_message(uint64_t usernum, prime_t *signet, uint64_t foldernu
 		return 0;
 	}
 
+	// Add the message to the full text search index. Encrypted messages are skipped, so the index doesn't expose their contents. The index
+	// is built from the header, the decoded text parts, which is the same text TEXT searches match against, and the raw body lines
+	// which BODY searches can match. A failure here isn't fatal, since searches will simply fall back to scanning the message.
+	if (!signet && (mime = mail_mime_part(message, 1))) {
+		text = mail_mime_text(mime);
+		raw = fulltext_raw(&(mime->body));
+
+		if ((searchable = st_merge("sss", &(mime->header), text, raw))) {
+			fulltext_index(usernum, messagenum, searchable);
+		}
+
+		st_cleanup(searchable);
+		st_cleanup(text);
+		st_cleanup(raw);
+		mail_mime_free(mime);
+	}
+
 	ns_free(path);
 	return messagenum;
 }
@@ -0,0 +1,147 @@
+
+/**
+ * @file /magma/objects/mail/sync.c
+ *
+ * @brief	Group commit logic, which lets concurrent message deliveries share a single flush of the storage file system.
+ */
+
+#include "magma.h"
+
+struct {
+	pthread_mutex_t lock;
+	pthread_cond_t done; /* Broadcast when a batch has been taken by its leader, and again once it has been flushed. */
+	pthread_cond_t full; /* Signaled when the batch fills up, so the leader can flush it without waiting for the window to close. */
+	size_t count; /* The number of descriptors waiting in the current batch. */
+	bool_t gathering; /* Set while a leader is waiting for the batch window to close. */
+	int fds[MAGMA_STORAGE_SYNC_BATCH];
+	int_t *outcomes[MAGMA_STORAGE_SYNC_BATCH];
+} commits = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.done = PTHREAD_COND_INITIALIZER,
+		.full = PTHREAD_COND_INITIALIZER,
+		.count = 0,
+		.gathering = false
+};
+
+/**
+ * @brief	Flush a batch of file descriptors to disk, issuing a single syncfs() call for each file system the batch touches.
+ * @param	fds			an array of file descriptors to be flushed.
+ * @param	results		an array which will receive 1 for each descriptor that was flushed, or -1 if the flush failed.
+ * @param	count		the number of descriptors in the batch.
+ * @return	This function returns no value.
+ */
+void mail_sync_flush(int *fds, int_t *results, size_t count) {
+
+	size_t j, unique = 0;
+	struct stat info;
+	dev_t devices[MAGMA_STORAGE_SYNC_BATCH];
+	int_t flushed[MAGMA_STORAGE_SYNC_BATCH];
+
+	for (size_t i = 0; i < count; i++) {
+
+		if (fstat(fds[i], &info)) {
+			results[i] = -1;
+			continue;
+		}
+
+		// Reuse the result if an earlier descriptor in the batch lives on the same file system.
+		for (j = 0; j < unique && devices[j] != info.st_dev; j++);
+
+		if (j == unique) {
+			devices[unique] = info.st_dev;
+
+			if ((flushed[unique++] = syncfs(fds[i]) ? -1 : 1) < 0) {
+				log_error("Could not flush the write buffers to disk. { errno = %i }", errno);
+			}
+		}
+
+		results[i] = flushed[j];
+	}
+
+	return;
+}
+
+/**
+ * @brief	Wait until the data written to a file descriptor has been flushed to disk.
+ * @note	The first thread to arrive becomes the leader of a new batch. It waits up to magma.storage.sync_window milliseconds, so other
+ * 			deliveries can join the batch, and then flushes the file system once on behalf of every member. The member which fills the
+ * 			batch wakes the leader, so a full batch is flushed at once, and any thread arriving while the batch is full waits to join the
+ * 			next one. If the window is set to zero, the descriptor is flushed immediately using fdatasync().
+ * @param	fd	the file descriptor to be flushed.
+ * @return	true if the data reached the disk, or false on failure.
+ */
+bool_t mail_sync_commit(int fd) {
+
+	size_t count;
+	int_t outcome = 0;
+	struct timespec deadline;
+	int fds[MAGMA_STORAGE_SYNC_BATCH];
+	int_t *outcomes[MAGMA_STORAGE_SYNC_BATCH], results[MAGMA_STORAGE_SYNC_BATCH];
+
+	if (!magma.storage.sync_window) {
+		return fdatasync(fd) ? false : true;
+	}
+
+	mutex_lock(&commits.lock);
+
+	// A full batch is about to be taken by its leader, so wait, and then join the next one.
+	while (commits.count == MAGMA_STORAGE_SYNC_BATCH) {
+		pthread_cond_wait(&commits.done, &commits.lock);
+	}
+
+	commits.fds[commits.count] = fd;
+	commits.outcomes[commits.count++] = &outcome;
+
+	// Followers wait for the leader to flush the batch, and the follower which fills it wakes the leader up.
+	if (commits.gathering) {
+
+		if (commits.count == MAGMA_STORAGE_SYNC_BATCH) {
+			pthread_cond_signal(&commits.full);
+		}
+
+		while (!outcome) {
+			pthread_cond_wait(&commits.done, &commits.lock);
+		}
+
+		mutex_unlock(&commits.lock);
+		return outcome > 0;
+	}
+
+	// Otherwise we become the leader, and give the other deliveries a chance to join us, until the window closes or the batch fills.
+	commits.gathering = true;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += magma.storage.sync_window / 1000;
+	deadline.tv_nsec += (magma.storage.sync_window % 1000) * 1000000;
+
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	while (commits.count < MAGMA_STORAGE_SYNC_BATCH && pthread_cond_timedwait(&commits.full, &commits.lock, &deadline) != ETIMEDOUT);
+
+	// Take ownership of the batch, and wake anybody waiting on a full batch, so new arrivals can start gathering the next one while we
+	// flush this one.
+	count = commits.count;
+	mm_copy(fds, commits.fds, sizeof(int) * count);
+	mm_copy(outcomes, commits.outcomes, sizeof(int_t *) * count);
+	commits.count = 0;
+	commits.gathering = false;
+	pthread_cond_broadcast(&commits.done);
+	mutex_unlock(&commits.lock);
+
+	mail_sync_flush(fds, results, count);
+
+	// Hand every member of the batch its result, and wake them up.
+	mutex_lock(&commits.lock);
+
+	for (size_t i = 0; i < count; i++) {
+		*outcomes[i] = results[i];
+	}
+
+	pthread_cond_broadcast(&commits.done);
+	mutex_unlock(&commits.lock);
+
+	return outcome > 0;
+}
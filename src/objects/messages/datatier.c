@@ -117,7 +117,7 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 	row_t *row;
 	multi_t key;
 	table_t *result;
-	inx_cursor_t *cursor;
+	meta_index_t *index;
 	MYSQL_BIND parameters[1];
 	meta_message_t *message;
 
@@ -149,7 +149,14 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 	if (!(result = stmt_get_result(stmts.select_messages, parameters))) {
 		return false;
 	}
+
+	// The message index is filled from the same rows, so it never has to be built by walking, and sorting, the messages collection.
+	else if (!(index = meta_index_alloc(res_row_count(result)))) {
+		res_table_free(result);
+		return false;
+	}
 	else if (!(row = res_row_next(result))) {
+		meta_index_publish(user, index);
 		res_table_free(result);
 		return true;
 	}
@@ -159,12 +166,14 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 		// We are using a fixed server name buffer of 33 bytes, so make sure the server name is 32 bytes or less.
 		if (res_field_length(row, 2) > 32) {
 			log_error("The server name found in the database was longer than 32 bytes. {usernum = %lu}", user->usernum);
+			meta_index_publish(user, index);
 			res_table_free(result);
 			return false;
 		}
 
-		else if (!(message = mm_alloc(sizeof(meta_message_t)))) {
+		else if (!(message = meta_message_alloc())) {
 			log_pedantic("Could not allocate %zu bytes to hold the message meta information.", sizeof(meta_message_t));
+			meta_index_publish(user, index);
 			res_table_free(result);
 			return false;
 		}
@@ -181,7 +190,8 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 
 		if (!message->messagenum || !message->foldernum || !message->size || *(message->server) == '\0') {
 			log_error("One of the critical message variables was zero or NULL. {usernum = %lu}", user->usernum);
-			mm_free(message);
+			meta_message_free(message);
+			meta_index_publish(user, index);
 			res_table_free(result);
 			return false;
 		}
@@ -189,32 +199,29 @@ bool_t meta_data_fetch_messages(meta_user_t *user) {
 		key.type = M_TYPE_UINT64;
 		key.val.u64 = message->messagenum;
 
-		// Add this message to the structure.
+		// Add this message to the structure. On failure the index is still published, since it holds the same messages as the collection.
 		if (!inx_append(user->messages, key, message)) {
 			log_error("Could not append the message to the linked list.");
-			mm_free(message);
+			meta_message_free(message);
+			meta_index_publish(user, index);
 			res_table_free(result);
 			return false;
 		}
 
+		meta_index_append(index, message);
 		row = res_row_next(result);
 	}
 
 	res_table_free(result);
 
-	if ((cursor = inx_cursor_alloc(user->messages))) {
-
-		while ((message = inx_cursor_value_next(cursor))) {
-
-			if (message->status & MAIL_STATUS_TAGGED) {
-				meta_data_fetch_message_tags(message);
-			}
-
+	for (size_t i = 0; i < index->count; i++) {
+		if (index->flags[i] & MAIL_STATUS_TAGGED) {
+			meta_data_fetch_message_tags(index->messages[i]);
 		}
-
-		inx_cursor_free(cursor);
 	}
 
+	meta_index_publish(user, index);
+
 	/// TODO: Do we still need this once the refactorization is complete?
 	/*if (meta_check_message_encryption(user) < 0) {
 		log_info("Storage encryption check failed on messages for user: %s", st_char_get(user->username));
@@ -0,0 +1,663 @@
+
+/**
+ * @file /magma/objects/messages/index.c
+ *
+ * @brief	Functions used to maintain a struct of arrays index of a user's messages.
+ *
+ * The index is filled directly from the database rows when a user's messages are loaded, and then kept current as messages are added,
+ * removed, moved, and flagged, so it only has to be rebuilt from the messages collection if a change was made without telling it. Since
+ * a published index is never altered in place, adding, or removing, a message copies the arrays into a replacement, and the replaced
+ * index is kept until the user is write locked, since readers may still be using it. The one exception is the flags array, which holds
+ * the authoritative flags of each message, and is updated in place, so a flag change doesn't cost a copy. Messages are sorted by folder,
+ * and then by message number, which means the slice belonging to a folder is in UID order, and matches the order used to assign
+ * sequence numbers.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Compare two messages by folder, and then by message number, for use with qsort().
+ */
+static int meta_index_compare(const void *one, const void *two) {
+
+	meta_message_t *a = *(meta_message_t **)one, *b = *(meta_message_t **)two;
+
+	if (a->foldernum != b->foldernum) {
+		return a->foldernum < b->foldernum ? -1 : 1;
+	}
+
+	return a->messagenum < b->messagenum ? -1 : a->messagenum > b->messagenum;
+}
+
+/// Returned when an index can't be built, so callers always receive a valid, if empty, index.
+static meta_index_t meta_index_empty = { .count = 0 };
+
+/**
+ * @brief	Free a message index, along with its arrays.
+ * @param	index	the index to be freed.
+ * @return	This function returns no value.
+ */
+static void meta_index_release(meta_index_t *index) {
+
+	if (!index || index == &meta_index_empty) {
+		return;
+	}
+
+	mm_cleanup(index->messagenums);
+	mm_cleanup(index->foldernums);
+	mm_cleanup(index->created);
+	mm_cleanup(index->flags);
+	mm_cleanup(index->sizes);
+	mm_cleanup(index->messages);
+	mm_free(index);
+
+	return;
+}
+
+/**
+ * @brief	Allocate an empty message index with room for a number of messages.
+ * @param	total	the number of messages the index should be able to hold.
+ * @return	NULL on failure, or a pointer to the newly allocated index.
+ */
+meta_index_t * meta_index_alloc(size_t total) {
+
+	meta_index_t *index;
+
+	if (!(index = mm_alloc(sizeof(meta_index_t)))) {
+		log_pedantic("Unable to allocate the message index.");
+		return NULL;
+	}
+	else if (!total) {
+		return index;
+	}
+
+	if (!(index->messagenums = mm_alloc(sizeof(uint64_t) * total)) || !(index->foldernums = mm_alloc(sizeof(uint64_t) * total)) ||
+		!(index->created = mm_alloc(sizeof(uint64_t) * total)) || !(index->flags = mm_alloc(sizeof(uint32_t) * total)) ||
+		!(index->sizes = mm_alloc(sizeof(uint32_t) * total)) || !(index->messages = mm_alloc(sizeof(meta_message_t *) * total))) {
+		log_pedantic("Unable to allocate the message index. { count = %zu }", total);
+		meta_index_release(index);
+		return NULL;
+	}
+
+	index->capacity = total;
+	return index;
+}
+
+/**
+ * @brief	Store a message at a position in a message index.
+ * @param	index	the message index.
+ * @param	i		the position which will hold the message.
+ * @param	message	the meta message object.
+ * @return	This function returns no value.
+ */
+static void meta_index_set(meta_index_t *index, size_t i, meta_message_t *message) {
+
+	index->messagenums[i] = message->messagenum;
+	index->foldernums[i] = message->foldernum;
+	index->created[i] = message->created;
+	index->flags[i] = message->status;
+	index->sizes[i] = message->size;
+	index->messages[i] = message;
+
+	if (message->messagenum > index->highest) {
+		index->highest = message->messagenum;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Copy a range of positions from one message index into another.
+ * @param	target	the index receiving the messages.
+ * @param	to		the first position in the target index.
+ * @param	source	the index holding the messages.
+ * @param	from	the first position in the source index.
+ * @param	count	the number of positions to copy.
+ * @return	This function returns no value.
+ */
+static void meta_index_copy(meta_index_t *target, size_t to, meta_index_t *source, size_t from, size_t count) {
+
+	if (!count) {
+		return;
+	}
+
+	mm_copy(target->messagenums + to, source->messagenums + from, sizeof(uint64_t) * count);
+	mm_copy(target->foldernums + to, source->foldernums + from, sizeof(uint64_t) * count);
+	mm_copy(target->created + to, source->created + from, sizeof(uint64_t) * count);
+	mm_copy(target->sizes + to, source->sizes + from, sizeof(uint32_t) * count);
+	mm_copy(target->messages + to, source->messages + from, sizeof(meta_message_t *) * count);
+
+	// The flags may be changing underneath us, so each value is loaded atomically.
+	for (size_t i = 0; i < count; i++) {
+		target->flags[to + i] = __atomic_load_n(&(source->flags[from + i]), __ATOMIC_RELAXED);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Find the first position in a message index which doesn't sort before a folder and message number.
+ * @param	index		the message index.
+ * @param	foldernum	the numerical id of the folder.
+ * @param	messagenum	the numerical id of the message.
+ * @return	the position found, or the index count if every message sorts before the values provided.
+ */
+static size_t meta_index_position(meta_index_t *index, uint64_t foldernum, uint64_t messagenum) {
+
+	size_t low = 0, high = index->count, middle;
+
+	while (low < high) {
+
+		middle = low + ((high - low) / 2);
+
+		if (index->foldernums[middle] < foldernum || (index->foldernums[middle] == foldernum && index->messagenums[middle] < messagenum)) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+/**
+ * @brief	Build a new message index from a messages collection.
+ * @param	messages	the messages collection.
+ * @return	NULL on failure, or a pointer to the newly allocated index.
+ */
+static meta_index_t * meta_index_build(inx_t *messages) {
+
+	size_t count = 0, total;
+	meta_index_t *index;
+	inx_cursor_t *cursor;
+	meta_message_t *message;
+
+	total = messages ? inx_count(messages) : 0;
+
+	if (!(index = meta_index_alloc(total)) || !total) {
+		return index;
+	}
+	else if (!(cursor = inx_cursor_alloc(messages))) {
+		meta_index_release(index);
+		return NULL;
+	}
+
+	while (count < total && (message = inx_cursor_value_next(cursor))) {
+		index->messages[count++] = message;
+	}
+
+	inx_cursor_free(cursor);
+
+	qsort(index->messages, count, sizeof(meta_message_t *), &meta_index_compare);
+
+	for (size_t i = 0; i < count; i++) {
+		meta_index_set(index, i, index->messages[i]);
+	}
+
+	index->count = count;
+	return index;
+}
+
+/**
+ * @brief	Add a message loaded from the database to the end of a message index allocated by meta_index_alloc().
+ * @note	The messages are expected to arrive in message number order, and are only sorted by folder once meta_index_publish() is called.
+ * @param	index	the message index.
+ * @param	message	the meta message object.
+ * @return	true if the message was added, or false if the index is full.
+ */
+bool_t meta_index_append(meta_index_t *index, meta_message_t *message) {
+
+	if (index->count >= index->capacity) {
+		return false;
+	}
+
+	meta_index_set(index, index->count++, message);
+	return true;
+}
+
+/**
+ * @brief	Find the first position in a sorted array of folder numbers which doesn't hold a lower folder number.
+ * @param	distinct	the sorted array of folder numbers.
+ * @param	folders		the number of folder numbers in the array.
+ * @param	foldernum	the folder number being searched for.
+ * @return	the position found, or folders if every folder number in the array is lower.
+ */
+static size_t meta_index_bucket(uint64_t *distinct, size_t folders, uint64_t foldernum) {
+
+	size_t low = 0, high = folders, middle;
+
+	while (low < high) {
+		middle = low + ((high - low) / 2);
+		if (distinct[middle] < foldernum) low = middle + 1;
+		else high = middle;
+	}
+
+	return low;
+}
+
+/**
+ * @brief	Make an index the current message index of a user, and retire the index it replaces.
+ * @note	The caller must hold the index lock, and the index must match the current state of the user's messages collection.
+ * @param	user	the meta user object.
+ * @param	index	the replacement index.
+ * @return	This function returns no value.
+ */
+static void meta_index_replace(meta_user_t *user, meta_index_t *index) {
+
+	if (user->index.current) {
+		user->index.current->retired = user->index.retired;
+		user->index.retired = user->index.current;
+	}
+
+	user->index.current = index;
+	user->index.source = user->messages;
+	user->index.serial = user->messages ? inx_serial(user->messages) : 0;
+	user->index.stale = false;
+
+	return;
+}
+
+/**
+ * @brief	Group the messages of an index built by meta_index_append() by folder, and publish it as the user's current message index.
+ * @note	The caller must hold a write lock on the meta user object, and the index must hold every message in the messages collection.
+ * 			Since the messages arrived in message number order, a stable distribution by folder leaves each folder in UID order, without
+ * 			having to sort the messages.
+ * @param	user	the meta user object.
+ * @param	index	the message index, which is consumed by the function.
+ * @return	true on success, or false if the index couldn't be published, in which case it will be rebuilt when it's next used.
+ */
+bool_t meta_index_publish(meta_user_t *user, meta_index_t *index) {
+
+	meta_index_t *sorted;
+	size_t folders = 0, low, *offsets = NULL;
+	uint64_t *distinct = NULL;
+
+	if (!index) {
+		return false;
+	}
+
+	// Find the distinct folders, which are kept sorted, so each message can find its folder with a binary search.
+	if (index->count && !(distinct = mm_alloc(sizeof(uint64_t) * index->count))) {
+		meta_index_release(index);
+		return false;
+	}
+
+	for (size_t i = 0; i < index->count; i++) {
+
+		low = meta_index_bucket(distinct, folders, index->foldernums[i]);
+
+		if (low == folders || distinct[low] != index->foldernums[i]) {
+			mm_move(distinct + low + 1, distinct + low, sizeof(uint64_t) * (folders - low));
+			distinct[low] = index->foldernums[i];
+			folders++;
+		}
+	}
+
+	if (!(sorted = meta_index_alloc(index->count)) || (folders && !(offsets = mm_alloc(sizeof(size_t) * (folders + 1))))) {
+		meta_index_release(sorted);
+		meta_index_release(index);
+		mm_cleanup(distinct);
+		return false;
+	}
+
+	// Count the messages in each folder, and then turn the counts into starting positions.
+	for (size_t i = 0; i < index->count; i++) {
+		offsets[meta_index_bucket(distinct, folders, index->foldernums[i]) + 1]++;
+	}
+
+	for (size_t i = 1; i <= folders; i++) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	for (size_t i = 0; i < index->count; i++) {
+		meta_index_copy(sorted, offsets[meta_index_bucket(distinct, folders, index->foldernums[i])]++, index, i, 1);
+	}
+
+	sorted->count = index->count;
+	sorted->highest = index->highest;
+
+	meta_index_release(index);
+	mm_cleanup(distinct);
+	mm_cleanup(offsets);
+
+	// If a message couldn't be added to the index, it's published anyway, but marked stale, so it will be rebuilt when it's next used.
+	mutex_lock(&(user->index.lock));
+	meta_index_replace(user, sorted);
+	user->index.stale = user->messages && inx_count(user->messages) != sorted->count;
+	mutex_unlock(&(user->index.lock));
+
+	return true;
+}
+
+/**
+ * @brief	Initialize the message index held by a meta user object.
+ * @param	user	the meta user object.
+ * @return	true on success, or false on failure.
+ */
+bool_t meta_index_init(meta_user_t *user) {
+
+	mm_wipe(&(user->index), sizeof(user->index));
+
+	if (mutex_init(&(user->index.lock), NULL) != 0) {
+		log_pedantic("Unable to initialize the message index lock.");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Free the indexes which were replaced since the meta user object was last write locked.
+ * @note	The caller must hold a write lock on the meta user object, which guarantees no reader is still using a replaced index.
+ * @param	user	the meta user object.
+ * @return	This function returns no value.
+ */
+void meta_index_reclaim(meta_user_t *user) {
+
+	meta_index_t *retired;
+
+	while ((retired = user->index.retired)) {
+		user->index.retired = retired->retired;
+		meta_index_release(retired);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free the message index held by a meta user object.
+ * @param	user	the meta user object.
+ * @return	This function returns no value.
+ */
+void meta_index_free(meta_user_t *user) {
+
+	meta_index_reclaim(user);
+	meta_index_release(user->index.current);
+	user->index.current = NULL;
+	mutex_destroy(&(user->index.lock));
+
+	return;
+}
+
+/**
+ * @brief	Copy a message index, with a message inserted at its sorted position.
+ * @param	current	the message index.
+ * @param	message	the meta message object to be inserted.
+ * @return	NULL on failure, or a pointer to the new index.
+ */
+static meta_index_t * meta_index_with(meta_index_t *current, meta_message_t *message) {
+
+	size_t position;
+	meta_index_t *result;
+
+	if (!(result = meta_index_alloc(current->count + 1))) {
+		return NULL;
+	}
+
+	position = meta_index_position(current, message->foldernum, message->messagenum);
+
+	meta_index_copy(result, 0, current, 0, position);
+	meta_index_copy(result, position + 1, current, position, current->count - position);
+
+	result->count = current->count + 1;
+	result->highest = current->highest;
+	meta_index_set(result, position, message);
+
+	return result;
+}
+
+/**
+ * @brief	Copy a message index, without one of its messages.
+ * @param	current		the message index.
+ * @param	foldernum	the numerical id of the folder holding the message.
+ * @param	messagenum	the numerical id of the message.
+ * @return	NULL if the message wasn't found, or the copy failed, otherwise a pointer to the new index.
+ */
+static meta_index_t * meta_index_without(meta_index_t *current, uint64_t foldernum, uint64_t messagenum) {
+
+	size_t position;
+	meta_index_t *result;
+
+	if ((position = meta_index_position(current, foldernum, messagenum)) >= current->count || current->foldernums[position] != foldernum ||
+		current->messagenums[position] != messagenum || !(result = meta_index_alloc(current->count - 1))) {
+		return NULL;
+	}
+
+	meta_index_copy(result, 0, current, 0, position);
+	meta_index_copy(result, position, current, position + 1, current->count - position - 1);
+	result->count = current->count - 1;
+
+	// The highest message number only needs to be found again if it belonged to the message which was removed.
+	if ((result->highest = current->highest) == messagenum) {
+		result->highest = 0;
+		for (size_t i = 0; i < result->count; i++) {
+			if (result->messagenums[i] > result->highest) result->highest = result->messagenums[i];
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Determine whether the current index reflected the messages collection before a single addition, or removal, was made to it.
+ * @note	The caller must hold the index lock. Each addition to, or removal from, a collection increments its serial number by one.
+ * @param	user	the meta user object.
+ * @return	true if the current index can be updated to reflect the change, or false if it has to be rebuilt anyway.
+ */
+static bool_t meta_index_behind(meta_user_t *user) {
+
+	return user->index.current && !user->index.stale && user->messages && user->index.source == user->messages &&
+		user->index.serial + 1 == inx_serial(user->messages);
+}
+
+/**
+ * @brief	Add a message to the current index, after it was added to the messages collection.
+ * @note	The caller must hold a write lock on the meta user object. The arrays are copied into a replacement index, so readers of the
+ * 			current index aren't disturbed. If the index was already out of date, or the copy fails, it will be rebuilt when it's next used.
+ * @param	user	the meta user object.
+ * @param	message	the meta message object which was added.
+ * @return	This function returns no value.
+ */
+void meta_index_insert(meta_user_t *user, meta_message_t *message) {
+
+	meta_index_t *replacement;
+
+	mutex_lock(&(user->index.lock));
+
+	if (meta_index_behind(user) && (replacement = meta_index_with(user->index.current, message))) {
+		meta_index_replace(user, replacement);
+	}
+
+	mutex_unlock(&(user->index.lock));
+
+	return;
+}
+
+/**
+ * @brief	Remove a message from the current index, after it was removed from the messages collection.
+ * @note	The caller must hold a write lock on the meta user object. The message object has usually been freed by now, so it's identified
+ * 			by its folder and message number. If the index was already out of date, or the copy fails, it will be rebuilt when it's next used.
+ * @param	user		the meta user object.
+ * @param	foldernum	the numerical id of the folder which held the message.
+ * @param	messagenum	the numerical id of the message.
+ * @return	This function returns no value.
+ */
+void meta_index_remove(meta_user_t *user, uint64_t foldernum, uint64_t messagenum) {
+
+	meta_index_t *replacement;
+
+	mutex_lock(&(user->index.lock));
+
+	if (meta_index_behind(user) && (replacement = meta_index_without(user->index.current, foldernum, messagenum))) {
+		meta_index_replace(user, replacement);
+	}
+
+	mutex_unlock(&(user->index.lock));
+
+	return;
+}
+
+/**
+ * @brief	Move a message to another folder, updating both the message object and the current index.
+ * @note	The caller must hold a write lock on the meta user object. The messages collection doesn't change, so if the index can't be
+ * 			updated, it's marked stale, and rebuilt when it's next used.
+ * @param	user		the meta user object.
+ * @param	message		the meta message object being moved.
+ * @param	foldernum	the numerical id of the folder the message is being moved to.
+ * @return	This function returns no value.
+ */
+void meta_index_move(meta_user_t *user, meta_message_t *message, uint64_t foldernum) {
+
+	uint64_t previous = message->foldernum;
+	meta_index_t *removed = NULL, *replacement = NULL;
+
+	mutex_lock(&(user->index.lock));
+
+	message->foldernum = foldernum;
+
+	if (user->index.current && !user->index.stale && user->messages && user->index.source == user->messages &&
+		user->index.serial == inx_serial(user->messages) && (removed = meta_index_without(user->index.current, previous, message->messagenum)) &&
+		(replacement = meta_index_with(removed, message))) {
+		meta_index_replace(user, replacement);
+	}
+	else {
+		user->index.stale = true;
+	}
+
+	meta_index_release(removed);
+	mutex_unlock(&(user->index.lock));
+
+	return;
+}
+
+/**
+ * @brief	Change the flags of a message, updating both the message object and the current index.
+ * @note	The flags array of the current index is updated in place, since it holds the authoritative flags for each message, which
+ * 			means the index never has to be rebuilt, or rescanned, to pick up a flag change.
+ * @param	user	the meta user object.
+ * @param	message	the meta message object.
+ * @param	status	the new flags for the message.
+ * @return	This function returns no value.
+ */
+void meta_index_status(meta_user_t *user, meta_message_t *message, uint32_t status) {
+
+	size_t position;
+	meta_index_t *current;
+
+	message->status = status;
+
+	mutex_lock(&(user->index.lock));
+
+	if ((current = user->index.current) && (position = meta_index_position(current, message->foldernum, message->messagenum)) < current->count &&
+		current->messages[position] == message) {
+		__atomic_store_n(&(current->flags[position]), status, __ATOMIC_RELAXED);
+	}
+
+	mutex_unlock(&(user->index.lock));
+
+	return;
+}
+
+/**
+ * @brief	Get the message index for a user, building a replacement if the messages collection has changed.
+ * @note	The caller must hold a lock on the meta user object, and must not use the index after releasing it. A replacement is built
+ * 			alongside the current index, which is retired rather than freed, since other readers may still be using it.
+ * @param	user	the meta user object.
+ * @return	a pointer to the user's message index, which will be empty if a replacement was needed but couldn't be built.
+ */
+meta_index_t * meta_index_get(meta_user_t *user) {
+
+	meta_index_t *index, *replacement;
+
+	mutex_lock(&(user->index.lock));
+
+	if (user->index.current && !user->index.stale && user->index.source == user->messages &&
+		(!user->messages || user->index.serial == inx_serial(user->messages))) {
+		index = user->index.current;
+	}
+	// If the build fails, the index stays stale, and the next caller will try again.
+	else if (!(replacement = meta_index_build(user->messages))) {
+		index = &meta_index_empty;
+	}
+	else {
+		meta_index_replace(user, (index = replacement));
+	}
+
+	mutex_unlock(&(user->index.lock));
+
+	return index;
+}
+
+/**
+ * @brief	Find the first position in a slice of the index with a message number greater than or equal to a value.
+ * @param	index		the message index.
+ * @param	first		the first position of the slice.
+ * @param	last		the position after the end of the slice.
+ * @param	messagenum	the message number being searched for.
+ * @return	the position found, or last if every message in the slice has a lower message number.
+ */
+size_t meta_index_uid(meta_index_t *index, size_t first, size_t last, uint64_t messagenum) {
+
+	size_t middle;
+
+	while (first < last) {
+
+		middle = first + ((last - first) / 2);
+
+		if (index->messagenums[middle] < messagenum) first = middle + 1;
+		else last = middle;
+	}
+
+	return first;
+}
+
+/**
+ * @brief	Find the slice of the index holding the messages of a folder.
+ * @param	index		the message index.
+ * @param	foldernum	the numerical id of the folder.
+ * @param	first		a pointer to receive the first position of the folder slice.
+ * @param	last		a pointer to receive the position after the end of the folder slice.
+ * @return	the number of messages in the folder.
+ */
+size_t meta_index_folder(meta_index_t *index, uint64_t foldernum, size_t *first, size_t *last) {
+
+	size_t low = 0, high = index->count, middle;
+
+	while (low < high) {
+		middle = low + ((high - low) / 2);
+		if (index->foldernums[middle] < foldernum) low = middle + 1;
+		else high = middle;
+	}
+
+	*first = low;
+	high = index->count;
+
+	while (low < high) {
+		middle = low + ((high - low) / 2);
+		if (index->foldernums[middle] <= foldernum) low = middle + 1;
+		else high = middle;
+	}
+
+	*last = low;
+
+	return *last - *first;
+}
+
+/**
+ * @brief	Find a message in the index using its folder and message number.
+ * @param	index		the message index.
+ * @param	foldernum	the numerical id of the folder holding the message.
+ * @param	messagenum	the numerical id of the message.
+ * @return	NULL if the message wasn't found, or a pointer to the meta message object.
+ */
+meta_message_t * meta_index_find(meta_index_t *index, uint64_t foldernum, uint64_t messagenum) {
+
+	size_t position = meta_index_position(index, foldernum, messagenum);
+
+	if (position < index->count && index->foldernums[position] == foldernum && index->messagenums[position] == messagenum) {
+		return index->messages[position];
+	}
+
+	return NULL;
+}
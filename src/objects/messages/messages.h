@@ -118,7 +118,24 @@ message_t *  message_alloc(uint64_t messagenum, uint64_t created, uint64_t signa
 void         message_free(message_t *message);
 inx_t *      messages_update(uint64_t usernum);
 
+/// index.c
+meta_index_t *    meta_index_alloc(size_t total);
+bool_t            meta_index_append(meta_index_t *index, meta_message_t *message);
+meta_message_t *  meta_index_find(meta_index_t *index, uint64_t foldernum, uint64_t messagenum);
+size_t            meta_index_folder(meta_index_t *index, uint64_t foldernum, size_t *first, size_t *last);
+void              meta_index_free(meta_user_t *user);
+meta_index_t *    meta_index_get(meta_user_t *user);
+bool_t            meta_index_init(meta_user_t *user);
+void              meta_index_insert(meta_user_t *user, meta_message_t *message);
+void              meta_index_move(meta_user_t *user, meta_message_t *message, uint64_t foldernum);
+bool_t            meta_index_publish(meta_user_t *user, meta_index_t *index);
+void              meta_index_reclaim(meta_user_t *user);
+void              meta_index_remove(meta_user_t *user, uint64_t foldernum, uint64_t messagenum);
+void              meta_index_status(meta_user_t *user, meta_message_t *message, uint32_t status);
+size_t            meta_index_uid(meta_index_t *index, size_t first, size_t last, uint64_t messagenum);
+
 /// meta.c
+meta_message_t *  meta_message_alloc(void);
 meta_message_t *  meta_message_by_number(inx_t *messages, uint64_t number);
 meta_message_t *  meta_message_dupe(meta_message_t *message);
 void              meta_message_free(meta_message_t *message);
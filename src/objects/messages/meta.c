@@ -7,6 +7,17 @@
 
 #include "magma.h"
 
+/// Meta message objects are created for every message in a mailbox, so they're held by a slab cache.
+static slab_t meta_message_slab = SLAB_CACHE("meta.messages", sizeof(meta_message_t));
+
+/**
+ * @brief	Allocate a zeroed meta message object.
+ * @return	NULL on failure, or a pointer to the new meta message object on success.
+ */
+meta_message_t * meta_message_alloc(void) {
+	return slab_get(&meta_message_slab);
+}
+
 /**
  * @brief	Free a meta message object (and its tags).
  * @return	This function returns no value.
@@ -19,7 +30,7 @@ void meta_message_free(meta_message_t *message) {
 			ar_free(message->tags);
 		}
 
-		mm_free(message);
+		slab_put(&meta_message_slab, message);
 	}
 
 	return;
@@ -34,7 +45,9 @@ meta_message_t * meta_message_dupe(meta_message_t *message) {
 
 	meta_message_t *result = NULL;
 
-	if (message && (result = mm_dupe(message, sizeof(meta_message_t)))) {
+	if (message && (result = meta_message_alloc())) {
+
+		mm_copy(result, message, sizeof(meta_message_t));
 
 		if (message->tags) {
 			result->tags = ar_dupe(message->tags);
@@ -286,7 +299,10 @@ bool_t meta_messages_copier(meta_user_t *user, meta_message_t *message, uint64_t
 
 	if (!inx_insert(user->messages, key, new)) {
 		log_error("Failed to insert message copy into user's messages.");
-		mm_free(new);
+		meta_message_free(new);
+	}
+	else {
+		meta_index_insert(user, new);
 	}
 
 	// If this operation is part of a much larger one we might want to wait until the end to update the message sequence numbers.
@@ -351,11 +367,11 @@ int_t meta_messages_mover(meta_user_t *user, meta_message_t *message, uint64_t t
 		return -1;
 	}
 
-	// Update the message context so it uses the new folder.
-	message->foldernum = target;
+	// Update the message context so it uses the new folder. The collection itself hasn't changed, so the message index needs to be told.
+	meta_index_move(user, message, target);
 
 	// New messages in a folder should be distinguished by the recent flag.
-	message->status |= MAIL_STATUS_RECENT;
+	meta_index_status(user, message, message->status | MAIL_STATUS_RECENT);
 
 	// If this operation is part of a much larger one we might want to wait until the end to update the message sequence numbers.
 	if (sequences) {
@@ -258,6 +258,9 @@ int_t meta_crypto_keys_create(uint64_t usernum, stringer_t *username, stringer_t
 		return false;
 	}
 
+	// The cached plain text no longer matches the stored form of the message.
+	mail_cache_remove(user->usernum, message->messagenum);
+
 	// QUESTION: What do we do if rename() succeeds but the transaction fails?
 	if (tran_commit(transaction)) {
 		log_pedantic("Transaction commit for file encryption failed.");
@@ -305,7 +308,7 @@ void encrypt_user_messages(meta_user_t *user) {
 	if (pending) {
 		log_info("Failed to encrypt entire queued message batch. Submitting for sleep + reprocessing.");
 		// QUESTION: Is this how we do it?
-		enqueue(encrypt_user_messages, user);
+		enqueue_priority(QUEUE_BACKGROUND, encrypt_user_messages, user);
 	} else {
 		log_info("Message encryption batch successfully completed for user: %s", st_char_get(user->username));
 		meta_user_ref_dec(user, META_PROTOCOL_GENERIC);
@@ -351,7 +354,7 @@ void decrypt_user_messages(meta_user_t *user) {
 	if (pending) {
 		log_info("Failed to decrypt entire queued message batch. Submitting for sleep + reprocessing.");
 		// QUESTION: Is this how we do it?
-		enqueue(encrypt_user_messages, user);
+		enqueue_priority(QUEUE_BACKGROUND, encrypt_user_messages, user);
 	} else {
 		log_info("Message decryption batch successfully completed for user: %s", st_char_get(user->username));
 		meta_user_ref_dec(user, META_PROTOCOL_GENERIC);
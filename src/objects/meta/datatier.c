@@ -723,86 +723,139 @@ inx_t * meta_data_fetch_alerts(uint64_t usernum) {
 }
 
 /**
- * @brief	Remove all user (non-system) flags from a collection of mail messages, and set the specified flags mask for them.
+ * @brief	Apply a flag update to a collection of mail messages, UPDATE_MESSAGE_FLAGS_BATCH messages at a time, inside a single transaction.
  *
- * @note	The new mask can contain both user and system flags, but only user flags will be stripped from each message initially.
+ * @note	The last batch is padded by repeating its final message number, so every batch can use the same prepared statement.
  *
+ * @param	statement	the prepared flag update statement.
+ * @param	masks		an array holding the flag masks which precede the usernum in the statement parameters.
+ * @param	count		the number of flag masks.
  * @param	messages	an inx holder containing the collection of messages to have their flags updated.
- * @param	usernum		the numerical of the user to whom the target messages belong, for validation purposes.
- * @param	foldernum	the numerical id of the parent folder containing the messages to be updated, for validation purposes.
- * @param	flags		a mask of all flags that are to be added to any matching messages in the collection.
+ * @param	usernum		the numerical id of the user to whom the target messages belong.
+ * @param	foldernum	the numerical id of the parent folder containing the messages to be updated.
  *
- * @return	true on success or false on failure.
+ * @return	true on success or false on failure, in which case none of the messages are updated.
  */
-bool_t meta_data_flags_replace(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags) {
+static bool_t meta_data_flags_update(MYSQL_STMT **statement, uint32_t *masks, size_t count, inx_t *messages, uint64_t usernum, uint64_t foldernum) {
 
+	size_t used;
+	int64_t transaction;
 	inx_cursor_t *cursor;
 	meta_message_t *active;
-	MYSQL_BIND parameters[6];
-	uint32_t complete = MAIL_STATUS_USER_FLAGS;
 	bool_t result = true;
+	uint64_t messagenums[UPDATE_MESSAGE_FLAGS_BATCH];
+	MYSQL_BIND parameters[3 + 2 + UPDATE_MESSAGE_FLAGS_BATCH];
 
-	// Sanity check.
-	if (!messages || !usernum || !foldernum) {
+	if (!(cursor = inx_cursor_alloc(messages))) {
 		return false;
 	}
 
-	// Iterate through and see if any messages have the recent flag set. Store the range.
-	if ((cursor = inx_cursor_alloc(messages))) {
+	mm_wipe(parameters, sizeof(parameters));
+
+	// Flag Masks
+	for (size_t i = 0; i < count; i++) {
+		parameters[i].buffer_type = MYSQL_TYPE_LONG;
+		parameters[i].buffer_length = sizeof(uint32_t);
+		parameters[i].buffer = &(masks[i]);
+		parameters[i].is_unsigned = true;
+	}
+
+	// Usernum
+	parameters[count].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[count].buffer_length = sizeof(uint64_t);
+	parameters[count].buffer = &usernum;
+	parameters[count].is_unsigned = true;
 
-		while ((active = inx_cursor_value_next(cursor))) {
+	// Foldernum
+	parameters[count + 1].buffer_type = MYSQL_TYPE_LONGLONG;
+	parameters[count + 1].buffer_length = sizeof(uint64_t);
+	parameters[count + 1].buffer = &foldernum;
+	parameters[count + 1].is_unsigned = true;
+
+	// Message Numbers
+	for (size_t i = 0; i < UPDATE_MESSAGE_FLAGS_BATCH; i++) {
+		parameters[count + 2 + i].buffer_type = MYSQL_TYPE_LONGLONG;
+		parameters[count + 2 + i].buffer_length = sizeof(uint64_t);
+		parameters[count + 2 + i].buffer = &(messagenums[i]);
+		parameters[count + 2 + i].is_unsigned = true;
+	}
 
-			if (active->foldernum == foldernum) {
+	if ((transaction = tran_start()) < 0) {
+		log_pedantic("Could not start a transaction. { transaction = %li }", transaction);
+		inx_cursor_free(cursor);
+		return false;
+	}
 
-				mm_wipe(parameters, sizeof(parameters));
-
-				// Complete
-				parameters[0].buffer_type = MYSQL_TYPE_LONG;
-				parameters[0].buffer_length = sizeof(uint32_t);
-				parameters[0].buffer = &complete;
-				parameters[0].is_unsigned = true;
-
-				// Complete
-				parameters[1].buffer_type = MYSQL_TYPE_LONG;
-				parameters[1].buffer_length = sizeof(uint32_t);
-				parameters[1].buffer = &complete;
-				parameters[1].is_unsigned = true;
-
-				// Replacement Flags
-				parameters[2].buffer_type = MYSQL_TYPE_LONG;
-				parameters[2].buffer_length = sizeof(uint32_t);
-				parameters[2].buffer = &flags;
-				parameters[2].is_unsigned = true;
-
-				// Usernum
-				parameters[3].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[3].buffer_length = sizeof(uint64_t);
-				parameters[3].buffer = &usernum;
-				parameters[3].is_unsigned = true;
-
-				// Foldernum
-				parameters[4].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[4].buffer_length = sizeof(uint64_t);
-				parameters[4].buffer = &foldernum;
-				parameters[4].is_unsigned = true;
-
-				// Message Numbers
-				parameters[5].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[5].buffer_length = sizeof(uint64_t);
-				parameters[5].buffer = &(active->messagenum);
-				parameters[5].is_unsigned = true;
-
-				if (!stmt_exec(stmts.update_message_flags_replace, parameters)) {
-					log_pedantic("Message flag replace failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
-					result = false;
-				}
+	while (result) {
 
+		// Fill the next batch with messages from the target folder.
+		for (used = 0; used < UPDATE_MESSAGE_FLAGS_BATCH && (active = inx_cursor_value_next(cursor));) {
+			if (active->foldernum == foldernum) {
+				messagenums[used++] = active->messagenum;
 			}
 		}
 
-		inx_cursor_free(cursor);
+		if (!used) {
+			break;
+		}
+
+		for (size_t i = used; i < UPDATE_MESSAGE_FLAGS_BATCH; i++) {
+			messagenums[i] = messagenums[used - 1];
+		}
+
+		if (!stmt_exec_conn(statement, parameters, transaction)) {
+			log_pedantic("Message flag update failed. { user = %lu / folder = %lu / messages = %zu }", usernum, foldernum, used);
+			result = false;
+		}
+
+		stats_adjust_by_name("objects.messages.flags.batches", 1);
+
+		// A partial batch means the collection has been exhausted.
+		if (used < UPDATE_MESSAGE_FLAGS_BATCH) {
+			break;
+		}
+	}
+
+	inx_cursor_free(cursor);
+
+	if (!result) {
+		tran_rollback(transaction);
+	}
+	else if (tran_commit(transaction)) {
+		log_pedantic("Could not commit the message flag update. { user = %lu / folder = %lu }", usernum, foldernum);
+		result = false;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Remove all user (non-system) flags from a collection of mail messages, and set the specified flags mask for them.
+ *
+ * @note	The new mask can contain both user and system flags, but only user flags will be stripped from each message initially.
+ *
+ * @param	messages	an inx holder containing the collection of messages to have their flags updated.
+ * @param	usernum		the numerical of the user to whom the target messages belong, for validation purposes.
+ * @param	foldernum	the numerical id of the parent folder containing the messages to be updated, for validation purposes.
+ * @param	flags		a mask of all flags that are to be added to any matching messages in the collection.
+ *
+ * @return	true on success or false on failure.
+ */
+bool_t meta_data_flags_replace(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags) {
+
+	bool_t result;
+	uint32_t masks[3] = { MAIL_STATUS_USER_FLAGS, MAIL_STATUS_USER_FLAGS, flags };
+
+	// Sanity check.
+	if (!messages || !usernum || !foldernum) {
+		return false;
 	}
 
+	result = meta_data_flags_update(stmts.update_message_flags_replace, masks, 3, messages, usernum, foldernum);
+
+	// Wake any sessions waiting on the folder, so they can report the new flags.
+	notify_publish_flags(usernum, foldernum, messages);
+
 	return result;
 }
 
@@ -818,64 +871,18 @@ bool_t meta_data_flags_replace(inx_t *messages, uint64_t usernum, uint64_t folde
  */
 bool_t meta_data_flags_remove(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags) {
 
-	inx_cursor_t *cursor;
-	meta_message_t *active;
-	MYSQL_BIND parameters[5];
-	bool_t result = true;
+	bool_t result;
+	uint32_t masks[2] = { flags, flags };
 
 	// Sanity check.
 	if (!messages || !usernum || !foldernum) {
 		return false;
 	}
 
-	// Iterate through and see if any messages have the recent flag set. Store the range.
-	if ((cursor = inx_cursor_alloc(messages))) {
+	result = meta_data_flags_update(stmts.update_message_flags_remove, masks, 2, messages, usernum, foldernum);
 
-		while ((active = inx_cursor_value_next(cursor))) {
-			if (active->foldernum == foldernum) {
-
-				mm_wipe(parameters, sizeof(parameters));
-
-				// Flag to Remove
-				parameters[0].buffer_type = MYSQL_TYPE_LONG;
-				parameters[0].buffer_length = sizeof(uint32_t);
-				parameters[0].buffer = &flags;
-				parameters[0].is_unsigned = true;
-
-				// Flag to Remove
-				parameters[1].buffer_type = MYSQL_TYPE_LONG;
-				parameters[1].buffer_length = sizeof(uint32_t);
-				parameters[1].buffer = &flags;
-				parameters[1].is_unsigned = true;
-
-				// Usernum
-				parameters[2].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[2].buffer_length = sizeof(uint64_t);
-				parameters[2].buffer = &usernum;
-				parameters[2].is_unsigned = true;
-
-				// Foldernum
-				parameters[3].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[3].buffer_length = sizeof(uint64_t);
-				parameters[3].buffer = &foldernum;
-				parameters[3].is_unsigned = true;
-
-				// Message Numbers
-				parameters[4].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[4].buffer_length =  sizeof(uint64_t);
-				parameters[4].buffer = &(active->messagenum);
-				parameters[4].is_unsigned = true;
-
-				if (!stmt_exec(stmts.update_message_flags_remove, parameters)) {
-					log_pedantic("Message flag removal failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
-					result = false;
-				}
-
-			}
-		}
-
-		inx_cursor_free(cursor);
-	}
+	// Wake any sessions waiting on the folder, so they can report the new flags.
+	notify_publish_flags(usernum, foldernum, messages);
 
 	return result;
 }
@@ -892,55 +899,18 @@ bool_t meta_data_flags_remove(inx_t *messages, uint64_t usernum, uint64_t folder
  */
 bool_t meta_data_flags_add(inx_t *messages, uint64_t usernum, uint64_t foldernum, uint32_t flags) {
 
-	inx_cursor_t *cursor;
-	meta_message_t *active;
-	MYSQL_BIND parameters[4];
-	bool_t result = true;
+	bool_t result;
+	uint32_t masks[1] = { flags };
 
 	// Sanity check.
 	if (!messages || !usernum || !foldernum) {
 		return false;
 	}
 
-	// Iterate through and see if any messages have the recent flag set. Store the range.
-	if ((cursor = inx_cursor_alloc(messages))) {
+	result = meta_data_flags_update(stmts.update_message_flags_add, masks, 1, messages, usernum, foldernum);
 
-		while ((active = inx_cursor_value_next(cursor))) {
-				mm_wipe(parameters, sizeof(parameters));
-
-				// Flag to Add
-				parameters[0].buffer_type = MYSQL_TYPE_LONG;
-				parameters[0].buffer_length = sizeof(uint32_t);
-				parameters[0].buffer = &flags;
-				parameters[0].is_unsigned = true;
-
-				// Usernum
-				parameters[1].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[1].buffer_length = sizeof(uint64_t);
-				parameters[1].buffer = &usernum;
-				parameters[1].is_unsigned = true;
-
-				// Foldernum
-				parameters[2].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[2].buffer_length = sizeof(uint64_t);
-				parameters[2].buffer = &foldernum;
-				parameters[2].is_unsigned = true;
-
-				// Message Numbers
-				parameters[3].buffer_type = MYSQL_TYPE_LONGLONG;
-				parameters[3].buffer_length = sizeof(uint64_t);
-				parameters[3].buffer = &(active->messagenum);
-				parameters[3].is_unsigned = true;
-
-				if (!stmt_exec(stmts.update_message_flags_add, parameters)) {
-					log_pedantic("Message flag addition failed. { user = %lu / message = %lu / flags = %u }", usernum, active->messagenum, flags);
-					result = false;
-				}
-
-			}
-
-		inx_cursor_free(cursor);
-	}
+	// Wake any sessions waiting on the folder, so they can report the new flags.
+	notify_publish_flags(usernum, foldernum, messages);
 
 	return result;
 }
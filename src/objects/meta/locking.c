@@ -34,6 +34,9 @@ void meta_user_wlock(meta_user_t *user) {
 		// When read/write locking issues have been fixed, this line can be used once again.
 		rwlock_lock_write(&(user->lock));
 		//log_pedantic("%20.li granted write lock", thread_get_thread_id());
+
+		// With the readers excluded, any message indexes they were using can be freed.
+		meta_index_reclaim(user);
 	}
 
 	return;
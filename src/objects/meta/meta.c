@@ -32,6 +32,7 @@ void meta_free(meta_user_t *user) {
 		// When read/write locking issues have been fixed, this line can be used once again.
 		rwlock_destroy(&(user->lock));
 		mutex_destroy(&(user->refs.lock));
+		meta_index_free(user);
 
 		mm_free(user);
 	}
@@ -85,6 +86,14 @@ meta_user_t * meta_alloc(void) {
 		mm_free(user);
 		return NULL;
 	}
+	// Initialize the message index.
+	else if (!meta_index_init(user)) {
+		mutex_destroy(&(user->refs.lock));
+		rwlock_destroy(&(user->lock));
+		rwlock_attr_destroy(&attr);
+		mm_free(user);
+		return NULL;
+	}
 
 	rwlock_attr_destroy(&attr);
 
@@ -0,0 +1,263 @@
+
+/**
+ * @file /magma/objects/notify.c
+ *
+ * @brief	An in-process table of sessions waiting for changes to a user's mailbox.
+ *
+ * Sessions, like an IMAP connection running the IDLE command, subscribe using the numerical id of the user they belong to. Code paths
+ * which change a mailbox publish an event against the user, which records the change on every matching subscriber and calls its wake
+ * function. Since the events never leave the process, changes made by other cluster nodes are still only noticed through the serial
+ * numbers held by memcached.
+ */
+
+#include "magma.h"
+
+struct {
+	uint64_t count;
+	pthread_mutex_t lock;
+	notify_subscriber_t *buckets[MAGMA_NOTIFY_BUCKETS];
+} notify = {
+	.count = 0
+};
+
+/**
+ * @brief	Initialize the mailbox notification table.
+ * @return	true on success or false on failure.
+ */
+bool_t notify_start(void) {
+
+	mm_wipe(notify.buckets, sizeof(notify.buckets));
+
+	if (mutex_init(&(notify.lock), NULL)) {
+		log_pedantic("Unable to initialize the mailbox notification lock.");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Shutdown the mailbox notification table.
+ * @note	The subscribers belong to their sessions, so they aren't freed here. Sessions are closed before this function is called.
+ * @return	This function returns no value.
+ */
+void notify_stop(void) {
+
+	mutex_lock(&(notify.lock));
+	mm_wipe(notify.buckets, sizeof(notify.buckets));
+	notify.count = 0;
+	mutex_unlock(&(notify.lock));
+
+	mutex_destroy(&(notify.lock));
+
+	return;
+}
+
+/**
+ * @brief	Register a session to be notified when a user's mailbox changes.
+ * @param	usernum		the numerical id of the user to be watched.
+ * @param	foldernum	the numerical id of the folder whose flag changes should be recorded.
+ * @param	wake		the function called when an event is published for the user. It's called while the table is locked, so it must not
+ * 						call back into the notification functions.
+ * @param	data		the value passed to the wake function.
+ * @return	NULL on failure, or a pointer to the subscriber, which must be released using notify_unsubscribe().
+ */
+notify_subscriber_t * notify_subscribe(uint64_t usernum, uint64_t foldernum, bool_t (*wake)(void *data), void *data) {
+
+	notify_subscriber_t *subscriber, **bucket;
+
+	if (!usernum || !wake) {
+		log_pedantic("Invalid parameters passed to the mailbox notification subscribe function.");
+		return NULL;
+	}
+	else if (!(subscriber = mm_alloc(sizeof(notify_subscriber_t)))) {
+		log_pedantic("Unable to allocate a mailbox notification subscriber.");
+		return NULL;
+	}
+
+	subscriber->usernum = usernum;
+	subscriber->foldernum = foldernum;
+	subscriber->wake = wake;
+	subscriber->data = data;
+
+	bucket = &(notify.buckets[usernum % MAGMA_NOTIFY_BUCKETS]);
+
+	mutex_lock(&(notify.lock));
+	subscriber->next = *bucket;
+	*bucket = subscriber;
+	__atomic_add_fetch(&(notify.count), 1, __ATOMIC_RELAXED);
+	mutex_unlock(&(notify.lock));
+
+	return subscriber;
+}
+
+/**
+ * @brief	Remove a session from the mailbox notification table, and free its subscriber.
+ * @param	subscriber	the subscriber to be removed.
+ * @return	This function returns no value.
+ */
+void notify_unsubscribe(notify_subscriber_t *subscriber) {
+
+	notify_subscriber_t **chain;
+
+	if (!subscriber) {
+		return;
+	}
+
+	chain = &(notify.buckets[subscriber->usernum % MAGMA_NOTIFY_BUCKETS]);
+
+	mutex_lock(&(notify.lock));
+
+	while (*chain && *chain != subscriber) {
+		chain = &((*chain)->next);
+	}
+
+	if (*chain) {
+		*chain = subscriber->next;
+		__atomic_sub_fetch(&(notify.count), 1, __ATOMIC_RELAXED);
+	}
+
+	mutex_unlock(&(notify.lock));
+
+	mm_free(subscriber);
+
+	return;
+}
+
+/**
+ * @brief	Publish a change to one of a user's objects, and wake any sessions watching the user.
+ * @param	type		the type of object which changed: OBJECT_USER, OBJECT_CONFIG, OBJECT_FOLDERS, OBJECT_MESSAGES, or OBJECT_CONTACTS.
+ * @param	usernum		the numerical id of the user who owns the object.
+ * @return	This function returns no value.
+ */
+void notify_publish(uint64_t type, uint64_t usernum) {
+
+	notify_subscriber_t *subscriber;
+
+	// Avoid the lock entirely when nobody is waiting, which is the common case for most of the callers.
+	if (!__atomic_load_n(&(notify.count), __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	mutex_lock(&(notify.lock));
+
+	for (subscriber = notify.buckets[usernum % MAGMA_NOTIFY_BUCKETS]; subscriber; subscriber = subscriber->next) {
+		if (subscriber->usernum == usernum) {
+			subscriber->pending |= (1 << type);
+			subscriber->wake(subscriber->data);
+		}
+	}
+
+	mutex_unlock(&(notify.lock));
+
+	return;
+}
+
+/**
+ * @brief	Publish a flag change for a collection of messages, and wake any sessions watching the folder.
+ * @param	usernum		the numerical id of the user who owns the messages.
+ * @param	foldernum	the numerical id of the folder holding the messages.
+ * @param	messages	the collection of messages whose flags were changed.
+ * @return	This function returns no value.
+ */
+void notify_publish_flags(uint64_t usernum, uint64_t foldernum, inx_t *messages) {
+
+	bool_t found;
+	inx_cursor_t *cursor;
+	meta_message_t *active;
+	notify_subscriber_t *subscriber;
+
+	if (!__atomic_load_n(&(notify.count), __ATOMIC_RELAXED) || !messages) {
+		return;
+	}
+
+	mutex_lock(&(notify.lock));
+
+	for (subscriber = notify.buckets[usernum % MAGMA_NOTIFY_BUCKETS]; subscriber; subscriber = subscriber->next) {
+
+		if (subscriber->usernum != usernum || subscriber->foldernum != foldernum) {
+			continue;
+		}
+
+		// Record each message, unless it's already waiting to be reported.
+		if ((cursor = inx_cursor_alloc(messages))) {
+
+			while (!subscriber->overflow && (active = inx_cursor_value_next(cursor))) {
+
+				found = false;
+
+				for (size_t i = 0; !found && i < subscriber->count; i++) {
+					if (subscriber->changed[i] == active->messagenum) found = true;
+				}
+
+				if (!found && subscriber->count == MAGMA_NOTIFY_CHANGES) subscriber->overflow = true;
+				else if (!found) subscriber->changed[subscriber->count++] = active->messagenum;
+			}
+
+			inx_cursor_free(cursor);
+		}
+		else {
+			subscriber->overflow = true;
+		}
+
+		subscriber->wake(subscriber->data);
+	}
+
+	mutex_unlock(&(notify.lock));
+
+	return;
+}
+
+/**
+ * @brief	Collect, and clear, the events recorded for a subscriber.
+ * @param	subscriber	the subscriber.
+ * @param	changed		an array, with room for MAGMA_NOTIFY_CHANGES entries, which will receive the messages whose flags changed.
+ * @param	count		a pointer to receive the number of entries stored in the changed array.
+ * @param	overflow	a pointer to receive whether more messages changed than the array could hold, in which case every message in the
+ * 						folder should be treated as changed.
+ * @return	the mask of object types which changed, using one bit per OBJECT_* value.
+ */
+uint32_t notify_take(notify_subscriber_t *subscriber, uint64_t *changed, size_t *count, bool_t *overflow) {
+
+	uint32_t pending;
+
+	mutex_lock(&(notify.lock));
+
+	pending = subscriber->pending;
+	*overflow = subscriber->overflow;
+	*count = subscriber->count;
+	mm_copy(changed, subscriber->changed, sizeof(uint64_t) * subscriber->count);
+
+	subscriber->pending = 0;
+	subscriber->overflow = false;
+	subscriber->count = 0;
+
+	mutex_unlock(&(notify.lock));
+
+	return pending;
+}
+
+/**
+ * @brief	Put a session to sleep until the next event, unless an event is already waiting to be collected.
+ * @note	The wait function is called while the table is locked, so an event published by another thread will either be seen here, or
+ * 			will find the session asleep, and wake it. The wait function must not call back into the notification functions.
+ * @param	subscriber	the subscriber.
+ * @param	wait		the function used to put the session to sleep.
+ * @param	data		the value passed to the wait function.
+ * @return	true if the session was put to sleep, or false if events are waiting and the caller should collect them.
+ */
+bool_t notify_wait(notify_subscriber_t *subscriber, void (*wait)(void *data), void *data) {
+
+	bool_t result = false;
+
+	mutex_lock(&(notify.lock));
+
+	if (!subscriber->pending && !subscriber->count && !subscriber->overflow) {
+		wait(data);
+		result = true;
+	}
+
+	mutex_unlock(&(notify.lock));
+
+	return result;
+}
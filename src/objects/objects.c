@@ -57,9 +57,8 @@ void obj_cache_stop(void) {
  *
  * @note	If the number of entries is over 4,096, then the prune function will remove entries candidates which have been unused more
  * 			then 5 minutes. If the index holds more than 2,048, entries older than 30 minutes are pruned, otherwise if the index holds
- * 			fewer than 2,048 entries, only those objects older than 1 hour are removed. Also, note that the precise interval between
- * 			scans is somewhat random, because the background thread responsible for running the prune function goes to sleep for a
- * 			random number of seconds.
+ * 			fewer than 2,048 entries, only those objects older than 1 hour are removed. The scan is handed to the worker pool by the
+ * 			timer wheel every MAGMA_TIMER_MAINTENANCE seconds.
  */
 void obj_cache_prune(void) {
 
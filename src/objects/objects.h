@@ -44,6 +44,16 @@ bool_t obj_cache_start(void);
 void obj_cache_prune(void);
 void obj_cache_stop(void);
 
+/// notify.c
+bool_t                notify_start(void);
+void                  notify_stop(void);
+void                  notify_unsubscribe(notify_subscriber_t *subscriber);
+void                  notify_publish(uint64_t type, uint64_t usernum);
+void                  notify_publish_flags(uint64_t usernum, uint64_t foldernum, inx_t *messages);
+bool_t                notify_wait(notify_subscriber_t *subscriber, void (*wait)(void *data), void *data);
+uint32_t              notify_take(notify_subscriber_t *subscriber, uint64_t *changed, size_t *count, bool_t *overflow);
+notify_subscriber_t * notify_subscribe(uint64_t usernum, uint64_t foldernum, bool_t (*wake)(void *data), void *data);
+
 /// serials.c
 uint64_t serial_get(uint64_t type, uint64_t num);
 uint64_t serial_increment(uint64_t type, uint64_t num);
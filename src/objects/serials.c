@@ -98,6 +98,9 @@ uint64_t serial_increment(uint64_t type, uint64_t num) {
 	result = cache_increment(key, 1, 1, 2592000);
 	st_free(key);
 
+	// Any local sessions waiting on the object can now see the change.
+	notify_publish(type, num);
+
 	return result;
 }
 
@@ -303,7 +303,7 @@ void sess_release(session_t *sess) {
 
 	// If its been more than two minutes since we last checked to see if things are up to date, queue a refresh ahead of the decrement.
 	if (sess_refresh_check(sess)) {
-		requeue(&sess_update, &sess_ref_dec, sess);
+		requeue_priority(QUEUE_BACKGROUND, &sess_update, &sess_ref_dec, sess);
 	}
 	else {
 		sess_ref_dec(sess);
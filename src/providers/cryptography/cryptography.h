@@ -154,12 +154,14 @@ bool_t           ssl_verify_privkey(const char *keyfile);
 int_t         tls_bits(TLS *tls);
 stringer_t *  tls_cipher(TLS *tls, stringer_t *output);
 void *        tls_client_alloc(int_t sockd);
+void *        tls_client_resume(int_t sockd, void *session);
 int           tls_continue(TLS *tls, int result, int syserror);
 stringer_t *  tls_error(TLS *tls, int_t code, stringer_t *output);
 void          tls_free(TLS *tls);
 int           tls_print(TLS *tls, const char *format, va_list args);
 int           tls_read(TLS *tls, void *buffer, int length, bool_t block);
-TLS *         tls_server_alloc(void *server, int sockd, int flags);
+bool_t        tls_resumed(TLS *tls);
+TLS *         tls_server_alloc(void *server, int sockd, int flags, uint32_t timeout);
 bool_t        tls_server_create(void *server, uint_t security_level);
 void          tls_server_destroy(void *server);
 int           tls_status(TLS *tls);
@@ -167,6 +169,15 @@ chr_t *       tls_suite(TLS *tls);
 chr_t *       tls_version(TLS *tls);
 int           tls_write(TLS *tls, const void *buffer, int length, bool_t block);
 
+/// sessions.c
+bool_t   tls_sessions_enable(SSL_CTX *context, const void *id, uint_t length);
+bool_t   tls_sessions_start(void);
+void     tls_sessions_stop(void);
+void     tls_tickets_rotate(void);
+
+/// offload.c
+bool_t   tls_offload(TLS *tls);
+
 /// random.c
 bool_t        rand_start(void);
 bool_t        rand_thread_start(void);
@@ -0,0 +1,216 @@
+/**
+ * @file /magma/providers/cryptography/offload.c
+ *
+ * @brief	Functions used to hand the encryption of outbound TLS records to the kernel.
+ *
+ * Once a TLS 1.2 connection has negotiated an AES-GCM cipher suite, the server write key is derived from the session master secret,
+ * and installed on the socket using the kernel TLS upper layer protocol. From then on, plain writes to the socket are encrypted by the
+ * kernel, which avoids copying each response through the OpenSSL record buffers. Inbound records are still decrypted by OpenSSL,
+ * so the connection object must never use SSL_write() again. If the kernel, or the cipher suite, isn't supported the connection is
+ * left unchanged, and writes continue to use the OpenSSL record layer.
+ *
+ * Anything OpenSSL writes after the key has been installed, such as a renegotiation handshake, a heartbeat response, or an alert,
+ * would be encrypted a second time by the kernel, and delivered as application data. So renegotiation is disabled, the OpenSSL write
+ * side is pointed at a null BIO which discards its output, and a connection which starts a new handshake anyway is shutdown.
+ */
+
+#include "magma.h"
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+// The kernel TLS constants, and structures, from linux/tls.h. They're declared here so magma can still be built with kernel headers
+// which predate the interface, in which case the setsockopt() calls will simply fail at runtime.
+#define TLS_OFFLOAD_TX 1
+#define TLS_OFFLOAD_VERSION_1_2 0x0303
+#define TLS_OFFLOAD_AES_GCM_128 51
+#define TLS_OFFLOAD_AES_GCM_256 52
+
+typedef struct {
+	uint16_t version;
+	uint16_t cipher;
+	uchr_t iv[8];
+	uchr_t key[16];
+	uchr_t salt[4];
+	uchr_t sequence[8];
+} tls_offload_aes128_t;
+
+typedef struct {
+	uint16_t version;
+	uint16_t cipher;
+	uchr_t iv[8];
+	uchr_t key[32];
+	uchr_t salt[4];
+	uchr_t sequence[8];
+} tls_offload_aes256_t;
+
+/**
+ * @brief	The TLS 1.2 pseudo random function, as described by RFC 5246, section 5.
+ * @param	digest		the hash function used by the negotiated cipher suite.
+ * @param	secret		the secret used to key the HMAC.
+ * @param	secret_length	the length, in bytes, of the secret.
+ * @param	label		a null terminated string identifying the output.
+ * @param	seed		the seed value.
+ * @param	seed_length	the length, in bytes, of the seed.
+ * @param	output		a buffer to receive the output.
+ * @param	length		the number of bytes of output to generate.
+ * @return	true on success, or false on failure.
+ */
+static bool_t tls_offload_prf(const EVP_MD *digest, const uchr_t *secret, int secret_length, const chr_t *label, const uchr_t *seed,
+	size_t seed_length, uchr_t *output, size_t length) {
+
+	HMAC_CTX hmac;
+	bool_t result = true;
+	uint_t a_length = 0, block_length = 0;
+	uchr_t a[EVP_MAX_MD_SIZE], block[EVP_MAX_MD_SIZE];
+
+	HMAC_CTX_init_d(&hmac);
+
+	// A(1) = HMAC(secret, label + seed)
+	if (HMAC_Init_ex_d(&hmac, secret, secret_length, digest, NULL) != 1 || HMAC_Update_d(&hmac, (uchr_t *)label, ns_length_get(label)) != 1 ||
+		HMAC_Update_d(&hmac, seed, seed_length) != 1 || HMAC_Final_d(&hmac, a, &a_length) != 1) {
+		result = false;
+	}
+
+	for (size_t position = 0; result && position < length; position += block_length) {
+
+		// P_hash = HMAC(secret, A(i) + label + seed), and then A(i + 1) = HMAC(secret, A(i))
+		if (HMAC_Init_ex_d(&hmac, NULL, 0, NULL, NULL) != 1 || HMAC_Update_d(&hmac, a, a_length) != 1 ||
+			HMAC_Update_d(&hmac, (uchr_t *)label, ns_length_get(label)) != 1 || HMAC_Update_d(&hmac, seed, seed_length) != 1 ||
+			HMAC_Final_d(&hmac, block, &block_length) != 1 || HMAC_Init_ex_d(&hmac, NULL, 0, NULL, NULL) != 1 ||
+			HMAC_Update_d(&hmac, a, a_length) != 1 || HMAC_Final_d(&hmac, a, &a_length) != 1) {
+			result = false;
+		}
+		else {
+			mm_copy(output + position, block, (length - position) < block_length ? (length - position) : block_length);
+		}
+	}
+
+	HMAC_CTX_cleanup_d(&hmac);
+	mm_wipe(block, sizeof(block));
+	mm_wipe(a, sizeof(a));
+
+	return result;
+}
+
+/**
+ * @brief	Shutdown an offloaded connection if the client starts a new handshake, since OpenSSL can't answer it.
+ * @param	tls		the TLS connection which triggered the callback.
+ * @param	where	a bitmask indicating the state of the connection.
+ * @param	ret		the return code associated with the event, which is ignored.
+ * @return	This function returns no value.
+ */
+static void tls_offload_info(const SSL *tls, int where, int ret) {
+
+	int sockd;
+
+	// The read that triggered the handshake will fail, and the connection will be closed by its owner.
+	if ((where & SSL_CB_HANDSHAKE_START) && (sockd = SSL_get_fd_d(tls)) >= 0) {
+		log_pedantic("An offloaded TLS connection attempted to renegotiate, so it will be closed.");
+		shutdown(sockd, SHUT_RDWR);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Hand the encryption of outbound records for a TLS connection to the kernel.
+ * @note	This function must be called after the handshake finishes, and before any application data is written. If it succeeds,
+ * 			all further output must be written directly to the socket, since the OpenSSL write state is no longer valid, and OpenSSL
+ * 			is left writing to a null BIO.
+ * @param	tls		the TLS connection to be offloaded.
+ * @return	true if the kernel is now encrypting the outbound records, or false if the connection should continue using SSL_write().
+ */
+bool_t tls_offload(TLS *tls) {
+
+	int sockd, bits;
+	BIO *wbio, *discard;
+	bool_t result = false;
+	const chr_t *name;
+	const EVP_MD *digest;
+	SSL_CIPHER *cipher;
+	tls_offload_aes128_t aes128;
+	tls_offload_aes256_t aes256;
+	uchr_t seed[SSL3_RANDOM_SIZE * 2], block[(32 * 2) + (4 * 2)];
+
+	// Only TLS 1.2 connections using an AES-GCM cipher suite can be offloaded.
+	if (!tls || tls->version != TLS1_2_VERSION || !tls->session || !tls->s3 || (sockd = SSL_get_fd_d(tls)) < 0 ||
+		!(cipher = SSL_get_current_cipher_d(tls)) || !(name = SSL_CIPHER_get_name_d(cipher)) || !strstr(name, "-GCM-") ||
+		((bits = SSL_CIPHER_get_bits_d(cipher, NULL)) != 128 && bits != 256)) {
+		return false;
+	}
+
+	// The cipher suite name tells us which hash function the pseudo random function should use.
+	digest = strstr(name, "-SHA384") ? EVP_sha384_d() : EVP_sha256_d();
+
+	// The key block is made up of the client write key, the server write key, the client write salt, and the server write salt.
+	mm_copy(seed, tls->s3->server_random, SSL3_RANDOM_SIZE);
+	mm_copy(seed + SSL3_RANDOM_SIZE, tls->s3->client_random, SSL3_RANDOM_SIZE);
+
+	if (!tls_offload_prf(digest, tls->session->master_key, tls->session->master_key_length, TLS_MD_KEY_EXPANSION_CONST, seed, sizeof(seed),
+		block, ((bits / 8) * 2) + (4 * 2))) {
+		mm_wipe(block, sizeof(block));
+		return false;
+	}
+
+	// If OpenSSL can't be stopped from writing to the socket, the connection can't be offloaded.
+	if (!(wbio = SSL_get_wbio_d(tls)) || !(discard = BIO_new_d(BIO_s_null_d()))) {
+		log_pedantic("Unable to create the BIO used to discard the output of an offloaded TLS connection. { error = %s }",
+			ssl_error_string(MEMORYBUF(256), 256));
+		mm_wipe(block, sizeof(block));
+		return false;
+	}
+
+	// If the kernel doesn't support TLS, this is where we find out.
+	if (setsockopt(sockd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+		mm_wipe(block, sizeof(block));
+		BIO_free_d(discard);
+		return false;
+	}
+
+	// The explicit nonce only needs to be unique, so we use the record sequence number, just like the kernel would.
+	if (bits == 128) {
+		mm_wipe(&aes128, sizeof(tls_offload_aes128_t));
+		aes128.version = TLS_OFFLOAD_VERSION_1_2;
+		aes128.cipher = TLS_OFFLOAD_AES_GCM_128;
+		mm_copy(aes128.key, block + 16, 16);
+		mm_copy(aes128.salt, block + 32 + 4, 4);
+		mm_copy(aes128.iv, tls->s3->write_sequence, 8);
+		mm_copy(aes128.sequence, tls->s3->write_sequence, 8);
+		result = !setsockopt(sockd, SOL_TLS, TLS_OFFLOAD_TX, &aes128, sizeof(tls_offload_aes128_t));
+		mm_wipe(&aes128, sizeof(tls_offload_aes128_t));
+	}
+	else {
+		mm_wipe(&aes256, sizeof(tls_offload_aes256_t));
+		aes256.version = TLS_OFFLOAD_VERSION_1_2;
+		aes256.cipher = TLS_OFFLOAD_AES_GCM_256;
+		mm_copy(aes256.key, block + 32, 32);
+		mm_copy(aes256.salt, block + 64 + 4, 4);
+		mm_copy(aes256.iv, tls->s3->write_sequence, 8);
+		mm_copy(aes256.sequence, tls->s3->write_sequence, 8);
+		result = !setsockopt(sockd, SOL_TLS, TLS_OFFLOAD_TX, &aes256, sizeof(tls_offload_aes256_t));
+		mm_wipe(&aes256, sizeof(tls_offload_aes256_t));
+	}
+
+	mm_wipe(block, sizeof(block));
+
+	// OpenSSL can no longer write to the connection, so renegotiation is refused, the close notify alert is skipped when the connection
+	// is shutdown, and anything else OpenSSL tries to send is discarded. Since the socket BIO is still used for reading, it isn't freed.
+	if (result) {
+		tls->s3->flags |= SSL3_FLAGS_NO_RENEGOTIATE_CIPHERS;
+		SSL_set_info_callback_d(tls, &tls_offload_info);
+		SSL_set_quiet_shutdown_d(tls, 1);
+		SSL_set_bio_d(tls, wbio, discard);
+	}
+	else {
+		log_pedantic("Unable to install the TLS write key on the socket. { error = %s }", strerror_r(errno, MEMORYBUF(256), 256));
+		BIO_free_d(discard);
+	}
+
+	return result;
+}
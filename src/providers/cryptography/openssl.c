@@ -56,7 +56,8 @@ bool_t lib_load_openssl(void) {
 		M_BIND(SSL_CTX_set_tmp_dh_callback), M_BIND(SSL_CTX_set_tmp_ecdh_callback), M_BIND(SSL_CTX_use_certificate_chain_file),
 		M_BIND(SSL_CTX_use_PrivateKey_file), M_BIND(SSLeay_version), M_BIND(SSL_free), M_BIND(SSL_get_error), M_BIND(SSL_get_peer_certificate),
 		M_BIND(SSL_get_shutdown), M_BIND(SSL_get_wbio), M_BIND(SSL_library_init), M_BIND(SSL_load_error_strings), M_BIND(SSL_new),
-		M_BIND(SSL_read), M_BIND(SSL_set_bio), M_BIND(SSL_shutdown), M_BIND(SSLv23_client_method), M_BIND(SSLv23_server_method),
+		M_BIND(SSL_read), M_BIND(SSL_set_bio), M_BIND(BIO_new), M_BIND(BIO_s_null), M_BIND(SSL_set_info_callback),
+		M_BIND(SSL_shutdown), M_BIND(SSLv23_client_method), M_BIND(SSLv23_server_method),
 		M_BIND(SSL_version_str), M_BIND(SSL_write), M_BIND(TLSv1_server_method), M_BIND(X509_get_ext), M_BIND(X509_get_ext_count),
 		M_BIND(X509_get_subject_name), M_BIND(X509_NAME_get_text_by_NID), M_BIND(EVP_MD_type), M_BIND(SSL_pending), M_BIND(SSL_want),
 		M_BIND(SSL_get_rfd), M_BIND(EVP_CIPHER_CTX_ctrl), M_BIND(EVP_CIPHER_CTX_flags), M_BIND(EVP_CIPHER_flags), M_BIND(X509_STORE_CTX_new),
@@ -85,7 +86,10 @@ bool_t lib_load_openssl(void) {
 		M_BIND(CRYPTO_set_mem_functions), M_BIND(CRYPTO_set_locked_mem_functions), M_BIND(DH_check), M_BIND(SSL_get_read_ahead),
 		M_BIND(SSL_set_read_ahead), M_BIND(SSL_peek), M_BIND(SSL_CIPHER_get_name), M_BIND(SSL_CIPHER_get_version), M_BIND(SSL_get_current_cipher),
 		M_BIND(SSL_get_version), M_BIND(SSL_CIPHER_get_bits), M_BIND(ERR_peek_error), M_BIND(SSL_set_connect_state), M_BIND(SSL_set_accept_state),
-		M_BIND(SSL_do_handshake)
+		M_BIND(SSL_do_handshake), M_BIND(SSL_SESSION_free), M_BIND(SSL_get1_session), M_BIND(SSL_set_session), M_BIND(SSL_CTX_set_timeout),
+		M_BIND(i2d_SSL_SESSION), M_BIND(d2i_SSL_SESSION), M_BIND(SSL_SESSION_get_time), M_BIND(SSL_SESSION_get_timeout), M_BIND(SSL_SESSION_get_id),
+		M_BIND(SSL_CTX_set_session_id_context), M_BIND(SSL_CTX_sess_set_new_cb), M_BIND(SSL_CTX_sess_set_get_cb), M_BIND(SSL_CTX_sess_set_remove_cb),
+		M_BIND(SSL_set_quiet_shutdown)
 
 	};
 
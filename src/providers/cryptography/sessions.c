@@ -0,0 +1,497 @@
+/**
+ * @file /magma/providers/cryptography/sessions.c
+ *
+ * @brief	The server side TLS session cache, and the session ticket keys, which let clients resume a previous session using an
+ * 			abbreviated handshake.
+ *
+ * Clients which support session tickets are given their session, encrypted with an in-memory key which is replaced by the maintenance
+ * thread every MAGMA_TLS_TICKET_ROTATE seconds. The keys are never written to disk, so tickets don't survive a restart. Clients which
+ * don't support tickets are resumed using a session id, which is looked up in a process wide cache. The cache replaces the OpenSSL
+ * internal cache, which is protected by a single lock, with independently locked shards. Each shard keeps its sessions in serialized
+ * form, on a least recently used list, and evicts from the tail once it holds MAGMA_TLS_SESSION_LIMIT sessions. The cache is shared by
+ * every server instance, but since each server context uses its own session id context, a session can only be resumed by the server
+ * which created it.
+ */
+
+#include "magma.h"
+
+typedef struct tls_session_entry {
+	time_t expiration;
+	stringer_t *session;
+	uint32_t id_length;
+	uchr_t id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+	struct tls_session_entry *prev, *next, *chain;
+} tls_session_entry_t;
+
+typedef struct {
+	uint64_t count;
+	pthread_mutex_t lock;
+	tls_session_entry_t *head, *tail;
+	tls_session_entry_t *buckets[MAGMA_TLS_SESSION_BUCKETS];
+} tls_session_shard_t;
+
+typedef struct {
+	uchr_t name[16], cipher[32], hmac[32];
+} tls_ticket_key_t;
+
+struct {
+	time_t rotated;
+	pthread_rwlock_t lock;
+	tls_ticket_key_t current, previous;
+	tls_session_shard_t shards[MAGMA_TLS_SESSION_SHARDS];
+} tls_sessions = {
+	.rotated = 0
+};
+
+/**
+ * @brief	Hash a session id, so sessions are spread evenly across the shards and their buckets.
+ */
+static uint64_t tls_session_hash(const uchr_t *id, uint32_t length) {
+	return hash_murmur64((void *)id, length);
+}
+
+/**
+ * @brief	Free a session cache entry.
+ * @param	entry	the entry to be freed.
+ * @return	This function returns no value.
+ */
+static void tls_session_entry_free(tls_session_entry_t *entry) {
+
+	if (entry) {
+		st_cleanup(entry->session);
+		mm_free(entry);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Remove an entry from its shard's hash chain and recently used list, and then free it.
+ * @note	The shard lock must be held by the caller.
+ * @param	shard	the shard holding the entry.
+ * @param	entry	the entry to be removed.
+ * @return	This function returns no value.
+ */
+static void tls_session_entry_remove(tls_session_shard_t *shard, tls_session_entry_t *entry) {
+
+	tls_session_entry_t **chain = &(shard->buckets[(tls_session_hash(entry->id, entry->id_length) / MAGMA_TLS_SESSION_SHARDS) %
+		MAGMA_TLS_SESSION_BUCKETS]);
+
+	while (*chain && *chain != entry) {
+		chain = &((*chain)->chain);
+	}
+
+	if (*chain) {
+		*chain = entry->chain;
+	}
+
+	if (entry->prev) entry->prev->next = entry->next;
+	else shard->head = entry->next;
+
+	if (entry->next) entry->next->prev = entry->prev;
+	else shard->tail = entry->prev;
+
+	shard->count--;
+	tls_session_entry_free(entry);
+
+	return;
+}
+
+/**
+ * @brief	Find a session in a shard using its id.
+ * @note	The shard lock must be held by the caller.
+ * @return	NULL if the session isn't cached, or a pointer to its entry.
+ */
+static tls_session_entry_t * tls_session_entry_find(tls_session_shard_t *shard, uint64_t hash, const uchr_t *id, uint32_t length) {
+
+	tls_session_entry_t *entry = shard->buckets[(hash / MAGMA_TLS_SESSION_SHARDS) % MAGMA_TLS_SESSION_BUCKETS];
+
+	while (entry && (entry->id_length != length || memcmp(entry->id, id, length))) {
+		entry = entry->chain;
+	}
+
+	return entry;
+}
+
+/**
+ * @brief	Fill a session ticket key with random data.
+ * @param	key		the key to be generated.
+ * @return	true on success, or false on failure.
+ */
+static bool_t tls_ticket_generate(tls_ticket_key_t *key) {
+
+	if (RAND_bytes_d(key->name, sizeof(key->name)) != 1 || RAND_bytes_d(key->cipher, sizeof(key->cipher)) != 1 ||
+		RAND_bytes_d(key->hmac, sizeof(key->hmac)) != 1) {
+		log_pedantic("Unable to generate a session ticket key. { error = %s }", ssl_error_string(MEMORYBUF(256), 256));
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Destroy the locks of the session cache shards, after tls_sessions_start() fails part way through.
+ * @param	count	the number of shards, starting with the first, whose locks were initialized.
+ * @return	This function returns no value.
+ */
+static void tls_sessions_unwind(uint64_t count) {
+
+	for (uint64_t i = 0; i < count; i++) {
+		mutex_destroy(&(tls_sessions.shards[i].lock));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Initialize the TLS session cache, and generate the initial session ticket keys.
+ * @return	true on success or false on failure.
+ */
+bool_t tls_sessions_start(void) {
+
+	for (uint64_t i = 0; i < MAGMA_TLS_SESSION_SHARDS; i++) {
+		mm_wipe(&(tls_sessions.shards[i]), sizeof(tls_session_shard_t));
+		if (mutex_init(&(tls_sessions.shards[i].lock), NULL)) {
+			log_pedantic("Unable to initialize the TLS session cache locks.");
+			tls_sessions_unwind(i);
+			return false;
+		}
+	}
+
+	if (rwlock_init(&(tls_sessions.lock), NULL)) {
+		log_pedantic("Unable to initialize the session ticket key lock.");
+		tls_sessions_unwind(MAGMA_TLS_SESSION_SHARDS);
+		return false;
+	}
+	// The previous key is never used to issue a ticket, so giving it a random value simply means no ticket will match it.
+	else if (!tls_ticket_generate(&(tls_sessions.current)) || !tls_ticket_generate(&(tls_sessions.previous))) {
+		mm_wipe(&(tls_sessions.current), sizeof(tls_ticket_key_t));
+		mm_wipe(&(tls_sessions.previous), sizeof(tls_ticket_key_t));
+		rwlock_destroy(&(tls_sessions.lock));
+		tls_sessions_unwind(MAGMA_TLS_SESSION_SHARDS);
+		return false;
+	}
+
+	tls_sessions.rotated = time(NULL);
+
+	return true;
+}
+
+/**
+ * @brief	Free the TLS session cache, and wipe the session ticket keys.
+ * @note	This function should only be called after every server context using the cache has been destroyed.
+ * @return	This function returns no value.
+ */
+void tls_sessions_stop(void) {
+
+	if (!tls_sessions.rotated) {
+		return;
+	}
+
+	for (uint64_t i = 0; i < MAGMA_TLS_SESSION_SHARDS; i++) {
+
+		mutex_lock(&(tls_sessions.shards[i].lock));
+		while (tls_sessions.shards[i].head) {
+			tls_session_entry_remove(&(tls_sessions.shards[i]), tls_sessions.shards[i].head);
+		}
+		mutex_unlock(&(tls_sessions.shards[i].lock));
+
+		mutex_destroy(&(tls_sessions.shards[i].lock));
+	}
+
+	rwlock_lock_write(&(tls_sessions.lock));
+	mm_wipe(&(tls_sessions.current), sizeof(tls_ticket_key_t));
+	mm_wipe(&(tls_sessions.previous), sizeof(tls_ticket_key_t));
+	tls_sessions.rotated = 0;
+	rwlock_unlock(&(tls_sessions.lock));
+
+	rwlock_destroy(&(tls_sessions.lock));
+
+	return;
+}
+
+/**
+ * @brief	Replace the session ticket key, if the current key is older than MAGMA_TLS_TICKET_ROTATE seconds.
+ * @note	This function is called periodically by the maintenance thread. The outgoing key is kept, so tickets it encrypted can still be
+ * 			used until the next rotation, at which point the client is given a new ticket.
+ * @return	This function returns no value.
+ */
+void tls_tickets_rotate(void) {
+
+	tls_ticket_key_t key;
+
+	if (!tls_sessions.rotated || time(NULL) - tls_sessions.rotated < MAGMA_TLS_TICKET_ROTATE) {
+		return;
+	}
+	// If the new key can't be generated, we'll try again during the next maintenance cycle.
+	else if (!tls_ticket_generate(&key)) {
+		return;
+	}
+
+	rwlock_lock_write(&(tls_sessions.lock));
+	mm_copy(&(tls_sessions.previous), &(tls_sessions.current), sizeof(tls_ticket_key_t));
+	mm_copy(&(tls_sessions.current), &key, sizeof(tls_ticket_key_t));
+	tls_sessions.rotated = time(NULL);
+	rwlock_unlock(&(tls_sessions.lock));
+
+	mm_wipe(&key, sizeof(tls_ticket_key_t));
+	stats_increment_by_name("provider.tls.tickets.rotated");
+
+	return;
+}
+
+/**
+ * @brief	Add a newly negotiated session to the cache.
+ * @see		SSL_CTX_sess_set_new_cb()
+ * @param	tls		the TLS connection which negotiated the session.
+ * @param	session	the session to be cached.
+ * @return	always returns 0, since the session is serialized, and the caller's reference isn't kept.
+ */
+static int tls_session_new(SSL *tls, SSL_SESSION *session) {
+
+	int length;
+	uint64_t hash;
+	uchr_t *data;
+	const uchr_t *id;
+	uint_t id_length = 0;
+	size_t evicted = 0;
+	tls_session_shard_t *shard;
+	tls_session_entry_t *entry, *existing, **bucket;
+
+	if (!(id = SSL_SESSION_get_id_d(session, &id_length)) || !id_length || id_length > SSL_MAX_SSL_SESSION_ID_LENGTH ||
+		(length = i2d_SSL_SESSION_d(session, NULL)) <= 0) {
+		return 0;
+	}
+
+	// Serialize the session before taking the lock.
+	if (!(entry = mm_alloc(sizeof(tls_session_entry_t))) || !(entry->session = st_alloc(length)) ||
+		!(data = st_data_get(entry->session)) || i2d_SSL_SESSION_d(session, &data) != length) {
+		tls_session_entry_free(entry);
+		return 0;
+	}
+
+	st_length_set(entry->session, length);
+	mm_copy(entry->id, id, id_length);
+	entry->id_length = id_length;
+	entry->expiration = SSL_SESSION_get_time_d(session) + SSL_SESSION_get_timeout_d(session);
+
+	hash = tls_session_hash(entry->id, entry->id_length);
+	shard = &(tls_sessions.shards[hash % MAGMA_TLS_SESSION_SHARDS]);
+	bucket = &(shard->buckets[(hash / MAGMA_TLS_SESSION_SHARDS) % MAGMA_TLS_SESSION_BUCKETS]);
+
+	mutex_lock(&(shard->lock));
+
+	// A session being updated replaces the copy already in the cache.
+	if ((existing = tls_session_entry_find(shard, hash, entry->id, entry->id_length))) {
+		tls_session_entry_remove(shard, existing);
+	}
+
+	entry->chain = *bucket;
+	*bucket = entry;
+
+	entry->next = shard->head;
+	if (shard->head) shard->head->prev = entry;
+	else shard->tail = entry;
+	shard->head = entry;
+	shard->count++;
+
+	while (shard->count > MAGMA_TLS_SESSION_LIMIT && shard->tail != entry) {
+		tls_session_entry_remove(shard, shard->tail);
+		evicted++;
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	if (evicted) {
+		stats_adjust_by_name("provider.tls.sessions.evicted", evicted);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Retrieve a session from the cache, so a client presenting its id can resume it.
+ * @see		SSL_CTX_sess_set_get_cb()
+ * @param	tls		the TLS connection attempting to resume a session.
+ * @param	id		the session id provided by the client.
+ * @param	length	the length, in bytes, of the session id.
+ * @param	copy	a pointer used to tell OpenSSL the returned session doesn't need an extra reference.
+ * @return	NULL if the session isn't cached, or has expired, otherwise a newly allocated copy of the session.
+ */
+static SSL_SESSION * tls_session_get(SSL *tls, uchr_t *id, int length, int *copy) {
+
+	uint64_t hash;
+	const uchr_t *data;
+	stringer_t *serialized = NULL;
+	tls_session_shard_t *shard;
+	tls_session_entry_t *entry;
+	SSL_SESSION *result = NULL;
+
+	*copy = 0;
+
+	if (length <= 0 || length > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+		return NULL;
+	}
+
+	hash = tls_session_hash(id, length);
+	shard = &(tls_sessions.shards[hash % MAGMA_TLS_SESSION_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+
+	if ((entry = tls_session_entry_find(shard, hash, id, length)) && entry->expiration <= time(NULL)) {
+		tls_session_entry_remove(shard, entry);
+		entry = NULL;
+	}
+
+	if (entry) {
+
+		// Move the entry to the front of the recently used list.
+		if (entry != shard->head) {
+
+			entry->prev->next = entry->next;
+			if (entry->next) entry->next->prev = entry->prev;
+			else shard->tail = entry->prev;
+
+			entry->prev = NULL;
+			entry->next = shard->head;
+			shard->head->prev = entry;
+			shard->head = entry;
+		}
+
+		serialized = st_dupe(entry->session);
+	}
+
+	mutex_unlock(&(shard->lock));
+
+	// The session is decoded outside the lock, since it's the most expensive part of the lookup.
+	if (serialized) {
+		data = st_data_get(serialized);
+		result = d2i_SSL_SESSION_d(NULL, &data, st_length_get(serialized));
+		st_free(serialized);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Remove a session from the cache, because it expired, or because the connection using it failed.
+ * @see		SSL_CTX_sess_set_remove_cb()
+ * @param	context		the TLS context the session belongs to.
+ * @param	session		the session to be removed.
+ * @return	This function returns no value.
+ */
+static void tls_session_remove(SSL_CTX *context, SSL_SESSION *session) {
+
+	uint64_t hash;
+	const uchr_t *id;
+	uint_t id_length = 0;
+	tls_session_shard_t *shard;
+	tls_session_entry_t *entry;
+
+	if (!(id = SSL_SESSION_get_id_d(session, &id_length)) || !id_length || id_length > SSL_MAX_SSL_SESSION_ID_LENGTH) {
+		return;
+	}
+
+	hash = tls_session_hash(id, id_length);
+	shard = &(tls_sessions.shards[hash % MAGMA_TLS_SESSION_SHARDS]);
+
+	mutex_lock(&(shard->lock));
+	if ((entry = tls_session_entry_find(shard, hash, id, id_length))) {
+		tls_session_entry_remove(shard, entry);
+	}
+	mutex_unlock(&(shard->lock));
+
+	return;
+}
+
+/**
+ * @brief	Setup the cipher and HMAC contexts used to encrypt a new session ticket, or decrypt one provided by a client.
+ * @see		SSL_CTX_set_tlsext_ticket_key_cb()
+ * @param	tls		the TLS connection which is issuing, or resuming, the ticket.
+ * @param	name	the 16 byte key name, which is stored in the ticket so the key which encrypted it can be found later.
+ * @param	iv		the initialization vector for the ticket.
+ * @param	cipher	the cipher context to be initialized.
+ * @param	hmac	the HMAC context to be initialized.
+ * @param	encrypt	if non-zero, a new ticket is being issued, otherwise a ticket provided by the client is being decrypted.
+ * @return	-1 on error, 0 if the ticket key wasn't found, 1 if the ticket is valid, or 2 if the ticket is valid, but was encrypted with
+ * 			the previous key, and should be replaced.
+ */
+static int tls_ticket_callback(SSL *tls, uchr_t *name, uchr_t *iv, EVP_CIPHER_CTX *cipher, HMAC_CTX *hmac, int encrypt) {
+
+	int result = 0;
+	tls_ticket_key_t key;
+
+	rwlock_lock_read(&(tls_sessions.lock));
+
+	if (encrypt) {
+		mm_copy(&key, &(tls_sessions.current), sizeof(tls_ticket_key_t));
+		result = 1;
+	}
+	else if (!memcmp(name, tls_sessions.current.name, sizeof(key.name))) {
+		mm_copy(&key, &(tls_sessions.current), sizeof(tls_ticket_key_t));
+		result = 1;
+	}
+	else if (!memcmp(name, tls_sessions.previous.name, sizeof(key.name))) {
+		mm_copy(&key, &(tls_sessions.previous), sizeof(tls_ticket_key_t));
+		result = 2;
+	}
+
+	rwlock_unlock(&(tls_sessions.lock));
+
+	// An unknown key name means the ticket is too old, or was issued by a different process, so a full handshake is required.
+	if (!result) {
+		return 0;
+	}
+
+	if (encrypt) {
+		mm_copy(name, key.name, sizeof(key.name));
+		if (RAND_bytes_d(iv, EVP_CIPHER_iv_length_d(EVP_aes_256_cbc_d())) != 1 ||
+			EVP_EncryptInit_ex_d(cipher, EVP_aes_256_cbc_d(), NULL, key.cipher, iv) != 1) {
+			result = -1;
+		}
+	}
+	else if (EVP_DecryptInit_ex_d(cipher, EVP_aes_256_cbc_d(), NULL, key.cipher, iv) != 1) {
+		result = -1;
+	}
+
+	if (result > 0 && HMAC_Init_ex_d(hmac, key.hmac, sizeof(key.hmac), EVP_sha256_d(), NULL) != 1) {
+		result = -1;
+	}
+
+	mm_wipe(&key, sizeof(tls_ticket_key_t));
+
+	return result;
+}
+
+/**
+ * @brief	Configure a server TLS context to use the session cache, and the session ticket keys.
+ * @param	context		the server TLS context.
+ * @param	id			a value unique to the server instance, which keeps its sessions from being resumed by the other servers.
+ * @param	length		the length, in bytes, of the unique value.
+ * @return	true on success, or false on failure.
+ */
+bool_t tls_sessions_enable(SSL_CTX *context, const void *id, uint_t length) {
+
+	if (!tls_sessions.rotated) {
+		log_pedantic("The TLS session cache hasn't been initialized.");
+		return false;
+	}
+	else if (SSL_CTX_set_session_id_context_d(context, id, length) != 1) {
+		log_pedantic("Unable to set the TLS session id context. { error = %s }", ssl_error_string(MEMORYBUF(256), 256));
+		return false;
+	}
+	else if (SSL_CTX_callback_ctrl_d(context, SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB, (void (*)(void))&tls_ticket_callback) != 1) {
+		log_pedantic("Unable to set the TLS session ticket key callback. { error = %s }", ssl_error_string(MEMORYBUF(256), 256));
+		return false;
+	}
+
+	// Sessions are only stored in our sharded cache, which avoids the lock protecting the internal cache.
+	SSL_CTX_ctrl_d(context, SSL_CTRL_SET_SESS_CACHE_MODE, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL, NULL);
+	SSL_CTX_set_timeout_d(context, MAGMA_TLS_SESSION_TIMEOUT);
+
+	SSL_CTX_sess_set_new_cb_d(context, &tls_session_new);
+	SSL_CTX_sess_set_get_cb_d(context, &tls_session_get);
+	SSL_CTX_sess_set_remove_cb_d(context, &tls_session_remove);
+
+	return true;
+}
@@ -39,7 +39,7 @@ bool_t tls_server_create(void *server, uint_t security_level) {
 		ciphers = SSL_DEFAULT_CIPHER_LIST;
 	}
 	else if (security_level == 2) {
-		options = (options | SSL_OP_NO_SSLv2 | SSL_OP_NO_TICKET | SSL_OP_NO_COMPRESSION | SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS);
+		options = (options | SSL_OP_NO_SSLv2 | SSL_OP_NO_COMPRESSION | SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS);
 		//options = SSL_OP_ALL | SSL_OP_NO_SSLv2 | SSL_MODE_AUTO_RETRY | SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS;
 		ciphers = MAGMA_CIPHERS_MEDIUM;
 	}
@@ -108,6 +108,13 @@ bool_t tls_server_create(void *server, uint_t security_level) {
 	// from sending a client certificate request.
 	SSL_CTX_set_verify_d(local->tls.context, SSL_VERIFY_NONE, NULL);
 
+	// Allow clients to resume a previous session, using either a session ticket or a cached session id. The port is used as the session
+	// id context, since it's unique to each server instance.
+	if (!tls_sessions_enable(local->tls.context, &(local->network.port), sizeof(local->network.port))) {
+		log_critical("Could not enable TLS session resumption.");
+		return false;
+	}
+
 	// Enabling the ellipitical curve single use will improve the forward secreecy for ecdh keys.
 //	else if (SSL_CTX_ctrl_d(local->tls.context, SSL_OP_SINGLE_ECDH_USE, 1, NULL) != 1) {
 //		log_critical("Could not enable single use elliptical curve.");
@@ -150,13 +157,18 @@ void tls_server_destroy(void *server) {
  * @param	server	a server object which contains the underlying SSL context.
  * @param	sockd	the file descriptor of the TCP connection to be made SSL-ready.
  * @param	flags	passed to BIO_new_socket(), determines whether the socket is shut down when the BIO is freed.
+ * @param	timeout	the number of seconds the client has to complete its side of the handshake.
+ * @return	NULL on failure, or if the handshake didn't finish before the deadline, otherwise a pointer to the TLS connection.
  */
-TLS * tls_server_alloc(void *server, int sockd, int flags) {
+TLS * tls_server_alloc(void *server, int sockd, int flags, uint32_t timeout) {
 
 	SSL *tls;
 	BIO *bio;
+	struct pollfd ready;
+	struct timespec now;
 	server_t *local = server;
-	int_t result = 0, counter = 0;
+	int_t result = 0, error = 0, mode;
+	int64_t deadline, remaining = 0;
 
 	// Clear the error state, so we get accurate indications of a problem.
 	errno = 0;
@@ -190,25 +202,51 @@ TLS * tls_server_alloc(void *server, int sockd, int flags) {
 	SSL_set_bio_d(tls, bio, bio);
 	SSL_set_accept_state_d(tls);
 
-	// If the result code indicates a handshake error, but the TCP connection is still alive, we retry the handshake.
+	// The handshake is performed using a non-blocking socket, so a client which stalls, or trickles its side of the handshake, can only
+	// hold the calling thread until the deadline, rather than for the full network timeout of the server.
+	if ((mode = fcntl(sockd, F_GETFL, 0)) == -1 || fcntl(sockd, F_SETFL, mode | O_NONBLOCK) == -1 || clock_gettime(CLOCK_MONOTONIC, &now)) {
+		log_pedantic("Unable to place the socket into non-blocking mode for the TLS handshake. { error = %s }", strerror_r(errno, MEMORYBUF(256), 256));
+		SSL_free_d(tls);
+		return NULL;
+	}
+
+	deadline = ((int64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000) + ((int64_t)timeout * 1000);
+
+	// If the handshake wants to read, or write, we wait for the socket to become ready, and then try again, until the deadline passes.
 	do {
 
-		// Attempt the server connection setup.
-		if ((result = SSL_accept_d(tls)) < 0) {
-			log_pedantic("TLS accept error, but the result indicates we should retry. { error = %i }", SSL_get_error_d(tls, result));
-		}
+		errno = 0;
+		ERR_clear_error_d();
 
-		else if (result < 1) {
+		if ((result = SSL_accept_d(tls)) == 1) {
+			break;
+		}
+		else if ((error = SSL_get_error_d(tls, result)) != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
 			log_pedantic("TLS accept error. { accept = %i / error = %s }", result, ssl_error_string(MEMORYBUF(512), 512));
+			break;
+		}
+		else if (clock_gettime(CLOCK_MONOTONIC, &now) ||
+			(remaining = deadline - (((int64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000))) <= 0) {
+			log_pedantic("The TLS handshake didn't finish before the deadline. { timeout = %u }", timeout);
+			break;
 		}
 
-	} while (result < 0 && counter++ < 10);
+		ready.fd = sockd;
+		ready.events = (error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT);
+		ready.revents = 0;
+
+	} while (poll(&ready, 1, remaining) >= 0 || errno == EINTR);
+
+	// Restore the original socket mode, since the connection will be handed back to the blocking worker threads.
+	fcntl(sockd, F_SETFL, mode);
 
 	if (result != 1) {
 		SSL_free_d(tls);
 		return NULL;
 	}
 
+	stats_increment_by_name(tls_resumed(tls) ? "provider.tls.handshakes.resumed" : "provider.tls.handshakes.full");
+
 	return tls;
 }
 
@@ -218,6 +256,18 @@ TLS * tls_server_alloc(void *server, int sockd, int flags) {
  * @return	NULL on failure or a pointer to the SSL handle of the file descriptor if SSL negotiation was successful.
  */
 void * tls_client_alloc(int_t sockd) {
+	return tls_client_resume(sockd, NULL);
+}
+
+/**
+ * @brief	Establish an TLS client wrapper around a socket descriptor, and attempt to resume a previous session.
+ * @see		SSL_get1_session()
+ * @param	sockd	the file descriptor of the socket to have its transport security level upgraded.
+ * @param	session	the session to be offered to the server, which is obtained from an earlier connection using SSL_get1_session(), or
+ * 					NULL to perform a full handshake.
+ * @return	NULL on failure or a pointer to the SSL handle of the file descriptor if SSL negotiation was successful.
+ */
+void * tls_client_resume(int_t sockd, void *session) {
 
 	BIO *bio;
 	SSL *tls;
@@ -265,6 +315,11 @@ void * tls_client_alloc(int_t sockd) {
 	SSL_set_bio_d(tls, bio, bio);
 	SSL_set_connect_state_d(tls);
 
+	// If the server doesn't recognize the session, the handshake simply falls back to negotiating a new one.
+	if (session && SSL_set_session_d(tls, session) != 1) {
+		log_pedantic("Could not offer the previous TLS session to the server. { error = %s }", ssl_error_string(MEMORYBUF(512), 512));
+	}
+
 	SSL_CTX_free_d(ctx);
 
 	do {
@@ -542,10 +597,8 @@ int tls_read(TLS *tls, void *buffer, int length, bool_t block) {
 		return -1;
 	}
 
-	// In the future, when we switch to OpenSSL v1.1.0 around the year ~2032, we should look into using an
-	// asynchronous SSL context to facilitate our non-blocking read/write operations. Look to configure the
-	// context using SSL_CTX_set_mode(SSL_CTX *ctx, long mode) with mode set to SSL_MODE_ASYNC.
-	if (!block) log_pedantic("Non-blocking TLS read calls have not been fully implemented yet.");
+	// Non-blocking reads are only attempted by the network event loop, which places the underlying socket into non-blocking
+	// mode first, and then uses tls_continue() to separate a want read result from a fatal error.
 
 	do {
 
@@ -651,3 +704,12 @@ int tls_print(TLS *tls, const char *format, va_list args) {
 
 	return result;
 }
+
+/**
+ * @brief	Determine whether a TLS connection resumed a previous session, instead of performing a full handshake.
+ * @param	tls		the TLS connection being inspected.
+ * @return	true if the session was resumed, otherwise false.
+ */
+bool_t tls_resumed(TLS *tls) {
+	return (tls && SSL_ctrl_d(tls, SSL_CTRL_GET_SESSION_REUSED, 0, NULL) == 1);
+}
@@ -126,6 +126,7 @@ uint64_t      stmt_insert_conn(MYSQL_STMT **group, MYSQL_BIND *parameters, uint3
 MYSQL_STMT *  stmt_open(MYSQL *mysql);
 bool_t        stmt_prepare(MYSQL_STMT *group, const char *query, unsigned long length);
 bool_t        stmt_rebuild(uint32_t connection);
+chr_t *       stmt_query(MYSQL_STMT **group);
 MYSQL_STMT *  stmt_reset(MYSQL_STMT **group, uint32_t connection);
 bool_t        stmt_start(void);
 void          stmt_stop(void);
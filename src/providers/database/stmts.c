@@ -214,6 +214,23 @@ bool_t stmt_rebuild(uint32_t connection) {
 	return true;
 }
 
+/**
+ * @brief	Find the query used to prepare a statement.
+ * @note	This function is used to describe the statements recorded by the flight recorder, so it only reads the statement table.
+ * @param	group	the prepared statement group.
+ * @return	NULL if the group isn't in the statement table, or a pointer to the query string.
+ */
+chr_t * stmt_query(MYSQL_STMT **group) {
+
+	for (uint32_t i = 0; group && i < sizeof(queries) / sizeof(chr_t *); i++) {
+		if (((MYSQL_STMT **)*((MYSQL_STMT **)&(stmts.select_domains) + i)) == group) {
+			return queries[i];
+		}
+	}
+
+	return NULL;
+}
+
 /*
  * @brief	Reset the prepared statement on client and server.
  * @param	group		the target prepare mysql statement.
@@ -227,6 +244,8 @@ MYSQL_STMT * stmt_reset(MYSQL_STMT **group, uint32_t connection) {
 		return NULL;
 	}
 
+	recorder_event(RECORDER_SQL_STATEMENT, connection, (uintptr_t)group);
+
 	// Try preparing the statement.
 	if (*(group + connection) == NULL || mysql_stmt_reset_d(*(group + connection))) {
 
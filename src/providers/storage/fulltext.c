@@ -0,0 +1,782 @@
+
+/**
+ * @file /magma/providers/storage/fulltext.c
+ *
+ * @brief	A persistent, per user, inverted index of the trigrams found inside messages, which lets searches skip messages that can't match.
+ *
+ * IMAP searches match any substring of a message, so the index records every run of three word characters, instead of whole words, which
+ * means a search value like "ello" still finds a message containing "hello". A message can only contain the value if it contains every
+ * trigram found inside the value, so the index can rule messages out, but a possible match must always be confirmed by scanning the message.
+ *
+ * The index lives in a Tokyo Cabinet hash file alongside the storage tanks. Each trigram is stored using the key "gram.USER.XYZ", and maps
+ * to the list of message numbers which contain it. The key "indexed.USER" holds the list of every message number which was added to the
+ * index, so searches can tell the difference between a message that doesn't contain a trigram, and a message that was never indexed. The
+ * key "message.USER.MESSAGE" holds the trigrams found inside a message, so they can be removed once the message is deleted.
+ *
+ * Delivered messages are held in memory, and written in batches, so a trigram found in several messages is appended to its list once. A
+ * message is only added to the indexed list after its trigrams are written, so a lost batch means the messages will simply be scanned.
+ * Deleted message numbers are recorded using the key "deleted.USER", and once enough accumulate, they're compacted out of every list.
+ */
+
+#include "magma.h"
+
+struct {
+	TCHDB *ctx;
+	time_t oldest;
+	size_t pending_count;
+	pthread_mutex_t lock;
+	fulltext_pending_t pending[MAGMA_STORAGE_SEARCH_BATCH];
+} fulltext = {
+	.ctx = NULL,
+	.oldest = 0,
+	.pending_count = 0,
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * @brief	Determine whether a character is part of a word.
+ * @note	Any byte outside the ASCII range is treated as a word character, so UTF-8 encoded words are indexed intact.
+ * @param	c	the character to be checked.
+ * @return	true if the character is alphanumeric, or outside the ASCII range, otherwise false.
+ */
+static bool_t fulltext_word_char(uchr_t c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+/**
+ * @brief	Pack three characters into a trigram, folding ASCII letters to lower case, the same way searches ignore case.
+ */
+static uint32_t fulltext_gram(uchr_t *data) {
+	return ((uint32_t)lower_chr(data[0]) << 16) | ((uint32_t)lower_chr(data[1]) << 8) | (uint32_t)lower_chr(data[2]);
+}
+
+/**
+ * @brief	Compare two trigrams, for use with qsort().
+ */
+static int fulltext_gram_compare(const void *one, const void *two) {
+	return *(uint32_t *)one < *(uint32_t *)two ? -1 : *(uint32_t *)one > *(uint32_t *)two;
+}
+
+/**
+ * @brief	Compare two message numbers, for use with qsort() and bsearch().
+ */
+static int fulltext_number_compare(const void *one, const void *two) {
+	return *(uint64_t *)one < *(uint64_t *)two ? -1 : *(uint64_t *)one > *(uint64_t *)two;
+}
+
+/**
+ * @brief	Compare two pending messages by user, and then message number, for use with qsort().
+ */
+static int fulltext_pending_compare(const void *one, const void *two) {
+
+	fulltext_pending_t *a = (fulltext_pending_t *)one, *b = (fulltext_pending_t *)two;
+
+	if (a->usernum != b->usernum) {
+		return a->usernum < b->usernum ? -1 : 1;
+	}
+
+	return a->messagenum < b->messagenum ? -1 : a->messagenum > b->messagenum;
+}
+
+/**
+ * @brief	Compare two postings by user, trigram, and then message number, for use with qsort().
+ */
+static int fulltext_posting_compare(const void *one, const void *two) {
+
+	fulltext_posting_t *a = (fulltext_posting_t *)one, *b = (fulltext_posting_t *)two;
+
+	if (a->usernum != b->usernum) {
+		return a->usernum < b->usernum ? -1 : 1;
+	}
+	else if (a->gram != b->gram) {
+		return a->gram < b->gram ? -1 : 1;
+	}
+
+	return a->messagenum < b->messagenum ? -1 : a->messagenum > b->messagenum;
+}
+
+/**
+ * @brief	Build the key for a trigram list.
+ * @param	key			a buffer of at least 64 bytes, which receives the key.
+ * @param	usernum		the numerical id of the user who owns the list.
+ * @param	gram		the trigram.
+ * @return	the length of the key, or 0 on failure.
+ */
+static int_t fulltext_gram_key(chr_t *key, uint64_t usernum, uint32_t gram) {
+
+	int_t length;
+
+	if ((length = snprintf(key, 60, "gram.%lu.", usernum)) <= 0 || length >= 60) {
+		return 0;
+	}
+
+	// The trigram is stored as raw bytes, since the key length is passed explicitly.
+	key[length++] = (gram >> 16) & 0xff;
+	key[length++] = (gram >> 8) & 0xff;
+	key[length++] = gram & 0xff;
+
+	return length;
+}
+
+/**
+ * @brief	Find the unique set of trigrams inside a block of text.
+ * @note	Only trigrams made up entirely of word characters are recorded, so the text surrounding a word can't affect the result. Words
+ * 			shorter than three characters don't produce any trigrams, and are only found by scanning the messages.
+ * @param	text	the text to be split.
+ * @param	count	a pointer to receive the number of trigrams found.
+ * @return	NULL if no trigrams were found, or a sorted array of trigrams, free of duplicates, which must be freed by the caller.
+ */
+uint32_t * fulltext_grams(stringer_t *text, size_t *count) {
+
+	uchr_t *data;
+	uint32_t *result = NULL;
+	size_t length, start, total = 0, unique = 0;
+
+	*count = 0;
+
+	if (st_empty_out(text, &data, &length)) {
+		return NULL;
+	}
+
+	// The first pass counts the trigrams, so the array can be allocated once.
+	for (size_t i = 0; i < length;) {
+
+		for (start = i; i < length && fulltext_word_char(data[i]); i++);
+
+		if (i - start >= 3) {
+			total += i - start - 2;
+		}
+
+		for (; i < length && !fulltext_word_char(data[i]); i++);
+	}
+
+	if (!total || !(result = mm_alloc(sizeof(uint32_t) * total))) {
+		return NULL;
+	}
+
+	for (size_t i = 0, j = 0; i < length && j < total;) {
+
+		for (start = i; i < length && fulltext_word_char(data[i]); i++);
+
+		for (size_t k = start; k + 3 <= i && j < total; k++) {
+			result[j++] = fulltext_gram(data + k);
+		}
+
+		for (; i < length && !fulltext_word_char(data[i]); i++);
+	}
+
+	qsort(result, total, sizeof(uint32_t), &fulltext_gram_compare);
+
+	for (size_t i = 0; i < total; i++) {
+		if (!unique || result[unique - 1] != result[i]) {
+			result[unique++] = result[i];
+		}
+	}
+
+	*count = unique;
+	return result;
+}
+
+/**
+ * @brief	Determine whether a character can appear inside a line of base64 encoded data.
+ */
+static bool_t fulltext_base64_char(uchr_t c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=' || c == '\r';
+}
+
+/**
+ * @brief	Extract the lines of a raw message body which should be indexed alongside the decoded text.
+ * @note	A line made up entirely of base64 characters is skipped, since the lines of an encoded part would fill the index with random
+ * 			trigrams. Every other line is kept, including the part headers, boundaries and the bodies of attachments which aren't base64
+ * 			encoded, so a value which can't appear inside base64 data, and isn't in the index, can't be anywhere in the raw body.
+ * @see		fulltext_term()
+ * @param	raw		the raw message body.
+ * @return	NULL if no lines were kept, or on failure, otherwise a managed string which must be freed by the caller.
+ */
+stringer_t * fulltext_raw(stringer_t *raw) {
+
+	uchr_t *data;
+	size_t length, start, total = 0;
+	stringer_t *result = NULL;
+	bool_t keep;
+
+	if (st_empty_out(raw, &data, &length)) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+
+		keep = false;
+
+		for (start = i; i < length && data[i] != '\n'; i++) {
+			if (!fulltext_base64_char(data[i])) keep = true;
+		}
+
+		// Each kept line is followed by a line feed, so trigrams can't span the lines which were skipped.
+		if (keep && (result || (result = st_alloc(length + 1)))) {
+			mm_copy(st_char_get(result) + total, data + start, i - start);
+			total += i - start;
+			*(st_char_get(result) + total++) = '\n';
+		}
+		else if (keep) {
+			log_pedantic("Unable to allocate %zu bytes for the raw text of a message.", length + 1);
+			return NULL;
+		}
+	}
+
+	if (result) {
+		st_length_set(result, total);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Determine whether the index can be used to rule out messages whose raw body doesn't contain a search value.
+ * @note	A value holding a character which can't appear inside base64 data, and no line breaks, can only match inside a line which
+ * 			fulltext_raw() kept, so if any of its trigrams are missing from the index, the value isn't in the raw body.
+ * @param	value	the search value.
+ * @return	true if the absence of the value from the index proves it's absent from the raw body, otherwise false.
+ */
+bool_t fulltext_term(stringer_t *value) {
+
+	uchr_t *data;
+	size_t length;
+	bool_t result = false;
+
+	if (st_empty_out(value, &data, &length)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		if (data[i] == '\r' || data[i] == '\n') return false;
+		else if (!fulltext_base64_char(data[i])) result = true;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Fetch a list of message numbers from the index.
+ * @param	key		the key of the list being fetched.
+ * @param	length	the length of the key.
+ * @param	count	a pointer to receive the number of message numbers in the list.
+ * @return	NULL if the list doesn't exist, or a sorted array of message numbers, which must be freed using tcfree_d().
+ */
+static uint64_t * fulltext_list(chr_t *key, int_t length, size_t *count) {
+
+	int size = 0;
+	uint64_t *result;
+
+	*count = 0;
+
+	if (!(result = tchdbget_d(fulltext.ctx, key, length, &size))) {
+		return NULL;
+	}
+	else if (size < sizeof(uint64_t)) {
+		tcfree_d(result);
+		return NULL;
+	}
+
+	// Batches and compactions may leave the message numbers out of order.
+	*count = size / sizeof(uint64_t);
+	qsort(result, *count, sizeof(uint64_t), &fulltext_number_compare);
+
+	return result;
+}
+
+/**
+ * @brief	Replace a list of message numbers, removing the list if it's empty.
+ * @param	key		the key of the list being replaced.
+ * @param	length	the length of the key.
+ * @param	list	the message numbers.
+ * @param	count	the number of message numbers in the list.
+ * @return	true on success, or false on failure.
+ */
+static bool_t fulltext_list_store(chr_t *key, int_t length, uint64_t *list, size_t count) {
+
+	if (!count) {
+		return tchdbout_d(fulltext.ctx, key, length) || tchdbecode_d(fulltext.ctx) == TCENOREC;
+	}
+
+	return tchdbputasync_d(fulltext.ctx, key, length, list, count * sizeof(uint64_t));
+}
+
+/**
+ * @brief	Free the trigrams held by the pending messages, and empty the batch.
+ * @note	The caller must hold the index lock.
+ * @return	This function returns no value.
+ */
+static void fulltext_pending_clear(void) {
+
+	for (size_t i = 0; i < fulltext.pending_count; i++) {
+		mm_cleanup(fulltext.pending[i].grams);
+	}
+
+	mm_wipe(fulltext.pending, sizeof(fulltext.pending));
+	fulltext.pending_count = 0;
+
+	return;
+}
+
+/**
+ * @brief	Write the pending batch of messages to the index.
+ * @note	The caller must hold the index lock. The postings are sorted, so every trigram list is appended to once per batch, no matter how
+ * 			many messages contain the trigram. The messages are added to the indexed lists last, so a failure part of the way through simply
+ * 			means the batch will be scanned by searches.
+ * @return	true on success, or false on failure.
+ */
+static bool_t fulltext_flush(void) {
+
+	int_t length;
+	size_t total = 0, run;
+	uint64_t *numbers = NULL;
+	fulltext_posting_t *postings = NULL;
+	chr_t key[64];
+
+	if (!fulltext.pending_count) {
+		return true;
+	}
+
+	for (size_t i = 0; i < fulltext.pending_count; i++) {
+		total += fulltext.pending[i].count;
+	}
+
+	// A message contributes each trigram once, so no run of postings can be longer than the batch.
+	if (!(numbers = mm_alloc(sizeof(uint64_t) * fulltext.pending_count)) || (total && !(postings = mm_alloc(sizeof(fulltext_posting_t) * total)))) {
+		log_pedantic("Unable to allocate memory for a full text search index batch. { postings = %zu }", total);
+		mm_cleanup(numbers);
+		fulltext_pending_clear();
+		return false;
+	}
+
+	qsort(fulltext.pending, fulltext.pending_count, sizeof(fulltext_pending_t), &fulltext_pending_compare);
+
+	for (size_t i = 0, j = 0; i < fulltext.pending_count; i++) {
+		for (size_t k = 0; k < fulltext.pending[i].count; k++, j++) {
+			postings[j].usernum = fulltext.pending[i].usernum;
+			postings[j].messagenum = fulltext.pending[i].messagenum;
+			postings[j].gram = fulltext.pending[i].grams[k];
+		}
+	}
+
+	if (total) {
+		qsort(postings, total, sizeof(fulltext_posting_t), &fulltext_posting_compare);
+	}
+
+	// Append each run of postings which share a user and trigram to the trigram list using a single write.
+	for (size_t i = 0; i < total; i += run) {
+
+		for (run = 0; i + run < total && postings[i + run].usernum == postings[i].usernum && postings[i + run].gram == postings[i].gram; run++) {
+			numbers[run] = postings[i + run].messagenum;
+		}
+
+		if (!(length = fulltext_gram_key(key, postings[i].usernum, postings[i].gram)) ||
+			!tchdbputcat_d(fulltext.ctx, key, length, numbers, run * sizeof(uint64_t))) {
+			log_error("Unable to update the full text search index. { tchdbputcat = %s / messages = %zu }", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)),
+				fulltext.pending_count);
+			goto error;
+		}
+	}
+
+	// Record which trigrams each message holds, so they can be found again once the message is deleted.
+	for (size_t i = 0; i < fulltext.pending_count; i++) {
+		if ((length = snprintf(key, sizeof(key), "message.%lu.%lu", fulltext.pending[i].usernum, fulltext.pending[i].messagenum)) <= 0 ||
+			(fulltext.pending[i].count && !tchdbputasync_d(fulltext.ctx, key, length, fulltext.pending[i].grams, fulltext.pending[i].count * sizeof(uint32_t)))) {
+			log_error("Unable to update the full text search index. { tchdbputasync = %s / messagenum = %lu }", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)),
+				fulltext.pending[i].messagenum);
+			goto error;
+		}
+	}
+
+	// The pending messages are sorted by user, so each user's indexed list is also appended to once.
+	for (size_t i = 0; i < fulltext.pending_count; i += run) {
+
+		for (run = 0; i + run < fulltext.pending_count && fulltext.pending[i + run].usernum == fulltext.pending[i].usernum; run++) {
+			numbers[run] = fulltext.pending[i + run].messagenum;
+		}
+
+		if ((length = snprintf(key, sizeof(key), "indexed.%lu", fulltext.pending[i].usernum)) <= 0 ||
+			!tchdbputcat_d(fulltext.ctx, key, length, numbers, run * sizeof(uint64_t))) {
+			log_error("Unable to update the full text search index. { tchdbputcat = %s / usernum = %lu }", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)),
+				fulltext.pending[i].usernum);
+			goto error;
+		}
+	}
+
+	mm_free(numbers);
+	mm_cleanup(postings);
+	fulltext_pending_clear();
+
+	return true;
+
+error:
+
+	mm_free(numbers);
+	mm_cleanup(postings);
+	fulltext_pending_clear();
+
+	return false;
+}
+
+/**
+ * @brief	Remove a user's deleted messages from every list in the index.
+ * @note	The caller must hold the index lock, so no batch can append to a list while it's being rewritten. The messages are removed from
+ * 			the indexed list first, so an interrupted compaction can only leave behind numbers that searches never ask about.
+ * @param	usernum		the numerical id of the user whose deleted messages are being compacted.
+ * @return	true on success, or false on failure.
+ */
+static bool_t fulltext_compact(uint64_t usernum) {
+
+	int size;
+	int_t length;
+	bool_t result = true;
+	uint32_t **records = NULL, *grams = NULL;
+	uint64_t *deleted = NULL, *list;
+	size_t deleted_count, count, kept, total = 0, unique = 0, *sizes = NULL;
+	chr_t key[64];
+
+	if ((length = snprintf(key, sizeof(key), "deleted.%lu", usernum)) <= 0 || !(deleted = fulltext_list(key, length, &deleted_count))) {
+		return true;
+	}
+	else if (!(records = mm_alloc(sizeof(uint32_t *) * deleted_count)) || !(sizes = mm_alloc(sizeof(size_t) * deleted_count))) {
+		log_pedantic("Unable to allocate memory for a full text search index compaction. { usernum = %lu }", usernum);
+		mm_cleanup(records);
+		tcfree_d(deleted);
+		return false;
+	}
+
+	if ((length = snprintf(key, sizeof(key), "indexed.%lu", usernum)) > 0 && (list = fulltext_list(key, length, &count))) {
+
+		kept = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			if (!bsearch(&list[i], deleted, deleted_count, sizeof(uint64_t), &fulltext_number_compare)) {
+				list[kept++] = list[i];
+			}
+		}
+
+		result = fulltext_list_store(key, length, list, kept);
+		tcfree_d(list);
+	}
+
+	// Collect the trigrams held by every deleted message, so each affected list is only rewritten once.
+	for (size_t i = 0; result && i < deleted_count; i++) {
+		if ((length = snprintf(key, sizeof(key), "message.%lu.%lu", usernum, deleted[i])) > 0 && (records[i] = tchdbget_d(fulltext.ctx, key, length, &size))) {
+			sizes[i] = size / sizeof(uint32_t);
+			total += sizes[i];
+		}
+	}
+
+	if (result && total && !(grams = mm_alloc(sizeof(uint32_t) * total))) {
+		log_pedantic("Unable to allocate memory for a full text search index compaction. { usernum = %lu }", usernum);
+		result = false;
+	}
+	else if (result && total) {
+
+		for (size_t i = 0, j = 0; i < deleted_count; i++) {
+			if (records[i]) {
+				mm_copy(grams + j, records[i], sizes[i] * sizeof(uint32_t));
+				j += sizes[i];
+			}
+		}
+
+		qsort(grams, total, sizeof(uint32_t), &fulltext_gram_compare);
+
+		for (size_t i = 0; i < total; i++) {
+			if (!unique || grams[unique - 1] != grams[i]) {
+				grams[unique++] = grams[i];
+			}
+		}
+	}
+
+	// Rewrite each trigram list without the deleted messages.
+	for (size_t i = 0; result && i < unique; i++) {
+
+		if (!(length = fulltext_gram_key(key, usernum, grams[i])) || !(list = fulltext_list(key, length, &count))) {
+			continue;
+		}
+
+		kept = 0;
+
+		for (size_t j = 0; j < count; j++) {
+			if (!bsearch(&list[j], deleted, deleted_count, sizeof(uint64_t), &fulltext_number_compare)) {
+				list[kept++] = list[j];
+			}
+		}
+
+		if (kept != count && !fulltext_list_store(key, length, list, kept)) {
+			log_error("Unable to update the full text search index. { tchdbputasync = %s / usernum = %lu }", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)), usernum);
+			result = false;
+		}
+
+		tcfree_d(list);
+	}
+
+	// Only discard the trigram records, and the deleted list, once every trigram list has been rewritten, so a failure can be retried.
+	for (size_t i = 0; result && i < deleted_count; i++) {
+		if (records[i] && (length = snprintf(key, sizeof(key), "message.%lu.%lu", usernum, deleted[i])) > 0) {
+			tchdbout_d(fulltext.ctx, key, length);
+		}
+	}
+
+	if (result && (length = snprintf(key, sizeof(key), "deleted.%lu", usernum)) > 0) {
+		tchdbout_d(fulltext.ctx, key, length);
+	}
+
+	for (size_t i = 0; i < deleted_count; i++) {
+		if (records[i]) tcfree_d(records[i]);
+	}
+
+	mm_cleanup(grams);
+	mm_free(records);
+	mm_free(sizes);
+	tcfree_d(deleted);
+
+	return result;
+}
+
+/**
+ * @brief	Add a message to the user's full text search index.
+ * @note	The message is held in memory until the batch is full, or the oldest message in the batch has waited MAGMA_STORAGE_SEARCH_DELAY
+ * 			seconds, at which point the entire batch is written. Until then, searches simply scan the message.
+ * @param	usernum		the numerical id of the user who owns the message.
+ * @param	messagenum	the numerical id of the message.
+ * @param	text		the searchable text of the message, as returned by mail_mime_text(), along with the message header, and the lines of
+ * 						the raw body returned by fulltext_raw().
+ * @return	true if the message was added to the index, or false on failure.
+ */
+bool_t fulltext_index(uint64_t usernum, uint64_t messagenum, stringer_t *text) {
+
+	bool_t result = true;
+	size_t count = 0;
+	uint32_t *grams;
+
+	if (!fulltext.ctx || st_empty(text)) {
+		return false;
+	}
+
+	// A message without any trigrams is still indexed, since it can't contain any search value which has a trigram.
+	grams = fulltext_grams(text, &count);
+
+	mutex_lock(&fulltext.lock);
+
+	if (!fulltext.pending_count) {
+		fulltext.oldest = time(NULL);
+	}
+
+	fulltext.pending[fulltext.pending_count].usernum = usernum;
+	fulltext.pending[fulltext.pending_count].messagenum = messagenum;
+	fulltext.pending[fulltext.pending_count].grams = grams;
+	fulltext.pending[fulltext.pending_count].count = count;
+	fulltext.pending_count++;
+
+	if (fulltext.pending_count == MAGMA_STORAGE_SEARCH_BATCH || time(NULL) - fulltext.oldest >= MAGMA_STORAGE_SEARCH_DELAY) {
+		result = fulltext_flush();
+	}
+
+	mutex_unlock(&fulltext.lock);
+
+	return result;
+}
+
+/**
+ * @brief	Record that a message was deleted, so its message number can be compacted out of the index.
+ * @note	Once MAGMA_STORAGE_SEARCH_COMPACT deleted messages have accumulated for the user, they're all removed from the index together.
+ * @param	usernum		the numerical id of the user who owned the message.
+ * @param	messagenum	the numerical id of the deleted message.
+ * @return	This function returns no value.
+ */
+void fulltext_remove(uint64_t usernum, uint64_t messagenum) {
+
+	int_t length;
+	size_t count = 0;
+	uint64_t *deleted;
+	chr_t key[64];
+
+	if (!fulltext.ctx) {
+		return;
+	}
+
+	mutex_lock(&fulltext.lock);
+
+	// A message which hasn't been written yet can simply be dropped from the batch.
+	for (size_t i = 0; i < fulltext.pending_count; i++) {
+		if (fulltext.pending[i].usernum == usernum && fulltext.pending[i].messagenum == messagenum) {
+			mm_cleanup(fulltext.pending[i].grams);
+			fulltext.pending[i] = fulltext.pending[--fulltext.pending_count];
+			mm_wipe(&(fulltext.pending[fulltext.pending_count]), sizeof(fulltext_pending_t));
+			mutex_unlock(&fulltext.lock);
+			return;
+		}
+	}
+
+	if ((length = snprintf(key, sizeof(key), "deleted.%lu", usernum)) <= 0 || !tchdbputcat_d(fulltext.ctx, key, length, &messagenum, sizeof(uint64_t))) {
+		log_error("Unable to update the full text search index. { tchdbputcat = %s / messagenum = %lu }", tchdberrmsg_d(tchdbecode_d(fulltext.ctx)), messagenum);
+	}
+	else if ((deleted = fulltext_list(key, length, &count))) {
+
+		tcfree_d(deleted);
+
+		if (count >= MAGMA_STORAGE_SEARCH_COMPACT && !fulltext_compact(usernum)) {
+			log_error("Unable to compact the full text search index. { usernum = %lu / deleted = %zu }", usernum, count);
+		}
+	}
+
+	mutex_unlock(&fulltext.lock);
+
+	return;
+}
+
+/**
+ * @brief	Free a full text search query.
+ * @param	query	the query to be freed.
+ * @return	This function returns no value.
+ */
+void fulltext_query_free(fulltext_query_t *query) {
+
+	if (query) {
+		if (query->indexed) tcfree_d(query->indexed);
+		if (query->matches) tcfree_d(query->matches);
+		mm_free(query);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Look up the messages which contain every trigram in a search value.
+ * @note	If the index can't answer the query, because the value doesn't contain any trigrams, or the user has no indexed messages,
+ * 			the returned query will be empty, and every message will need to be scanned.
+ * @param	usernum		the numerical id of the user whose messages are being searched.
+ * @param	value		the search value.
+ * @return	NULL on failure, or a query object, which should be passed to fulltext_query_check().
+ */
+fulltext_query_t * fulltext_query(uint64_t usernum, stringer_t *value) {
+
+	int_t length;
+	size_t grams_count = 0, count, kept;
+	uint32_t *grams = NULL;
+	uint64_t *list;
+	fulltext_query_t *query;
+	chr_t key[64];
+
+	if (!(query = mm_alloc(sizeof(fulltext_query_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a full text search query.", sizeof(fulltext_query_t));
+		return NULL;
+	}
+
+	if (!fulltext.ctx || st_empty(value) || !(grams = fulltext_grams(value, &grams_count))) {
+		return query;
+	}
+
+	if ((length = snprintf(key, sizeof(key), "indexed.%lu", usernum)) <= 0 || !(query->indexed = fulltext_list(key, length, &(query->indexed_count)))) {
+		mm_free(grams);
+		return query;
+	}
+
+	// Intersect the lists for each trigram, which leaves the messages containing all of them.
+	for (size_t i = 0; i < grams_count; i++) {
+
+		if (!(length = fulltext_gram_key(key, usernum, grams[i])) || !(list = fulltext_list(key, length, &count))) {
+			if (query->matches) tcfree_d(query->matches);
+			query->matches = NULL;
+			query->matches_count = 0;
+			break;
+		}
+		else if (!query->matches) {
+			query->matches = list;
+			query->matches_count = count;
+			continue;
+		}
+
+		kept = 0;
+
+		for (size_t j = 0, k = 0; j < query->matches_count && k < count;) {
+			if (query->matches[j] < list[k]) j++;
+			else if (query->matches[j] > list[k]) k++;
+			else {
+				query->matches[kept++] = query->matches[j];
+				j++;
+				k++;
+			}
+		}
+
+		query->matches_count = kept;
+		tcfree_d(list);
+
+		if (!kept) {
+			break;
+		}
+	}
+
+	mm_free(grams);
+
+	return query;
+}
+
+/**
+ * @brief	Check whether a message could match a full text search query.
+ * @note	A message containing every trigram still has to be scanned, since the trigrams may not appear in the same order as the value.
+ * @param	query		the query returned by fulltext_query().
+ * @param	messagenum	the numerical id of the message being evaluated.
+ * @return	-1 if the message was indexed, and is missing a trigram from the search value, or 0 if the message needs to be scanned.
+ */
+int_t fulltext_query_check(fulltext_query_t *query, uint64_t messagenum) {
+
+	if (!query || !query->indexed || !bsearch(&messagenum, query->indexed, query->indexed_count, sizeof(uint64_t), &fulltext_number_compare)) {
+		return 0;
+	}
+	else if (!query->matches || !bsearch(&messagenum, query->matches, query->matches_count, sizeof(uint64_t), &fulltext_number_compare)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief	Write any messages waiting in a partial batch to the index.
+ * @return	true on success, or false on failure.
+ */
+bool_t fulltext_sync(void) {
+
+	bool_t result = true;
+
+	if (fulltext.ctx) {
+		mutex_lock(&fulltext.lock);
+		result = fulltext_flush();
+		mutex_unlock(&fulltext.lock);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Open the full text search index.
+ * @param	location	the path to the index file.
+ * @return	true on success, or false on failure.
+ */
+bool_t fulltext_start(char *location) {
+
+	if (!(fulltext.ctx = tank_open(location))) {
+		log_critical("Unable to open the full text search index.");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Write any pending messages, then flush and close the full text search index.
+ * @return	This function returns no value.
+ */
+void fulltext_stop(void) {
+
+	if (fulltext.ctx) {
+		fulltext_sync();
+		tank_close(fulltext.ctx);
+		fulltext.ctx = NULL;
+	}
+
+	return;
+}
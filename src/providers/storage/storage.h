@@ -67,6 +67,26 @@ typedef struct __attribute__ ((packed)) {
 
 } entry_t;
 
+typedef struct {
+	uint64_t usernum; /*!< The user who owns the message. */
+	uint64_t messagenum; /*!< The message waiting to be written to the index. */
+	uint32_t *grams; /*!< The sorted list of trigrams found inside the message. */
+	size_t count; /*!< The number of entries in the trigram list. */
+} fulltext_pending_t;
+
+typedef struct {
+	uint64_t usernum; /*!< The user who owns the message. */
+	uint64_t messagenum; /*!< The message containing the trigram. */
+	uint32_t gram; /*!< The trigram, packed into the low three bytes. */
+} fulltext_posting_t;
+
+typedef struct {
+	uint64_t *indexed; /*!< The sorted list of message numbers which were added to the index. */
+	uint64_t *matches; /*!< The sorted list of message numbers which contain every trigram in the search value. */
+	size_t indexed_count; /*!< The number of entries in the indexed list. */
+	size_t matches_count; /*!< The number of entries in the matches list. */
+} fulltext_query_t;
+
 
 bool_t lib_load_tokyo(void);
 const chr_t * lib_version_tokyo(void);
@@ -78,6 +98,8 @@ inx_t * tree_alloc(uint64_t options, void *data_free);
 //! Startup and shutdown.
 void tank_stop(void);
 bool_t tank_start(void);
+void tank_close(TCHDB *ctx);
+TCHDB * tank_open(char *location);
 
 //! Info functions.
 uint64_t tank_size(void);
@@ -96,5 +118,18 @@ uint64_t tank_store(uint64_t hnum, uint64_t tnum, uint64_t unum, stringer_t *dat
 bool_t tank_delete_object(int64_t transaction, uint64_t hnum, uint64_t tnum, uint64_t unum, uint64_t onum);
 uint64_t tank_insert_object(int64_t transaction, uint64_t hnum, uint64_t tnum, uint64_t unum, uint64_t size, uint64_t flags);
 
+//! Full text search index.
+void fulltext_stop(void);
+bool_t fulltext_sync(void);
+bool_t fulltext_start(char *location);
+bool_t fulltext_term(stringer_t *value);
+stringer_t * fulltext_raw(stringer_t *raw);
+void fulltext_query_free(fulltext_query_t *query);
+uint32_t * fulltext_grams(stringer_t *text, size_t *count);
+void fulltext_remove(uint64_t usernum, uint64_t messagenum);
+fulltext_query_t * fulltext_query(uint64_t usernum, stringer_t *value);
+int_t fulltext_query_check(fulltext_query_t *query, uint64_t messagenum);
+bool_t fulltext_index(uint64_t usernum, uint64_t messagenum, stringer_t *text);
+
 #endif
 
@@ -156,6 +156,8 @@ stringer_t * tank_load(uint64_t hnum, uint64_t tnum, uint64_t unum, uint64_t onu
 	int key_len, block_len;
 	stringer_t *result = NULL;
 
+	recorder_event(RECORDER_TANK_READ, tnum, onum);
+
 	// Build the retrieval key.
 	if ((key_len = snprintf(key_buffer, 512, "object.%lu.%lu.%lu.%lu", hnum, tnum, unum, onum)) < 14) {
 		log_error("An error occurred during setup. {object = object.%lu.%lu.%lu.%lu}", hnum, tnum, unum, onum);
@@ -523,6 +525,13 @@ bool_t tank_start(void) {
 		}
 	}
 
+	// Open the full text search index.
+	expected = ns_length_get(magma.storage.tank) + 11 + (*(magma.storage.tank + ns_length_get(magma.storage.tank)) == '/' ? 0 : 1);
+	if (snprintf(location, MAGMA_FILEPATH_MAX + 1, "%s%ssearch.data", magma.storage.tank, *(magma.storage.tank + ns_length_get(magma.storage.tank)) == '/' ? "" : "/") != expected || !fulltext_start(location)) {
+		log_critical("Storage system startup failed.");
+		return false;
+	}
+
 	return true;
 }
 
@@ -531,6 +540,8 @@ bool_t tank_start(void) {
  */
 void tank_stop(void) {
 
+	fulltext_stop();
+
 	for (uint64_t i = 0; i < tanks_num; i++) {
 		tank_close(*(store.tanks + i));
 	}
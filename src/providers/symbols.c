@@ -245,10 +245,12 @@ OCSP_REQUEST * (*OCSP_REQUEST_new_d)(void) = NULL;
 int (*EC_KEY_check_key_d)(const EC_KEY *key) = NULL;
 int (*EVP_MD_CTX_cleanup_d)(EVP_MD_CTX *ctx) = NULL;
 void (*OCSP_REQUEST_free_d)(OCSP_REQUEST *a) = NULL;
+void (*SSL_SESSION_free_d)(SSL_SESSION *ses) = NULL;
 const EVP_CIPHER * (*EVP_aes_256_gcm_d)(void) = NULL;
 int (*SSL_peek_d)(SSL *ssl,void *buf,int num) = NULL;
 const EVP_CIPHER * (*EVP_aes_256_cbc_d)(void) = NULL;
 void (*SSL_set_read_ahead_d)(SSL *s, int yes) = NULL;
+SSL_SESSION * (*SSL_get1_session_d)(SSL *ssl) = NULL;
 EVP_CIPHER_CTX * (*EVP_CIPHER_CTX_new_d)(void) = NULL;
 int (*OCSP_check_nonce_d)(void *req, void *bs) = NULL;
 int (*X509_verify_cert_d)(X509_STORE_CTX *ctx) = NULL;
@@ -285,8 +287,14 @@ EC_POINT * (*EC_POINT_new_d)(const EC_GROUP *group) = NULL;
 int (*BN_bn2bin_d)(const BIGNUM *, unsigned char *) = NULL;
 BIO * (*BIO_new_fp_d)(FILE *stream, int close_flag) = NULL;
 X509_EXTENSION * (*X509_get_ext_d) (X509 *x, int loc) = NULL;
+long (*SSL_CTX_set_timeout_d)(SSL_CTX *ctx, long t) = NULL;
+long (*SSL_SESSION_get_time_d)(const SSL_SESSION *s) = NULL;
+void (*SSL_set_quiet_shutdown_d)(SSL *ssl, int mode) = NULL;
 SSL_CTX * (*SSL_CTX_new_d)(const SSL_METHOD * method) = NULL;
 void (*SSL_set_bio_d)(SSL *ssl, BIO *rbio, BIO *wbio) = NULL;
+BIO * (*BIO_new_d)(BIO_METHOD *type) = NULL;
+BIO_METHOD * (*BIO_s_null_d)(void) = NULL;
+void (*SSL_set_info_callback_d)(SSL *ssl, void (*cb)(const SSL *ssl, int type, int val)) = NULL;
 unsigned char * (*ASN1_STRING_data_d)(ASN1_STRING *x) = NULL;
 int (*BN_bn2mpi_d)(const BIGNUM *a, unsigned char *to) = NULL;
 int (*SSL_CTX_check_private_key_d)(const SSL_CTX *ctx) = NULL;
@@ -299,6 +307,8 @@ const char * (*X509_verify_cert_error_string_d)(long n) = NULL;
 int (*SHA256_Final_d)(unsigned char *md, SHA256_CTX *c) = NULL;
 int (*SHA512_Final_d)(unsigned char *md, SHA512_CTX *c) = NULL;
 int (*X509_check_issued_d)(X509 *issuer, X509 *subject) = NULL;
+int (*SSL_set_session_d)(SSL *to, SSL_SESSION *session) = NULL;
+long (*SSL_SESSION_get_timeout_d)(const SSL_SESSION *s) = NULL;
 SSL_CIPHER * (*SSL_get_current_cipher_d)(const SSL *ssl) = NULL;
 int (*EVP_CIPHER_block_size_d)(const EVP_CIPHER *cipher) = NULL;
 int (*EVP_CIPHER_key_length_d)(const EVP_CIPHER *cipher) = NULL;
@@ -324,6 +334,7 @@ int (*OCSP_REQ_CTX_set1_req_d)(OCSP_REQ_CTX *rctx, void *req) = NULL;
 struct stack_st_OPENSSL_STRING * (*X509_get1_ocsp_d)(X509 *x) = NULL;
 void (*X509_email_free_d)(struct stack_st_OPENSSL_STRING *sk) = NULL;
 const BIGNUM * (*EC_KEY_get0_private_key_d)(const EC_KEY *key) = NULL;
+int (*i2d_SSL_SESSION_d)(SSL_SESSION *in, unsigned char **pp) = NULL;
 const EVP_CIPHER * (*EVP_get_cipherbyname_d)(const char *name) = NULL;
 int (*EVP_PKEY_set1_RSA_d)(EVP_PKEY *pkey, struct rsa_st *key) = NULL;
 int (*SHA1_Update_d)(SHA_CTX *c, const void *data, size_t len) = NULL;
@@ -388,16 +399,19 @@ int (*DH_generate_parameters_ex_d)(DH *dh, int prime_len,int generator, BN_GENCB
 ECDSA_SIG * (*ECDSA_do_sign_d)(const unsigned char *dgst, int dgst_len, EC_KEY *eckey) = NULL;
 int (*X509_STORE_load_locations_d)(X509_STORE *ctx, const char *file, const char *path) = NULL;
 OCSP_REQ_CTX * (*OCSP_sendreq_new_d)(BIO *io, const char *path, void *req, int maxline) = NULL;
+const unsigned char * (*SSL_SESSION_get_id_d)(const SSL_SESSION *s, unsigned int *len) = NULL;
 void (*SSL_CTX_set_verify_d)(SSL_CTX *ctx, int mode, int (*cb) (int, X509_STORE_CTX *)) = NULL;
 EC_POINT * (*EC_POINT_hex2point_d)(const EC_GROUP *, const char *, EC_POINT *, BN_CTX *) = NULL;
 int (*CRYPTO_set_locked_mem_functions_d)(void *(*m) (size_t), void (*free_func) (void *)) = NULL;
 int (*OCSP_REQ_CTX_add1_header_d)(OCSP_REQ_CTX *rctx, const char *name, const char *value) = NULL;
 void (*X509_STORE_CTX_set_chain_d)(struct x509_store_ctx_st *ctx, struct stack_st_X509 *sk) = NULL;
+SSL_SESSION * (*d2i_SSL_SESSION_d)(SSL_SESSION **a, const unsigned char **pp, long length) = NULL;
 int (*SSL_CTX_load_verify_locations_d)(SSL_CTX *ctx, const char *CAfile, const char *CApath) = NULL;
 OCSP_RESPONSE * (*d2i_OCSP_RESPONSE_d)(OCSP_RESPONSE **a, const unsigned char **in, long len) = NULL;
 int (*OCSP_parse_url_d)(const char *url, char **phost, char **pport, char **ppath, int *pssl) = NULL;
 int (*HMAC_Init_ex_d)(HMAC_CTX *ctx, const void *key, int len, const EVP_MD *md, ENGINE *impl) = NULL;
 int (*EC_POINT_cmp_d)(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *b, BN_CTX *ctx) = NULL;
+void (*SSL_CTX_sess_set_new_cb_d)(SSL_CTX *ctx, int (*new_session_cb)(SSL *ssl, SSL_SESSION *sess)) = NULL;
 void (*SSL_CTX_set_tmp_dh_callback_d)(SSL_CTX *ctx, DH *(*dh)(SSL *ssl,int is_export, int keylength))  = NULL;
 int (*ECDSA_do_verify_d)(const unsigned char *dgst, int dgst_len, const ECDSA_SIG *sig, EC_KEY *eckey) = NULL;
 int (*X509_check_host_d)(X509 *x, const char *chk, size_t chklen, unsigned int flags, char **peername) = NULL;
@@ -408,6 +422,8 @@ char * (*EC_POINT_point2hex_d)(const EC_GROUP *, const EC_POINT *, point_convers
 void (*CRYPTO_set_locking_callback_d)(void(*locking_function)(int mode, int n, const char *file, int line)) = NULL;
 int (*EVP_VerifyFinal_d)(EVP_MD_CTX *ctx, const unsigned char *sigbuf, unsigned int siglen, EVP_PKEY *pkey) = NULL;
 void (*SSL_CTX_set_tmp_ecdh_callback_d)(SSL_CTX *ctx, EC_KEY *(*ecdh)(SSL *ssl,int is_export, int keylength)) = NULL;
+int (*SSL_CTX_set_session_id_context_d)(SSL_CTX *ctx, const unsigned char *sid_ctx, unsigned int sid_ctx_len) = NULL;
+void (*SSL_CTX_sess_set_remove_cb_d)(SSL_CTX *ctx, void (*remove_session_cb)(SSL_CTX *ctx, SSL_SESSION *sess)) = NULL;
 int (*EVP_DecryptUpdate_d)(EVP_CIPHER_CTX *ctx, unsigned char *out, int *outl, const unsigned char *in, int inl) = NULL;
 int (*EVP_EncryptUpdate_d)(EVP_CIPHER_CTX *ctx, unsigned char *out, int *outl, const unsigned char *in, int inl) = NULL;
 int (*OCSP_basic_verify_d)(void *bs, struct stack_st_X509 *certs, struct x509_store_st *st, unsigned long flags) = NULL;
@@ -417,6 +433,7 @@ int (*EC_POINT_oct2point_d)(const EC_GROUP *group, EC_POINT *p, const unsigned c
 void (*ED25519_keypair_from_seed_d)(uint8_t out_public_key[32], uint8_t out_private_key[64], const uint8_t seed[32]) = NULL;
 int (*EVP_Digest_d)(const void *data, size_t count, unsigned char *md, unsigned int *size, const EVP_MD *type, ENGINE *impl) = NULL;
 int (*ED25519_verify_d)(const uint8_t *message, size_t message_len, const uint8_t signature[64], const uint8_t public_key[32]) = NULL;
+void (*SSL_CTX_sess_set_get_cb_d)(SSL_CTX *ctx, SSL_SESSION *(*get_session_cb)(SSL *ssl, unsigned char *data, int len, int *copy)) = NULL;
 int (*EVP_DecryptInit_ex_d)(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, ENGINE *impl, const unsigned char *key, const unsigned char *iv) = NULL;
 int (*EVP_EncryptInit_ex_d)(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, ENGINE *impl, const unsigned char *key, const unsigned char *iv) = NULL;
 int (*EC_POINT_mul_d)(const EC_GROUP *group, EC_POINT *r, const BIGNUM *g_scalar, const EC_POINT *point, const BIGNUM *p_scalar, BN_CTX *ctx) = NULL;
@@ -485,6 +502,7 @@ bool (*tchdbtune_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t
 bool (*tchdboptimize_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts) = NULL;
 bool (*tcndbputkeep_d)(TCNDB *ndb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
 bool (*tchdbputasync_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
+bool (*tchdbputcat_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz) = NULL;
 bool (*tcndbgetboth_d)(TCNDB *ndb, const void *kbuf, int ksiz, void **rkbuf, int *rksiz, void **rvbuf, int *rvsiz) = NULL;
 
 //! Jansson
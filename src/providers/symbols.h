@@ -345,10 +345,12 @@ extern OCSP_REQUEST * (*OCSP_REQUEST_new_d)(void);
 extern int (*EC_KEY_check_key_d)(const EC_KEY *key);
 extern int (*EVP_MD_CTX_cleanup_d)(EVP_MD_CTX *ctx);
 extern void (*OCSP_REQUEST_free_d)(OCSP_REQUEST *a);
+extern void (*SSL_SESSION_free_d)(SSL_SESSION *ses);
 extern const EVP_CIPHER * (*EVP_aes_256_gcm_d)(void);
 extern const EVP_CIPHER * (*EVP_aes_256_cbc_d)(void);
 extern int (*SSL_peek_d)(SSL *ssl,void *buf,int num);
 extern void (*SSL_set_read_ahead_d)(SSL *s, int yes);
+extern SSL_SESSION * (*SSL_get1_session_d)(SSL *ssl);
 extern EVP_CIPHER_CTX * (*EVP_CIPHER_CTX_new_d)(void);
 extern int (*OCSP_check_nonce_d)(void *req, void *bs);
 extern int (*X509_verify_cert_d)(X509_STORE_CTX *ctx);
@@ -385,8 +387,14 @@ extern EC_POINT * (*EC_POINT_new_d)(const EC_GROUP *group);
 extern int (*BN_bn2bin_d)(const BIGNUM *, unsigned char *);
 extern BIO * (*BIO_new_fp_d)(FILE *stream, int close_flag);
 extern X509_EXTENSION * (*X509_get_ext_d) (X509 *x, int loc);
+extern long (*SSL_CTX_set_timeout_d)(SSL_CTX *ctx, long t);
+extern long (*SSL_SESSION_get_time_d)(const SSL_SESSION *s);
+extern void (*SSL_set_quiet_shutdown_d)(SSL *ssl, int mode);
 extern SSL_CTX * (*SSL_CTX_new_d)(const SSL_METHOD * method);
 extern void (*SSL_set_bio_d)(SSL *ssl, BIO *rbio, BIO *wbio);
+extern BIO * (*BIO_new_d)(BIO_METHOD *type);
+extern BIO_METHOD * (*BIO_s_null_d)(void);
+extern void (*SSL_set_info_callback_d)(SSL *ssl, void (*cb)(const SSL *ssl, int type, int val));
 extern unsigned char * (*ASN1_STRING_data_d)(ASN1_STRING *x);
 extern int (*BN_bn2mpi_d)(const BIGNUM *a, unsigned char *to);
 extern int (*SSL_CTX_check_private_key_d)(const SSL_CTX *ctx);
@@ -399,6 +407,8 @@ extern const char * (*X509_verify_cert_error_string_d)(long n);
 extern int (*SHA256_Final_d)(unsigned char *md, SHA256_CTX *c);
 extern int (*SHA512_Final_d)(unsigned char *md, SHA512_CTX *c);
 extern int (*X509_check_issued_d)(X509 *issuer, X509 *subject);
+extern int (*SSL_set_session_d)(SSL *to, SSL_SESSION *session);
+extern long (*SSL_SESSION_get_timeout_d)(const SSL_SESSION *s);
 extern SSL_CIPHER * (*SSL_get_current_cipher_d)(const SSL *ssl);
 extern int (*EVP_CIPHER_block_size_d)(const EVP_CIPHER *cipher);
 extern int (*EVP_CIPHER_key_length_d)(const EVP_CIPHER *cipher);
@@ -424,6 +434,7 @@ extern int (*OCSP_REQ_CTX_set1_req_d)(OCSP_REQ_CTX *rctx, void *req);
 extern struct stack_st_OPENSSL_STRING * (*X509_get1_ocsp_d)(X509 *x);
 extern void (*X509_email_free_d)(struct stack_st_OPENSSL_STRING *sk);
 extern const BIGNUM * (*EC_KEY_get0_private_key_d)(const EC_KEY *key);
+extern int (*i2d_SSL_SESSION_d)(SSL_SESSION *in, unsigned char **pp);
 extern const EVP_CIPHER * (*EVP_get_cipherbyname_d)(const char *name);
 extern int (*EVP_PKEY_set1_RSA_d)(EVP_PKEY *pkey, struct rsa_st *key);
 extern int (*SHA1_Update_d)(SHA_CTX *c, const void *data, size_t len);
@@ -488,16 +499,19 @@ extern int (*DH_generate_parameters_ex_d)(DH *dh, int prime_len,int generator, B
 extern ECDSA_SIG * (*ECDSA_do_sign_d)(const unsigned char *dgst, int dgst_len, EC_KEY *eckey);
 extern int (*X509_STORE_load_locations_d)(X509_STORE *ctx, const char *file, const char *path);
 extern OCSP_REQ_CTX * (*OCSP_sendreq_new_d)(BIO *io, const char *path, void *req, int maxline);
+extern const unsigned char * (*SSL_SESSION_get_id_d)(const SSL_SESSION *s, unsigned int *len);
 extern void (*SSL_CTX_set_verify_d)(SSL_CTX *ctx, int mode, int (*cb) (int, X509_STORE_CTX *));
 extern EC_POINT * (*EC_POINT_hex2point_d)(const EC_GROUP *, const char *, EC_POINT *, BN_CTX *);
 extern int (*CRYPTO_set_locked_mem_functions_d)(void *(*m) (size_t), void (*free_func) (void *));
 extern int (*OCSP_REQ_CTX_add1_header_d)(OCSP_REQ_CTX *rctx, const char *name, const char *value);
 extern void (*X509_STORE_CTX_set_chain_d)(struct x509_store_ctx_st *ctx, struct stack_st_X509 *sk);
+extern SSL_SESSION * (*d2i_SSL_SESSION_d)(SSL_SESSION **a, const unsigned char **pp, long length);
 extern int (*SSL_CTX_load_verify_locations_d)(SSL_CTX *ctx, const char *CAfile, const char *CApath);
 extern OCSP_RESPONSE * (*d2i_OCSP_RESPONSE_d)(OCSP_RESPONSE **a, const unsigned char **in, long len);
 extern int (*OCSP_parse_url_d)(const char *url, char **phost, char **pport, char **ppath, int *pssl);
 extern int (*HMAC_Init_ex_d)(HMAC_CTX *ctx, const void *key, int len, const EVP_MD *md, ENGINE *impl);
 extern int (*EC_POINT_cmp_d)(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *b, BN_CTX *ctx);
+extern void (*SSL_CTX_sess_set_new_cb_d)(SSL_CTX *ctx, int (*new_session_cb)(SSL *ssl, SSL_SESSION *sess));
 extern void (*SSL_CTX_set_tmp_dh_callback_d)(SSL_CTX *ctx, DH *(*dh)(SSL *ssl,int is_export, int keylength)) ;
 extern int (*ECDSA_do_verify_d)(const unsigned char *dgst, int dgst_len, const ECDSA_SIG *sig, EC_KEY *eckey);
 extern int (*X509_check_host_d)(X509 *x, const char *chk, size_t chklen, unsigned int flags, char **peername);
@@ -508,6 +522,8 @@ extern char * (*EC_POINT_point2hex_d)(const EC_GROUP *, const EC_POINT *, point_
 extern void (*CRYPTO_set_locking_callback_d)(void(*locking_function)(int mode, int n, const char *file, int line));
 extern int (*EVP_VerifyFinal_d)(EVP_MD_CTX *ctx, const unsigned char *sigbuf, unsigned int siglen, EVP_PKEY *pkey);
 extern void (*SSL_CTX_set_tmp_ecdh_callback_d)(SSL_CTX *ctx, EC_KEY *(*ecdh)(SSL *ssl,int is_export, int keylength));
+extern int (*SSL_CTX_set_session_id_context_d)(SSL_CTX *ctx, const unsigned char *sid_ctx, unsigned int sid_ctx_len);
+extern void (*SSL_CTX_sess_set_remove_cb_d)(SSL_CTX *ctx, void (*remove_session_cb)(SSL_CTX *ctx, SSL_SESSION *sess));
 extern int (*EVP_DecryptUpdate_d)(EVP_CIPHER_CTX *ctx, unsigned char *out, int *outl, const unsigned char *in, int inl);
 extern int (*EVP_EncryptUpdate_d)(EVP_CIPHER_CTX *ctx, unsigned char *out, int *outl, const unsigned char *in, int inl);
 extern int (*OCSP_basic_verify_d)(void *bs, struct stack_st_X509 *certs, struct x509_store_st *st, unsigned long flags);
@@ -517,6 +533,7 @@ extern int (*EC_POINT_oct2point_d)(const EC_GROUP *group, EC_POINT *p, const uns
 extern void (*ED25519_keypair_from_seed_d)(uint8_t out_public_key[32], uint8_t out_private_key[64], const uint8_t seed[32]);
 extern int (*EVP_Digest_d)(const void *data, size_t count, unsigned char *md, unsigned int *size, const EVP_MD *type, ENGINE *impl);
 extern int (*ED25519_verify_d)(const uint8_t *message, size_t message_len, const uint8_t signature[64], const uint8_t public_key[32]);
+extern void (*SSL_CTX_sess_set_get_cb_d)(SSL_CTX *ctx, SSL_SESSION *(*get_session_cb)(SSL *ssl, unsigned char *data, int len, int *copy));
 extern int (*EVP_DecryptInit_ex_d)(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, ENGINE *impl, const unsigned char *key, const unsigned char *iv);
 extern int (*EVP_EncryptInit_ex_d)(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, ENGINE *impl, const unsigned char *key, const unsigned char *iv);
 extern int (*EC_POINT_mul_d)(const EC_GROUP *group, EC_POINT *r, const BIGNUM *g_scalar, const EC_POINT *point, const BIGNUM *p_scalar, BN_CTX *ctx);
@@ -585,6 +602,7 @@ extern bool (*tchdbtune_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, u
 extern bool (*tchdboptimize_d)(TCHDB *hdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts);
 extern bool (*tcndbputkeep_d)(TCNDB *ndb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 extern bool (*tchdbputasync_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+extern bool (*tchdbputcat_d)(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 extern bool (*tcndbgetboth_d)(TCNDB *ndb, const void *kbuf, int ksiz, void **rkbuf, int *rksiz, void **rvbuf, int *rvsiz);
 
 //! Jansson
@@ -57,9 +57,16 @@
 // Messages table
 #define SELECT_MESSAGES "SELECT messagenum, foldernum, server, status, size, signum, sigkey, UNIX_TIMESTAMP(created) FROM Messages WHERE usernum = ? AND visible = 1 ORDER BY messagenum ASC"
 #define UPDATE_MESSAGE_VISIBILITY "UPDATE Messages SET visible = 0 WHERE messagenum = ?"
-#define UPDATE_MESSAGE_FLAGS_ADD "UPDATE Messages SET status = (status | ?) WHERE usernum = ? AND foldernum = ? AND messagenum = ?"
-#define UPDATE_MESSAGE_FLAGS_REMOVE "UPDATE Messages SET status = ((status | ?) ^ ?) WHERE usernum = ? AND foldernum = ? AND messagenum = ?"
-#define UPDATE_MESSAGE_FLAGS_REPLACE  "UPDATE Messages SET status = (((status | ?) ^ ?) | ?) WHERE usernum = ? AND foldernum = ? AND messagenum = ?"
+
+// The flag updates are applied to UPDATE_MESSAGE_FLAGS_BATCH messages at a time, so the IN list holds exactly that many placeholders.
+#define UPDATE_MESSAGE_FLAGS_BATCH 128
+#define UPDATE_MESSAGE_FLAGS_IN_8 "?, ?, ?, ?, ?, ?, ?, ?"
+#define UPDATE_MESSAGE_FLAGS_IN_32 UPDATE_MESSAGE_FLAGS_IN_8 ", " UPDATE_MESSAGE_FLAGS_IN_8 ", " UPDATE_MESSAGE_FLAGS_IN_8 ", " UPDATE_MESSAGE_FLAGS_IN_8
+#define UPDATE_MESSAGE_FLAGS_IN UPDATE_MESSAGE_FLAGS_IN_32 ", " UPDATE_MESSAGE_FLAGS_IN_32 ", " UPDATE_MESSAGE_FLAGS_IN_32 ", " UPDATE_MESSAGE_FLAGS_IN_32
+#define UPDATE_MESSAGE_FLAGS_ADD "UPDATE Messages SET status = (status | ?) WHERE usernum = ? AND foldernum = ? AND messagenum IN (" UPDATE_MESSAGE_FLAGS_IN ")"
+#define UPDATE_MESSAGE_FLAGS_REMOVE "UPDATE Messages SET status = ((status | ?) ^ ?) WHERE usernum = ? AND foldernum = ? AND messagenum IN (" UPDATE_MESSAGE_FLAGS_IN ")"
+#define UPDATE_MESSAGE_FLAGS_REPLACE  "UPDATE Messages SET status = (((status | ?) ^ ?) | ?) WHERE usernum = ? AND foldernum = ? AND messagenum IN (" UPDATE_MESSAGE_FLAGS_IN ")"
+
 #define UPDATE_MESSAGE_FOLDER "UPDATE Messages SET foldernum = ? WHERE messagenum = ? AND usernum = ? AND foldernum = ?"
 #define INSERT_MESSAGE "INSERT INTO Messages (usernum, foldernum, server, status, size, signum, sigkey, created) VALUES (?, ?, ?, ?, ?, ?, ?, NOW())"
 #define INSERT_MESSAGE_DUPLICATE "INSERT INTO Messages (usernum, foldernum, server, status, size, signum, sigkey, created) VALUES (?, ?, ?, ?, ?, ?, ?, FROM_UNIXTIME(?))"
@@ -30,11 +30,18 @@ void dmtp_sort(void) {
 
 void dmtp_requeue(connection_t *con) {
 
+	uint32_t delay;
+
 	if (!status() || con_status(con) < 0 || con->protocol.violations > con->server->violations.cutoff) {
-		enqueue(&dmtp_quit, con);
+		enqueue_priority(QUEUE_DELIVERY, &dmtp_quit, con);
+	}
+	// A protocol violation penalty is served by the timer wheel, so the worker thread is free to handle other connections.
+	else if ((delay = con->protocol.delay)) {
+		con->protocol.delay = 0;
+		timer_enqueue(delay / 1000, &dmtp_process, con);
 	}
 	else {
-		enqueue(&dmtp_process, con);
+		enqueue_priority(QUEUE_DELIVERY, &dmtp_process, con);
 	}
 
 	return;
@@ -51,17 +58,17 @@ void dmtp_process(connection_t *con) {
 
 	if (con_read_line(con, true) < 0) {
 		con->command = NULL;
-		enqueue(&dmtp_quit, con);
+		enqueue_priority(QUEUE_DELIVERY, &dmtp_quit, con);
 		return;
 	}
 	else if (pl_empty(con->network.line) && ((con->protocol.spins++) + con->protocol.violations) > con->server->violations.cutoff) {
 		con->command = NULL;
-		enqueue(&dmtp_quit, con);
+		enqueue_priority(QUEUE_DELIVERY, &dmtp_quit, con);
 		return;
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&dmtp_process, con);
+		enqueue_priority(QUEUE_DELIVERY, &dmtp_process, con);
 		return;
 	}
 
@@ -76,15 +83,15 @@ void dmtp_process(connection_t *con) {
 		// inbound or outbound processor instead the command processor, and the QUIT command destroys a connection thereby eliminating the need
 		// to enqueue it.
 		if (command->function == &dmtp_data || command->function == &dmtp_quit) {
-			enqueue(command->function, con);
+			enqueue_priority(QUEUE_DELIVERY, command->function, con);
 		}
 		else {
-			requeue(command->function, &dmtp_requeue, con);
+			requeue_priority(QUEUE_DELIVERY, command->function, &dmtp_requeue, con);
 		}
 	}
 	else {
 		con->command = NULL;
-		requeue(&dmtp_invalid, &dmtp_requeue, con);
+		requeue_priority(QUEUE_DELIVERY, &dmtp_invalid, &dmtp_requeue, con);
 	}
 	return;
 }
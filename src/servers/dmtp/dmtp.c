@@ -52,7 +52,7 @@ void dmtp_noop(connection_t *con) {
 void dmtp_invalid(connection_t *con) {
 
 	con->protocol.violations++;
-	usleep(con->server->violations.delay);
+	con->protocol.delay = con->server->violations.delay;
 	con_write_bl(con, "500 INVALID COMMAND\n", 20);
 	return;
 }
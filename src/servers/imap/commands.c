@@ -27,11 +27,54 @@ int_t imap_compare(const void *compare, const void *command) {
 }
 
 /**
- * @brief	Sort the IMAP command table to be ready for binary searches.
+ * @brief	Sort the IMAP command table to be ready for binary searches, and allocate a latency histogram for each command.
  * @return	This function returns no value.
  */
 void imap_sort(void) {
 	qsort(imap_commands, sizeof(imap_commands) / sizeof(imap_commands[0]), sizeof(command_t), &imap_compare);
+
+	for (size_t i = 0; i < sizeof(imap_commands) / sizeof(imap_commands[0]); i++) {
+		if (!imap_commands[i].latency) imap_commands[i].latency = latency_alloc("imap", imap_commands[i].string, imap_commands[i].length);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Find the handler for an IMAP command.
+ * @param	name	the name of the command, as parsed from the client's input.
+ * @return	NULL if the command isn't supported, or a pointer to the command's entry in the command table.
+ */
+command_t * imap_command(stringer_t *name) {
+
+	command_t client = { .function = NULL };
+
+	client.string = st_char_get(name);
+	client.length = st_length_get(name);
+
+	return bsearch(&client, imap_commands, sizeof(imap_commands) / sizeof(imap_commands[0]), sizeof(command_t), imap_compare);
+}
+
+/**
+ * @brief	Finish the current command by recording how long it took, and reclaiming everything it allocated from the connection arena.
+ * @param	con		a pointer to the connection object of the imap session.
+ * @return	This function returns no value.
+ */
+void imap_complete(connection_t *con) {
+
+	// The command has finished, so record how long it took.
+	if (con->command) {
+		recorder_event(RECORDER_COMMAND_END, 0, (uintptr_t)con->command->string);
+	}
+
+	if (con->protocol.dispatched) {
+		latency_record(con->command ? con->command->latency : NULL, con->protocol.dispatched);
+		con->protocol.dispatched = 0;
+	}
+
+	// Reclaim everything the command allocated from the connection arena.
+	arena_reset(con->arena);
+
 	return;
 }
 
@@ -42,16 +85,53 @@ void imap_sort(void) {
  */
 void imap_requeue(connection_t *con) {
 
+	imap_complete(con);
+
 	if (!status() || con_status(con) < 0 || con_status(con) == 2 || con->protocol.violations > con->server->violations.cutoff) {
 		enqueue(&imap_logout, con);
 	}
+	else if (con->imap.idle) {
+		imap_idle_wait(con);
+	}
 	else {
-		enqueue(&imap_process, con);
+		con_events_wait(con, &imap_process);
 	}
 
 	return;
 }
 
+/**
+ * @brief	Execute the command selected by imap_process() with the connection arena active, so the temporary allocations which opt
+ * 			into using an arena are reclaimed in a single step by imap_requeue().
+ * @param	con		a pointer to the connection object of the imap session.
+ * @return	This function returns no value.
+ */
+void imap_dispatch(connection_t *con) {
+
+	arena_t *previous;
+
+	// The arena is allocated by the first command. If that fails, the allocations which would have used it are made off the heap.
+	if (!con->arena) {
+		con->arena = arena_alloc(MM_ARENA_BLOCK);
+	}
+
+	previous = arena_enter(con->arena);
+
+	// Every command is queued using this function, so the flight recorder is told which handler is about to run.
+	if (con->command) {
+		recorder_event(RECORDER_COMMAND_DISPATCH, 0, (uintptr_t)con->command->function);
+		((void (*)(connection_t *))con->command->function)(con);
+	}
+	else {
+		recorder_event(RECORDER_COMMAND_DISPATCH, 0, (uintptr_t)&imap_invalid);
+		imap_invalid(con);
+	}
+
+	arena_enter(previous);
+
+	return;
+}
+
 /**
  * @brief	Perform client command processing on an established imap session.
  * @note	This function will read the next line of user input, parse the command, and then attempt to execute it with the appropriate handler.
@@ -61,7 +141,7 @@ void imap_requeue(connection_t *con) {
 void imap_process(connection_t *con) {
 
 	int_t state;
-	command_t *command, client = { .function = NULL };
+	command_t *command;
 
 	// If the connection indicates an error occurred, or the socket was closed by the client we send the connection to the logout function.
 	if (((state = con_read_line(con, true)) < 0) || (state == -2)) {
@@ -76,7 +156,7 @@ void imap_process(connection_t *con) {
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&imap_process, con);
+		con_events_wait(con, &imap_process);
 		return;
 	}
 
@@ -103,29 +183,29 @@ void imap_process(connection_t *con) {
 
 		// Requeue and hope the next line of data is useful.
 		con->command = NULL;
-		enqueue(&imap_process, con);
+		con_events_wait(con, &imap_process);
 		return;
 
 	}
 
-	client.string = st_char_get(con->imap.command);
-	client.length = st_length_get(con->imap.command);
-
-	if ((command = bsearch(&client, imap_commands, sizeof(imap_commands) / sizeof(imap_commands[0]), sizeof(command_t), imap_compare))) {
+	if ((command = imap_command(con->imap.command))) {
 
 		con->command = command;
 		con->protocol.spins = 0;
+		con->protocol.dispatched = command->latency ? perf_rdtsc() : 0;
+		recorder_event(RECORDER_COMMAND_START, 0, (uintptr_t)command->string);
 
-		if (command->function == &imap_logout) {
+		// The TLS handshake is handed off to its own pool, so the STARTTLS command requeues the connection itself.
+		if (command->function == &imap_logout || command->function == &imap_starttls) {
 			enqueue(command->function, con);
 		}
 		else {
-			requeue(command->function, &imap_requeue, con);
+			requeue(&imap_dispatch, &imap_requeue, con);
 		}
 	}
 	else {
 		con->command = NULL;
-		requeue(&imap_invalid, &imap_requeue, con);
+		requeue(&imap_dispatch, &imap_requeue, con);
 	}
 	return;
 }
@@ -1052,7 +1052,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 
 	// Process the UID.
 	if (con->imap.uid == 1 || items->uid == 1) {
-		if (!(value = st_aprint_opts(MANAGED_T | HEAP | CONTIGUOUS, "%lu", meta->messagenum))) {
+		if (!(value = st_aprint_opts(MANAGED_T | ARENA | CONTIGUOUS, "%lu", meta->messagenum))) {
 			return NULL;
 		}
 		output = imap_fetch_response_add(output, PLACER("UID", 3), value);
@@ -1061,7 +1061,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 	// Process the message flags.
 	if (items->flags == 1 || meta->updated == 1) {
 		if ((value
-			= st_merge("nnnnnnnnnnnnn", "(", (meta->status & MAIL_STATUS_ANSWERED) != 0 ? "\\Answered" : "",
+			= st_merge_opts(MANAGED_T | ARENA | CONTIGUOUS, "nnnnnnnnnnnnn", "(", (meta->status & MAIL_STATUS_ANSWERED) != 0 ? "\\Answered" : "",
 				(meta->status & MAIL_STATUS_ANSWERED) != 0 && (meta->status & MAIL_STATUS_FLAGGED) != 0 ? " " : "",
 				(meta->status & MAIL_STATUS_FLAGGED) != 0 ? "\\Flagged" : "",
 				(meta->status & (MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED)) != 0 && (meta->status & MAIL_STATUS_DELETED) != 0 ? " " : "",
@@ -1082,7 +1082,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 	if (items->internaldate == 1) {
 		ctime = meta->created;
 		if (localtime_r(&ctime, &ltime) == NULL || strftime(buffer, 128, "\"%d-%b-%Y %H:%M:%S %z\"", &ltime) <= 0 ||
-			(value = st_import(buffer, ns_length_get(buffer))) == NULL) {
+			(value = st_import_opts(MANAGED_T | ARENA | CONTIGUOUS, buffer, ns_length_get(buffer))) == NULL) {
 			imap_fetch_response_free(output);
 			return NULL;
 		}
@@ -1216,7 +1216,7 @@ imap_fetch_response_t * imap_fetch_message(connection_t *con, meta_message_t *me
 			state = snprintf(buffer, 128, "%zu", meta->size);
 		}
 
-		if (state <= 0 || (value = st_import(buffer, ns_length_get(buffer))) == NULL) {
+		if (state <= 0 || (value = st_import_opts(MANAGED_T | ARENA | CONTIGUOUS, buffer, ns_length_get(buffer))) == NULL) {
 			mail_destroy(message);
 			mail_destroy_header(header);
 			imap_fetch_response_free(output);
@@ -1244,8 +1244,8 @@ inx_t * imap_duplicate_messages(inx_t *messages) {
 	meta_message_t *active, *duplicate;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
 
-	// Allocate the linked the list.
-	if (!(output = inx_alloc(M_INX_LINKED, &meta_message_free))) {
+	// Allocate the linked the list. The copies are only used by the current command, so the list nodes can come from the connection arena.
+	if (!(output = inx_alloc(M_INX_LINKED | M_INX_ARENA, &meta_message_free))) {
 		return NULL;
 	}
 
@@ -1275,44 +1275,45 @@ inx_t * imap_duplicate_messages(inx_t *messages) {
 	return output;
 }
 
-// Returns a copy of the messages. Make sure you rely on the message numbers and not the sequence numbers.
-inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *range, int_t uid) {
+/**
+ * @brief	Collect the messages in the selected folder which fall inside a sequence set.
+ * @note	The folder is located in the user's message index, so each part of the sequence set is resolved using a binary search,
+ * 			instead of walking the entire mailbox. The caller must hold a lock on the meta user object. If the current thread has an active
+ * 			arena, the list nodes are allocated from it, so the list must be freed before the arena is reset.
+ * @param	user		the meta user object whose messages are being narrowed.
+ * @param	selected	the numerical id of the selected folder.
+ * @param	range		the sequence set provided by the client.
+ * @param	uid			if set, the sequence set holds UIDs, otherwise it holds sequence numbers.
+ * @return	NULL if no messages were found, or a linked index of the matching meta message objects, which refer to the user's messages,
+ * 			so rely on the message numbers and not the sequence numbers.
+ */
+inx_t * imap_narrow_messages(meta_user_t *user, uint64_t selected, stringer_t *range, int_t uid) {
 
 	int_t asterisk;
 	inx_t *output = NULL;
-	inx_cursor_t *cursor;
+	meta_index_t *index;
 	uint32_t commas, parts;
-	meta_message_t *active;
 	placer_t sequence, start_token, end_token;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = 0 };
+	size_t first, last, from, to;
 	uint64_t start, end, number, highest_uid = 0, highest_seq = 0;
 
-	if (!messages || !range) {
+	if (!user || !user->messages || !range) {
 		log_error("Sanity check failed, passed a NULL parameter.");
 		return NULL;
 	}
 
-	// Allocate the linked list.
-	if (!(output = inx_alloc(M_INX_LINKED, NULL))) {
+	// Allocate the linked list. The list only lives as long as the command, so its nodes can come from the connection arena.
+	if (!(output = inx_alloc(M_INX_LINKED | M_INX_ARENA, NULL))) {
 		return NULL;
 	}
 
-	// Find the highest message number.
-	if ((cursor = inx_cursor_alloc(messages))) {
-
-		while ((active = inx_cursor_value_next(cursor))) {
-
-			if (active->foldernum == selected && active->messagenum > highest_uid) {
-				highest_uid = active->messagenum;
-			}
-
-			if (active->foldernum == selected && active->sequencenum > highest_seq) {
-				highest_seq = active->sequencenum;
-			}
-
-		}
+	// Find the folder, and its highest message number. Messages are sorted by UID, so the last message also has the highest sequence number.
+	index = meta_index_get(user);
 
-		inx_cursor_free(cursor);
+	if (meta_index_folder(index, selected, &first, &last)) {
+		highest_uid = index->messagenums[last - 1];
+		highest_seq = index->messages[last - 1]->sequencenum;
 	}
 
 	// Count the commas.
@@ -1392,24 +1393,21 @@ inx_t * imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *ran
 			start = highest_uid;
 		}
 
-		// Loop through and collect the messages.
-		number = 0;
+		// Translate the range into a slice of the folder. Sequence numbers are positions inside the folder, while UIDs need to be searched for.
+		if (uid == 0) {
+			from = first + (start ? start - 1 : 0);
+			to = (asterisk == 1 || end > last - first) ? last : first + end;
+		}
+		else {
+			from = meta_index_uid(index, first, last, start);
+			to = (asterisk == 1 || end == UINT64_MAX) ? last : meta_index_uid(index, from, last, end + 1);
+		}
 
 		//log_pedantic("start = %lu / end = %lu / asterisk = %i / uid = %i { %.*s }", start, end, asterisk, uid, st_length_int(range), st_char_get(range));
 
-		if ((cursor = inx_cursor_alloc(messages))) {
-
-			while ((active = inx_cursor_value_next(cursor))) {
-
-				if (active->foldernum == selected && ((uid == 0 && ++number >= start && (asterisk == 1 || number <= end)) ||
-					(uid == 1 && active->messagenum >= start && (asterisk == 1 || active->messagenum <= end)))) {
-					key.val.u64 = active->messagenum;
-					inx_append(output, key, active);
-				}
-
-			}
-
-			inx_cursor_free(cursor);
+		for (size_t i = from; i < to && i < last; i++) {
+			key.val.u64 = index->messagenums[i];
+			inx_append(output, key, index->messages[i]);
 		}
 	}
 
@@ -7,6 +7,9 @@
 
 #include "magma.h"
 
+/// Response nodes are created for every data item of every message fetched, so those not taken from an arena are held by a slab cache.
+static slab_t imap_fetch_response_slab = SLAB_CACHE("imap.fetch.responses", sizeof(imap_fetch_response_t));
+
 void imap_fetch_response_free(imap_fetch_response_t *response) {
 
 	imap_fetch_response_t *holder;
@@ -16,7 +19,7 @@ void imap_fetch_response_free(imap_fetch_response_t *response) {
 		st_cleanup(response->value);
 		holder = response;
 		response = (imap_fetch_response_t *)response->next;
-		mm_free(holder);
+		if (!holder->arena) slab_put(&imap_fetch_response_slab, holder);
 	}
 
 	return;
@@ -32,15 +35,17 @@ imap_fetch_response_t * imap_fetch_response_add(imap_fetch_response_t *response,
 		return response;
 	}
 
-	// Allocate structure.
-	if (!(output = mm_alloc(sizeof(imap_fetch_response_t)))) {
+	// Allocate structure. When the command is running with an arena, the node is taken from the arena, otherwise it comes from the slab cache.
+	if (!(output = arena_current() ? mm_arena_alloc(sizeof(imap_fetch_response_t)) : slab_get(&imap_fetch_response_slab))) {
 		st_free(value);
 		return response;
 	}
 
+	output->arena = arena_current() ? true : false;
+
 	// Setup structure.
-	if (!(output->key = st_dupe_opts(MANAGED_T | HEAP | CONTIGUOUS, key))) {
-		mm_free(output);
+	if (!(output->key = st_dupe_opts(MANAGED_T | ARENA | CONTIGUOUS, key))) {
+		if (!output->arena) slab_put(&imap_fetch_response_slab, output);
 		st_free(value);
 		return response;
 	}
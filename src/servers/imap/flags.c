@@ -141,13 +141,13 @@ void imap_update_flags(meta_user_t *user, inx_t *messages, uint64_t foldernum, i
 		while ((active = inx_cursor_value_next(cursor))) {
 			if (active->foldernum == foldernum) {
 				if ((action & IMAP_FLAG_ADD) == IMAP_FLAG_ADD) {
-					active->status = active->status | flags;
+					meta_index_status(user, active, active->status | flags);
 				}
 				else if ((action & IMAP_FLAG_REMOVE) == IMAP_FLAG_REMOVE) {
-					active->status = (active->status | flags) ^ flags;
+					meta_index_status(user, active, (active->status | flags) ^ flags);
 				}
 				else if ((action & IMAP_FLAG_REPLACE) == IMAP_FLAG_REPLACE) {
-					active->status = ((active->status | complete) ^ complete) | flags;
+					meta_index_status(user, active, ((active->status | complete) ^ complete) | flags);
 				}
 			}
 		}
@@ -666,8 +666,7 @@ int_t imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original,
  * @brief	Get the status of a folder.
  * @note	This function will count the number of messages in a folder, as well as the number of messages marked recent or unseen,
  * 			as well as the numerical id of the first message in the folder and the UIDNEXT of the specified folder.
- * @param	folders		an inx holder containing a list of folders to be searched for the specified folder.
- * @param	messages	an inx holder containing a complete list of a user's messages to be examined for gathering statistics.
+ * @param	user		the meta user object whose folders and messages are being examined.
  * @param	name		a managed string containing the name of the imap folder to be queried.
  * @param	status		a pointer to an imap folder status object to receive the folder's status information.
  * @return	1 on success or <= 0 on failure.
@@ -675,13 +674,13 @@ int_t imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original,
  *         -1:	The specified folder name was invalid.
  *         -2:	The folder did not exist.
  */
-int_t imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap_folder_status_t *status) {
+int_t imap_folder_status(meta_user_t *user, stringer_t *name, imap_folder_status_t *status) {
 
+	size_t first, last;
+	meta_index_t *index;
 	meta_folder_t *folder;
-	inx_cursor_t *cursor;
-	meta_message_t *message;
 
-	if (!folders || !name || !status) {
+	if (!user || !user->folders || !name || !status) {
 		log_pedantic("We were passed an invalid pointer.");
 		return 0;
 	}
@@ -695,46 +694,35 @@ int_t imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap
 	}
 
 	// Make sure the folder exists, and find the structure.
-	if (!(folder = meta_folders_by_name(folders, name))) {
+	if (!(folder = meta_folders_by_name(user->folders, name))) {
 		return -2;
 	}
 
 	// Store the folder number.
 	status->foldernum = folder->foldernum;
 
-	// Iterate through the messages structure and collect status information.
-	if ((cursor = inx_cursor_alloc(messages))) {
-
-		while ((message = inx_cursor_value_next(cursor))) {
-
-			if (message->foldernum == folder->foldernum) {
-				status->messages++;
+	// Scan the folder's flags in the message index to collect the status information.
+	index = meta_index_get(user);
+	status->messages = meta_index_folder(index, folder->foldernum, &first, &last);
 
-				if ((message->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					status->recent++;
-				}
+	for (size_t i = first; i < last; i++) {
 
-				if ((message->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
-					status->unseen++;
-
-					if (!status->first) {
-						status->first = status->messages;
-					}
-
-				}
+		if ((index->flags[i] & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
+			status->recent++;
+		}
 
-			}
+		if ((index->flags[i] & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
+			status->unseen++;
 
-			if (message->messagenum > status->uidnext) {
-				status->uidnext = message->messagenum;
+			if (!status->first) {
+				status->first = i - first + 1;
 			}
 
 		}
 
-		inx_cursor_free(cursor);
 	}
 
-	status->uidnext += 1;
+	status->uidnext = index->highest + 1;
 
 	return 1;
 }
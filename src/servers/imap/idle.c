@@ -0,0 +1,226 @@
+/**
+ * @file /magma/servers/imap/idle.c
+ *
+ * @brief	Functions used to implement the IDLE command, as described by RFC 2177.
+ *
+ * An idling connection is registered with the mailbox notification table, and parked on the network event loop. It's handed back
+ * to a worker thread when the client sends more data, or when another session publishes a change to the user's mailbox, at which
+ * point any changes to the selected folder are sent to the client as untagged responses.
+ */
+
+#include "magma.h"
+
+// The interned id of the idle connection statistic.
+static uint64_t imap_idle_connections = 0;
+
+/**
+ * @brief	Wake an idling connection, if it's parked on the network event loop.
+ * @param	data	the connection object.
+ * @return	true if the connection was dispatched, otherwise false.
+ */
+static bool_t imap_idle_wake(void *data) {
+	return con_events_wake((connection_t *)data);
+}
+
+/**
+ * @brief	Park an idling connection on the network event loop.
+ * @param	data	the connection object.
+ * @return	This function returns no value.
+ */
+static void imap_idle_park(void *data) {
+	con_events_wait((connection_t *)data, &imap_idle_continue);
+	return;
+}
+
+/**
+ * @brief	Append an untagged FETCH response holding the flags of a message to an output buffer.
+ * @param	output	the managed string which will receive the response.
+ * @param	active	the message whose flags are being reported.
+ * @return	NULL on failure, or a pointer to the output buffer.
+ */
+static stringer_t * imap_idle_flags(stringer_t *output, meta_message_t *active) {
+
+	stringer_t *line = MANAGEDBUF(256);
+
+	if (st_sprint(line, "* %lu FETCH (FLAGS (%s%s%s%s%s%s%s%s%s%s%s) UID %lu)\r\n", active->sequencenum,
+		(active->status & MAIL_STATUS_ANSWERED) != 0 ? "\\Answered" : "",
+		(active->status & MAIL_STATUS_ANSWERED) != 0 && (active->status & MAIL_STATUS_FLAGGED) != 0 ? " " : "",
+		(active->status & MAIL_STATUS_FLAGGED) != 0 ? "\\Flagged" : "",
+		(active->status & (MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED)) != 0 && (active->status & MAIL_STATUS_DELETED) != 0 ? " " : "",
+		(active->status & MAIL_STATUS_DELETED) != 0 ? "\\Deleted" : "",
+		(active->status & (MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED | MAIL_STATUS_DELETED)) != 0 && (active->status & MAIL_STATUS_SEEN) != 0 ? " " : "",
+		(active->status & MAIL_STATUS_SEEN) != 0 ? "\\Seen" : "",
+		(active->status & (MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED | MAIL_STATUS_DELETED | MAIL_STATUS_SEEN)) != 0 && (active->status & MAIL_STATUS_DRAFT) != 0 ? " " : "",
+		(active->status & MAIL_STATUS_DRAFT) != 0 ? "\\Draft" : "",
+		(active->status & (MAIL_STATUS_ANSWERED | MAIL_STATUS_FLAGGED | MAIL_STATUS_DELETED | MAIL_STATUS_SEEN | MAIL_STATUS_DRAFT)) != 0 && (active->status & MAIL_STATUS_RECENT) != 0 ? " " : "",
+		(active->status & MAIL_STATUS_RECENT) != 0 ? "\\Recent" : "", active->messagenum) <= 0) {
+		return output;
+	}
+
+	return st_append_opts(8192, output, line);
+}
+
+/**
+ * @brief	Start an IDLE session, by registering the connection with the mailbox notification table.
+ * @param	con		the connection which issued the IDLE command.
+ * @return	true on success, or false on failure.
+ */
+bool_t imap_idle_start(connection_t *con) {
+
+	if (!(con->imap.idle = notify_subscribe(con->imap.user->usernum, con->imap.selected, &imap_idle_wake, con))) {
+		return false;
+	}
+
+	stats_increment_by_num(stats_intern(&imap_idle_connections, "imap.connections.idle"));
+	return true;
+}
+
+/**
+ * @brief	End an IDLE session, and remove the connection from the mailbox notification table.
+ * @param	con		the idling connection.
+ * @return	This function returns no value.
+ */
+void imap_idle_stop(connection_t *con) {
+
+	if (con->imap.idle) {
+		notify_unsubscribe(con->imap.idle);
+		stats_decrement_by_num(stats_intern(&imap_idle_connections, "imap.connections.idle"));
+		con->imap.idle = NULL;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Wait for the client to end the IDLE command, or for a change to the user's mailbox.
+ * @note	If a change was published while the connection was busy, it's processed immediately instead of waiting.
+ * @param	con		the idling connection.
+ * @return	This function returns no value.
+ */
+void imap_idle_wait(connection_t *con) {
+
+	// Send any updates now, since the connection is parked while the notification table is locked, and an idling client can wait for
+	// hours, so the output buffer is released instead of being held until the next update.
+	con_flush(con);
+	con_release(con);
+
+	if (!notify_wait(con->imap.idle, &imap_idle_park, con)) {
+		enqueue(&imap_idle_continue, con);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Send the client any changes to the selected folder which were published since the last update.
+ * @param	con		the idling connection.
+ * @return	This function returns no value.
+ */
+void imap_idle_update(connection_t *con) {
+
+	bool_t overflow;
+	uint32_t pending;
+	meta_index_t *index;
+	size_t count, first, last;
+	meta_message_t *active;
+	stringer_t *output = NULL;
+	uint64_t changed[MAGMA_NOTIFY_CHANGES];
+
+	pending = notify_take(con->imap.idle, changed, &count, &overflow);
+
+	// Without a selected folder, there is nothing to report.
+	if (!con->imap.selected) {
+		return;
+	}
+
+	// Refresh the session, and report the new folder totals if they changed.
+	if ((pending & ((1 << OBJECT_USER) | (1 << OBJECT_FOLDERS) | (1 << OBJECT_MESSAGES))) && imap_session_update(con) == 1) {
+		con_print(con, "* %lu EXISTS\r\n* %lu RECENT\r\n", con->imap.messages_total, con->imap.messages_recent);
+	}
+
+	if (!count && !overflow) {
+		return;
+	}
+
+	// The read lock ensures a session changing the flags has finished updating the shared message objects.
+	meta_user_rlock(con->imap.user);
+
+	if (con->imap.user->messages) {
+
+		index = meta_index_get(con->imap.user);
+
+		// If too many messages changed to track individually, the flags for the entire folder are sent.
+		if (overflow && meta_index_folder(index, con->imap.selected, &first, &last)) {
+			for (size_t i = first; i < last; i++) {
+				output = imap_idle_flags(output, index->messages[i]);
+			}
+		}
+		else {
+			for (size_t i = 0; i < count; i++) {
+				if ((active = meta_index_find(index, con->imap.selected, changed[i]))) {
+					output = imap_idle_flags(output, active);
+				}
+			}
+		}
+	}
+
+	meta_user_unlock(con->imap.user);
+
+	if (st_populated(output)) {
+		con_write_st(con, output);
+	}
+
+	st_cleanup(output);
+	return;
+}
+
+/**
+ * @brief	Handle an idling connection after it has been woken up, either by the client sending data, or by a change to the mailbox.
+ * @note	The only valid input is the DONE continuation, which ends the IDLE command and returns the connection to regular command
+ * 			processing. Anything else also ends the command, but with an error.
+ * @param	con		the idling connection.
+ * @return	This function returns no value.
+ */
+void imap_idle_continue(connection_t *con) {
+
+	int_t state;
+
+	// The connection failed, timed out, or the server is shutting down, so imap_requeue() will send the connection to the logout function.
+	if (!status() || con_status(con) < 0 || !con->imap.idle) {
+		imap_idle_stop(con);
+		imap_requeue(con);
+		return;
+	}
+
+	imap_idle_update(con);
+
+	// Check whether the client has sent anything, without waiting for it.
+	if ((state = con_read_ready(con)) < 0) {
+		imap_idle_stop(con);
+		enqueue(&imap_logout, con);
+		return;
+	}
+	else if (state == 0) {
+		imap_requeue(con);
+		return;
+	}
+	else if (con_read_line(con, false) < 0) {
+		imap_idle_stop(con);
+		enqueue(&imap_logout, con);
+		return;
+	}
+
+	imap_idle_stop(con);
+
+	if (!st_cmp_ci_starts(&(con->network.line), PLACER("DONE", 4)) && pl_length_get(con->network.line) <= 6) {
+		con_print(con, "%.*s OK IDLE terminated.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+	}
+	else {
+		con->protocol.violations++;
+		con_print(con, "%.*s BAD IDLE terminated. Expected the DONE continuation.\r\n", st_length_int(con->imap.tag),
+			st_char_get(con->imap.tag));
+	}
+
+	imap_requeue(con);
+	return;
+}
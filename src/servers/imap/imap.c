@@ -14,7 +14,8 @@
 /**
  * @brief	Create a secure connection for an IMAP session.
  *
- * @note	RFC 2595 / section 3.1 specifies that STARTTLS is only available in a non-authenticated state.
+ * @note	RFC 2595 / section 3.1 specifies that STARTTLS is only available in a non-authenticated state. The handshake is performed
+ * 			by the handshake pool, so this command requeues the connection itself.
  *
  * @param	con		the connection on top of which the TLS session will be established.
  *
@@ -24,23 +25,41 @@ void imap_starttls(connection_t *con) {
 
 	if (con->imap.session_state != 0) {
 		imap_invalid(con);
+		imap_requeue(con);
 		return;
 	}
 	else if (con_secure(con) == 1) {
 		con_print(con, "%.*s BAD This session is already using TLS.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
+		imap_requeue(con);
 		return;
 	}
 	else if (con_secure(con) == -1) {
 		con_print(con, "%.*s NO This server is not configured to support TLS.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
+		imap_requeue(con);
 		return;
 	}
 
 	// Tell the user that we are ready to start the negotiation.
 	con_print(con, "%.*s OK Ready to start TLS negotiation.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
+	con_flush(con);
 
-	if (!(con->network.tls = tls_server_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
+	con_secure_enqueue(con, &imap_starttls_complete);
+	return;
+}
+
+/**
+ * @brief	Finish an IMAP STARTTLS command, once the handshake pool has attempted the TLS handshake.
+ *
+ * @param	con		the connection on top of which the TLS session was established.
+ *
+ * @return	This function returns no value.
+ */
+void imap_starttls_complete(connection_t *con) {
+
+	if (!con->network.tls) {
 		con_print(con, "%.*s NO TLS Connection attempt failed.\r\n", st_length_get(con->imap.tag), st_char_get(con->imap.tag));
 		log_pedantic("The TLS connection attempt failed.");
+		imap_requeue(con);
 		return;
 	}
 
@@ -49,6 +68,7 @@ void imap_starttls(connection_t *con) {
 	st_length_set(con->network.buffer, 0);
 	con->network.line = pl_null();
 	con->network.status = 1;
+	imap_requeue(con);
 
 	return;
 }
@@ -63,7 +83,7 @@ void imap_starttls(connection_t *con) {
 void imap_invalid(connection_t *con) {
 
 	con->protocol.violations++;
-	usleep(con->server->violations.delay);
+	con->protocol.delay = con->server->violations.delay;
 	con_print(con, "%.*s BAD Command not recognized.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 
 	return;
@@ -662,7 +682,7 @@ void imap_status(connection_t *con) {
 
 	// Get the folder status.
 	meta_user_rlock(con->imap.user);
-	state = imap_folder_status(con->imap.user->folders, con->imap.user->messages, imap_get_st_ar(con->imap.arguments, 0), &status);
+	state = imap_folder_status(con->imap.user, imap_get_st_ar(con->imap.arguments, 0), &status);
 	meta_user_unlock(con->imap.user);
 
 	// Figure out what to output.
@@ -809,7 +829,7 @@ void imap_examine(connection_t *con) {
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_index_status(con->imap.user, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 		inx_cursor_free(cursor);
@@ -820,7 +840,7 @@ void imap_examine(connection_t *con) {
 
 	// Get the folder status.
 	meta_user_rlock(con->imap.user);
-	state = imap_folder_status(con->imap.user->folders, con->imap.user->messages, imap_get_st_ar(con->imap.arguments, 0), &status);
+	state = imap_folder_status(con->imap.user, imap_get_st_ar(con->imap.arguments, 0), &status);
 	meta_user_unlock(con->imap.user);
 
 	if (state == 1) {
@@ -882,7 +902,7 @@ void imap_select(connection_t *con) {
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_index_status(con->imap.user, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 			inx_cursor_free(cursor);
@@ -894,7 +914,7 @@ void imap_select(connection_t *con) {
 
 	// Get the folder status.
 	meta_user_wlock(con->imap.user);
-	if ((state = imap_folder_status(con->imap.user->folders, con->imap.user->messages, imap_get_st_ar(con->imap.arguments, 0), &status)) == 1) {
+	if ((state = imap_folder_status(con->imap.user, imap_get_st_ar(con->imap.arguments, 0), &status)) == 1) {
 
 		// Now that this folder has been opened, remove the recent flag in the database.
 		meta_data_flags_remove(con->imap.user->messages, con->imap.user->usernum, status.foldernum, MAIL_STATUS_RECENT);
@@ -995,7 +1015,7 @@ void imap_store(connection_t *con) {
 	}
 
 	// Narrow by the sequence range provided.
-	else if (!(messages = imap_narrow_messages(con->imap.user->messages, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid))) {
+	else if (!(messages = imap_narrow_messages(con->imap.user, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid))) {
 		meta_user_unlock(con->imap.user);
 		con_print(con, "%.*s OK Store complete.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		return;
@@ -1165,7 +1185,7 @@ void imap_close(connection_t *con) {
 		if ((cursor = inx_cursor_alloc(con->imap.user->messages))) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-					active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+					meta_index_status(con->imap.user, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 				}
 			}
 			inx_cursor_free(cursor);
@@ -1335,7 +1355,7 @@ void imap_copy(connection_t *con) {
 
 	// Narrow by the sequence range provided.
 	// Due to bugs in several clients, invalid sequences may be submitted. Return an okay if the sequence isn't found so the client doesn't hang.
-	else if (con->imap.user->messages == NULL || (messages = imap_narrow_messages(con->imap.user->messages, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid)) == NULL) {
+	else if (con->imap.user->messages == NULL || (messages = imap_narrow_messages(con->imap.user, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid)) == NULL) {
 		meta_user_unlock(con->imap.user);
 		con_print(con, "%.*s OK No messages were found matching the range provided.\r\n", st_length_int(con->imap.tag),
 			st_char_get(con->imap.tag));
@@ -1530,6 +1550,7 @@ void imap_append(connection_t *con) {
 
 void imap_fetch(connection_t *con) {
 
+	size_t mark;
 	int_t space = 0;
 	inx_cursor_t *cursor;
 	meta_message_t *active;
@@ -1574,7 +1595,7 @@ void imap_fetch(connection_t *con) {
 	}
 
 	// Narrow by the sequence range provided.
-	if (con->imap.user->messages == NULL || (messages = imap_narrow_messages(con->imap.user->messages, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid)) == NULL) {
+	if (con->imap.user->messages == NULL || (messages = imap_narrow_messages(con->imap.user, con->imap.selected, imap_get_st_ar(con->imap.arguments, 0), con->imap.uid)) == NULL) {
 		meta_user_unlock(con->imap.user);
 		con_print(con, "%.*s OK Fetch complete. No messages were found matching the range provided.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 		imap_fetch_free_items(items);
@@ -1587,7 +1608,7 @@ void imap_fetch(connection_t *con) {
 		if ((cursor = inx_cursor_alloc(messages))) {
 			while ((active = inx_cursor_value_next(cursor))) {
 				if ((active->status & MAIL_STATUS_SEEN) != MAIL_STATUS_SEEN) {
-					active->status = (active->status | MAIL_STATUS_SEEN);
+					meta_index_status(con->imap.user, active, active->status | MAIL_STATUS_SEEN);
 					active->updated = 1;
 				}
 			}
@@ -1619,7 +1640,8 @@ void imap_fetch(connection_t *con) {
 	if ((cursor = inx_cursor_alloc(duplicate))) {
 		while (status() && con_status(con) >= 0 && (active = inx_cursor_value_next(cursor))) {
 
-			// Fetch the data.
+			// Fetch the data. The response is discarded once it has been written, so the arena is rewound after every message.
+			mark = arena_mark(arena_current());
 			iterate = response = imap_fetch_message(con, active, items);
 			space = 0;
 
@@ -1680,6 +1702,7 @@ void imap_fetch(connection_t *con) {
 
 			// Free the response and advance.
 			imap_fetch_response_free(response);
+			arena_rewind(arena_current(), mark);
 			con_write_bl(con, ")\r\n", 3);
 		}
 
@@ -1746,15 +1769,36 @@ void imap_search(connection_t *con) {
 	return;
 }
 
+/**
+ * @brief	Begin an IDLE command, as described by RFC 2177.
+ * @note	The connection is registered for mailbox change notifications, and imap_requeue() will then park it until the client sends the
+ * 			DONE continuation, or another session changes the mailbox.
+ * @param	con		the connection which issued the IDLE command.
+ * @return	This function returns no value.
+ */
 void imap_idle(connection_t *con) {
 
-	if (con->imap.session_state != 1) {
+	if (con->imap.session_state != 1 || !con->imap.user) {
 		con_print(con, "%.*s BAD The IDLE command is not available until you are authenticated.\r\n", st_length_int(con->imap.tag),
 			st_char_get(con->imap.tag));
+		return;
 	}
-	else {
-		con_print(con, "%.*s NO IDLE Failed. The IDLE command is not currently supported.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+	else if (con->imap.arguments) {
+		con_print(con, "%.*s BAD The IDLE command does not accept any arguments.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+		return;
+	}
+	else if (!imap_idle_start(con)) {
+		con_print(con, "%.*s NO IDLE Failed. Unable to register for mailbox updates.\r\n", st_length_int(con->imap.tag), st_char_get(con->imap.tag));
+		return;
+	}
+
+	con_write_bl(con, "+ idling\r\n", 10);
+
+	// Report anything that changed since the last command, so the client starts out with the current folder status.
+	if (con->imap.selected && imap_session_update(con) == 1) {
+		con_print(con, "* %lu EXISTS\r\n* %lu RECENT\r\n", con->imap.messages_total, con->imap.messages_recent);
 	}
+
 	return;
 }
 
@@ -1820,7 +1864,7 @@ void imap_capability(connection_t *con) {
 	}
 
 	// STARTTLS should only appear if the server instance has been configured with an TLS certificate. The connection must also be pre-authentication and unencrypted.
-	con_print(con, "* CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID\r\n%.*s OK Completed.\r\n", con_secure(con) == 0 && con->imap.session_state == 0 ?
+	con_print(con, "* CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID IDLE\r\n%.*s OK Completed.\r\n", con_secure(con) == 0 && con->imap.session_state == 0 ?
 		" STARTTLS " : " ",	st_length_int(con->imap.tag), st_char_get(con->imap.tag));
 
 	return;
@@ -1839,7 +1883,7 @@ void imap_init(connection_t *con) {
 	con_reverse_enqueue(con);
 
 	// Introduce ourselves. Note the string below needs to stay in sync with the capability command.
-	con_print(con, "* OK [CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID]%s%.*s%sMagma IMAP server v%s is ready.\r\n",
+	con_print(con, "* OK [CAPABILITY IMAP4 IMAP4rev1%sLITERAL+ ID IDLE]%s%.*s%sMagma IMAP server v%s is ready.\r\n",
 		con_secure(con) == 0 ? " STARTTLS " : " ", st_length_get(con->server->domain) ? " " : "", st_length_int(con->server->domain),
 		st_char_get(con->server->domain), st_length_get(con->server->domain) ? " " : "", build_version());
 
@@ -35,10 +35,13 @@
 #define IMAP_FLAG_REPLACE 8
 
 /// commands.c
-int_t   imap_compare(const void *compare, const void *command);
-void    imap_process(connection_t *con);
-void    imap_requeue(connection_t *con);
-void    imap_sort(void);
+command_t *  imap_command(stringer_t *name);
+int_t        imap_compare(const void *compare, const void *command);
+void         imap_complete(connection_t *con);
+void         imap_dispatch(connection_t *con);
+void         imap_process(connection_t *con);
+void         imap_requeue(connection_t *con);
+void         imap_sort(void);
 
 /// fetch_response.c
 imap_fetch_response_t *  imap_fetch_response_add(imap_fetch_response_t *response, stringer_t *key, stringer_t *value);
@@ -61,7 +64,7 @@ stringer_t *              imap_fetch_return_header(connection_t *con, meta_messa
 mail_message_t *          imap_fetch_return_message(connection_t *con, meta_message_t *meta, mail_message_t **message, stringer_t **header, imap_fetch_response_t *output);
 mail_mime_t *             imap_fetch_return_mime(connection_t *con, meta_message_t *meta, mail_message_t **message, stringer_t **header, imap_fetch_response_t *output);
 stringer_t *              imap_fetch_return_text(connection_t *con, meta_message_t *meta, mail_message_t **message, stringer_t **header, imap_fetch_response_t *output);
-inx_t *                   imap_narrow_messages(inx_t *messages, uint64_t selected, stringer_t *range, int_t uid);
+inx_t *                   imap_narrow_messages(meta_user_t *user, uint64_t selected, stringer_t *range, int_t uid);
 imap_fetch_dataitems_t *  imap_parse_dataitems(imap_arguments_t *arguments);
 int_t                     imap_valid_sequence(stringer_t *range);
 
@@ -78,11 +81,18 @@ int_t         imap_folder_create(uint64_t usernum, inx_t *folders, stringer_t *n
 stringer_t *  imap_folder_name_escaped(inx_t *folders, meta_folder_t *active);
 int_t         imap_folder_remove(uint64_t usernum, inx_t *folders, inx_t *messages, stringer_t *name);
 int_t         imap_folder_rename(uint64_t usernum, inx_t *folders, stringer_t *original, stringer_t *rename);
-int_t         imap_folder_status(inx_t *folders, inx_t *messages, stringer_t *name, imap_folder_status_t *status);
+int_t         imap_folder_status(meta_user_t *user, stringer_t *name, imap_folder_status_t *status);
 inx_t *       imap_narrow_folders(inx_t *folders, stringer_t *reference, stringer_t *mailbox);
 uint64_t      imap_next_folder_order(inx_t *folders, uint64_t parent);
 bool_t        imap_valid_folder_name(stringer_t *name);
 
+/// idle.c
+void     imap_idle_continue(connection_t *con);
+bool_t   imap_idle_start(connection_t *con);
+void     imap_idle_stop(connection_t *con);
+void     imap_idle_update(connection_t *con);
+void     imap_idle_wait(connection_t *con);
+
 /// imap.c
 void   imap_append(connection_t *con);
 void   imap_capability(connection_t *con);
@@ -107,6 +117,7 @@ void   imap_rename(connection_t *con);
 void   imap_search(connection_t *con);
 void   imap_select(connection_t *con);
 void   imap_starttls(connection_t *con);
+void   imap_starttls_complete(connection_t *con);
 void   imap_status(connection_t *con);
 void   imap_store(connection_t *con);
 void   imap_subscribe(connection_t *con);
@@ -146,14 +157,15 @@ stringer_t *  imap_range_build(size_t length, uint64_t *numbers);
 /// search.c
 int_t    imap_search_flag(uint32_t status, uint32_t flag, int_t has);
 inx_t *  imap_search_messages(connection_t *con);
-int_t    imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
+int_t    imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, inx_t *queries, stringer_t *value);
 int_t    imap_search_messages_date(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *date, int_t internal, int_t expected);
 int_t    imap_search_messages_date_compare(stringer_t *one, stringer_t *two);
 int_t    imap_search_messages_header(meta_user_t *user, mail_message_t **data, stringer_t **header, meta_message_t *active, stringer_t *field, stringer_t *value);
-int_t    imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion);
+int_t    imap_search_messages_index(meta_user_t *user, meta_message_t *active, inx_t *queries, stringer_t *value);
+int_t    imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, inx_t *queries, imap_arguments_t *array, unsigned recursion);
 int_t    imap_search_messages_range(meta_message_t *active, stringer_t *range, int_t uid);
 int_t    imap_search_messages_size(meta_message_t *active, stringer_t *value, int_t expected);
-int_t    imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value);
+int_t    imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, inx_t *queries, stringer_t *value);
 
 /// sessions.c
 void    imap_session_destroy(connection_t *con);
@@ -21,7 +21,7 @@ int_t imap_append_message(connection_t *con, meta_folder_t *folder, uint32_t fla
 		return 0;
 	}
 
-	if ((new = mm_alloc(sizeof(meta_message_t))) == NULL) {
+	if ((new = meta_message_alloc()) == NULL) {
 		log_pedantic("Unable to allocate %zu bytes for a message structure.", sizeof(meta_message_t));
 		return 0;
 	}
@@ -34,7 +34,10 @@ int_t imap_append_message(connection_t *con, meta_folder_t *folder, uint32_t fla
 	snprintf(new->server, 33, "%.*s", st_length_int(magma.storage.active), st_char_get(magma.storage.active));
 
 	if (inx_append(con->imap.user->messages, key, new) != true) {
-		mm_free(new);
+		meta_message_free(new);
+	}
+	else {
+		meta_index_insert(con->imap.user, new);
 	}
 
 	meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
@@ -52,13 +55,16 @@ int_t imap_append_message(connection_t *con, meta_folder_t *folder, uint32_t fla
 
 int_t imap_message_expunge(connection_t *con, meta_message_t *message) {
 
+	uint64_t foldernum;
 	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (message && message->messagenum ? message->messagenum : 0) };
 
 	if (!mail_remove_message(con->imap.user->usernum, message->messagenum, message->size, message->server)) {
 		return 0;
 	}
 
+	foldernum = message->foldernum;
 	inx_delete(con->imap.user->messages, key);
+	meta_index_remove(con->imap.user, foldernum, key.val.u64);
 	return 1;
 }
 
@@ -95,7 +101,10 @@ int_t imap_message_copier(connection_t *con, meta_message_t *message, uint64_t t
 	}
 
 	if (inx_append(con->imap.user->messages, key, new) != true) {
-		mm_free(new);
+		meta_message_free(new);
+	}
+	else {
+		meta_index_insert(con->imap.user, new);
 	}
 
 	meta_messages_update_sequences(con->imap.user->folders, con->imap.user->messages);
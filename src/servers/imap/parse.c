@@ -454,7 +454,9 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 				if ((uint64_t)characters > number) {
 					mm_move(st_char_get(con->network.buffer), st_char_get(con->network.buffer) + number, characters - number);
 					st_length_set(con->network.buffer, characters - number);
-					con->network.line = line_pl_st(con->network.buffer, 0);
+					if (pl_empty((con->network.line = line_pl_st(con->network.buffer, 0)))) {
+						con->network.line = pl_init(st_data_get(con->network.buffer), 0);
+					}
 				}
 				else {
 					st_length_set(con->network.buffer, 0);
@@ -539,7 +541,9 @@ int_t imap_parse_literal(connection_t *con, stringer_t **output, chr_t **start,
 			if (characters > left) {
 				mm_move(st_char_get(con->network.buffer), st_char_get(con->network.buffer) + left, characters - left);
 				st_length_set(con->network.buffer, characters - left);
-				con->network.line = line_pl_st(con->network.buffer, 0);
+				if (pl_empty((con->network.line = line_pl_st(con->network.buffer, 0)))) {
+					con->network.line = pl_init(st_data_get(con->network.buffer), 0);
+				}
 			}
 			else {
 					st_length_set(con->network.buffer, 0);
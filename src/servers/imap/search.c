@@ -194,43 +194,90 @@ int_t imap_search_messages_header(meta_user_t *user, mail_message_t **data, stri
 	return compare;
 }
 
-int_t imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value) {
+/**
+ * @brief	Use the full text search index to decide whether a message could contain a search value, without loading the message.
+ * @note	The index lookup for each search value is performed once per search, and cached inside the queries index. The index can only
+ * 			rule a message out, so a message which could contain the value must still be scanned.
+ * @param	user		the user whose messages are being searched.
+ * @param	active		the message being evaluated.
+ * @param	queries		an index of full text search queries, keyed by the address of the search value.
+ * @param	value		the search value.
+ * @return	-1 if the message can't contain the value, or 0 if the message needs to be scanned.
+ */
+int_t imap_search_messages_index(meta_user_t *user, meta_message_t *active, inx_t *queries, stringer_t *value) {
+
+	fulltext_query_t *query;
+	multi_t key = { .type = M_TYPE_UINT64, .val.u64 = (uint64_t)value };
+
+	if (!queries || !user || !value) {
+		return 0;
+	}
+
+	else if (!(query = inx_find(queries, key)) && (!(query = fulltext_query(user->usernum, value)) || !inx_insert(queries, key, query))) {
+		fulltext_query_free(query);
+		return 0;
+	}
+
+	return fulltext_query_check(query, active->messagenum);
+}
+
+int_t imap_search_messages_body(meta_user_t *user, mail_message_t **data, meta_message_t *active, inx_t *queries, stringer_t *value) {
 
 	size_t location;
 	int_t compare = -1;
-	stringer_t *current = NULL;
+	placer_t body = pl_null();
+
+	// The index only holds the raw body lines which aren't base64 encoded, so it can only rule messages out for values which can't appear
+	// inside base64 data.
+	if (fulltext_term(value) && imap_search_messages_index(user, active, queries, value) == -1) {
+		compare = -1;
+	}
 
 	// Load the message, if necessary.
-	if (*data == NULL && ((*data = mail_load_message(active, user, NULL, 0)) == NULL || mail_mime_update(*data) == 0)) {
+	else if (*data == NULL && ((*data = mail_load_message(active, user, NULL, 0)) == NULL || mail_mime_update(*data) == 0)) {
 		compare = -1;
 	}
 
-	// Search for the value inside the body.
-	else if (st_search_ci(&((*data)->mime->body), value, &location) == 1) {
-		compare = 1;
+	// If the message couldn't be parsed, search the raw text which follows the header.
+	else if (!(*data)->mime) {
+		if ((*data)->header_length < st_length_get((*data)->text)) {
+			body = pl_init(st_char_get((*data)->text) + (*data)->header_length, st_length_get((*data)->text) - (*data)->header_length);
+		}
+		compare = !pl_empty(body) && st_search_ci(&body, value, &location) == 1 ? 1 : -1;
 	}
 
-	// Cleanup
-	if (current != NULL) {
-		st_free(current);
+	// Search for the value inside the raw body.
+	else if (st_search_ci(&((*data)->mime->body), value, &location) == 1) {
+		compare = 1;
 	}
 
 	return compare;
 }
 
-int_t imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, stringer_t *value) {
+int_t imap_search_messages_text(meta_user_t *user, mail_message_t **data, meta_message_t *active, inx_t *queries, stringer_t *value) {
 
 	size_t location;
 	int_t compare = -1;
 	stringer_t *current = NULL;
 
+	// Try ruling the message out using the index, before loading the message.
+	if (imap_search_messages_index(user, active, queries, value) == -1) {
+		compare = -1;
+	}
+
 	// Load the message, if necessary.
-	if (*data == NULL && ((*data = mail_load_message(active, user, NULL, 0)) == NULL || mail_mime_update(*data) == 0)) {
+	else if (*data == NULL && ((*data = mail_load_message(active, user, NULL, 0)) == NULL || mail_mime_update(*data) == 0)) {
 		compare = -1;
 	}
 
-	// Search for the value inside the header line.
-	else if (st_search_ci((*data)->text, value, &location) == 1) {
+	// If the message couldn't be parsed, search the raw text.
+	else if (!(*data)->mime) {
+		compare = st_search_ci((*data)->text, value, &location) == 1 ? 1 : -1;
+	}
+
+	// Search for the value inside the header, and then inside the decoded body.
+	else if (st_search_ci(&((*data)->mime->header), value, &location) == 1 ||
+		((current = mail_mime_text((*data)->mime)) && st_search_ci(current, value, &location) == 1)) {
 		compare = 1;
 	}
 
@@ -344,7 +391,7 @@ int_t imap_search_messages_range(meta_message_t *active, stringer_t *range, int_
 	return -1;
 }
 
-int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, imap_arguments_t *array, unsigned recursion) {
+int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, stringer_t **header, meta_message_t *current, inx_t *queries, imap_arguments_t *array, unsigned recursion) {
 
 	stringer_t *item;
 	unsigned number, increment = 0;
@@ -365,7 +412,7 @@ int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, st
 
 		// Handle nested arrays.
 		if (imap_get_type_ar(array, increment) == IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_inner(user, message, header, current, imap_get_ar_ar(array, increment++), recursion + 1);
+			eval = imap_search_messages_inner(user, message, header, current, queries, imap_get_ar_ar(array, increment++), recursion + 1);
 		}
 		else if ((item = imap_get_st_ar(array, increment++)) == NULL) {
 			eval = -1;
@@ -462,12 +509,12 @@ int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, st
 
 		// Body checks.
 		else if (increment < number && !st_cmp_ci_eq(item, PLACER("BODY", 4)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_body(user, message, current, imap_get_st_ar(array, increment++));
+			eval = imap_search_messages_body(user, message, current, queries, imap_get_st_ar(array, increment++));
 		}
 
 		// Full message checks.
 		else if (increment < number && !st_cmp_ci_eq(item, PLACER("TEXT", 4)) && imap_get_type_ar(array, increment) != IMAP_ARGUMENT_TYPE_ARRAY) {
-			eval = imap_search_messages_text(user, message, current, imap_get_st_ar(array, increment++));
+			eval = imap_search_messages_text(user, message, current, queries, imap_get_st_ar(array, increment++));
 		}
 
 		// Size checks.
@@ -563,8 +610,10 @@ int_t imap_search_messages_inner(meta_user_t *user, mail_message_t **message, st
 inx_t * imap_search_messages(connection_t *con) {
 
 	time_t start;
-	inx_t *output = NULL;
+	meta_index_t *index = NULL;
 	inx_cursor_t *cursor = NULL;
+	size_t position = 0, first = 0, last = 0;
+	inx_t *output = NULL, *queries = NULL;
 	stringer_t *header = NULL;
 	mail_message_t *message = NULL;
 	uint64_t finished = 0, uid = 0, count = 0;
@@ -575,24 +624,31 @@ inx_t * imap_search_messages(connection_t *con) {
 		return NULL;
 	}
 
+	// The full text search lookups are cached for the duration of the search. If the cache can't be allocated every message is scanned.
+	queries = inx_alloc(M_INX_HASHED, &fulltext_query_free);
+
 	while (status() && !finished) {
 
 		/// LOW: Is a read lock necessary now that were using index reference counters and thread safe iteration cursors?
 		meta_user_rlock(con->imap.user);
 		start = time(NULL);
 
-		if (con->imap.user && con->imap.user->messages && (cursor = inx_cursor_alloc(con->imap.user->messages))) {
-			while (uid && (active = inx_cursor_value_next(cursor)) && active->messagenum <= uid);
+		// Resume the scan in the selected folder's slice of the message index, just past the last message examined.
+		if (con->imap.user && con->imap.user->messages) {
+			index = meta_index_get(con->imap.user);
+			meta_index_folder(index, con->imap.selected, &first, &last);
+			position = uid ? meta_index_uid(index, first, last, uid + 1) : first;
 		}
 		else {
 			finished = 1;
 		}
 
-		while (!finished && time(NULL) != (start + 1) && (active = inx_cursor_value_next(cursor))) {
+		while (!finished && time(NULL) != (start + 1) && position < last) {
+
+			active = index->messages[position++];
 
 			// Check for a match.
-			if (active->foldernum == con->imap.selected &&
-					imap_search_messages_inner(con->imap.user, &message, &header, active, con->imap.arguments, 0) == 1 &&
+			if (imap_search_messages_inner(con->imap.user, &message, &header, active, queries, con->imap.arguments, 0) == 1 &&
 					(key.val.u64 = active->messagenum) && (duplicate = meta_message_dupe(active)) &&
 					inx_append(output, key, duplicate) != true) {
 				meta_message_free(duplicate);
@@ -614,18 +670,19 @@ inx_t * imap_search_messages(connection_t *con) {
 		}
 
 		meta_user_unlock(con->imap.user);
-		inx_cursor_free(cursor);
 
-		// If the search defers it should also sleep to allowing other threads access.
-		if (!active) {
+		// If the search defers, yield the processor so threads waiting on the user lock get a turn, without parking the worker in a sleep.
+		if (finished || position >= last) {
 			finished = 1;
 		}
 		else {
-			usleep(10000);
+			sched_yield();
 		}
 
 	}
 
+	inx_cleanup(queries);
+
 	// If the user serial number has changed, then messages may have been added or removed from the user's mailbox, which
 	// means the sequence numbers, which are relative, for messages in the output index could have changed. The  logic below
 	// iterates through the output index and updates the sequence number duplicate message strucutre with the current sequence
@@ -635,10 +692,11 @@ inx_t * imap_search_messages(connection_t *con) {
 
 		meta_user_rlock(con->imap.user);
 
+		index = meta_index_get(con->imap.user);
+
 		while ((active = inx_cursor_value_next(cursor)) && con->imap.user && con->imap.user->messages) {
 
-			key = inx_cursor_key_active(cursor);
-			duplicate = inx_find(con->imap.user->messages, key);
+			duplicate = meta_index_find(index, con->imap.selected, active->messagenum);
 
 			// If the message isn't found, then it might have been removed by another connection while the search was
 			// running. In that case we'll set the sequence number to zero so message doesn't get included in the output.
@@ -695,7 +753,7 @@ inx_t * imap_search_messages(connection_t *con) {
 		while (counter++ < 25 && session != NULL && con->imap.user != NULL && con->imap.user->messages != NULL && (active = ll_pop(con->imap.user->messages)) != NULL) {
 
 			// Check for a match.
-			if (active->foldernum == con->imap.selected && imap_search_messages_inner(con->imap.user, &message, &header, active, con->imap.arguments, 0) == 1 &&
+			if (active->foldernum == con->imap.selected && imap_search_messages_inner(con->imap.user, &message, &header, active, queries, con->imap.arguments, 0) == 1 &&
 				(duplicate = meta_message_dupe(active)) != NULL) {
 				ll_add(output, duplicate);
 			}
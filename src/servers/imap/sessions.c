@@ -95,6 +95,9 @@ void imap_session_destroy(connection_t *con) {
 	inx_cursor_t *cursor;
 	meta_message_t *active;
 
+	// A connection which is torn down in the middle of an IDLE command must stop receiving notifications before it's freed.
+	imap_idle_stop(con);
+
 	meta_user_wlock(con->imap.user);
 
 	// If a folder was selected, clear the recent flag before closing the mailbox.
@@ -104,7 +107,7 @@ void imap_session_destroy(connection_t *con) {
 		while ((active = inx_cursor_value_next(cursor))) {
 
 			if (active->foldernum == con->imap.selected && (active->status & MAIL_STATUS_RECENT) == MAIL_STATUS_RECENT) {
-				active->status = (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT;
+				meta_index_status(con->imap.user, active, (active->status | MAIL_STATUS_RECENT) ^ MAIL_STATUS_RECENT);
 			}
 
 		}
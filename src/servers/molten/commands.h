@@ -10,9 +10,17 @@
 
 command_t molten_commands[] = {
 		{
+			.string = "LATENCY",
+			.length = 7,
+			.function = &molten_latency
+		},{
 			.string = "QUIT",
 			.length = 4,
 			.function = &molten_quit
+		},{
+			.string = "RECORDER",
+			.length = 8,
+			.function = &molten_recorder
 		},{
 			.string = "STATS",
 			.length = 5,
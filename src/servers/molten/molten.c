@@ -38,6 +38,79 @@ void molten_stats(connection_t *con) {
 	return;
 }
 
+/**
+ * @brief	Print the latency percentiles of every protocol command which has been executed at least once.
+ * @note	The percentiles are reported in microseconds, using the same STAT lines as the STATS command, so the output can be parsed the
+ * 			same way. For example, the 99th percentile of the IMAP FETCH command is reported as imap.fetch.p99.
+ * @param	con		the molten client connection.
+ * @return	This function returns no value.
+ */
+void molten_latency(connection_t *con) {
+
+	uint64_t count;
+	latency_t *histogram = NULL;
+	struct {
+		chr_t *suffix;
+		uint64_t permille;
+	} percentiles[] = { { "p50", 500 }, { "p90", 900 }, { "p99", 990 }, { "p999", 999 } };
+
+	while ((histogram = latency_next(histogram))) {
+
+		if (!(count = latency_count(histogram))) {
+			continue;
+		}
+		else if (con_print(con, "STAT %s.count %lu\r\n", latency_name(histogram), count) < 0) {
+			enqueue(&molten_quit, con);
+			return;
+		}
+
+		for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+			if (con_print(con, "STAT %s.%s %lu\r\n", latency_name(histogram), percentiles[i].suffix,
+				(latency_percentile(histogram, percentiles[i].permille) + 999) / 1000) < 0) {
+				enqueue(&molten_quit, con);
+				return;
+			}
+		}
+
+	}
+
+	con_write_bl(con, "END\r\n", 5) < 0 ? enqueue(&molten_quit, con) : enqueue(&molten_parse, con);
+
+	return;
+}
+
+/**
+ * @brief	Send a single flight recorder line to a molten client.
+ * @param	context	the molten client connection.
+ * @param	line	the formatted line, which ends with a newline.
+ * @param	length	the length of the line.
+ * @return	true if the line was written, or false if the dump should be stopped.
+ */
+static bool_t molten_recorder_line(void *context, chr_t *line, size_t length) {
+
+	if (length && line[length - 1] == '\n') {
+		length--;
+	}
+
+	return con_print((connection_t *)context, "EVENT %.*s\r\n", (int)length, line) >= 0;
+}
+
+/**
+ * @brief	Print the events held by the flight recorder of every thread, oldest first, one thread at a time.
+ * @see		recorder_dump()
+ * @param	con		the molten client connection.
+ * @return	This function returns no value.
+ */
+void molten_recorder(connection_t *con) {
+
+	recorder_dump(&molten_recorder_line, con);
+
+	// The dump stops at the first failed write, so check the connection before sending the terminator.
+	(con_status(con) < 0 || con_write_bl(con, "END\r\n", 5) < 0) ? enqueue(&molten_quit, con) : enqueue(&molten_parse, con);
+
+	return;
+}
+
 void molten_invalid(connection_t *con) {
 
 	con_write_bl(con, "ERROR\r\n", 7) < 0 ? enqueue(&molten_quit, con) : enqueue(&molten_parse, con);
@@ -11,7 +11,9 @@
 /// molten.c
 void   molten_init(connection_t *con);
 void   molten_invalid(connection_t *con);
+void   molten_latency(connection_t *con);
 void   molten_quit(connection_t *con);
+void   molten_recorder(connection_t *con);
 void   molten_stats(connection_t *con);
 
 /// commands.c
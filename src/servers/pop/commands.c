@@ -20,21 +20,36 @@ int_t pop_compare(const void *compare, const void *command) {
 }
 
 /**
- * @brief	Sort the POP3 command table to be ready for binary searches.
+ * @brief	Sort the POP3 command table to be ready for binary searches, and allocate a latency histogram for each command.
  * @return	This function returns no value.
  */
 void pop_sort(void) {
 	qsort(pop_commands, sizeof(pop_commands) / sizeof(pop_commands[0]), sizeof(command_t), &pop_compare);
+
+	for (size_t i = 0; i < sizeof(pop_commands) / sizeof(pop_commands[0]); i++) {
+		if (!pop_commands[i].latency) pop_commands[i].latency = latency_alloc("pop", pop_commands[i].string, pop_commands[i].length);
+	}
+
 	return;
 }
 
 void pop_requeue(connection_t *con) {
 
+	// The command has finished, so record how long it took.
+	if (con->command) {
+		recorder_event(RECORDER_COMMAND_END, 0, (uintptr_t)con->command->string);
+	}
+
+	if (con->protocol.dispatched) {
+		latency_record(con->command ? con->command->latency : NULL, con->protocol.dispatched);
+		con->protocol.dispatched = 0;
+	}
+
 	if (!status() || con_status(con) < 0 || con->protocol.violations > con->server->violations.cutoff) {
 		enqueue(&pop_quit, con);
 	}
 	else {
-		enqueue(&pop_process, con);
+		con_events_wait(con, &pop_process);
 	}
 
 	return;
@@ -56,7 +71,7 @@ void pop_process(connection_t *con) {
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&pop_process, con);
+		con_events_wait(con, &pop_process);
 		return;
 	}
 
@@ -67,11 +82,17 @@ void pop_process(connection_t *con) {
 
 		con->command = command;
 		con->protocol.spins = 0;
+		con->protocol.dispatched = command->latency ? perf_rdtsc() : 0;
+		recorder_event(RECORDER_COMMAND_START, 0, (uintptr_t)command->string);
 
 		if (command->function == &pop_quit) {
 			con->pop.expunge = true;
 			enqueue(command->function, con);
 		}
+		// The TLS handshake is handed off to its own pool, so the command requeues the connection itself.
+		else if (command->function == &pop_starttls) {
+			enqueue(command->function, con);
+		}
 		else {
 			requeue(command->function, &pop_requeue, con);
 		}
@@ -12,6 +12,7 @@
 /**
  * @brief	Initialize a TLS session for an unauthenticated POP3 session.
  * @note	RFC 2595 / section 4 dictates that the STLS/STARTTLS command should only be available in the authorization state.
+ * 			The handshake is performed by the handshake pool, so this command requeues the connection itself.
  * @param	con		the connection of the POP3 client requesting the transport layer security upgrade.
  * @return	This function returns no value (all error messages are written directly to the requesting client).
  */
@@ -19,23 +20,39 @@ void pop_starttls(connection_t *con) {
 
 	if (con->pop.session_state != 0) {
 		pop_invalid(con);
+		pop_requeue(con);
 		return;
 	}
 	else if (con_secure(con) == 1) {
 		con_write_bl(con, "-ERR Session is already encrypted.\r\n", 36);
+		pop_requeue(con);
 		return;
 	}
 	else if (con_secure(con) == -1) {
 		con_write_bl(con, "-ERR This server has not been configured to support STLS.\r\n", 59);
+		pop_requeue(con);
 		return;
 	}
 
 	// Tell the user that we are ready to start the negotiation.
 	con_write_bl(con, "+OK Ready to start TLS negotiation.\r\n", 37);
+	con_flush(con);
 
-	if (!(con->network.tls = tls_server_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
+	con_secure_enqueue(con, &pop_starttls_complete);
+	return;
+}
+
+/**
+ * @brief	Finish a POP3 STLS/STARTTLS command, once the handshake pool has attempted the TLS handshake.
+ * @param	con		the connection of the POP3 client requesting the transport layer security upgrade.
+ * @return	This function returns no value.
+ */
+void pop_starttls_complete(connection_t *con) {
+
+	if (!con->network.tls) {
 		con_write_bl(con, "-ERR STARTTLS FAILED\r\n", 22);
 		log_pedantic("The TLS connection attempt failed.");
+		pop_requeue(con);
 		return;
 	}
 
@@ -44,6 +61,7 @@ void pop_starttls(connection_t *con) {
 	con->network.line = pl_null();
 	con->network.status = 1;
 	pop_session_reset(con);
+	pop_requeue(con);
 
 	return;
 }
@@ -67,7 +85,7 @@ void pop_noop(connection_t *con) {
 void pop_invalid(connection_t *con) {
 
 	con->protocol.violations++;
-	usleep(con->server->violations.delay);
+	con->protocol.delay = con->server->violations.delay;
 	con_write_bl(con, "-ERR Unrecognized command.\r\n", 28);
 
 	return;
@@ -486,7 +504,7 @@ void pop_dele(connection_t *con) {
 		con_write_bl(con, "-ERR Message already deleted.\r\n", 31);
 	}
 	else {
-		active->status += MAIL_STATUS_HIDDEN;
+		meta_index_status(con->pop.user, active, active->status | MAIL_STATUS_HIDDEN);
 		con_write_bl(con, "+OK Message marked for deletion.\r\n", 34);
 	}
 
@@ -39,6 +39,7 @@ void   pop_quit(connection_t *con);
 void   pop_retr(connection_t *con);
 void   pop_rset(connection_t *con);
 void   pop_starttls(connection_t *con);
+void   pop_starttls_complete(connection_t *con);
 void   pop_stat(connection_t *con);
 void   pop_top(connection_t *con);
 void   pop_uidl(connection_t *con);
@@ -29,7 +29,7 @@ int_t pop_session_reset(connection_t *con) {
 		while ((active = inx_cursor_value_next(cursor))) {
 
 			if ((active->status & MAIL_STATUS_HIDDEN) == MAIL_STATUS_HIDDEN) {
-				active->status -= MAIL_STATUS_HIDDEN;
+				meta_index_status(con->pop.user, active, active->status & ~MAIL_STATUS_HIDDEN);
 			}
 
 		}
@@ -49,6 +49,7 @@ int_t pop_session_reset(connection_t *con) {
  */
 void pop_session_destroy(connection_t *con) {
 
+	uint64_t foldernum;
 	bool_t deleted = false;
 	inx_cursor_t *cursor;
 	meta_message_t *active;
@@ -69,7 +70,9 @@ void pop_session_destroy(connection_t *con) {
 					if ((active->status & MAIL_STATUS_HIDDEN) == MAIL_STATUS_HIDDEN) {
 						mail_remove_message(con->pop.user->usernum, active->messagenum, active->size, active->server);
 						key.val.u64 = active->messagenum;
+						foldernum = active->foldernum;
 						inx_delete(con->pop.user->messages, key);
+						meta_index_remove(con->pop.user, foldernum, key.val.u64);
 						deleted = true;
 					}
 
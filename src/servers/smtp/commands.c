@@ -20,21 +20,36 @@ int_t smtp_compare(const void *compare, const void *command) {
 }
 
 /**
- * @brief	Sort the SMTP command table to be ready for binary searches.
+ * @brief	Sort the SMTP command table to be ready for binary searches, and allocate a latency histogram for each command.
  * @return	This function returns no value.
  */
 void smtp_sort(void) {
 	qsort(smtp_commands, sizeof(smtp_commands) / sizeof(smtp_commands[0]), sizeof(command_t), &smtp_compare);
+
+	for (size_t i = 0; i < sizeof(smtp_commands) / sizeof(smtp_commands[0]); i++) {
+		if (!smtp_commands[i].latency) smtp_commands[i].latency = latency_alloc("smtp", smtp_commands[i].string, smtp_commands[i].length);
+	}
+
 	return;
 }
 
 void smtp_requeue(connection_t *con) {
 
+	// The command has finished, so record how long it took.
+	if (con->command) {
+		recorder_event(RECORDER_COMMAND_END, 0, (uintptr_t)con->command->string);
+	}
+
+	if (con->protocol.dispatched) {
+		latency_record(con->command ? con->command->latency : NULL, con->protocol.dispatched);
+		con->protocol.dispatched = 0;
+	}
+
 	if (!status() || con_status(con) < 0 || con->protocol.violations > con->server->violations.cutoff) {
-		enqueue(&smtp_quit, con);
+		enqueue_priority(con_priority(con), &smtp_quit, con);
 	}
 	else {
-		enqueue(&smtp_process, con);
+		con_events_wait(con, &smtp_process);
 	}
 
 	return;
@@ -51,17 +66,17 @@ void smtp_process(connection_t *con) {
 
 	if (con_read_line(con, true) < 0) {
 		con->command = NULL;
-		enqueue(&smtp_quit, con);
+		enqueue_priority(con_priority(con), &smtp_quit, con);
 		return;
 	}
 	else if (pl_empty(con->network.line) && ((con->protocol.spins++) + con->protocol.violations) > con->server->violations.cutoff) {
 		con->command = NULL;
-		enqueue(&smtp_quit, con);
+		enqueue_priority(con_priority(con), &smtp_quit, con);
 		return;
 	}
 	else if (pl_empty(con->network.line)) {
 		con->command = NULL;
-		enqueue(&smtp_process, con);
+		con_events_wait(con, &smtp_process);
 		return;
 	}
 
@@ -71,20 +86,22 @@ void smtp_process(connection_t *con) {
 	if ((command = bsearch(&client, smtp_commands, sizeof(smtp_commands) / sizeof(smtp_commands[0]), sizeof(command_t), smtp_compare))) {
 		con->command = command;
 		con->protocol.spins = 0;
+		con->protocol.dispatched = command->latency ? perf_rdtsc() : 0;
+		recorder_event(RECORDER_COMMAND_START, 0, (uintptr_t)command->string);
 
 		// If the DATA and QUIT commands need control over the requeue process. If the DATA command is successful it will enqueue the
 		// inbound or outbound processor instead the command processor, and the QUIT command destroys a connection thereby eliminating the need
-		// to enqueue it.
-		if (command->function == &smtp_data || command->function == &smtp_quit) {
-			enqueue(command->function, con);
+		// to enqueue it. The STARTTLS command hands the connection to the handshake pool, and requeues it once the handshake finishes.
+		if (command->function == &smtp_data || command->function == &smtp_quit || command->function == &smtp_starttls) {
+			enqueue_priority(con_priority(con), command->function, con);
 		}
 		else {
-			requeue(command->function, &smtp_requeue, con);
+			requeue_priority(con_priority(con), command->function, &smtp_requeue, con);
 		}
 	}
 	else {
 		con->command = NULL;
-		requeue(&smtp_invalid, &smtp_requeue, con);
+		requeue_priority(con_priority(con), &smtp_invalid, &smtp_requeue, con);
 	}
 	return;
 }
@@ -0,0 +1,313 @@
+
+/**
+ * @file /magma/servers/smtp/data.c
+ *
+ * @brief	Functions used to scan the message data sent by a client after the DATA command.
+ *
+ * The scanner looks for line feeds using SIMD comparisons, and only stops at the line feeds which need attention: bare line feeds
+ * that need a carriage return, and line feeds followed by a period, which may be dot stuffed or the end of the message. Everything
+ * between those points is copied in bulk. Inside the header, every line feed is examined, so the blank line ending the header can
+ * be found, and non-ASCII bytes are dropped.
+ */
+
+#include "magma.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief	Find the next line feed, or non-ASCII byte, using a byte at a time loop.
+ * @param	data	the data being scanned.
+ * @param	from	the offset where the scan starts.
+ * @param	length	the length of the data.
+ * @return	the offset of the byte found, or length if there wasn't one.
+ */
+size_t smtp_data_find_header_scalar(uchr_t *data, size_t from, size_t length) {
+
+	for (size_t i = from; i < length; i++) {
+		if (data[i] == '\n' || data[i] >= 0x80) return i;
+	}
+
+	return length;
+}
+
+/**
+ * @brief	Find the next line feed which isn't preceded by a carriage return, or is followed by a period, using a byte at a time loop.
+ * @note	A line feed at the very start or end of the data is always returned, since the neighboring byte isn't available.
+ * @param	data	the data being scanned.
+ * @param	from	the offset where the scan starts.
+ * @param	length	the length of the data.
+ * @return	the offset of the line feed found, or length if there wasn't one.
+ */
+size_t smtp_data_find_body_scalar(uchr_t *data, size_t from, size_t length) {
+
+	for (size_t i = from; i < length; i++) {
+		if (data[i] == '\n' && (i == 0 || data[i - 1] != '\r' || i + 1 == length || data[i + 1] == '.')) return i;
+	}
+
+	return length;
+}
+
+#if defined(__SSE2__)
+
+/**
+ * @brief	Find the next line feed, or non-ASCII byte, sixteen bytes at a time.
+ */
+size_t smtp_data_find_header_sse2(uchr_t *data, size_t from, size_t length) {
+
+	uint32_t mask;
+	size_t i = from;
+	__m128i chunk, lf = _mm_set1_epi8('\n');
+
+	for (; i + 16 <= length; i += 16) {
+
+		chunk = _mm_loadu_si128((__m128i *)(data + i));
+
+		// The sign bit of each byte is set for non-ASCII characters, so the chunk itself doubles as a mask.
+		if ((mask = (uint32_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf)) | _mm_movemask_epi8(chunk)))) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return smtp_data_find_header_scalar(data, i, length);
+}
+
+/**
+ * @brief	Find the next line feed which isn't preceded by a carriage return, or is followed by a period, sixteen bytes at a time.
+ */
+size_t smtp_data_find_body_sse2(uchr_t *data, size_t from, size_t length) {
+
+	uint32_t mask;
+	size_t i = from;
+	__m128i feeds, lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'), dot = _mm_set1_epi8('.');
+
+	// The comparisons look one byte behind, and one byte ahead, so the first byte is checked on its own.
+	if (i == 0 && length && data[0] == '\n') {
+		return 0;
+	}
+	else if (i == 0) {
+		i = 1;
+	}
+
+	for (; i + 17 <= length; i += 16) {
+
+		feeds = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i)), lf);
+
+		if ((mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(feeds, _mm_or_si128(
+			_mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i - 1)), cr), _mm_set1_epi8(-1)),
+			_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(data + i + 1)), dot)))))) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return smtp_data_find_body_scalar(data, i, length);
+}
+
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief	Find the next line feed, or non-ASCII byte, thirty two bytes at a time.
+ * @note	This function is only called if the processor supports AVX2.
+ */
+__attribute__((target("avx2"))) size_t smtp_data_find_header_avx2(uchr_t *data, size_t from, size_t length) {
+
+	uint32_t mask;
+	size_t i = from;
+	__m256i chunk, lf = _mm256_set1_epi8('\n');
+
+	for (; i + 32 <= length; i += 32) {
+
+		chunk = _mm256_loadu_si256((__m256i *)(data + i));
+
+		if ((mask = (uint32_t)(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, lf)) | _mm256_movemask_epi8(chunk)))) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return smtp_data_find_header_scalar(data, i, length);
+}
+
+/**
+ * @brief	Find the next line feed which isn't preceded by a carriage return, or is followed by a period, thirty two bytes at a time.
+ * @note	This function is only called if the processor supports AVX2.
+ */
+__attribute__((target("avx2"))) size_t smtp_data_find_body_avx2(uchr_t *data, size_t from, size_t length) {
+
+	uint32_t mask;
+	size_t i = from;
+	__m256i feeds, lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r'), dot = _mm256_set1_epi8('.');
+
+	if (i == 0 && length && data[0] == '\n') {
+		return 0;
+	}
+	else if (i == 0) {
+		i = 1;
+	}
+
+	for (; i + 33 <= length; i += 32) {
+
+		feeds = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)(data + i)), lf);
+
+		if ((mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(feeds, _mm256_or_si256(
+			_mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)(data + i - 1)), cr), _mm256_set1_epi8(-1)),
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)(data + i + 1)), dot)))))) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return smtp_data_find_body_scalar(data, i, length);
+}
+
+#endif
+
+struct {
+	size_t (*header)(uchr_t *data, size_t from, size_t length);
+	size_t (*body)(uchr_t *data, size_t from, size_t length);
+} smtp_data_finders = {
+	.header = NULL,
+	.body = NULL
+};
+
+/**
+ * @brief	Select the fastest scanning functions supported by the processor.
+ * @return	This function returns no value.
+ */
+void smtp_data_finders_init(void) {
+
+	size_t (*header)(uchr_t *data, size_t from, size_t length) = &smtp_data_find_header_scalar;
+	size_t (*body)(uchr_t *data, size_t from, size_t length) = &smtp_data_find_body_scalar;
+
+#if defined(__SSE2__)
+	header = &smtp_data_find_header_sse2;
+	body = &smtp_data_find_body_sse2;
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		header = &smtp_data_find_header_avx2;
+		body = &smtp_data_find_body_avx2;
+	}
+#endif
+
+	// Every thread arrives at the same answer, so the race to store the pointers is harmless.
+	__atomic_store_n(&smtp_data_finders.body, body, __ATOMIC_RELAXED);
+	__atomic_store_n(&smtp_data_finders.header, header, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Scan a block of message data, copying it into the output buffer, until the line holding a single period is found.
+ * @note	Leading periods are removed from dot stuffed lines, bare line feeds are given a carriage return, and non-ASCII bytes are
+ * 			dropped from the header. The terminating line isn't copied. The state should be initialized using SMTP_DATA_LINE_START,
+ * 			with the header flag set, and is updated so the next block can pick up where this one left off.
+ * @param	state	the scanner state.
+ * @param	input	the data to be scanned.
+ * @param	length	the length of the data.
+ * @param	output	the buffer receiving the message, which must have room for twice the input length.
+ * @param	written	a pointer to receive the number of bytes written to the output buffer.
+ * @return	the number of input bytes consumed, which will be less than length if the end of the message was found.
+ */
+size_t smtp_data_scan(smtp_data_t *state, uchr_t *input, size_t length, uchr_t *output, size_t *written) {
+
+	uchr_t *out = output;
+	size_t pos = 0, next;
+
+	if (!__atomic_load_n(&smtp_data_finders.header, __ATOMIC_ACQUIRE)) {
+		smtp_data_finders_init();
+	}
+
+	while (pos < length && !state->done) {
+
+		// The start of each line is handled one byte at a time, since a period or carriage return may need the byte after it.
+		switch (state->line) {
+
+			case (SMTP_DATA_LINE_START):
+				if (input[pos] == '.') {
+					state->line = SMTP_DATA_LINE_DOT;
+					pos++;
+					continue;
+				}
+				else if (state->header && input[pos] == '\r') {
+					state->line = SMTP_DATA_LINE_CR;
+					pos++;
+					continue;
+				}
+				else if (state->header && input[pos] == '\n') {
+					state->header = false;
+				}
+				break;
+
+			// A lone period ends the message, otherwise the leading period was added by the client and gets dropped.
+			case (SMTP_DATA_LINE_DOT):
+				if (input[pos] == '\n') {
+					state->done = true;
+					pos++;
+					continue;
+				}
+				else if (input[pos] == '\r') {
+					state->line = SMTP_DATA_LINE_DOT_CR;
+					pos++;
+					continue;
+				}
+				break;
+
+			case (SMTP_DATA_LINE_DOT_CR):
+				if (input[pos] == '\n') {
+					state->done = true;
+					pos++;
+					continue;
+				}
+				*out++ = '\r';
+				break;
+
+			// An empty line inside the header marks the start of the body.
+			case (SMTP_DATA_LINE_CR):
+				if (input[pos] == '\n') {
+					state->header = false;
+				}
+				*out++ = '\r';
+				break;
+		}
+
+		state->line = SMTP_DATA_LINE_MIDDLE;
+
+		// Copy everything up to the next byte that needs attention.
+		next = state->header ? smtp_data_finders.header(input, pos, length) : smtp_data_finders.body(input, pos, length);
+
+		if (next > pos) {
+			mm_copy(out, input + pos, next - pos);
+			out += next - pos;
+			pos = next;
+		}
+
+		if (pos == length) {
+			break;
+		}
+
+		// Make sure every line ends with a carriage return, then a line feed.
+		else if (input[pos] == '\n') {
+
+			if (!(out > output ? *(out - 1) == '\r' : state->carriage)) {
+				*out++ = '\r';
+			}
+
+			*out++ = '\n';
+			state->line = SMTP_DATA_LINE_START;
+		}
+
+		// Otherwise we stopped on a non-ASCII byte inside the header, which gets dropped.
+		pos++;
+	}
+
+	if (out > output) {
+		state->carriage = *(out - 1) == '\r';
+	}
+
+	*written = out - output;
+	return pos;
+}
@@ -11,6 +11,7 @@
 
 /**
  * @brief	Initialize a TLS session for an unauthenticated SMTP session.
+ * @note	The handshake is performed by the handshake pool, so this command requeues the connection itself.
  * @param	con		the connection of the SMTP endpoint requesting the transport layer security upgrade.
  * @return	This function returns no value.
  */
@@ -19,19 +20,34 @@ void smtp_starttls(connection_t *con) {
 	// Check for an existing TLS connection.
 	if (con_secure(con) == 1) {
 		con_write_bl(con, "454 Session is already encrypted.\r\n", 35);
+		smtp_requeue(con);
 		return;
 	}
 	// Check whether we support the STARTTLS command.
 	else if (con_secure(con) == -1) {
 		con_write_bl(con, "554 This server has not been configured to support STARTTLS.\r\n", 62);
+		smtp_requeue(con);
 		return;
 	}
 
 	con_write_bl(con, "220 READY\r\n", 11);
+	con_flush(con);
+
+	con_secure_enqueue(con, &smtp_starttls_complete);
+	return;
+}
+
+/**
+ * @brief	Finish an SMTP STARTTLS command, once the handshake pool has attempted the TLS handshake.
+ * @param	con		the connection of the SMTP endpoint requesting the transport layer security upgrade.
+ * @return	This function returns no value.
+ */
+void smtp_starttls_complete(connection_t *con) {
 
-	if (!(con->network.tls = tls_server_alloc(con->server, con->network.sockd, M_SSL_BIO_NOCLOSE))) {
+	if (!con->network.tls) {
 		con_write_bl(con, "454 STARTTLS FAILED\r\n", 21);
 		log_pedantic("The SSL connection attempt failed.");
+		smtp_requeue(con);
 		return;
 	}
 
@@ -40,6 +56,7 @@ void smtp_starttls(connection_t *con) {
 	con->network.line = pl_null();
 	con->network.status = 1;
 	smtp_session_reset(con);
+	smtp_requeue(con);
 
 	return;
 }
@@ -163,7 +180,7 @@ void smtp_noop(connection_t *con) {
 void smtp_disabled(connection_t *con) {
 
 	con->protocol.violations++;
-	usleep(con->server->violations.delay);
+	con->protocol.delay = con->server->violations.delay;
 	con_print(con, "502 %.*s DISABLED\r\n", (int)con->command->length, con->command->string);
 
 	return;
@@ -176,7 +193,7 @@ void smtp_disabled(connection_t *con) {
 void smtp_invalid(connection_t *con) {
 
 	con->protocol.violations++;
-	usleep(con->server->violations.delay);
+	con->protocol.delay = con->server->violations.delay;
 	con_write_bl(con, "500 INVALID COMMAND\r\n", 21);
 
 	return;
@@ -815,126 +832,63 @@ void smtp_data_finish(connection_t *con, size_t read, int_t checker) {
 
 int_t smtp_data_read(connection_t *con, stringer_t **message) {
 
-	chr_t *stream, *buffer;
+	int64_t read = 0;
 	stringer_t *result, *holder;
-	int_t read = 0, increment;
-	size_t used = 0, size = 128 * 1024;
-	int_t header = 1, checker = 1, carriage = 0;
+	size_t used = 0, size, consumed, written;
+	smtp_data_t state = {
+		.line = SMTP_DATA_LINE_START,
+		.header = true,
+		.carriage = false,
+		.done = false
+	};
 
 	// In case we end early.
 	*message = NULL;
-	stream = st_data_get(con->network.buffer);
 
-	// Expand the stringer in 128 KB chunks.
+	// If the client declared the message size using the SIZE parameter, allocate enough space to hold the entire message up front. Room
+	// is also left for the worst case expansion of a full network buffer, so a well behaved client never triggers a reallocation.
+	size = (con->smtp.suggested_length && con->smtp.suggested_length <= con->smtp.max_length ? con->smtp.suggested_length : 128 * 1024) +
+		(st_avail_get(con->network.buffer) * 2) + 1;
+
 	if (!(result = st_alloc_opts(MAPPED_T | JOINTED | HEAP, size))) {
-		smtp_data_finish(con, 0, checker);
+		smtp_data_finish(con, 0, SMTP_DATA_LINE_START);
 		return -1;
 	}
 
-	// Setup the pointer into the stringer.
-	buffer = st_char_get(result);
 	read = con_read(con);
 
-	while (checker != 4 && read > 0 && status()) {
-
-		// Setup the stream.
-		stream = st_data_get(con->network.buffer);
+	while (!state.done && read > 0 && status()) {
 
 		// Size check.
 		if ((read + used) > con->smtp.max_length) {
 			log_pedantic("Message exceeded size limit of %zu bytes. Reading till the end, and then returning an error.", con->smtp.max_length);
-			smtp_data_finish(con, read, checker);
+			smtp_data_finish(con, read, state.line <= SMTP_DATA_LINE_DOT_CR ? state.line : SMTP_DATA_LINE_MIDDLE);
 			st_free(result);
 			return -2;
 		}
 
-		// Read in the new data.
-		for (increment = 0; checker != 4 && increment < read; increment++) {
-
-			// Logic for detecting header mode.
-			if (header != 3) {
-				if (header == 0 && *stream == '\n') {
-					header++;
-				}
-				else if (header == 1 && *stream == '\n') {
-					header += 2;
-				}
-				else if (header == 1 && *stream == '\r') {
-					header++;
-				}
-				else if (header == 2 && *stream == '\n') {
-					header++;
-				}
-				else if (header != 0) {
-					header = 0;
-				}
-			}
+		// Make sure we have enough room for the worst case, which is a buffer full of bare line feeds that each need a carriage return.
+		if (used + (read * 2) + 1 > size) {
 
-			// Logic for detecting the end of a message.
-			if (checker == 0 && *stream == '\n') {
-				checker++;
-			}
-			else if (checker == 1 && *stream == '.') {
-				checker++;
-			}
-			else if (checker == 2 && *stream == '\n') {
-				checker += 2;
-			}
-			else if (checker == 2 && *stream == '\r') {
-				checker++;
-			}
-			else if (checker == 3 && *stream == '\n') {
-				checker++;
-			}
-			else if (*stream == '\n') {
-				checker = 1;
-			}
-			else if (checker != 0) {
-				checker = 0;
-			}
+			size = (size * 2) > (used + (read * 2) + 1) ? (size * 2) : (used + (read * 2) + 1);
 
-			// Make sure every line ends with a carriage return, then line break.
-			if (*stream == '\n' && carriage == 0) {
-				*buffer++ = '\r';
-				used++;
-			}
-			else if (*stream == '\r') {
-				carriage = 1;
-			}
-			else if (carriage != 0) {
-				carriage = 0;
+			if (!(holder = st_realloc(result, size))) {
+				log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Returning an error to the client.", size);
+				smtp_data_finish(con, read, state.line <= SMTP_DATA_LINE_DOT_CR ? state.line : SMTP_DATA_LINE_MIDDLE);
+				st_free(result);
+				return -1;
 			}
 
-			// In header mode, we only read in ASCII (0x00 to 0x7F) characters.
-			if (header != 3 && *stream >= 0) {
-				*buffer++ = *stream;
-				used++;
-			}
-			// Otherwise we read in anything.
-			else if (header == 3) {
-				*buffer++ = *stream;
-				used++;
-			}
+			result = holder;
+		}
 
-			// Make sure we have enough room in the buffer.
-			if (used + 32 > size) {
-				if ((holder = st_realloc(result, size + (128 * 1024))) == NULL) {
-					log_pedantic("Attempted to allocate a buffer of %zu bytes to hold an incoming message, and failed. Returning an error to the client.", size + (128 * 1024));
-					smtp_data_finish(con, read, checker);
-					st_free(result);
-					return -1;
-				}
-
-				// Setup the pointers again.
-				size += 128 * 1024;
-				result = holder;
-				buffer = st_char_get(result) + used;
-			}
+		consumed = smtp_data_scan(&state, st_data_get(con->network.buffer), read, st_data_get(result) + used, &written);
+		used += written;
 
-			stream++;
-		}
+		// Mark the data we processed, so anything left over, like a pipelined command, will be returned by the next read.
+		con->network.line = pl_init(st_data_get(con->network.buffer), consumed);
 
-		if (checker != 4) {
+		if (!state.done) {
 			read = con_read(con);
 		}
 	}
@@ -949,12 +903,6 @@ int_t smtp_data_read(connection_t *con, stringer_t **message) {
 		return -4;
 	}
 
-	// So that read line will get anything left in buffer.
-	if ((stream - st_char_get(con->network.buffer)) < read) {
-		st_data_set(&(con->network.line), st_data_get(con->network.buffer));
-		st_length_set(&(con->network.line), stream - st_char_get(con->network.buffer));
-	}
-
 	// Setup the output.
 	st_length_set(result, used);
 	*message = result;
@@ -1200,10 +1148,10 @@ void smtp_data(connection_t *con) {
 	con->smtp.message = message;
 
 	if (con->smtp.authenticated == true) {
-		requeue(&smtp_data_outbound, &smtp_requeue, con);
+		requeue_priority(con_priority(con), &smtp_data_outbound, &smtp_requeue, con);
 	}
 	else {
-		requeue(&smtp_data_inbound, &smtp_requeue, con);
+		requeue_priority(con_priority(con), &smtp_data_inbound, &smtp_requeue, con);
 	}
 
 	return;
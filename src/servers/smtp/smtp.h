@@ -27,6 +27,12 @@ int_t   smtp_compare(const void *compare, const void *command);
 void    smtp_process(connection_t *con);
 void    smtp_sort(void);
 
+/// data.c
+size_t  smtp_data_find_body_scalar(uchr_t *data, size_t from, size_t length);
+size_t  smtp_data_find_header_scalar(uchr_t *data, size_t from, size_t length);
+void    smtp_data_finders_init(void);
+size_t  smtp_data_scan(smtp_data_t *state, uchr_t *input, size_t length, uchr_t *output, size_t *written);
+
 /// datatier.c
 int_t         smtp_check_authorized_from(uint64_t usernum, stringer_t *address);
 int_t         smtp_check_receive_quota(connection_t *con, smtp_inbound_prefs_t *prefs);
@@ -56,6 +62,7 @@ void   smtp_quit(connection_t *con);
 void   smtp_rcpt_to(connection_t *con);
 void   smtp_rset(connection_t *con);
 void   smtp_starttls(connection_t *con);
+void   smtp_starttls_complete(connection_t *con);
 void   submission_init(connection_t *con);
 
 /// parse.c
@@ -1273,13 +1273,13 @@ void portal_endpoint_messages_flag(connection_t *con) {
 				while ((active = inx_cursor_value_next(cursor))) {
 					switch (action) {
 					case (PORTAL_ENDPOINT_ACTION_ADD):
-						active->status = active->status | bits;
+						meta_index_status(con->http.session->user, active, active->status | bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_REMOVE):
-						active->status = (active->status | bits) ^ bits;
+						meta_index_status(con->http.session->user, active, (active->status | bits) ^ bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_REPLACE):
-						active->status = ((active->status | MAIL_STATUS_USER_FLAGS) ^ MAIL_STATUS_USER_FLAGS) | bits;
+						meta_index_status(con->http.session->user, active, ((active->status | MAIL_STATUS_USER_FLAGS) ^ MAIL_STATUS_USER_FLAGS) | bits);
 						break;
 					case (PORTAL_ENDPOINT_ACTION_LIST):
 						if (!(entry = json_pack_ex_d(&err, JSON_ENSURE_ASCII, "{s:I, s:o}", "messageID", active->messagenum, "flags", portal_message_flags_array(active)))) {
@@ -1480,6 +1480,7 @@ void portal_endpoint_messages_remove(connection_t *con) {
 			} else {
 				// Remove the message from the mailbox context.
 				inx_delete(con->http.session->user->messages, key);
+				meta_index_remove(con->http.session->user, folder, key.val.u64);
 			}
 
 		}
@@ -21,6 +21,14 @@ void statistics_process(connection_t *con) {
 	stringer_t *raw;
 	struct tm tm_time;
 	http_page_t *page;
+	latency_t *histogram;
+	struct {
+		chr_t *name, *id;
+	} commands[] = { { "imap.fetch", "imap_fetch" }, { "imap.search", "imap_search" }, { "smtp.data", "smtp_data" }, { "pop.retr", "pop_retr" } };
+	struct {
+		chr_t *suffix;
+		uint64_t permille;
+	} percentiles[] = { { "p50", 500 }, { "p90", 900 }, { "p99", 990 }, { "p999", 999 } };
 
 	if (!(page = http_page_get("statistics/statistics"))) {
 		http_print_500(con);
@@ -50,6 +58,18 @@ void statistics_process(connection_t *con) {
 	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_today']", portal_stats[portal_stat_users_registered_today].val);
 	xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)"//xhtml:td[@id='users_registered_week']", portal_stats[portal_stat_users_registered_week].val);
 
+	// The command latencies are reported in microseconds.
+	for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+
+		histogram = latency_find(commands[i].name);
+
+		for (size_t j = 0; j < sizeof(percentiles) / sizeof(percentiles[0]); j++) {
+			snprintf(buffer, 256, "//xhtml:td[@id='%s_%s']", commands[i].id, percentiles[j].suffix);
+			xml_set_xpath_uint64(page->xpath_ctx, (xmlChar *)buffer, (latency_percentile(histogram, percentiles[j].permille) + 999) / 1000);
+		}
+
+	}
+
 	if (!(raw = xml_dump_doc(page->doc_obj))) {
 		http_print_500(con);
 		http_page_free(page);